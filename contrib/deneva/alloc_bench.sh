@@ -0,0 +1,72 @@
+#!/bin/bash
+
+# Throughput and peak RSS of the server with glibc malloc, with jemalloc, and with the slab
+# allocator of mem_alloc.cpp behind THREAD_ALLOC and PART_ALLOC, on YCSB and TPCC, one server and
+# one client on this machine. The server is built with -O2 and without ASan, which would replace
+# malloc. Run from contrib/deneva:
+#
+#     ./alloc_bench.sh [WORKLOAD...]
+#
+# jemalloc is preloaded from JEMALLOC, by default the libjemalloc ldconfig knows; without one its
+# runs are skipped. config.h and ifconfig.txt are restored on exit, also when a build fails or the
+# script is interrupted. Results go to alloc_bench/.
+
+workloads=${@:-"YCSB TPCC"}
+jemalloc=${JEMALLOC:-$(ldconfig -p | awk '/libjemalloc\.so/ { print $NF; exit }')}
+out=alloc_bench
+mkdir -p $out
+cp config.h $out/config.h.orig
+rm -f $out/ifconfig.txt.orig
+[ -f ifconfig.txt ] && cp ifconfig.txt $out/ifconfig.txt.orig
+
+restore() {
+    cp $out/config.h.orig config.h
+    if [ -f $out/ifconfig.txt.orig ]; then
+        cp $out/ifconfig.txt.orig ifconfig.txt
+    else
+        rm -f ifconfig.txt
+    fi
+}
+trap restore EXIT
+printf "127.0.0.1\n127.0.0.1\n" > ifconfig.txt
+
+for wl in $workloads
+do
+    for alloc in malloc jemalloc THREAD_ALLOC PART_ALLOC
+    do
+        preload=""
+        if [ $alloc = jemalloc ]; then
+            if [ -z "$jemalloc" ]; then
+                echo "$wl $alloc: no libjemalloc, set JEMALLOC"
+                continue
+            fi
+            preload=$jemalloc
+        fi
+        cp $out/config.h.orig config.h
+        sed -i -e "s/^#define WORKLOAD .*/#define WORKLOAD ${wl}/" \
+               -e "s/^#define THREAD_ALLOC .*/#define THREAD_ALLOC false/" \
+               -e "s/^#define PART_ALLOC .*/#define PART_ALLOC false/" \
+               -e "s/^#define NODE_CNT .*/#define NODE_CNT 1/" \
+               -e "s/^#define CLIENT_NODE_CNT .*/#define CLIENT_NODE_CNT 1/" config.h
+        if [ $alloc = THREAD_ALLOC ] || [ $alloc = PART_ALLOC ]; then
+            sed -i "s/^#define ${alloc} .*/#define ${alloc} true/" config.h
+        fi
+        make clean > /dev/null
+        # gcc 12 at -O2 warns of maybe uninitialized results in client_txn.cpp, row_dta.cpp and
+        # row_ts.cpp, which -Werror would turn into errors
+        make -j BUILD_FLAGS="-g -O2 -Wno-maybe-uninitialized" > /dev/null || exit 1
+
+        LD_PRELOAD=$preload /usr/bin/time -f "%M" -o $out/${wl}_${alloc}_rss \
+            ./rundb -nid0 > $out/${wl}_${alloc}_server.txt &
+        server=$!
+        ./runcl -nid1 > $out/${wl}_${alloc}_client.txt &
+        client=$!
+        wait $server $client
+
+        rss=$(tail -1 $out/${wl}_${alloc}_rss)
+        grep "\[summary\]" $out/${wl}_${alloc}_server.txt | tr ',' '\n' | awk -F= \
+            -v wl=$wl -v alloc=$alloc -v rss=$rss '
+            $1 == "tput" { tput = $2 }
+            END { printf "%s %s: tput=%f peak_rss=%dKB\n", wl, alloc, tput, rss }'
+    done
+done
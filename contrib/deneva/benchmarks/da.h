@@ -3,6 +3,7 @@
 #include "config.h"
 #include "query.h"
 #include "row.h"
+#include "schema_layout.h"
 #include "txn.h"
 #include "wl.h"
 #include "creator.h"
@@ -67,7 +67,7 @@ RC DATxnManager::process_query(const DAQuery* const da_query) {
                 row_t* TempRow = ((row_t *)item->location);
                 rc = get_row(TempRow, WR, row);
                 if (rc == RCOK) {
-                    row->set_value(VALUE, version);
+                    write_field<da_schema::DAtab::value>(row, version);
                 } else if (rc == Abort){
                     rc = start_abort();
                     already_abort_tab.insert(trans_id);
@@ -80,7 +80,7 @@ RC DATxnManager::process_query(const DAQuery* const da_query) {
                 row_t* TempRow = ((row_t *)item->location);
                 rc = get_row(TempRow, RD, row);
                 if (rc == RCOK) {
-                    row->get_value(VALUE, value[0]);
+                    value[0] = row->get_field<da_schema::DAtab::value>();
                 } else if (rc == Abort) {
                     rc = start_abort();
                     already_abort_tab.insert(trans_id);
@@ -104,7 +104,7 @@ RC DATxnManager::process_query(const DAQuery* const da_query) {
                     TempRow = ((row_t *)item->location);
                     rc = get_row(TempRow, SCAN, row);
                     if (rc == RCOK) {
-                        row->get_value(VALUE, value[i]);
+                        value[i] = row->get_field<da_schema::DAtab::value>();
                     } else if (rc == Abort) {
                         rc = start_abort();
                         already_abort_tab.insert(trans_id);
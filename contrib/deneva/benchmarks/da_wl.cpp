@@ -45,6 +45,7 @@ RC DAWorkload::init_schema(const char *schema_file) {
   printf("base Workload init_schema over");
   t_datab = tables["DAtab"];
   i_datab = indexes["DAtab_IDX"];
+  check_layouts(da_schema::layouts);
   return RCOK;
 }
 
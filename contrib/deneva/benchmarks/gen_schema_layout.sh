@@ -0,0 +1,69 @@
+#!/bin/sh
+# Generate the compiled table layouts (see row_field in storage/catalog.h) from the schema files.
+# The tables of <NAME>_schema.txt go to namespace <name>_schema. Run from contrib/deneva:
+#
+#     sh benchmarks/gen_schema_layout.sh > benchmarks/schema_layout.h
+#
+# The Makefile does this when a schema file changes.
+
+cd "$(dirname "$0")" || exit 1
+export LC_ALL=C
+
+cat <<'EOF'
+// Generated by benchmarks/gen_schema_layout.sh from benchmarks/*_schema.txt, do not edit.
+
+#ifndef _SCHEMA_LAYOUT_H_
+#define _SCHEMA_LAYOUT_H_
+
+#include "global.h"
+#include "catalog.h"
+EOF
+
+for file in *_schema.txt; do
+    awk -v ns="$(echo "${file%.txt}" | tr 'A-Z' 'a-z')" '
+    function end_table() {
+        if (table == "") return
+        printf "    static constexpr uint32_t tuple_size = %d;\n", offset
+        printf "    static constexpr row_column columns[] = {\n%s    };\n", columns
+        printf "    static constexpr row_layout layout = {\"%s\", %d, %d, columns};\n", table, offset,
+               field_cnt
+        printf "};\n\n"
+        layouts = layouts "    " ident "::layout,\n"
+        table = ""
+    }
+    BEGIN { printf "\nnamespace %s {\n\n", ns }
+    { sub(/\r$/, "") }
+    /^TABLE=/ {
+        end_table()
+        table = substr($0, 7)
+        ident = table
+        gsub(/[^A-Za-z0-9_]/, "_", ident)
+        offset = 0
+        field_cnt = 0
+        columns = ""
+        printf "struct %s {\n", ident
+        next
+    }
+    /^INDEX=/ || /^[ \t]*$/ { end_table(); next }
+    table != "" {
+        split($0, f, ",")
+        size = f[1] + 0
+        type = f[2]
+        name = f[3]
+        gsub(/[ \t]/, "", type)
+        gsub(/[ \t]/, "", name)
+        if (type == "string") type = "char"
+        printf "    typedef row_field<%d, %d, %s> %s;\n", offset, size, type, name
+        columns = columns sprintf("        {\"%s\", %d, %d},\n", name, offset, size)
+        offset += size
+        field_cnt++
+    }
+    END {
+        end_table()
+        printf "static constexpr row_layout layouts[] = {\n%s};\n\n", layouts
+        printf "}\n"
+    }
+    ' "$file"
+done
+
+printf '\n#endif\n'
@@ -21,6 +21,7 @@
 #include "txn.h"
 #include "query.h"
 #include "row.h"
+#include "schema_layout.h"
 
 class PPSQuery;
 class PPSQueryMessage;
@@ -748,11 +748,7 @@ inline RC PPSTxnManager::run_getpartsbyproduct_3(uint64_t &part_key, row_t *& r_
   /*
     SELECT PART_KEY FROM USES WHERE PRODUCT_KEY = ?
    */
-  //r_local->get_value(PART_KEY,part_key);
-  //char * data __attribute__((unused));
-  //data = r_local->get_data();
-  // PART_KEY is located at column 1
-  r_local->get_value(1,part_key);
+  part_key = r_local->get_field<pps_schema::USES::PART_KEY>();
   DEBUG("Read part_key %ld\n",part_key);
   return RCOK;
 }
@@ -827,11 +823,7 @@ inline RC PPSTxnManager::run_orderproduct_3(uint64_t &part_key, row_t *& r_local
   /*
     SELECT PART_KEY FROM USES WHERE PRODUCT_KEY = ?
    */
-  //r_local->get_value(PART_KEY,part_key);
-  //char * data __attribute__((unused));
-  //data = r_local->get_data();
-  // PART_KEY is located at column 1
-  r_local->get_value(1,part_key);
+  part_key = r_local->get_field<pps_schema::USES::PART_KEY>();
   DEBUG("Read part_key %ld\n",part_key);
   return RCOK;
 }
@@ -859,8 +851,8 @@ inline RC PPSTxnManager::run_orderproduct_5(row_t *& r_local) {
   // update
   // If part_amount is 0, should abort
   uint64_t part_amount;
-  r_local->get_value(PART_AMOUNT,part_amount);
-  r_local->set_value(PART_AMOUNT,part_amount-1);
+  part_amount = r_local->get_field<pps_schema::PARTS::PART_AMOUNT>();
+  write_field<pps_schema::PARTS::PART_AMOUNT>(r_local, part_amount - 1);
   return RCOK;
 }
 
@@ -909,7 +901,7 @@ inline RC PPSTxnManager::run_getpartsbysupplier_3(uint64_t &part_key, row_t *& r
   /*
     SELECT PART_KEY FROM USES WHERE supplier_KEY = ?
    */
-    r_local->get_value(1,part_key);
+    part_key = r_local->get_field<pps_schema::SUPPLIES::PART_KEY>();
     DEBUG("Read part_key %ld\n",part_key);
     return RCOK;
 }
@@ -954,7 +946,7 @@ inline RC PPSTxnManager::run_updateproductpart_1(uint64_t part_key, row_t *& r_l
     UPDATE PART_KEY FROM PRODUCTS WHERE PRODUCT_KEY = ?
    */
   assert(r_local);
-  r_local->set_value(1,part_key);
+  write_field<pps_schema::USES::PART_KEY>(r_local, part_key);
   return RCOK;
 }
 
@@ -977,8 +969,8 @@ inline RC PPSTxnManager::run_updatepart_1(row_t *& r_local) {
    */
   assert(r_local);
   uint64_t amount;
-  r_local->get_value(1,amount);
-  r_local->set_value(1,amount+100);
+  amount = r_local->get_field<pps_schema::PARTS::PART_AMOUNT>();
+  write_field<pps_schema::PARTS::PART_AMOUNT>(r_local, amount + 100);
   return RCOK;
 }
 
@@ -27,6 +27,7 @@
 #include "query.h"
 #include "txn.h"
 #include "mem_alloc.h"
+#include "snapshot.h"
 
 RC PPSWorkload::init() {
     Workload::init();
@@ -46,7 +47,10 @@ RC PPSWorkload::init() {
   printf("Done\n");
   printf("Initializing table... ");
   fflush(stdout);
-    init_table();
+    if (!TableSnapshot::load(this)) {
+        init_table();
+        TableSnapshot::save(this);
+    }
   printf("Done\n");
   fflush(stdout);
     return RCOK;
@@ -65,6 +69,7 @@ RC PPSWorkload::init_schema(const char * schema_file) {
     i_products = indexes["PRODUCTS_IDX"];
     i_uses = indexes["USES_IDX"];
     i_supplies = indexes["SUPPLIES_IDX"];
+    check_layouts(pps_schema::layouts);
     return RCOK;
 }
 
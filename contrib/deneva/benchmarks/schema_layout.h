@@ -0,0 +1,654 @@
+// Generated by benchmarks/gen_schema_layout.sh from benchmarks/*_schema.txt, do not edit.
+
+#ifndef _SCHEMA_LAYOUT_H_
+#define _SCHEMA_LAYOUT_H_
+
+#include "global.h"
+#include "catalog.h"
+
+namespace pps_schema {
+
+struct PARTS {
+    typedef row_field<0, 8, int64_t> PART_KEY;
+    typedef row_field<8, 8, int64_t> PART_AMOUNT;
+    typedef row_field<16, 10, char> FIELD1;
+    typedef row_field<26, 10, char> FIELD2;
+    typedef row_field<36, 10, char> FIELD3;
+    typedef row_field<46, 10, char> FIELD4;
+    typedef row_field<56, 10, char> FIELD5;
+    typedef row_field<66, 10, char> FIELD6;
+    typedef row_field<76, 10, char> FIELD7;
+    typedef row_field<86, 10, char> FIELD8;
+    typedef row_field<96, 10, char> FIELD9;
+    typedef row_field<106, 10, char> FIELD10;
+    static constexpr uint32_t tuple_size = 116;
+    static constexpr row_column columns[] = {
+        {"PART_KEY", 0, 8},
+        {"PART_AMOUNT", 8, 8},
+        {"FIELD1", 16, 10},
+        {"FIELD2", 26, 10},
+        {"FIELD3", 36, 10},
+        {"FIELD4", 46, 10},
+        {"FIELD5", 56, 10},
+        {"FIELD6", 66, 10},
+        {"FIELD7", 76, 10},
+        {"FIELD8", 86, 10},
+        {"FIELD9", 96, 10},
+        {"FIELD10", 106, 10},
+    };
+    static constexpr row_layout layout = {"PARTS", 116, 12, columns};
+};
+
+struct PRODUCTS {
+    typedef row_field<0, 8, int64_t> PRODUCT_KEY;
+    typedef row_field<8, 10, char> FIELD1;
+    typedef row_field<18, 10, char> FIELD2;
+    typedef row_field<28, 10, char> FIELD3;
+    typedef row_field<38, 10, char> FIELD4;
+    typedef row_field<48, 10, char> FIELD5;
+    typedef row_field<58, 10, char> FIELD6;
+    typedef row_field<68, 10, char> FIELD7;
+    typedef row_field<78, 10, char> FIELD8;
+    typedef row_field<88, 10, char> FIELD9;
+    typedef row_field<98, 10, char> FIELD10;
+    static constexpr uint32_t tuple_size = 108;
+    static constexpr row_column columns[] = {
+        {"PRODUCT_KEY", 0, 8},
+        {"FIELD1", 8, 10},
+        {"FIELD2", 18, 10},
+        {"FIELD3", 28, 10},
+        {"FIELD4", 38, 10},
+        {"FIELD5", 48, 10},
+        {"FIELD6", 58, 10},
+        {"FIELD7", 68, 10},
+        {"FIELD8", 78, 10},
+        {"FIELD9", 88, 10},
+        {"FIELD10", 98, 10},
+    };
+    static constexpr row_layout layout = {"PRODUCTS", 108, 11, columns};
+};
+
+struct SUPPLIERS {
+    typedef row_field<0, 8, int64_t> SUPPLIER_KEY;
+    typedef row_field<8, 10, char> FIELD1;
+    typedef row_field<18, 10, char> FIELD2;
+    typedef row_field<28, 10, char> FIELD3;
+    typedef row_field<38, 10, char> FIELD4;
+    typedef row_field<48, 10, char> FIELD5;
+    typedef row_field<58, 10, char> FIELD6;
+    typedef row_field<68, 10, char> FIELD7;
+    typedef row_field<78, 10, char> FIELD8;
+    typedef row_field<88, 10, char> FIELD9;
+    typedef row_field<98, 10, char> FIELD10;
+    static constexpr uint32_t tuple_size = 108;
+    static constexpr row_column columns[] = {
+        {"SUPPLIER_KEY", 0, 8},
+        {"FIELD1", 8, 10},
+        {"FIELD2", 18, 10},
+        {"FIELD3", 28, 10},
+        {"FIELD4", 38, 10},
+        {"FIELD5", 48, 10},
+        {"FIELD6", 58, 10},
+        {"FIELD7", 68, 10},
+        {"FIELD8", 78, 10},
+        {"FIELD9", 88, 10},
+        {"FIELD10", 98, 10},
+    };
+    static constexpr row_layout layout = {"SUPPLIERS", 108, 11, columns};
+};
+
+struct USES {
+    typedef row_field<0, 8, int64_t> PRODUCT_KEY;
+    typedef row_field<8, 8, int64_t> PART_KEY;
+    static constexpr uint32_t tuple_size = 16;
+    static constexpr row_column columns[] = {
+        {"PRODUCT_KEY", 0, 8},
+        {"PART_KEY", 8, 8},
+    };
+    static constexpr row_layout layout = {"USES", 16, 2, columns};
+};
+
+struct SUPPLIES {
+    typedef row_field<0, 8, int64_t> SUPPLIER_KEY;
+    typedef row_field<8, 8, int64_t> PART_KEY;
+    static constexpr uint32_t tuple_size = 16;
+    static constexpr row_column columns[] = {
+        {"SUPPLIER_KEY", 0, 8},
+        {"PART_KEY", 8, 8},
+    };
+    static constexpr row_layout layout = {"SUPPLIES", 16, 2, columns};
+};
+
+static constexpr row_layout layouts[] = {
+    PARTS::layout,
+    PRODUCTS::layout,
+    SUPPLIERS::layout,
+    USES::layout,
+    SUPPLIES::layout,
+};
+
+}
+
+namespace tpcc_full_schema {
+
+struct WAREHOUSE {
+    typedef row_field<0, 8, int64_t> W_ID;
+    typedef row_field<8, 10, char> W_NAME;
+    typedef row_field<18, 20, char> W_STREET_1;
+    typedef row_field<38, 20, char> W_STREET_2;
+    typedef row_field<58, 20, char> W_CITY;
+    typedef row_field<78, 2, char> W_STATE;
+    typedef row_field<80, 9, char> W_ZIP;
+    typedef row_field<89, 8, double> W_TAX;
+    typedef row_field<97, 8, double> W_YTD;
+    static constexpr uint32_t tuple_size = 105;
+    static constexpr row_column columns[] = {
+        {"W_ID", 0, 8},
+        {"W_NAME", 8, 10},
+        {"W_STREET_1", 18, 20},
+        {"W_STREET_2", 38, 20},
+        {"W_CITY", 58, 20},
+        {"W_STATE", 78, 2},
+        {"W_ZIP", 80, 9},
+        {"W_TAX", 89, 8},
+        {"W_YTD", 97, 8},
+    };
+    static constexpr row_layout layout = {"WAREHOUSE", 105, 9, columns};
+};
+
+struct DISTRICT {
+    typedef row_field<0, 8, int64_t> D_ID;
+    typedef row_field<8, 8, int64_t> D_W_ID;
+    typedef row_field<16, 10, char> D_NAME;
+    typedef row_field<26, 20, char> D_STREET_1;
+    typedef row_field<46, 20, char> D_STREET_2;
+    typedef row_field<66, 20, char> D_CITY;
+    typedef row_field<86, 2, char> D_STATE;
+    typedef row_field<88, 9, char> D_ZIP;
+    typedef row_field<97, 8, double> D_TAX;
+    typedef row_field<105, 8, double> D_YTD;
+    typedef row_field<113, 8, int64_t> D_NEXT_O_ID;
+    static constexpr uint32_t tuple_size = 121;
+    static constexpr row_column columns[] = {
+        {"D_ID", 0, 8},
+        {"D_W_ID", 8, 8},
+        {"D_NAME", 16, 10},
+        {"D_STREET_1", 26, 20},
+        {"D_STREET_2", 46, 20},
+        {"D_CITY", 66, 20},
+        {"D_STATE", 86, 2},
+        {"D_ZIP", 88, 9},
+        {"D_TAX", 97, 8},
+        {"D_YTD", 105, 8},
+        {"D_NEXT_O_ID", 113, 8},
+    };
+    static constexpr row_layout layout = {"DISTRICT", 121, 11, columns};
+};
+
+struct CUSTOMER {
+    typedef row_field<0, 8, int64_t> C_ID;
+    typedef row_field<8, 8, int64_t> C_D_ID;
+    typedef row_field<16, 8, int64_t> C_W_ID;
+    typedef row_field<24, 16, char> C_FIRST;
+    typedef row_field<40, 2, char> C_MIDDLE;
+    typedef row_field<42, 16, char> C_LAST;
+    typedef row_field<58, 20, char> C_STREET_1;
+    typedef row_field<78, 20, char> C_STREET_2;
+    typedef row_field<98, 20, char> C_CITY;
+    typedef row_field<118, 2, char> C_STATE;
+    typedef row_field<120, 9, char> C_ZIP;
+    typedef row_field<129, 16, char> C_PHONE;
+    typedef row_field<145, 8, int64_t> C_SINCE;
+    typedef row_field<153, 2, char> C_CREDIT;
+    typedef row_field<155, 8, int64_t> C_CREDIT_LIM;
+    typedef row_field<163, 8, int64_t> C_DISCOUNT;
+    typedef row_field<171, 8, double> C_BALANCE;
+    typedef row_field<179, 8, double> C_YTD_PAYMENT;
+    typedef row_field<187, 8, uint64_t> C_PAYMENT_CNT;
+    typedef row_field<195, 8, uint64_t> C_DELIVERY_CNT;
+    typedef row_field<203, 500, char> C_DATA;
+    static constexpr uint32_t tuple_size = 703;
+    static constexpr row_column columns[] = {
+        {"C_ID", 0, 8},
+        {"C_D_ID", 8, 8},
+        {"C_W_ID", 16, 8},
+        {"C_FIRST", 24, 16},
+        {"C_MIDDLE", 40, 2},
+        {"C_LAST", 42, 16},
+        {"C_STREET_1", 58, 20},
+        {"C_STREET_2", 78, 20},
+        {"C_CITY", 98, 20},
+        {"C_STATE", 118, 2},
+        {"C_ZIP", 120, 9},
+        {"C_PHONE", 129, 16},
+        {"C_SINCE", 145, 8},
+        {"C_CREDIT", 153, 2},
+        {"C_CREDIT_LIM", 155, 8},
+        {"C_DISCOUNT", 163, 8},
+        {"C_BALANCE", 171, 8},
+        {"C_YTD_PAYMENT", 179, 8},
+        {"C_PAYMENT_CNT", 187, 8},
+        {"C_DELIVERY_CNT", 195, 8},
+        {"C_DATA", 203, 500},
+    };
+    static constexpr row_layout layout = {"CUSTOMER", 703, 21, columns};
+};
+
+struct HISTORY {
+    typedef row_field<0, 8, int64_t> H_C_ID;
+    typedef row_field<8, 8, int64_t> H_C_D_ID;
+    typedef row_field<16, 8, int64_t> H_C_W_ID;
+    typedef row_field<24, 8, int64_t> H_D_ID;
+    typedef row_field<32, 8, int64_t> H_W_ID;
+    typedef row_field<40, 8, int64_t> H_DATE;
+    typedef row_field<48, 8, double> H_AMOUNT;
+    typedef row_field<56, 24, char> H_DATA;
+    static constexpr uint32_t tuple_size = 80;
+    static constexpr row_column columns[] = {
+        {"H_C_ID", 0, 8},
+        {"H_C_D_ID", 8, 8},
+        {"H_C_W_ID", 16, 8},
+        {"H_D_ID", 24, 8},
+        {"H_W_ID", 32, 8},
+        {"H_DATE", 40, 8},
+        {"H_AMOUNT", 48, 8},
+        {"H_DATA", 56, 24},
+    };
+    static constexpr row_layout layout = {"HISTORY", 80, 8, columns};
+};
+
+struct NEW_ORDER {
+    typedef row_field<0, 8, int64_t> NO_O_ID;
+    typedef row_field<8, 8, int64_t> NO_D_ID;
+    typedef row_field<16, 8, int64_t> NO_W_ID;
+    static constexpr uint32_t tuple_size = 24;
+    static constexpr row_column columns[] = {
+        {"NO_O_ID", 0, 8},
+        {"NO_D_ID", 8, 8},
+        {"NO_W_ID", 16, 8},
+    };
+    static constexpr row_layout layout = {"NEW-ORDER", 24, 3, columns};
+};
+
+struct ORDER {
+    typedef row_field<0, 8, int64_t> O_ID;
+    typedef row_field<8, 8, int64_t> O_C_ID;
+    typedef row_field<16, 8, int64_t> O_D_ID;
+    typedef row_field<24, 8, int64_t> O_W_ID;
+    typedef row_field<32, 8, int64_t> O_ENTRY_D;
+    typedef row_field<40, 8, int64_t> O_CARRIER_ID;
+    typedef row_field<48, 8, int64_t> O_OL_CNT;
+    typedef row_field<56, 8, int64_t> O_ALL_LOCAL;
+    static constexpr uint32_t tuple_size = 64;
+    static constexpr row_column columns[] = {
+        {"O_ID", 0, 8},
+        {"O_C_ID", 8, 8},
+        {"O_D_ID", 16, 8},
+        {"O_W_ID", 24, 8},
+        {"O_ENTRY_D", 32, 8},
+        {"O_CARRIER_ID", 40, 8},
+        {"O_OL_CNT", 48, 8},
+        {"O_ALL_LOCAL", 56, 8},
+    };
+    static constexpr row_layout layout = {"ORDER", 64, 8, columns};
+};
+
+struct ORDER_LINE {
+    typedef row_field<0, 8, int64_t> OL_O_ID;
+    typedef row_field<8, 8, int64_t> OL_D_ID;
+    typedef row_field<16, 8, int64_t> OL_W_ID;
+    typedef row_field<24, 8, int64_t> OL_NUMBER;
+    typedef row_field<32, 8, int64_t> OL_I_ID;
+    typedef row_field<40, 8, int64_t> OL_SUPPLY_W_ID;
+    typedef row_field<48, 8, int64_t> OL_DELIVERY_D;
+    typedef row_field<56, 8, int64_t> OL_QUANTITY;
+    typedef row_field<64, 8, double> OL_AMOUNT;
+    typedef row_field<72, 8, int64_t> OL_DIST_INFO;
+    static constexpr uint32_t tuple_size = 80;
+    static constexpr row_column columns[] = {
+        {"OL_O_ID", 0, 8},
+        {"OL_D_ID", 8, 8},
+        {"OL_W_ID", 16, 8},
+        {"OL_NUMBER", 24, 8},
+        {"OL_I_ID", 32, 8},
+        {"OL_SUPPLY_W_ID", 40, 8},
+        {"OL_DELIVERY_D", 48, 8},
+        {"OL_QUANTITY", 56, 8},
+        {"OL_AMOUNT", 64, 8},
+        {"OL_DIST_INFO", 72, 8},
+    };
+    static constexpr row_layout layout = {"ORDER-LINE", 80, 10, columns};
+};
+
+struct ITEM {
+    typedef row_field<0, 8, int64_t> I_ID;
+    typedef row_field<8, 8, int64_t> I_IM_ID;
+    typedef row_field<16, 24, char> I_NAME;
+    typedef row_field<40, 8, int64_t> I_PRICE;
+    typedef row_field<48, 50, char> I_DATA;
+    static constexpr uint32_t tuple_size = 98;
+    static constexpr row_column columns[] = {
+        {"I_ID", 0, 8},
+        {"I_IM_ID", 8, 8},
+        {"I_NAME", 16, 24},
+        {"I_PRICE", 40, 8},
+        {"I_DATA", 48, 50},
+    };
+    static constexpr row_layout layout = {"ITEM", 98, 5, columns};
+};
+
+struct STOCK {
+    typedef row_field<0, 8, int64_t> S_I_ID;
+    typedef row_field<8, 8, int64_t> S_W_ID;
+    typedef row_field<16, 8, int64_t> S_QUANTITY;
+    typedef row_field<24, 24, char> S_DIST_01;
+    typedef row_field<48, 24, char> S_DIST_02;
+    typedef row_field<72, 24, char> S_DIST_03;
+    typedef row_field<96, 24, char> S_DIST_04;
+    typedef row_field<120, 24, char> S_DIST_05;
+    typedef row_field<144, 24, char> S_DIST_06;
+    typedef row_field<168, 24, char> S_DIST_07;
+    typedef row_field<192, 24, char> S_DIST_08;
+    typedef row_field<216, 24, char> S_DIST_09;
+    typedef row_field<240, 24, char> S_DIST_10;
+    typedef row_field<264, 8, int64_t> S_YTD;
+    typedef row_field<272, 8, int64_t> S_ORDER_CNT;
+    typedef row_field<280, 8, int64_t> S_REMOTE_CNT;
+    typedef row_field<288, 50, char> S_DATA;
+    static constexpr uint32_t tuple_size = 338;
+    static constexpr row_column columns[] = {
+        {"S_I_ID", 0, 8},
+        {"S_W_ID", 8, 8},
+        {"S_QUANTITY", 16, 8},
+        {"S_DIST_01", 24, 24},
+        {"S_DIST_02", 48, 24},
+        {"S_DIST_03", 72, 24},
+        {"S_DIST_04", 96, 24},
+        {"S_DIST_05", 120, 24},
+        {"S_DIST_06", 144, 24},
+        {"S_DIST_07", 168, 24},
+        {"S_DIST_08", 192, 24},
+        {"S_DIST_09", 216, 24},
+        {"S_DIST_10", 240, 24},
+        {"S_YTD", 264, 8},
+        {"S_ORDER_CNT", 272, 8},
+        {"S_REMOTE_CNT", 280, 8},
+        {"S_DATA", 288, 50},
+    };
+    static constexpr row_layout layout = {"STOCK", 338, 17, columns};
+};
+
+static constexpr row_layout layouts[] = {
+    WAREHOUSE::layout,
+    DISTRICT::layout,
+    CUSTOMER::layout,
+    HISTORY::layout,
+    NEW_ORDER::layout,
+    ORDER::layout,
+    ORDER_LINE::layout,
+    ITEM::layout,
+    STOCK::layout,
+};
+
+}
+
+namespace tpcc_short_schema {
+
+struct WAREHOUSE {
+    typedef row_field<0, 8, int64_t> W_ID;
+    typedef row_field<8, 10, char> W_NAME;
+    typedef row_field<18, 20, char> W_STREET_1;
+    typedef row_field<38, 20, char> W_STREET_2;
+    typedef row_field<58, 20, char> W_CITY;
+    typedef row_field<78, 2, char> W_STATE;
+    typedef row_field<80, 9, char> W_ZIP;
+    typedef row_field<89, 8, double> W_TAX;
+    typedef row_field<97, 8, double> W_YTD;
+    static constexpr uint32_t tuple_size = 105;
+    static constexpr row_column columns[] = {
+        {"W_ID", 0, 8},
+        {"W_NAME", 8, 10},
+        {"W_STREET_1", 18, 20},
+        {"W_STREET_2", 38, 20},
+        {"W_CITY", 58, 20},
+        {"W_STATE", 78, 2},
+        {"W_ZIP", 80, 9},
+        {"W_TAX", 89, 8},
+        {"W_YTD", 97, 8},
+    };
+    static constexpr row_layout layout = {"WAREHOUSE", 105, 9, columns};
+};
+
+struct DISTRICT {
+    typedef row_field<0, 8, int64_t> D_ID;
+    typedef row_field<8, 8, int64_t> D_W_ID;
+    typedef row_field<16, 10, char> D_NAME;
+    typedef row_field<26, 20, char> D_STREET_1;
+    typedef row_field<46, 20, char> D_STREET_2;
+    typedef row_field<66, 20, char> D_CITY;
+    typedef row_field<86, 2, char> D_STATE;
+    typedef row_field<88, 9, char> D_ZIP;
+    typedef row_field<97, 8, double> D_TAX;
+    typedef row_field<105, 8, double> D_YTD;
+    typedef row_field<113, 8, int64_t> D_NEXT_O_ID;
+    static constexpr uint32_t tuple_size = 121;
+    static constexpr row_column columns[] = {
+        {"D_ID", 0, 8},
+        {"D_W_ID", 8, 8},
+        {"D_NAME", 16, 10},
+        {"D_STREET_1", 26, 20},
+        {"D_STREET_2", 46, 20},
+        {"D_CITY", 66, 20},
+        {"D_STATE", 86, 2},
+        {"D_ZIP", 88, 9},
+        {"D_TAX", 97, 8},
+        {"D_YTD", 105, 8},
+        {"D_NEXT_O_ID", 113, 8},
+    };
+    static constexpr row_layout layout = {"DISTRICT", 121, 11, columns};
+};
+
+struct CUSTOMER {
+    typedef row_field<0, 8, int64_t> C_ID;
+    typedef row_field<8, 8, int64_t> C_D_ID;
+    typedef row_field<16, 8, int64_t> C_W_ID;
+    typedef row_field<24, 2, char> C_MIDDLE;
+    typedef row_field<26, 16, char> C_LAST;
+    typedef row_field<42, 2, char> C_STATE;
+    typedef row_field<44, 2, char> C_CREDIT;
+    typedef row_field<46, 8, int64_t> C_DISCOUNT;
+    typedef row_field<54, 8, double> C_BALANCE;
+    typedef row_field<62, 8, double> C_YTD_PAYMENT;
+    typedef row_field<70, 8, uint64_t> C_PAYMENT_CNT;
+    static constexpr uint32_t tuple_size = 78;
+    static constexpr row_column columns[] = {
+        {"C_ID", 0, 8},
+        {"C_D_ID", 8, 8},
+        {"C_W_ID", 16, 8},
+        {"C_MIDDLE", 24, 2},
+        {"C_LAST", 26, 16},
+        {"C_STATE", 42, 2},
+        {"C_CREDIT", 44, 2},
+        {"C_DISCOUNT", 46, 8},
+        {"C_BALANCE", 54, 8},
+        {"C_YTD_PAYMENT", 62, 8},
+        {"C_PAYMENT_CNT", 70, 8},
+    };
+    static constexpr row_layout layout = {"CUSTOMER", 78, 11, columns};
+};
+
+struct HISTORY {
+    typedef row_field<0, 8, int64_t> H_C_ID;
+    typedef row_field<8, 8, int64_t> H_C_D_ID;
+    typedef row_field<16, 8, int64_t> H_C_W_ID;
+    typedef row_field<24, 8, int64_t> H_D_ID;
+    typedef row_field<32, 8, int64_t> H_W_ID;
+    typedef row_field<40, 8, int64_t> H_DATE;
+    typedef row_field<48, 8, double> H_AMOUNT;
+    static constexpr uint32_t tuple_size = 56;
+    static constexpr row_column columns[] = {
+        {"H_C_ID", 0, 8},
+        {"H_C_D_ID", 8, 8},
+        {"H_C_W_ID", 16, 8},
+        {"H_D_ID", 24, 8},
+        {"H_W_ID", 32, 8},
+        {"H_DATE", 40, 8},
+        {"H_AMOUNT", 48, 8},
+    };
+    static constexpr row_layout layout = {"HISTORY", 56, 7, columns};
+};
+
+struct NEW_ORDER {
+    typedef row_field<0, 8, int64_t> NO_O_ID;
+    typedef row_field<8, 8, int64_t> NO_D_ID;
+    typedef row_field<16, 8, int64_t> NO_W_ID;
+    static constexpr uint32_t tuple_size = 24;
+    static constexpr row_column columns[] = {
+        {"NO_O_ID", 0, 8},
+        {"NO_D_ID", 8, 8},
+        {"NO_W_ID", 16, 8},
+    };
+    static constexpr row_layout layout = {"NEW-ORDER", 24, 3, columns};
+};
+
+struct ORDER {
+    typedef row_field<0, 8, int64_t> O_ID;
+    typedef row_field<8, 8, int64_t> O_C_ID;
+    typedef row_field<16, 8, int64_t> O_D_ID;
+    typedef row_field<24, 8, int64_t> O_W_ID;
+    typedef row_field<32, 8, int64_t> O_ENTRY_D;
+    typedef row_field<40, 8, int64_t> O_CARRIER_ID;
+    typedef row_field<48, 8, int64_t> O_OL_CNT;
+    typedef row_field<56, 8, int64_t> O_ALL_LOCAL;
+    static constexpr uint32_t tuple_size = 64;
+    static constexpr row_column columns[] = {
+        {"O_ID", 0, 8},
+        {"O_C_ID", 8, 8},
+        {"O_D_ID", 16, 8},
+        {"O_W_ID", 24, 8},
+        {"O_ENTRY_D", 32, 8},
+        {"O_CARRIER_ID", 40, 8},
+        {"O_OL_CNT", 48, 8},
+        {"O_ALL_LOCAL", 56, 8},
+    };
+    static constexpr row_layout layout = {"ORDER", 64, 8, columns};
+};
+
+struct ORDER_LINE {
+    typedef row_field<0, 8, int64_t> OL_O_ID;
+    typedef row_field<8, 8, int64_t> OL_D_ID;
+    typedef row_field<16, 8, int64_t> OL_W_ID;
+    typedef row_field<24, 8, int64_t> OL_NUMBER;
+    typedef row_field<32, 8, int64_t> OL_I_ID;
+    static constexpr uint32_t tuple_size = 40;
+    static constexpr row_column columns[] = {
+        {"OL_O_ID", 0, 8},
+        {"OL_D_ID", 8, 8},
+        {"OL_W_ID", 16, 8},
+        {"OL_NUMBER", 24, 8},
+        {"OL_I_ID", 32, 8},
+    };
+    static constexpr row_layout layout = {"ORDER-LINE", 40, 5, columns};
+};
+
+struct ITEM {
+    typedef row_field<0, 8, int64_t> I_ID;
+    typedef row_field<8, 8, int64_t> I_IM_ID;
+    typedef row_field<16, 24, char> I_NAME;
+    typedef row_field<40, 8, int64_t> I_PRICE;
+    typedef row_field<48, 50, char> I_DATA;
+    static constexpr uint32_t tuple_size = 98;
+    static constexpr row_column columns[] = {
+        {"I_ID", 0, 8},
+        {"I_IM_ID", 8, 8},
+        {"I_NAME", 16, 24},
+        {"I_PRICE", 40, 8},
+        {"I_DATA", 48, 50},
+    };
+    static constexpr row_layout layout = {"ITEM", 98, 5, columns};
+};
+
+struct STOCK {
+    typedef row_field<0, 8, int64_t> S_I_ID;
+    typedef row_field<8, 8, int64_t> S_W_ID;
+    typedef row_field<16, 8, int64_t> S_QUANTITY;
+    typedef row_field<24, 8, int64_t> S_REMOTE_CNT;
+    static constexpr uint32_t tuple_size = 32;
+    static constexpr row_column columns[] = {
+        {"S_I_ID", 0, 8},
+        {"S_W_ID", 8, 8},
+        {"S_QUANTITY", 16, 8},
+        {"S_REMOTE_CNT", 24, 8},
+    };
+    static constexpr row_layout layout = {"STOCK", 32, 4, columns};
+};
+
+static constexpr row_layout layouts[] = {
+    WAREHOUSE::layout,
+    DISTRICT::layout,
+    CUSTOMER::layout,
+    HISTORY::layout,
+    NEW_ORDER::layout,
+    ORDER::layout,
+    ORDER_LINE::layout,
+    ITEM::layout,
+    STOCK::layout,
+};
+
+}
+
+namespace ycsb_schema {
+
+struct MAIN_TABLE {
+    typedef row_field<0, 100, char> F0;
+    typedef row_field<100, 100, char> F1;
+    typedef row_field<200, 100, char> F2;
+    typedef row_field<300, 100, char> F3;
+    typedef row_field<400, 100, char> F4;
+    typedef row_field<500, 100, char> F5;
+    typedef row_field<600, 100, char> F6;
+    typedef row_field<700, 100, char> F7;
+    typedef row_field<800, 100, char> F8;
+    typedef row_field<900, 100, char> F9;
+    static constexpr uint32_t tuple_size = 1000;
+    static constexpr row_column columns[] = {
+        {"F0", 0, 100},
+        {"F1", 100, 100},
+        {"F2", 200, 100},
+        {"F3", 300, 100},
+        {"F4", 400, 100},
+        {"F5", 500, 100},
+        {"F6", 600, 100},
+        {"F7", 700, 100},
+        {"F8", 800, 100},
+        {"F9", 900, 100},
+    };
+    static constexpr row_layout layout = {"MAIN_TABLE", 1000, 10, columns};
+};
+
+static constexpr row_layout layouts[] = {
+    MAIN_TABLE::layout,
+};
+
+}
+
+namespace da_schema {
+
+struct DAtab {
+    typedef row_field<0, 8, int64_t> id;
+    typedef row_field<8, 8, int64_t> value;
+    static constexpr uint32_t tuple_size = 16;
+    static constexpr row_column columns[] = {
+        {"id", 0, 8},
+        {"value", 8, 8},
+    };
+    static constexpr row_layout layout = {"DAtab", 16, 2, columns};
+};
+
+static constexpr row_layout layouts[] = {
+    DAtab::layout,
+};
+
+}
+
+#endif
@@ -21,6 +21,14 @@
 #include "txn.h"
 #include "query.h"
 #include "row.h"
+#include "schema_layout.h"
+
+// layouts of the schema file TPCCWorkload::init() reads
+#if TPCC_SMALL
+namespace tpcc_schema = tpcc_short_schema;
+#else
+namespace tpcc_schema = tpcc_full_schema;
+#endif
 
 class TPCCQuery;
 class TPCCQueryMessage;
@@ -89,6 +97,11 @@ public:
 
 private:
     uint64_t num_wh;
+    // init thread id loads the ids [first_init_key(cnt, id), first_init_key(cnt, id + 1)) of 1..cnt,
+    // a contiguous range so that the keys it passes to an IndexLoader ascend
+    static uint64_t first_init_key(uint64_t cnt, uint64_t id) {
+        return cnt * id / g_init_parallelism + 1;
+    }
     void init_tab_item(int id);
     void init_tab_wh();
     void init_tab_dist(uint64_t w_id);
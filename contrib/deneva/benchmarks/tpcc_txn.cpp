@@ -539,9 +539,9 @@ inline RC TPCCTxnManager::run_payment_1(uint64_t w_id, uint64_t d_id, uint64_t d
 
 
     double w_ytd;
-    r_wh_local->get_value(W_YTD, w_ytd);
+    w_ytd = r_wh_local->get_field<tpcc_schema::WAREHOUSE::W_YTD>();
     if (g_wh_update) {
-        r_wh_local->set_value(W_YTD, w_ytd + h_amount);
+        write_field<tpcc_schema::WAREHOUSE::W_YTD>(r_wh_local, w_ytd + h_amount);
     }
   return RCOK;
 }
@@ -571,8 +571,8 @@ inline RC TPCCTxnManager::run_payment_3(uint64_t w_id, uint64_t d_id, uint64_t d
         WHERE d_w_id=:w_id AND d_id=:d_id;
     +=====================================================*/
     double d_ytd;
-    r_dist_local->get_value(D_YTD, d_ytd);
-    r_dist_local->set_value(D_YTD, d_ytd + h_amount);
+    d_ytd = r_dist_local->get_field<tpcc_schema::DISTRICT::D_YTD>();
+    write_field<tpcc_schema::DISTRICT::D_YTD>(r_dist_local, d_ytd + h_amount);
 
     return RCOK;
 }
@@ -666,16 +666,16 @@ inline RC TPCCTxnManager::run_payment_5(uint64_t w_id, uint64_t d_id, uint64_t c
   assert(r_cust_local != NULL);
     double c_balance;
     double c_ytd_payment;
-    double c_payment_cnt;
+    uint64_t c_payment_cnt;
 
-    r_cust_local->get_value(C_BALANCE, c_balance);
-    r_cust_local->set_value(C_BALANCE, c_balance - h_amount);
-    r_cust_local->get_value(C_YTD_PAYMENT, c_ytd_payment);
-    r_cust_local->set_value(C_YTD_PAYMENT, c_ytd_payment + h_amount);
-    r_cust_local->get_value(C_PAYMENT_CNT, c_payment_cnt);
-    r_cust_local->set_value(C_PAYMENT_CNT, c_payment_cnt + 1);
+    c_balance = r_cust_local->get_field<tpcc_schema::CUSTOMER::C_BALANCE>();
+    write_field<tpcc_schema::CUSTOMER::C_BALANCE>(r_cust_local, c_balance - h_amount);
+    c_ytd_payment = r_cust_local->get_field<tpcc_schema::CUSTOMER::C_YTD_PAYMENT>();
+    write_field<tpcc_schema::CUSTOMER::C_YTD_PAYMENT>(r_cust_local, c_ytd_payment + h_amount);
+    c_payment_cnt = r_cust_local->get_field<tpcc_schema::CUSTOMER::C_PAYMENT_CNT>();
+    write_field<tpcc_schema::CUSTOMER::C_PAYMENT_CNT>(r_cust_local, c_payment_cnt + 1);
 
-    //char * c_credit = r_cust_local->get_value(C_CREDIT);
+    //char * c_credit = r_cust_local->get_field_ptr<tpcc_schema::CUSTOMER::C_CREDIT>();
 
     /*=============================================================================+
       EXEC SQL INSERT INTO
@@ -686,14 +686,14 @@ inline RC TPCCTxnManager::run_payment_5(uint64_t w_id, uint64_t d_id, uint64_t c
     uint64_t row_id;
     // Which partition should we be inserting into?
     _wl->t_history->get_new_row(r_hist, wh_to_part(c_w_id), row_id);
-    r_hist->set_value(H_C_ID, c_id);
-    r_hist->set_value(H_C_D_ID, c_d_id);
-    r_hist->set_value(H_C_W_ID, c_w_id);
-    r_hist->set_value(H_D_ID, d_id);
-    r_hist->set_value(H_W_ID, w_id);
+    r_hist->set_field<tpcc_schema::HISTORY::H_C_ID>(c_id);
+    r_hist->set_field<tpcc_schema::HISTORY::H_C_D_ID>(c_d_id);
+    r_hist->set_field<tpcc_schema::HISTORY::H_C_W_ID>(c_w_id);
+    r_hist->set_field<tpcc_schema::HISTORY::H_D_ID>(d_id);
+    r_hist->set_field<tpcc_schema::HISTORY::H_W_ID>(w_id);
     int64_t date = 2013;
-    r_hist->set_value(H_DATE, date);
-    r_hist->set_value(H_AMOUNT, h_amount);
+    r_hist->set_field<tpcc_schema::HISTORY::H_DATE>(date);
+    r_hist->set_field<tpcc_schema::HISTORY::H_AMOUNT>(h_amount);
     insert_row(r_hist, _wl->t_history);
 
     return RCOK;
@@ -724,8 +724,8 @@ inline RC TPCCTxnManager::new_order_1(uint64_t w_id, uint64_t d_id, uint64_t c_i
                                       uint64_t ol_cnt, uint64_t o_entry_d, uint64_t *o_id,
                                       row_t *r_wh_local) {
   assert(r_wh_local != NULL);
-    double w_tax;
-    r_wh_local->get_value(W_TAX, w_tax);
+    double w_tax __attribute__ ((unused));
+    w_tax = r_wh_local->get_field<tpcc_schema::WAREHOUSE::W_TAX>();
   return RCOK;
 }
 
@@ -747,12 +747,12 @@ inline RC TPCCTxnManager::new_order_3(uint64_t w_id, uint64_t d_id, uint64_t c_i
                                       uint64_t ol_cnt, uint64_t o_entry_d, uint64_t *o_id,
                                       row_t *r_cust_local) {
   assert(r_cust_local != NULL);
-    uint64_t c_discount;
+    uint64_t c_discount __attribute__ ((unused));
     //char * c_last;
     //char * c_credit;
-    r_cust_local->get_value(C_DISCOUNT, c_discount);
-    //c_last = r_cust_local->get_value(C_LAST);
-    //c_credit = r_cust_local->get_value(C_CREDIT);
+    c_discount = r_cust_local->get_field<tpcc_schema::CUSTOMER::C_DISCOUNT>();
+    //c_last = r_cust_local->get_field_ptr<tpcc_schema::CUSTOMER::C_LAST>();
+    //c_credit = r_cust_local->get_field_ptr<tpcc_schema::CUSTOMER::C_CREDIT>();
   return RCOK;
 }
 
@@ -782,10 +782,10 @@ inline RC TPCCTxnManager::new_order_5(uint64_t w_id, uint64_t d_id, uint64_t c_i
   assert(r_dist_local != NULL);
     //double d_tax;
     //int64_t o_id;
-    //d_tax = *(double *) r_dist_local->get_value(D_TAX);
-    *o_id = *(int64_t *) r_dist_local->get_value(D_NEXT_O_ID);
+    //d_tax = r_dist_local->get_field<tpcc_schema::DISTRICT::D_TAX>();
+    *o_id = r_dist_local->get_field<tpcc_schema::DISTRICT::D_NEXT_O_ID>();
     (*o_id) ++;
-    r_dist_local->set_value(D_NEXT_O_ID, *o_id);
+    write_field<tpcc_schema::DISTRICT::D_NEXT_O_ID>(r_dist_local, *o_id);
 
     // return o_id
     /*========================================================================================+
@@ -795,14 +795,14 @@ inline RC TPCCTxnManager::new_order_5(uint64_t w_id, uint64_t d_id, uint64_t c_i
     row_t * r_order;
     uint64_t row_id;
     _wl->t_order->get_new_row(r_order, wh_to_part(w_id), row_id);
-    r_order->set_value(O_ID, *o_id);
-    r_order->set_value(O_C_ID, c_id);
-    r_order->set_value(O_D_ID, d_id);
-    r_order->set_value(O_W_ID, w_id);
-    r_order->set_value(O_ENTRY_D, o_entry_d);
-    r_order->set_value(O_OL_CNT, ol_cnt);
+    r_order->set_field<tpcc_schema::ORDER::O_ID>(*o_id);
+    r_order->set_field<tpcc_schema::ORDER::O_C_ID>(c_id);
+    r_order->set_field<tpcc_schema::ORDER::O_D_ID>(d_id);
+    r_order->set_field<tpcc_schema::ORDER::O_W_ID>(w_id);
+    r_order->set_field<tpcc_schema::ORDER::O_ENTRY_D>(o_entry_d);
+    r_order->set_field<tpcc_schema::ORDER::O_OL_CNT>(ol_cnt);
     int64_t all_local = (remote? 0 : 1);
-    r_order->set_value(O_ALL_LOCAL, all_local);
+    r_order->set_field<tpcc_schema::ORDER::O_ALL_LOCAL>(all_local);
     insert_row(r_order, _wl->t_order);
     /*=======================================================+
     EXEC SQL INSERT INTO NEW_ORDER (no_o_id, no_d_id, no_w_id)
@@ -810,9 +810,9 @@ inline RC TPCCTxnManager::new_order_5(uint64_t w_id, uint64_t d_id, uint64_t c_i
     +=======================================================*/
     row_t * r_no;
     _wl->t_neworder->get_new_row(r_no, wh_to_part(w_id), row_id);
-    r_no->set_value(NO_O_ID, *o_id);
-    r_no->set_value(NO_D_ID, d_id);
-    r_no->set_value(NO_W_ID, w_id);
+    r_no->set_field<tpcc_schema::NEW_ORDER::NO_O_ID>(*o_id);
+    r_no->set_field<tpcc_schema::NEW_ORDER::NO_D_ID>(d_id);
+    r_no->set_field<tpcc_schema::NEW_ORDER::NO_W_ID>(w_id);
     insert_row(r_no, _wl->t_neworder);
 
     return RCOK;
@@ -842,13 +842,13 @@ inline RC TPCCTxnManager::new_order_6(uint64_t ol_i_id, row_t *& r_item_local) {
 
 inline RC TPCCTxnManager::new_order_7(uint64_t ol_i_id, row_t * r_item_local) {
   assert(r_item_local != NULL);
-        int64_t i_price;
+        int64_t i_price __attribute__ ((unused));
         //char * i_name;
         //char * i_data;
 
-        r_item_local->get_value(I_PRICE, i_price);
-        //i_name = r_item_local->get_value(I_NAME);
-        //i_data = r_item_local->get_value(I_DATA);
+        i_price = r_item_local->get_field<tpcc_schema::ITEM::I_PRICE>();
+        //i_name = r_item_local->get_field_ptr<tpcc_schema::ITEM::I_NAME>();
+        //i_data = r_item_local->get_field_ptr<tpcc_schema::ITEM::I_DATA>();
 
     return RCOK;
 }
@@ -891,22 +891,22 @@ inline RC TPCCTxnManager::new_order_9(uint64_t w_id, uint64_t d_id, bool remote,
         // XXX s_dist_xx are not retrieved.
         UInt64 s_quantity;
         int64_t s_remote_cnt;
-        s_quantity = *(int64_t *)r_stock_local->get_value(S_QUANTITY);
+        s_quantity = r_stock_local->get_field<tpcc_schema::STOCK::S_QUANTITY>();
 #if !TPCC_SMALL
         int64_t s_ytd;
         int64_t s_order_cnt;
         char * s_data __attribute__ ((unused));
-        r_stock_local->get_value(S_YTD, s_ytd);
-        r_stock_local->set_value(S_YTD, s_ytd + ol_quantity);
+        s_ytd = r_stock_local->get_field<tpcc_schema::STOCK::S_YTD>();
+        write_field<tpcc_schema::STOCK::S_YTD>(r_stock_local, s_ytd + ol_quantity);
     // In Coordination Avoidance, this record must be protected!
-        r_stock_local->get_value(S_ORDER_CNT, s_order_cnt);
-        r_stock_local->set_value(S_ORDER_CNT, s_order_cnt + 1);
-        s_data = r_stock_local->get_value(S_DATA);
+        s_order_cnt = r_stock_local->get_field<tpcc_schema::STOCK::S_ORDER_CNT>();
+        write_field<tpcc_schema::STOCK::S_ORDER_CNT>(r_stock_local, s_order_cnt + 1);
+        s_data = r_stock_local->get_field_ptr<tpcc_schema::STOCK::S_DATA>();
 #endif
         if (remote) {
-            s_remote_cnt = *(int64_t*)r_stock_local->get_value(S_REMOTE_CNT);
+            s_remote_cnt = r_stock_local->get_field<tpcc_schema::STOCK::S_REMOTE_CNT>();
             s_remote_cnt ++;
-            r_stock_local->set_value(S_REMOTE_CNT, &s_remote_cnt);
+            write_field<tpcc_schema::STOCK::S_REMOTE_CNT>(r_stock_local, s_remote_cnt);
         }
         uint64_t quantity;
         if (s_quantity > ol_quantity + 10) {
@@ -914,7 +914,7 @@ inline RC TPCCTxnManager::new_order_9(uint64_t w_id, uint64_t d_id, bool remote,
         } else {
             quantity = s_quantity - ol_quantity + 91;
         }
-        r_stock_local->set_value(S_QUANTITY, &quantity);
+        write_field<tpcc_schema::STOCK::S_QUANTITY>(r_stock_local, quantity);
 
         /*====================================================+
         EXEC SQL INSERT
@@ -928,15 +928,15 @@ inline RC TPCCTxnManager::new_order_9(uint64_t w_id, uint64_t d_id, bool remote,
         row_t * r_ol;
         uint64_t row_id;
         _wl->t_orderline->get_new_row(r_ol, wh_to_part(ol_supply_w_id), row_id);
-        r_ol->set_value(OL_O_ID, &o_id);
-        r_ol->set_value(OL_D_ID, &d_id);
-        r_ol->set_value(OL_W_ID, &w_id);
-        r_ol->set_value(OL_NUMBER, &ol_number);
-        r_ol->set_value(OL_I_ID, &ol_i_id);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_O_ID>(o_id);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_D_ID>(d_id);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_W_ID>(w_id);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_NUMBER>(ol_number);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_I_ID>(ol_i_id);
 #if !TPCC_SMALL
-        r_ol->set_value(OL_SUPPLY_W_ID, &ol_supply_w_id);
-        r_ol->set_value(OL_QUANTITY, &ol_quantity);
-        r_ol->set_value(OL_AMOUNT, &ol_amount);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_SUPPLY_W_ID>(ol_supply_w_id);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_QUANTITY>(ol_quantity);
+        r_ol->set_field<tpcc_schema::ORDER_LINE::OL_AMOUNT>(ol_amount);
 #endif
         insert_row(r_ol, _wl->t_orderline);
 
@@ -1051,7 +1051,7 @@ RC TPCCTxnManager::run_tpcc_phase2() {
         rc = new_order_2( w_id, d_id, c_id, remote, ol_cnt, o_entry_d, &tpcc_query->o_id, row);
         rc = new_order_3( w_id, d_id, c_id, remote, ol_cnt, o_entry_d, &tpcc_query->o_id, row);
         rc = new_order_4( w_id, d_id, c_id, remote, ol_cnt, o_entry_d, &tpcc_query->o_id, row);
-        tpcc_query->o_id = *(int64_t *) row->get_value(D_NEXT_O_ID);
+        tpcc_query->o_id = row->get_field<tpcc_schema::DISTRICT::D_NEXT_O_ID>();
         //rc = new_order_5( w_id, d_id, c_id, remote, ol_cnt, o_entry_d, &tpcc_query->o_id, row);
       }
         for(uint64_t i = 0; i < tpcc_query->ol_cnt; i++) {
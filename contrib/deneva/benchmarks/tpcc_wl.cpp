@@ -28,6 +28,7 @@
 #include "txn.h"
 #include "mem_alloc.h"
 #include "tpcc_const.h"
+#include "snapshot.h"
 
 RC TPCCWorkload::init() {
     Workload::init();
@@ -57,7 +58,10 @@ RC TPCCWorkload::init() {
   printf("Done\n");
   printf("Initializing table... ");
   fflush(stdout);
-    init_table();
+    if (!TableSnapshot::load(this)) {
+        init_table();
+        TableSnapshot::save(this);
+    }
   printf("Done\n");
   fflush(stdout);
     return RCOK;
@@ -83,6 +87,7 @@ RC TPCCWorkload::init_schema(const char * schema_file) {
     i_stock = indexes["STOCK_IDX"];
 //    i_order = indexes["ORDER_IDX"];
 //    i_orderline = indexes["ORDER-LINE_IDX"];
+    check_layouts(tpcc_schema::layouts);
     return RCOK;
 }
 
@@ -120,6 +125,7 @@ RC TPCCWorkload::init_table() {
             exit(-1);
         }
   }
+  index_load_finish(i_stock);
   printf("STOCK Done\n");
   fflush(stdout);
   // Item Table
@@ -134,6 +140,7 @@ RC TPCCWorkload::init_table() {
             exit(-1);
         }
   }
+  index_load_finish(i_item);
   printf("ITEM Done\n");
   fflush(stdout);
   // Customer Table
@@ -148,6 +155,7 @@ RC TPCCWorkload::init_table() {
             exit(-1);
         }
   }
+  index_load_finish(i_customer_id);
   printf("ITEM Done\n");
   fflush(stdout);
 
@@ -217,7 +225,8 @@ RC TPCCWorkload::get_txn_man(TxnManager *& txn_manager) {
 
 void TPCCWorkload::init_tab_item(int id) {
   if (WL_VERB) printf("[init] loading item table\n");
-    for (UInt32 i = id+1; i <= g_max_items; i+=g_init_parallelism) {
+    IndexLoader loader(i_item);
+    for (UInt32 i = first_init_key(g_max_items, id); i < first_init_key(g_max_items, id + 1); i++) {
         row_t * row;
         uint64_t row_id;
         t_item->get_new_row(row, 0, row_id);
@@ -233,7 +242,7 @@ void TPCCWorkload::init_tab_item(int id) {
     if (RAND(10) == 0) strcpy(data, "original");
         row->set_value(I_DATA, data);
 
-        index_insert(i_item, i, row, 0);
+        loader.load(i, row, 0);
     }
 }
 
@@ -310,8 +319,9 @@ void TPCCWorkload::init_tab_dist(uint64_t wid) {
 }
 
 void TPCCWorkload::init_tab_stock(int id, uint64_t wid) {
-
-    for (UInt32 sid = id + 1; sid <= g_max_items; sid+=g_init_parallelism) {
+    IndexLoader loader(i_stock);
+    for (UInt32 sid = first_init_key(g_max_items, id); sid < first_init_key(g_max_items, id + 1);
+         sid++) {
         row_t * row;
         uint64_t row_id;
         t_stock->get_new_row(row, 0, row_id);
@@ -347,13 +357,15 @@ void TPCCWorkload::init_tab_stock(int id, uint64_t wid) {
     */
         row->set_value(S_DATA, s_data);
 #endif
-        index_insert(i_stock, stockKey(sid, wid), row, wh_to_part(wid));
+        loader.load(stockKey(sid, wid), row, wh_to_part(wid));
     }
 }
 
 void TPCCWorkload::init_tab_cust(int id, uint64_t did, uint64_t wid) {
     assert(g_cust_per_dist >= 1000);
-    for (UInt32 cid = id+1; cid <= g_cust_per_dist; cid += g_init_parallelism) {
+    IndexLoader loader(i_customer_id);
+    for (UInt32 cid = first_init_key(g_cust_per_dist, id);
+         cid < first_init_key(g_cust_per_dist, id + 1); cid++) {
         row_t * row;
         uint64_t row_id;
         t_customer->get_new_row(row, 0, row_id);
@@ -414,10 +426,12 @@ void TPCCWorkload::init_tab_cust(int id, uint64_t did, uint64_t wid) {
         row->set_value(C_YTD_PAYMENT, 10.0);
         row->set_value(C_PAYMENT_CNT, 1);
         uint64_t key;
+        // last name keys are hashes in no particular order and shared between threads, so they
+        // are inserted one by one
         key = custNPKey(c_last, did, wid);
         index_insert(i_customer_last, key, row, wh_to_part(wid));
         key = custKey(cid, did, wid);
-        index_insert(i_customer_id, key, row, wh_to_part(wid));
+        loader.load(key, row, wh_to_part(wid));
     }
 }
 
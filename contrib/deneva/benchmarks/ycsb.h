@@ -21,6 +21,8 @@
 #include "txn.h"
 #include "global.h"
 #include "helper.h"
+#include "index_btree.h"
+#include "schema_layout.h"
 
 class YCSBQuery;
 class YCSBQueryMessage;
@@ -69,6 +71,7 @@ private:
   RC run_txn_state();
   RC run_ycsb_0(ycsb_request * req,row_t *& row_local);
   RC run_ycsb_1(access_t acctype, row_t * row_local);
+  row_t * next_scan_row(ycsb_request * req);
   RC run_ycsb();
   bool is_done() ;
   bool is_local_request(uint64_t idx) ;
@@ -78,6 +81,11 @@ private:
     YCSBWorkload * _wl;
     YCSBRemTxnType state;
   uint64_t next_record_id;
+  // rows read so far by the scan in requests[next_record_id]
+  uint64_t scan_row_cnt;
+#if INDEX_STRUCT == IDX_BTREE
+  bt_cursor scan_cursor;
+#endif
 };
 
 #endif
@@ -34,6 +34,17 @@
 uint64_t YCSBQueryGenerator::the_n = 0;
 double YCSBQueryGenerator::denom = 0;
 
+// Add the keys of the rows req touches to all_keys, unless one of them is already there. YCSB keys
+// are dense, so the rows a scan reads in the partition of req->key are known in advance.
+static bool reserve_keys(set<uint64_t> & all_keys, const ycsb_request * req) {
+    uint64_t row_cnt = req->acctype == SCAN ? req->scan_len : 1;
+    for (uint64_t i = 0; i < row_cnt; i++) {
+        if (all_keys.count(req->key + i * g_part_cnt) > 0) return false;
+    }
+    for (uint64_t i = 0; i < row_cnt; i++) all_keys.insert(req->key + i * g_part_cnt);
+    return true;
+}
+
 void YCSBQueryGenerator::init() {
     mrand = (myrand *) mem_allocator.alloc(sizeof(myrand));
     mrand->init(get_sys_clock());
@@ -134,7 +145,7 @@ uint64_t YCSBQuery::get_participants(Workload * wl) {
     assert(active_nodes.size()==g_node_cnt);
     for(uint64_t i = 0; i < requests.size(); i++) {
         uint64_t req_nid = GET_NODE_ID(((YCSBWorkload*)wl)->key_to_part(requests[i]->key));
-        if(requests[i]->acctype == RD) {
+        if(requests[i]->acctype == RD || requests[i]->acctype == SCAN) {
             if (participant_nodes[req_nid] == 0) ++participant_cnt;
             participant_nodes.set(req_nid,1);
         }
@@ -174,6 +185,21 @@ bool YCSBQuery::readonly() {
     return true;
 }
 
+void YCSBQueryGenerator::set_acctype(ycsb_request * req, double r_twr, double r) {
+    // only draw for scans when they are enabled, so read/write workloads keep their random stream
+    if (g_scan_perc > 0 && (double)(mrand->next() % 10000) / 10000 < g_scan_perc) {
+        req->acctype = SCAN;
+        // like YCSB workload E, scan lengths are uniform in [1, SCAN_LEN]
+        req->scan_len = mrand->next() % g_scan_len + 1;
+        return;
+    }
+    if (r_twr < g_txn_read_perc || r < g_tup_read_perc)
+        req->acctype = RD;
+    else
+        req->acctype = WR;
+    req->scan_len = 0;
+}
+
 // The following algorithm comes from the paper:
 // Quickly generating billion-record synthetic databases
 // However, it seems there is a small bug.
@@ -223,10 +249,7 @@ BaseQuery * YCSBQueryGenerator::gen_requests_hot(uint64_t home_partition_id, Wor
         double hot =  (double)(mrand->next() % 10000) / 10000;
         uint64_t partition_id;
         ycsb_request * req = (ycsb_request*) mem_allocator.alloc(sizeof(ycsb_request));
-        if (r_twr < g_txn_read_perc || r < g_tup_read_perc)
-            req->acctype = RD;
-        else
-            req->acctype = WR;
+        set_acctype(req, r_twr, r);
 
         uint64_t row_id = 0;
         if ( FIRST_PART_LOCAL && rid == 0) {
@@ -268,8 +291,7 @@ BaseQuery * YCSBQueryGenerator::gen_requests_hot(uint64_t home_partition_id, Wor
         req->key = primary_key;
         req->value = mrand->next() % (1<<8);
         // Make sure a single row is not accessed twice
-        if (all_keys.find(req->key) == all_keys.end()) {
-            all_keys.insert(req->key);
+        if (reserve_keys(all_keys, req)) {
             access_cnt ++;
         } else {
             // Need to have the full g_req_per_query amount
@@ -345,10 +367,7 @@ BaseQuery * YCSBQueryGenerator::gen_requests_zipf(uint64_t home_partition_id, Wo
     #endif
 #endif
         ycsb_request * req = (ycsb_request*) mem_allocator.alloc(sizeof(ycsb_request));
-        if (r_twr < g_txn_read_perc || r < g_tup_read_perc)
-            req->acctype = RD;
-        else
-            req->acctype = WR;
+        set_acctype(req, r_twr, r);
         uint64_t row_id = zipf(table_size - 1, g_zipf_theta);
         assert(row_id < table_size);
         uint64_t primary_key = row_id * g_part_cnt + partition_id;
@@ -357,8 +376,7 @@ BaseQuery * YCSBQueryGenerator::gen_requests_zipf(uint64_t home_partition_id, Wo
         req->key = primary_key;
         req->value = mrand->next() % (1<<8);
         // Make sure a single row is not accessed twice
-        if (all_keys.find(req->key) == all_keys.end()) {
-            all_keys.insert(req->key);
+        if (reserve_keys(all_keys, req)) {
             access_cnt ++;
         } else {
             // Need to have the full g_req_per_query amount
@@ -35,18 +35,21 @@ class YCSBClientQueryMessage;
 class ycsb_request {
 public:
   ycsb_request() {}
-  ycsb_request(const ycsb_request& req) : acctype(req.acctype), key(req.key), value(req.value) { }
+  ycsb_request(const ycsb_request& req)
+      : acctype(req.acctype), key(req.key), value(req.value), scan_len(req.scan_len) {}
   void copy(ycsb_request * req) {
     this->acctype = req->acctype;
     this->key = req->key;
     this->value = req->value;
+    this->scan_len = req->scan_len;
   }
 //    char table_name[80];
     access_t acctype;
     uint64_t key;
     char value;
-    // only for (qtype == SCAN)
-    //UInt32 scan_len;
+    // only for (acctype == SCAN): the scan reads the scan_len rows of the partition of key
+    // starting at key
+    UInt32 scan_len;
 };
 
 class YCSBQueryGenerator : public QueryGenerator {
@@ -57,6 +60,7 @@ public:
 private:
     BaseQuery * gen_requests_hot(uint64_t home_partition_id, Workload * h_wl);
     BaseQuery * gen_requests_zipf(uint64_t home_partition_id, Workload * h_wl);
+    void set_acctype(ycsb_request * req, double r_twr, double r);
     // for Zipfian distribution
     double zeta(uint64_t n, double theta);
     uint64_t zipf(uint64_t n, double theta);
@@ -51,6 +51,7 @@ void YCSBTxnManager::init(uint64_t thd_id, Workload * h_wl) {
 void YCSBTxnManager::reset() {
   state = YCSB_0;
   next_record_id = 0;
+  scan_row_cnt = 0;
     TxnManager::reset();
 }
 
@@ -69,6 +70,18 @@ RC YCSBTxnManager::acquire_locks() {
     DEBUG("LK Acquire (%ld,%ld) %d,%ld -> %ld\n", get_txn_id(), get_batch_id(), req->acctype,
           req->key, GET_NODE_ID(part_id));
     if (GET_NODE_ID(part_id) != g_node_id) continue;
+    if (req->acctype == SCAN) {
+      // lock every row the scan will read
+      scan_row_cnt = 0;
+      for (row_t * row = next_scan_row(req); row != NULL; row = next_scan_row(req)) {
+        RC rc2 = get_lock(row, SCAN);
+        if(rc2 != RCOK) {
+          rc = rc2;
+        }
+      }
+      scan_row_cnt = 0;
+      continue;
+    }
         INDEX * index = _wl->the_index;
         itemid_t * item;
         item = index_read(index, req->key, part_id);
@@ -143,6 +156,13 @@ void YCSBTxnManager::next_ycsb_state() {
       state = YCSB_1;
       break;
     case YCSB_1:
+      // a scan stays on its request until it has read all of its rows
+      if (((YCSBQuery*)query)->requests[next_record_id]->acctype == SCAN && row != NULL &&
+          scan_row_cnt < ((YCSBQuery*)query)->requests[next_record_id]->scan_len) {
+        state = YCSB_0;
+        break;
+      }
+      scan_row_cnt = 0;
       next_record_id++;
       if(!IS_LOCAL(txn->txn_id) || !is_done()) {
         state = YCSB_0;
@@ -212,12 +232,49 @@ RC YCSBTxnManager::run_txn_state() {
   return rc;
 }
 
+row_t * YCSBTxnManager::next_scan_row(ycsb_request * req) {
+  if (scan_row_cnt >= req->scan_len) return NULL;
+  uint64_t part_id = _wl->key_to_part(req->key);
+  uint64_t starttime = get_sys_clock();
+  itemid_t * m_item;
+#if INDEX_STRUCT == IDX_BTREE
+  if (scan_row_cnt == 0) {
+    _wl->the_index->index_scan(scan_cursor, req->key, m_item, part_id);
+  } else {
+    _wl->the_index->index_scan_next(scan_cursor, m_item);
+  }
+  // with CENTRAL_INDEX one tree holds all local partitions, skip the keys of the others
+  while (m_item != NULL && (uint64_t)_wl->key_to_part(scan_cursor.key) != part_id) {
+    _wl->the_index->index_scan_next(scan_cursor, m_item);
+  }
+#else
+  // IndexHash is not ordered, but the keys of a partition are dense, so read the next ones
+  uint64_t key = req->key + scan_row_cnt * g_part_cnt;
+  m_item = NULL;
+  if (key < g_synth_table_size) _wl->the_index->index_read(key, m_item, part_id, get_thd_id());
+#endif
+  INC_STATS(get_thd_id(), txn_index_time, get_sys_clock() - starttime);
+  if (scan_row_cnt == 0) INC_STATS(get_thd_id(), txn_scan_cnt, 1);
+  if (m_item == NULL) return NULL;
+  scan_row_cnt++;
+  INC_STATS(get_thd_id(), txn_scan_row_cnt, 1);
+  return (row_t *) m_item->location;
+}
+
 RC YCSBTxnManager::run_ycsb_0(ycsb_request * req,row_t *& row_local) {
     RC rc = RCOK;
         int part_id = _wl->key_to_part( req->key );
         access_t type = req->acctype;
       itemid_t * m_item;
 
+    if (type == SCAN) {
+      // Each scanned row is accessed like a read: a shared lock or a read set entry, depending on
+      // CC_ALG. row_local is NULL when the scan ran out of rows in its partition.
+      row_t * scan_row = next_scan_row(req);
+      row_local = NULL;
+      return scan_row == NULL ? RCOK : get_row(scan_row, SCAN, row_local);
+    }
+
         m_item = index_read(_wl->the_index, req->key, part_id);
 
         row_t * row = ((row_t *)m_item->location);
@@ -230,10 +287,11 @@ RC YCSBTxnManager::run_ycsb_0(ycsb_request * req,row_t *& row_local) {
 
 RC YCSBTxnManager::run_ycsb_1(access_t acctype, row_t * row_local) {
   if (acctype == RD || acctype == SCAN) {
+    if (row_local == NULL) return RCOK;
     int fid = 0;
         char * data = row_local->get_data();
         uint64_t fval __attribute__ ((unused));
-    fval = *(uint64_t *)(&data[fid * 100]);
+    fval = *(uint64_t *)(&data[ycsb_schema::MAIN_TABLE::columns[fid].offset]);
 #if ISOLATION_LEVEL == READ_COMMITTED || ISOLATION_LEVEL == READ_UNCOMMITTED
     // Release lock after read
     release_last_row_lock();
@@ -242,8 +300,10 @@ RC YCSBTxnManager::run_ycsb_1(access_t acctype, row_t * row_local) {
   } else {
     assert(acctype == WR);
         int fid = 0;
+      uint32_t offset = ycsb_schema::MAIN_TABLE::columns[fid].offset;
+      log_undo(row_local, offset, sizeof(uint64_t));
       char * data = row_local->get_data();
-      *(uint64_t *)(&data[fid * 100]) = 0;
+      *(uint64_t *)(&data[offset]) = 0;
 #if YCSB_ABORT_MODE
     if (data[0] == 'a') return RCOK;
 #endif
@@ -337,18 +397,22 @@ RC YCSBTxnManager::run_ycsb() {
   for (uint64_t i = 0; i < ycsb_query->requests.size(); i++) {
       ycsb_request * req = ycsb_query->requests[i];
     if (this->phase == CALVIN_LOC_RD && req->acctype == WR) continue;
-    if (this->phase == CALVIN_EXEC_WR && req->acctype == RD) continue;
+    if (this->phase == CALVIN_EXEC_WR && req->acctype != WR) continue;
 
         uint64_t part_id = _wl->key_to_part( req->key );
     bool loc = GET_NODE_ID(part_id) == g_node_id;
 
     if (!loc) continue;
 
-    rc = run_ycsb_0(req,row);
-    assert(rc == RCOK);
+    scan_row_cnt = 0;
+    do {
+      rc = run_ycsb_0(req,row);
+      assert(rc == RCOK);
 
-    rc = run_ycsb_1(req->acctype,row);
-    assert(rc == RCOK);
+      rc = run_ycsb_1(req->acctype,row);
+      assert(rc == RCOK);
+    } while (req->acctype == SCAN && row != NULL && scan_row_cnt < req->scan_len);
+    scan_row_cnt = 0;
   }
   return rc;
 
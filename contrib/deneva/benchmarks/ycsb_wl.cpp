@@ -30,6 +30,7 @@
 #include "row_mvcc.h"
 #include "mem_alloc.h"
 #include "query.h"
+#include "snapshot.h"
 
 int YCSBWorkload::next_tid;
 
@@ -52,7 +53,10 @@ RC YCSBWorkload::init() {
 
   printf("Initializing table... ");
   fflush(stdout);
-    init_table_parallel();
+    if (!TableSnapshot::load(this)) {
+        init_table_parallel();
+        TableSnapshot::save(this);
+    }
   printf("Done\n");
   fflush(stdout);
 //    init_table();
@@ -63,6 +67,7 @@ RC YCSBWorkload::init_schema(const char * schema_file) {
     Workload::init_schema(schema_file);
     the_table = tables["MAIN_TABLE"];
     the_index = indexes["MAIN_INDEX"];
+    check_layouts(ycsb_schema::layouts);
     return RCOK;
 }
 
@@ -138,6 +143,7 @@ void YCSBWorkload::init_table_parallel() {
             exit(-1);
         }
     }
+    index_load_finish(the_index);
     enable_thread_mem_pool = false;
 }
 
@@ -149,15 +155,12 @@ void * YCSBWorkload::init_table_slice() {
   uint64_t key_cnt = 0;
     while ((UInt32)ATOM_FETCH_ADD(next_tid, 0) < g_init_parallelism) {}
     assert((UInt32)ATOM_FETCH_ADD(next_tid, 0) == g_init_parallelism);
+    // each thread loads a contiguous slice of keys, so the keys it passes to the loader ascend
+    IndexLoader loader(the_index);
     uint64_t slice_size = g_synth_table_size / g_init_parallelism;
-    for (uint64_t key = slice_size * tid;
-            key < slice_size * (tid + 1);
-            //key ++
-    ) {
-    if(GET_NODE_ID(key_to_part(key)) != g_node_id) {
-      ++key;
-      continue;
-    }
+    for (uint64_t key = slice_size * tid; key < slice_size * (tid + 1); key++) {
+        int part_id = key_to_part(key); // % g_part_cnt;
+    if(GET_NODE_ID(part_id) != g_node_id) continue;
 
     ++key_cnt;
     if(key_cnt % 500000 == 0) {
@@ -166,7 +169,6 @@ void * YCSBWorkload::init_table_slice() {
 //        printf("tid=%d. key=%ld\n", tid, key);
         row_t * new_row = NULL;
         uint64_t row_id;
-        int part_id = key_to_part(key); // % g_part_cnt;
         rc = the_table->get_new_row(new_row, part_id, row_id);
         assert(rc == RCOK);
 //        uint64_t value = rand();
@@ -186,18 +188,9 @@ void * YCSBWorkload::init_table_slice() {
         }
 #endif
 
-        itemid_t * m_item =
-            (itemid_t *) mem_allocator.alloc( sizeof(itemid_t));
-        assert(m_item != NULL);
-        m_item->type = DT_row;
-        m_item->location = new_row;
-        m_item->valid = true;
-        uint64_t idx_key = primary_key;
-
-        rc = the_index->index_insert(idx_key, m_item, part_id);
-        assert(rc == RCOK);
-    key += g_part_cnt;
+        loader.load(primary_key, new_row, part_id);
     }
+    loader.flush();
   printf("Thd %d inserted %ld keys\n",tid,key_cnt);
     return NULL;
 }
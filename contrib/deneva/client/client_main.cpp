@@ -49,6 +49,7 @@ int main(int argc, char *argv[]) {
     printf("Running client...\n\n");
     // 0. initialize global data structure
     parser(argc, argv);
+    mem_allocator.init();
     assert(g_node_id >= g_node_cnt);
     //assert(g_client_node_cnt <= g_node_cnt);
 
@@ -204,6 +205,7 @@ int main(int argc, char *argv[]) {
     printf("CLIENT PASS! SimTime = %ld\n", endtime - starttime);
     if (STATS_ENABLE) stats.print_client(false);
     fflush(stdout);
+    tport_man.shutdown();
     return 0;
 }
 
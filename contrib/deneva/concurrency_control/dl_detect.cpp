@@ -0,0 +1,270 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "dl_detect.h"
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "row_lock.h"
+#include "txn.h"
+
+// the first word of an event in a DlBuffer, WAIT events are followed by their edges
+#define DL_EVENT_WAIT 1
+#define DL_EVENT_END 0
+#define DL_WAIT_WORDS 8
+#define DL_EDGE_WORDS 2
+#define DL_END_WORDS 3
+
+struct dl_frame {
+    uint64_t txn_id;
+    DlWait * wait;
+    uint64_t edge;
+};
+
+void DlDetector::init() {
+    buf_cnt = g_total_thread_cnt;
+    bufs = (DlBuffer *) mem_allocator.align_alloc(sizeof(DlBuffer) * buf_cnt);
+    for (uint64_t i = 0; i < buf_cnt; i++) {
+        bufs[i].data = (uint64_t *) mem_allocator.alloc(sizeof(uint64_t) * DL_BUF_SIZE);
+        bufs[i].filled = 0;
+        bufs[i].drained = 0;
+        bufs[i].edges = new std::vector<DlEdge>();
+    }
+    detect_thd = UINT64_MAX;
+    pass = 0;
+    last_detect = 0;
+}
+
+void DlDetector::write_word(DlBuffer & buf, uint64_t & pos, uint64_t word) {
+    buf.data[pos % DL_BUF_SIZE] = word;
+    pos++;
+}
+
+void DlDetector::wait_begin(uint64_t thd_id) { bufs[thd_id].edges->clear(); }
+
+void DlDetector::wait_for(uint64_t thd_id, TxnManager * txn) {
+    bufs[thd_id].edges->push_back(DlEdge{txn->get_txn_id(), txn->dl_restart_cnt});
+}
+
+void DlDetector::wait_publish(uint64_t thd_id, TxnManager * txn, Row_lock * lock) {
+    DlBuffer & buf = bufs[thd_id];
+    const std::vector<DlEdge> & edges = *buf.edges;
+    uint64_t size = DL_WAIT_WORDS + DL_EDGE_WORDS * edges.size();
+    assert(size <= DL_BUF_SIZE);
+    // wait for the detector thread to make room
+    while (buf.filled + size - __atomic_load_n(&buf.drained, __ATOMIC_ACQUIRE) > DL_BUF_SIZE) {
+        if (simulation->is_done()) return;
+    }
+    uint64_t pos = buf.filled;
+    write_word(buf, pos, (edges.size() << 1) | DL_EVENT_WAIT);
+    write_word(buf, pos, txn->get_txn_id());
+    write_word(buf, pos, txn->dl_wait_seq);
+    write_word(buf, pos, txn->dl_restart_cnt);
+    write_word(buf, pos, txn->get_timestamp());
+    write_word(buf, pos, get_sys_clock());
+    write_word(buf, pos, (uint64_t) lock);
+    write_word(buf, pos, (uint64_t) txn);
+    for (const DlEdge & edge : edges) {
+        write_word(buf, pos, edge.txn_id);
+        write_word(buf, pos, edge.restart);
+    }
+    __atomic_store_n(&buf.filled, pos, __ATOMIC_RELEASE);
+}
+
+void DlDetector::wait_done(uint64_t thd_id, uint64_t txn_id, uint64_t seq) {
+    // the detector granted the lock while it aborted a waiter
+    if (thd_id == detect_thd) {
+        end_wait(txn_id, seq);
+        return;
+    }
+    DlBuffer & buf = bufs[thd_id];
+    while (buf.filled + DL_END_WORDS - __atomic_load_n(&buf.drained, __ATOMIC_ACQUIRE) >
+           DL_BUF_SIZE) {
+        if (simulation->is_done()) return;
+    }
+    uint64_t pos = buf.filled;
+    write_word(buf, pos, DL_EVENT_END);
+    write_word(buf, pos, txn_id);
+    write_word(buf, pos, seq);
+    __atomic_store_n(&buf.filled, pos, __ATOMIC_RELEASE);
+}
+
+// Moves the events of all buffers to pending, without looking at them. Events always end up in
+// pending whole.
+void DlDetector::drain() {
+    for (uint64_t i = 0; i < buf_cnt; i++) {
+        DlBuffer & buf = bufs[i];
+        uint64_t end = __atomic_load_n(&buf.filled, __ATOMIC_ACQUIRE);
+        for (uint64_t pos = buf.drained; pos < end; pos++) {
+            pending.push_back(buf.data[pos % DL_BUF_SIZE]);
+        }
+        __atomic_store_n(&buf.drained, end, __ATOMIC_RELEASE);
+    }
+}
+
+void DlDetector::apply_pending() {
+    uint64_t pos = 0;
+    while (pos < pending.size()) {
+        uint64_t head = pending[pos];
+        if ((head & 1) == DL_EVENT_END) {
+            end_wait(pending[pos + 1], pending[pos + 2]);
+            pos += DL_END_WORDS;
+            continue;
+        }
+        DlWait wait;
+        uint64_t txn_id = pending[pos + 1];
+        wait.seq = pending[pos + 2];
+        wait.restart = pending[pos + 3];
+        wait.ts = pending[pos + 4];
+        wait.starttime = pending[pos + 5];
+        wait.lock = (Row_lock *) pending[pos + 6];
+        wait.txn = (TxnManager *) pending[pos + 7];
+        pos += DL_WAIT_WORDS;
+        wait.edges.resize(head >> 1);
+        for (DlEdge & edge : wait.edges) {
+            edge.txn_id = pending[pos];
+            edge.restart = pending[pos + 1];
+            pos += DL_EDGE_WORDS;
+        }
+        wait.removed = false;
+        wait.visit = 0;
+        wait.on_stack = false;
+        add_wait(txn_id, wait);
+    }
+    pending.clear();
+}
+
+// The events of a transaction can come from different buffers, so a wait may end before it
+// begins here. A transaction waits for one lock at a time, and seq orders its waits.
+void DlDetector::add_wait(uint64_t txn_id, DlWait & wait) {
+    auto e = ended.find(txn_id);
+    if (e != ended.end() && e->second.seq >= wait.seq) {
+        if (e->second.seq == wait.seq) ended.erase(e);
+        return;
+    }
+    auto w = waits.find(txn_id);
+    if (w != waits.end() && w->second.seq > wait.seq) return;
+    waits[txn_id] = wait;
+    added.push_back(txn_id);
+}
+
+void DlDetector::end_wait(uint64_t txn_id, uint64_t seq) {
+    auto w = waits.find(txn_id);
+    if (w != waits.end()) {
+        if (w->second.seq <= seq) w->second.removed = true;
+        if (w->second.seq >= seq) return;
+    }
+    DlEnd & e = ended[txn_id];
+    if (e.seq < seq) e.seq = seq;
+    e.time = last_detect;
+}
+
+// Returns false if the transaction does not wait any more.
+bool DlDetector::abort_waiter(uint64_t thd_id, uint64_t txn_id, DlWait & wait) {
+    if (wait.removed) return false;
+    RC rc;
+    while ((rc = wait.lock->lock_abort(wait.txn, txn_id, wait.seq, thd_id)) == WAIT) {
+        // the holder of the latch may wait for room in its buffer
+        drain();
+    }
+    wait.removed = true;
+    return rc == RCOK;
+}
+
+// A DFS from the waits added since the last pass. A back edge closes a cycle on the stack; once
+// its youngest waiter is aborted, the DFS goes on from below it, and the waits above it can be
+// visited again. The edges of a wait never change and every pass breaks the cycles it reaches, so
+// a cycle that is new to this pass goes through a new wait.
+void DlDetector::find_cycles(uint64_t thd_id) {
+    pass++;
+    std::vector<dl_frame> stack;
+    for (uint64_t txn_id : added) {
+        auto root = waits.find(txn_id);
+        if (root == waits.end() || root->second.removed || root->second.visit == pass) continue;
+        root->second.visit = pass;
+        root->second.on_stack = true;
+        stack.push_back(dl_frame{root->first, &root->second, 0});
+        while (!stack.empty()) {
+            dl_frame & top = stack.back();
+            DlWait & wait = *top.wait;
+            if (wait.removed || top.edge == wait.edges.size()) {
+                wait.on_stack = false;
+                stack.pop_back();
+                continue;
+            }
+            const DlEdge & edge = wait.edges[top.edge++];
+            auto n = waits.find(edge.txn_id);
+            // the run of the transaction the edge was recorded for is over
+            if (n == waits.end() || n->second.removed || n->second.restart != edge.restart)
+                continue;
+            DlWait & next = n->second;
+            if (next.visit != pass) {
+                next.visit = pass;
+                next.on_stack = true;
+                stack.push_back(dl_frame{n->first, &next, 0});
+                continue;
+            }
+            if (!next.on_stack) continue;
+
+            uint64_t first = stack.size() - 1;
+            while (stack[first].wait != &next) first--;
+            uint64_t victim = first;
+            for (uint64_t i = first + 1; i < stack.size(); i++) {
+                const DlWait & v = *stack[victim].wait;
+                if (stack[i].wait->ts > v.ts ||
+                    (stack[i].wait->ts == v.ts && stack[i].txn_id > stack[victim].txn_id))
+                    victim = i;
+            }
+            if (abort_waiter(thd_id, stack[victim].txn_id, *stack[victim].wait)) {
+                INC_STATS(thd_id,dl_cycle_cnt,1);
+            }
+            for (uint64_t i = victim; i < stack.size(); i++) {
+                stack[i].wait->on_stack = false;
+                if (i > victim) stack[i].wait->visit = 0;
+            }
+            stack.resize(victim);
+        }
+    }
+    added.clear();
+}
+
+void DlDetector::detect(uint64_t thd_id) {
+    detect_thd = thd_id;
+    uint64_t starttime = get_sys_clock();
+    if (starttime < last_detect + DL_DETECT_INTVL) {
+        usleep((last_detect + DL_DETECT_INTVL - starttime) / 1000);
+        return;
+    }
+    if (last_detect > 0) INC_STATS(thd_id,dl_detect_intvl_time,starttime - last_detect);
+    last_detect = starttime;
+
+    drain();
+    apply_pending();
+    find_cycles(thd_id);
+    // a cycle across nodes is never in the graph
+    for (auto & w : waits) {
+        if (!w.second.removed && starttime > w.second.starttime + DL_DETECT_TIMEOUT &&
+            abort_waiter(thd_id, w.first, w.second)) {
+            INC_STATS(thd_id,dl_timeout_cnt,1);
+        }
+    }
+    for (auto w = waits.begin(); w != waits.end();) {
+        if (w->second.removed) w = waits.erase(w);
+        else w++;
+    }
+    // Every pass drains all buffers, so the begin of a wait comes soon after its end, if at all.
+    // The ends of waits that were erased before their end came, because the detector aborted
+    // them or a later wait of the transaction replaced them, never find a begin.
+    for (auto e = ended.begin(); e != ended.end();) {
+        if (starttime > e->second.time + DL_DETECT_TIMEOUT) e = ended.erase(e);
+        else e++;
+    }
+
+    INC_STATS(thd_id,dl_detect_cnt,1);
+    INC_STATS(thd_id,dl_detect_time,get_sys_clock() - starttime);
+}
@@ -0,0 +1,110 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _DL_DETECT_H_
+#define _DL_DETECT_H_
+
+#include <unordered_map>
+
+#include "global.h"
+
+class Row_lock;
+class TxnManager;
+
+// words of the ring of one DlBuffer
+#define DL_BUF_SIZE (1UL << 16)
+
+// A transaction a wait waits for. A transaction keeps its txn_id when it restarts, so the edge
+// names the run of it that the waiter saw as well.
+struct DlEdge {
+    uint64_t txn_id;
+    uint64_t restart;
+};
+
+// The wait events of one thread. The counters only grow; data is a ring of DL_BUF_SIZE words.
+struct DlBuffer {
+    uint64_t * data;
+    volatile uint64_t filled;
+    volatile uint64_t drained;
+    // edges of the wait being published
+    std::vector<DlEdge> * edges;
+    char pad[CL_SIZE - 4 * sizeof(uint64_t)];
+};
+
+// A transaction waiting for a lock, and the transactions it waits for.
+struct DlWait {
+    uint64_t seq;
+    // the run of the waiter, as in TxnManager::dl_restart_cnt
+    uint64_t restart;
+    ts_t ts;
+    uint64_t starttime;
+    Row_lock * lock;
+    TxnManager * txn;
+    std::vector<DlEdge> edges;
+    // the wait ended in this pass
+    bool removed;
+    // DFS state, visit is the pass that visited the wait last
+    uint64_t visit;
+    bool on_stack;
+};
+
+// The end of a wait the detector did not see begin, and the start of the pass that saw it end.
+struct DlEnd {
+    uint64_t seq;
+    uint64_t time;
+};
+
+/*
+   [DL_DETECT] A transaction that has to wait for a lock publishes a wait event to the DlBuffer of
+   its thread: the transactions that own the lock or queue for it before it. Whoever grants the
+   lock publishes that the wait ended. Every DL_DETECT_INTVL the detector thread drains the
+   buffers into its waits-for graph and runs a DFS from the waits that are new to it, which finds
+   the cycles that formed since the last pass. For each cycle it aborts the youngest waiter, by taking it out of the
+   lock queue and restarting it with dl_victim set. An edge only leads to the wait of the run of
+   the transaction it was recorded for; an owner that restarted since holds none of its locks any
+   more. Only the waits on this node are in the graph,
+   so a waiter that waited for longer than DL_DETECT_TIMEOUT is aborted as well.
+
+   The detector reads a TxnManager only under the latch of the lock the transaction waits for,
+   where it can be sure that the transaction still waits.
+*/
+class DlDetector {
+public:
+    void init();
+    // called under the latch of the lock
+    void wait_begin(uint64_t thd_id);
+    void wait_for(uint64_t thd_id, TxnManager * txn);
+    void wait_publish(uint64_t thd_id, TxnManager * txn, Row_lock * lock);
+    void wait_done(uint64_t thd_id, uint64_t txn_id, uint64_t seq);
+    // the detector thread
+    void detect(uint64_t thd_id);
+
+private:
+    void write_word(DlBuffer & buf, uint64_t & pos, uint64_t word);
+    void drain();
+    void apply_pending();
+    void add_wait(uint64_t txn_id, DlWait & wait);
+    void end_wait(uint64_t txn_id, uint64_t seq);
+    bool abort_waiter(uint64_t thd_id, uint64_t txn_id, DlWait & wait);
+    void find_cycles(uint64_t thd_id);
+
+    DlBuffer * bufs;
+    uint64_t buf_cnt;
+    // for the detector thread
+    uint64_t detect_thd;
+    std::vector<uint64_t> pending;
+    std::unordered_map<uint64_t, DlWait> waits;
+    // the transactions whose wait was added since the last pass, where the DFS starts
+    std::vector<uint64_t> added;
+    // the waits that ended before the detector saw them begin, kept for DL_DETECT_TIMEOUT
+    std::unordered_map<uint64_t, DlEnd> ended;
+    uint64_t pass;
+    uint64_t last_detect;
+};
+
+#endif
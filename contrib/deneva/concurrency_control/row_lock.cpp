@@ -14,6 +14,7 @@
     limitations under the License.
 */
 
+#include "dl_detect.h"
 #include "helper.h"
 #include "manager.h"
 #include "mem_alloc.h"
@@ -39,9 +40,135 @@ void Row_lock::init(row_t * row) {
     lock_type = LOCK_NONE;
     blatch = false;
     own_starttime = 0;
+#if LOCK_WORD_FAST
+    lock_word = 0;
+    owner_ts = UINT64_MAX;
+    word_owner_cnt = 0;
+    word_owner_ts = 0;
+#endif
+}
 
+#if LOCK_WORD_FAST
+bool Row_lock::lock_get_fast(lock_t type, TxnManager * txn, RC & rc) {
+    uint64_t word = __atomic_load_n(&lock_word, __ATOMIC_ACQUIRE);
+    while (true) {
+        if (word & LOCK_WORD_RESET) {
+            word = __atomic_load_n(&lock_word, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        if (word & LOCK_WORD_INFLATED) return false;
+#if TWOPL_LITE
+        bool conflict = (word & LOCK_WORD_OWNERS) != 0;
+#else
+        bool conflict = (word & LOCK_WORD_EX) || (type == LOCK_EX && (word & LOCK_WORD_OWNERS));
+#endif
+        if (conflict) {
+#if CC_ALG == NO_WAIT
+            INC_STATS(txn->get_thd_id(),twopl_already_owned_cnt,1);
+            DEBUG("abort %ld,%ld %ld %lx\n", txn->get_txn_id(), txn->get_batch_id(),
+                _row->get_primary_key(), (uint64_t)_row);
+            rc = Abort;
+            return true;
+#else
+            return false;
+#endif
+        }
+#if CC_ALG == WAIT_DIE
+        // published before the owner is counted in the word, so inflate() sees it
+        ts_t ts = owner_ts;
+        while (txn->get_timestamp() < ts &&
+               !__atomic_compare_exchange_n(&owner_ts, &ts, txn->get_timestamp(), false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+        }
+#endif
+        uint64_t new_word = type == LOCK_EX ? word | LOCK_WORD_EX : word + 1;
+        if (__atomic_compare_exchange_n(&lock_word, &word, new_word, false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_ACQUIRE))
+            break;
+    }
+    if (word & LOCK_WORD_OWNERS) {
+        INC_STATS(txn->get_thd_id(),twopl_already_owned_cnt,1);
+        INC_STATS(txn->get_thd_id(),twopl_sh_bypass_cnt,1);
+    } else {
+        own_starttime = get_sys_clock();
+    }
+    rc = RCOK;
+    return true;
 }
 
+bool Row_lock::lock_release_fast(TxnManager * txn) {
+    uint64_t word = __atomic_load_n(&lock_word, __ATOMIC_ACQUIRE);
+    bool last = false;
+    while (true) {
+        if (word & LOCK_WORD_INFLATED) return false;
+        assert(word & LOCK_WORD_OWNERS);
+        last = (word & LOCK_WORD_EX) || (word & LOCK_WORD_SH_CNT) == 1;
+        uint64_t new_word = word - 1;
+        if (last) {
+#if CC_ALG == WAIT_DIE
+            new_word = (word & LOCK_WORD_GEN) | LOCK_WORD_RESET;
+#else
+            new_word = 0;
+#endif
+        }
+        if (__atomic_compare_exchange_n(&lock_word, &word, new_word, false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_ACQUIRE))
+            break;
+    }
+    if (last) {
+#if CC_ALG == WAIT_DIE
+        owner_ts = UINT64_MAX;
+        __atomic_store_n(&lock_word, ((word & LOCK_WORD_GEN) + LOCK_WORD_GEN_ONE) & LOCK_WORD_GEN,
+                         __ATOMIC_RELEASE);
+#endif
+        uint64_t endtime = get_sys_clock();
+        INC_STATS(txn->get_thd_id(),twopl_owned_cnt,1);
+        INC_STATS(txn->get_thd_id(),twopl_owned_time,endtime - own_starttime);
+        if (word & LOCK_WORD_EX) {
+            INC_STATS(txn->get_thd_id(),twopl_ex_owned_time,endtime - own_starttime);
+            INC_STATS(txn->get_thd_id(),twopl_ex_owned_cnt,1);
+        } else {
+            INC_STATS(txn->get_thd_id(),twopl_sh_owned_time,endtime - own_starttime);
+            INC_STATS(txn->get_thd_id(),twopl_sh_owned_cnt,1);
+        }
+    }
+    return true;
+}
+
+// Called with the latch held. The owners in the word join the owners of the queue structures.
+void Row_lock::inflate() {
+    uint64_t word = __atomic_load_n(&lock_word, __ATOMIC_ACQUIRE);
+    while (!(word & LOCK_WORD_INFLATED)) {
+        if (word & LOCK_WORD_RESET) {
+            word = __atomic_load_n(&lock_word, __ATOMIC_ACQUIRE);
+            continue;
+        }
+        if (!__atomic_compare_exchange_n(&lock_word, &word,
+                                         (word & LOCK_WORD_GEN) | LOCK_WORD_INFLATED, false,
+                                         __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE))
+            continue;
+        assert(owner_cnt == 0 && waiters_head == NULL);
+        word_owner_cnt = (word & LOCK_WORD_EX) ? 1 : word & LOCK_WORD_SH_CNT;
+        if (word_owner_cnt > 0) {
+            word_owner_ts = __atomic_load_n(&owner_ts, __ATOMIC_SEQ_CST);
+            owner_cnt = word_owner_cnt;
+            lock_type = (word & LOCK_WORD_EX) ? LOCK_EX : LOCK_SH;
+        }
+        break;
+    }
+}
+
+// Called with the latch held. Once nobody owns or waits for the lock, it goes back to the word.
+void Row_lock::deflate() {
+    if (owner_cnt > 0 || waiters_head != NULL) return;
+    assert(word_owner_cnt == 0);
+    owner_ts = UINT64_MAX;
+    uint64_t word = lock_word;
+    __atomic_store_n(&lock_word, ((word & LOCK_WORD_GEN) + LOCK_WORD_GEN_ONE) & LOCK_WORD_GEN,
+                     __ATOMIC_RELEASE);
+}
+#endif
+
 RC Row_lock::lock_get(lock_t type, TxnManager * txn) {
     uint64_t *txnids = NULL;
     int txncnt = 0;
@@ -49,16 +176,29 @@ RC Row_lock::lock_get(lock_t type, TxnManager * txn) {
 }
 
 RC Row_lock::lock_get(lock_t type, TxnManager * txn, uint64_t* &txnids, int &txncnt) {
-    assert (CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == CALVIN);
+    assert (CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == CALVIN);
     RC rc;
     uint64_t starttime = get_sys_clock();
     uint64_t lock_get_start_time = starttime;
+#if LOCK_WORD_FAST
+    if (!g_central_man && lock_get_fast(type, txn, rc)) {
+        uint64_t timespan = get_sys_clock() - starttime;
+        txn->txn_stats.cc_time += timespan;
+        txn->txn_stats.cc_time_short += timespan;
+        INC_STATS(txn->get_thd_id(),twopl_getlock_time,timespan);
+        INC_STATS(txn->get_thd_id(),twopl_getlock_cnt,1);
+        return rc;
+    }
+#endif
     if (g_central_man) {
         glob_manager.lock_row(_row);
     } else {
         uint64_t mtx_wait_starttime = get_sys_clock();
         pthread_mutex_lock( latch );
         INC_STATS(txn->get_thd_id(),mtx[17],get_sys_clock() - mtx_wait_starttime);
+#if LOCK_WORD_FAST
+        inflate();
+#endif
     }
     INC_STATS(txn->get_thd_id(), trans_access_lock_wait_time, get_sys_clock() - lock_get_start_time);
     if(owner_cnt > 0) {
@@ -73,7 +213,8 @@ RC Row_lock::lock_get(lock_t type, TxnManager * txn, uint64_t* &txnids, int &txn
             conflict = true;
         }
     }
-    if (CC_ALG == CALVIN && !conflict) {
+    // [DL_DETECT] a waiter waits for the owners it saw, so nobody may join them past it
+    if ((CC_ALG == CALVIN || CC_ALG == DL_DETECT) && !conflict) {
         if (waiters_head) conflict = true;
     }
 
@@ -116,6 +257,13 @@ RC Row_lock::lock_get(lock_t type, TxnManager * txn, uint64_t* &txnids, int &txn
                 }
                 if (!canwait) break;
             }
+#if LOCK_WORD_FAST
+            if (word_owner_cnt > 0 && txn->get_timestamp() > word_owner_ts) {
+                INC_STATS(txn->get_thd_id(), twopl_diff_time,
+                    (txn->get_timestamp() - word_owner_ts));
+                canwait = false;
+            }
+#endif
             if (canwait) {
                 // insert txn to the right position
                 // the waiter list is always in timestamp order
@@ -153,6 +301,29 @@ RC Row_lock::lock_get(lock_t type, TxnManager * txn, uint64_t* &txnids, int &txn
                     _row->get_primary_key(), (uint64_t)_row);
                 rc = Abort;
             }
+        } else if (CC_ALG == DL_DETECT) {
+            // wait at the tail, for the owners and everybody waiting before
+            LockEntry * entry = get_entry();
+            entry->start_ts = get_sys_clock();
+            entry->txn = txn;
+            entry->type = type;
+            ATOM_CAS(txn->lock_ready,1,0);
+            txn->incr_lr();
+            txn->dl_wait_seq ++;
+            dl_detector.wait_begin(txn->get_thd_id());
+            for (uint64_t i = 0; i < owners_size; i++) {
+                for (LockEntry * en = owners[i]; en != NULL; en = en->next)
+                    dl_detector.wait_for(txn->get_thd_id(), en->txn);
+            }
+            for (LockEntry * en = waiters_head; en != NULL; en = en->next)
+                dl_detector.wait_for(txn->get_thd_id(), en->txn);
+            dl_detector.wait_publish(txn->get_thd_id(), txn, this);
+            LIST_PUT_TAIL(waiters_head, waiters_tail, entry);
+            waiter_cnt ++;
+            DEBUG("lk_wait (%ld,%ld): owners %d, own type %d, req type %d, key %ld %lx\n",
+                txn->get_txn_id(), txn->get_batch_id(), owner_cnt, lock_type, type,
+                _row->get_primary_key(), (uint64_t)_row);
+            rc = WAIT;
         } else if (CC_ALG == CALVIN){
             LockEntry * entry = get_entry();
             entry->start_ts = get_sys_clock();
@@ -215,9 +386,12 @@ final:
 
     if (g_central_man)
         glob_manager.release_row(_row);
-    else
+    else {
+#if LOCK_WORD_FAST
+        deflate();
+#endif
         pthread_mutex_unlock( latch );
-
+    }
 
     return rc;
 }
@@ -231,6 +405,16 @@ RC Row_lock::lock_release(TxnManager * txn) {
     }
 #endif
     uint64_t starttime = get_sys_clock();
+#if LOCK_WORD_FAST
+    if (!g_central_man && lock_release_fast(txn)) {
+        uint64_t timespan = get_sys_clock() - starttime;
+        txn->txn_stats.cc_time += timespan;
+        txn->txn_stats.cc_time_short += timespan;
+        INC_STATS(txn->get_thd_id(),twopl_release_time,timespan);
+        INC_STATS(txn->get_thd_id(),twopl_release_cnt,1);
+        return RCOK;
+    }
+#endif
     if (g_central_man) glob_manager.lock_row(_row);
     else {
         uint64_t mtx_wait_starttime = get_sys_clock();
@@ -271,10 +455,19 @@ RC Row_lock::lock_release(TxnManager * txn) {
         en = en->next;
     }
 
-    if (en) { // find the entry in the owner list
-        if (prev) prev->next = en->next;
-        else owners[hash(txn->get_txn_id())] = en->next;
-        return_entry(en);
+#if LOCK_WORD_FAST
+    // not in the list, so one of the owners the word had when the lock was inflated
+    bool word_owner = en == NULL && word_owner_cnt > 0;
+    if (word_owner) word_owner_cnt --;
+#else
+    bool word_owner = false;
+#endif
+    if (en || word_owner) {
+        if (en) { // find the entry in the owner list
+            if (prev) prev->next = en->next;
+            else owners[hash(txn->get_txn_id())] = en->next;
+            return_entry(en);
+        }
         owner_cnt --;
         if (owner_cnt == 0) {
             INC_STATS(txn->get_thd_id(),twopl_owned_cnt,1);
@@ -312,6 +505,29 @@ RC Row_lock::lock_release(TxnManager * txn) {
         assert(en->txn->get_txn_id() !=txn->get_txn_id());
 #endif
 
+    grant_waiters(txn->get_thd_id());
+
+    uint64_t timespan = get_sys_clock() - starttime;
+    txn->txn_stats.cc_time += timespan;
+    txn->txn_stats.cc_time_short += timespan;
+    INC_STATS(txn->get_thd_id(),twopl_release_time,timespan);
+    INC_STATS(txn->get_thd_id(),twopl_release_cnt,1);
+
+    if (g_central_man)
+        glob_manager.release_row(_row);
+    else {
+#if LOCK_WORD_FAST
+        deflate();
+#endif
+        pthread_mutex_unlock( latch );
+    }
+
+
+    return RCOK;
+}
+
+// Called with the latch held. Lets the waiters at the head join the owners while they can.
+void Row_lock::grant_waiters(uint64_t thd_id) {
     LockEntry * entry;
     // If any waiter can join the owners, just do it!
     while (waiters_head && !conflict_lock(lock_type, waiters_head->type)) {
@@ -328,7 +544,12 @@ RC Row_lock::lock_release(TxnManager * txn) {
         entry->txn->txn_stats.cc_block_time += timespan;
         entry->txn->txn_stats.cc_block_time_short += timespan;
 #endif
-        INC_STATS(txn->get_thd_id(),twopl_wait_time,timespan);
+        INC_STATS(thd_id,twopl_wait_time,timespan);
+#if CC_ALG == DL_DETECT
+        dl_detector.wait_done(thd_id, entry->txn->get_txn_id(), entry->txn->dl_wait_seq);
+        INC_STATS(thd_id,dl_wait_cnt,1);
+        INC_STATS(thd_id,dl_wait_time,timespan);
+#endif
 
 #if CC_ALG != NO_WAIT
         STACK_PUSH(owners[hash(entry->txn->get_txn_id())], entry);
@@ -346,7 +567,7 @@ RC Row_lock::lock_release(TxnManager * txn) {
                 entry->txn->txn_stats.cc_block_time += timespan;
                 entry->txn->txn_stats.cc_block_time_short += timespan;
 #endif
-                txn_table.restart_txn(txn->get_thd_id(), entry->txn->get_txn_id(),
+                txn_table.restart_txn(thd_id, entry->txn->get_txn_id(),
                         entry->txn->get_batch_id());
             }
         }
@@ -358,20 +579,46 @@ RC Row_lock::lock_release(TxnManager * txn) {
         return_entry(entry);
 #endif
     }
+}
 
-    uint64_t timespan = get_sys_clock() - starttime;
-    txn->txn_stats.cc_time += timespan;
-    txn->txn_stats.cc_time_short += timespan;
-    INC_STATS(txn->get_thd_id(),twopl_release_time,timespan);
-    INC_STATS(txn->get_thd_id(),twopl_release_cnt,1);
-
-    if (g_central_man)
-        glob_manager.release_row(_row);
-    else
-        pthread_mutex_unlock( latch );
-
+// [DL_DETECT] Called by the deadlock detector. If txn still waits here with the wait seq, takes it
+// out of the queue and restarts it as a victim. Returns WAIT if the latch is taken, since its
+// holder can be waiting for the detector to drain a buffer, and ERROR if txn does not wait.
+RC Row_lock::lock_abort(TxnManager * txn, uint64_t txn_id, uint64_t seq, uint64_t thd_id) {
+    if (g_central_man) glob_manager.lock_row(_row);
+    else if (pthread_mutex_trylock(latch) != 0) return WAIT;
+
+    // txn is only looked at once it is known to wait, until then it may be gone
+    LockEntry * en = waiters_head;
+    while (en != NULL && en->txn != txn) en = en->next;
+    RC rc = ERROR;
+    if (en != NULL && txn->get_txn_id() == txn_id && txn->dl_wait_seq == seq) {
+        DEBUG("dl_abort (%ld,%ld): owners %d, own type %d, req type %d, key %ld %lx\n",
+            txn->get_txn_id(), txn->get_batch_id(), owner_cnt, lock_type, en->type,
+            _row->get_primary_key(), (uint64_t)_row);
+        LIST_REMOVE(en);
+        if (en == waiters_head) waiters_head = en->next;
+        if (en == waiters_tail) waiters_tail = en->prev;
+        return_entry(en);
+        waiter_cnt --;
+        uint64_t timespan = get_sys_clock() - txn->twopl_wait_start;
+        txn->twopl_wait_start = 0;
+        txn->txn_stats.cc_block_time += timespan;
+        txn->txn_stats.cc_block_time_short += timespan;
+        INC_STATS(thd_id,dl_wait_cnt,1);
+        INC_STATS(thd_id,dl_wait_time,timespan);
+        txn->dl_victim = true;
+        if(txn->decr_lr() == 0 && ATOM_CAS(txn->lock_ready,false,true)) {
+            txn_table.restart_txn(thd_id, txn_id, txn->get_batch_id());
+        }
+        // the waiters behind it may not have to wait any more
+        grant_waiters(thd_id);
+        rc = RCOK;
+    }
 
-    return RCOK;
+    if (g_central_man) glob_manager.release_row(_row);
+    else pthread_mutex_unlock( latch );
+    return rc;
 }
 
 bool Row_lock::conflict_lock(lock_t l1, lock_t l2) {
@@ -17,6 +17,26 @@
 #ifndef ROW_LOCK_H
 #define ROW_LOCK_H
 
+/*
+   With ROW_LOCK_WORD, NO_WAIT and WAIT_DIE keep the owners of a row in one word while nobody
+   waits: LOCK_WORD_EX, or the number of LOCK_SH owners. Taking or releasing such a lock is a CAS,
+   without the latch or a LockEntry. NO_WAIT never needs more. Under WAIT_DIE a conflict takes the
+   latch and inflates the lock: the owners in the word become anonymous owners of the queue
+   structures below, and every request goes through the latch until the lock is free again.
+   owner_ts is at most the timestamp of the oldest owner in the word, which the wait-die rule
+   needs; owners publish it before they count themselves in.
+*/
+#define LOCK_WORD_FAST      (ROW_LOCK_WORD && (CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE))
+#define LOCK_WORD_EX        (1UL << 63)
+#define LOCK_WORD_INFLATED  (1UL << 62)
+// the last owner is resetting owner_ts
+#define LOCK_WORD_RESET     (1UL << 61)
+// bumped whenever the lock becomes free, so that a stale CAS fails
+#define LOCK_WORD_GEN_ONE   (1UL << 32)
+#define LOCK_WORD_GEN       ((LOCK_WORD_RESET - 1) & ~(LOCK_WORD_GEN_ONE - 1))
+#define LOCK_WORD_SH_CNT    (LOCK_WORD_GEN_ONE - 1)
+#define LOCK_WORD_OWNERS    (LOCK_WORD_EX | LOCK_WORD_SH_CNT)
+
 struct LockEntry {
     lock_t type;
     ts_t   start_ts;
@@ -32,11 +52,27 @@ public:
     RC lock_get(lock_t type, TxnManager * txn);
     RC lock_get(lock_t type, TxnManager * txn, uint64_t* &txnids, int &txncnt);
     RC lock_release(TxnManager * txn);
+    // [DL_DETECT] the deadlock detector aborts a waiter
+    RC lock_abort(TxnManager * txn, uint64_t txn_id, uint64_t seq, uint64_t thd_id);
 
 private:
     pthread_mutex_t * latch;
     bool blatch;
 
+#if LOCK_WORD_FAST
+    volatile uint64_t lock_word;
+    volatile uint64_t owner_ts;
+    // Return false to take the latch.
+    bool lock_get_fast(lock_t type, TxnManager * txn, RC & rc);
+    bool lock_release_fast(TxnManager * txn);
+    void inflate();
+    void deflate();
+    // owners that took the lock in the word before it was inflated
+    UInt32 word_owner_cnt;
+    ts_t word_owner_ts;
+#endif
+
+    void         grant_waiters(uint64_t thd_id);
     bool         conflict_lock(lock_t l1, lock_t l2);
     LockEntry * get_entry();
     void         return_entry(LockEntry * entry);
@@ -20,67 +20,82 @@
 #include "manager.h"
 #include "row_mvcc.h"
 #include "mem_alloc.h"
+#include "pool.h"
+
+static void his_init(MVHistory & his) {
+    his.vers = his.inline_vers;
+    his.len = 0;
+    his.cap = MVCC_INLINE_VERS;
+}
+
+// Insert ver before the first version that is not newer than it.
+static void his_insert(MVHistory & his, const MVVersion & ver) {
+    if (his.len == his.cap) {
+        MVVersion * vers = (MVVersion *) mem_allocator.alloc(sizeof(MVVersion) * his.cap * 2);
+        memcpy(vers, his.vers, sizeof(MVVersion) * his.len);
+        if (his.vers != his.inline_vers) mem_allocator.free(his.vers, sizeof(MVVersion) * his.cap);
+        his.vers = vers;
+        his.cap *= 2;
+    }
+    uint64_t i = 0;
+    while (i < his.len && ver.ts < his.vers[i].ts) i++;
+    memmove(&his.vers[i + 1], &his.vers[i], sizeof(MVVersion) * (his.len - i));
+    his.vers[i] = ver;
+    his.len++;
+}
+
+// Move a history that fits into the row again back there.
+static void his_shrink(MVHistory & his) {
+    if (his.vers == his.inline_vers || his.len > MVCC_INLINE_VERS) return;
+    memcpy(his.inline_vers, his.vers, sizeof(MVVersion) * his.len);
+    mem_allocator.free(his.vers, sizeof(MVVersion) * his.cap);
+    his.vers = his.inline_vers;
+    his.cap = MVCC_INLINE_VERS;
+}
 
 void Row_mvcc::init(row_t * row) {
     _row = row;
     readreq_mvcc = NULL;
     prereq_mvcc = NULL;
-    readhis = NULL;
-    writehis = NULL;
-    readhistail = NULL;
-    writehistail = NULL;
+    his_init(readhis);
+    his_init(writehis);
+    gc_ts = 0;
     blatch = false;
     latch = (pthread_mutex_t *)mem_allocator.alloc(sizeof(pthread_mutex_t));
     pthread_mutex_init(latch, NULL);
-    whis_len = 0;
-    rhis_len = 0;
     rreq_len = 0;
     preq_len = 0;
 }
 
-row_t * Row_mvcc::clear_history(TsType type, ts_t ts) {
-    MVHisEntry ** queue;
-    MVHisEntry ** tail;
-    switch (type) {
-    case R_REQ:
-        queue = &readhis;
-        tail = &readhistail;
-        break;
-    case W_REQ:
-        queue = &writehis;
-        tail = &writehistail;
-        break;
-    default:
-        assert(false);
+// Drop the versions that no active transaction can see any more. Here is a tricky bug. The oldest
+// transaction might be reading an even older version whose timestamp < t_th. But we cannot
+// recycle that version because it is still being used. So the first version older than t_th is
+// kept, in both histories.
+void Row_mvcc::clear_history(uint64_t thd_id, ts_t t_th) {
+    uint64_t i = 0;
+    while (i < readhis.len && readhis.vers[i].ts >= t_th) i++;
+    if (i + 1 < readhis.len) {
+        readhis.len = i + 1;
+        his_shrink(readhis);
     }
-    MVHisEntry * his = *tail;
-    MVHisEntry * prev = NULL;
-    row_t * row = NULL;
-    while (his && his->prev && his->prev->ts < ts) {
-        prev = his->prev;
-        assert(prev->ts >= his->ts);
-        if (row != NULL) {
+
+    i = 0;
+    while (i < writehis.len && writehis.vers[i].ts >= t_th) i++;
+    if (i + 1 < writehis.len) {
+        uint64_t now = get_sys_clock();
+        // the base row stands for the newest version dropped
+        _row->copy(writehis.vers[i + 1].row);
+        for (uint64_t j = i + 1; j < writehis.len; j++) {
+            INC_STATS(thd_id, mvcc_gc_lag_time, now - writehis.vers[j - 1].time);
+            row_t * row = writehis.vers[j].row;
             row->free_row();
-            mem_allocator.free(row, sizeof(row_t));
+            row_pool.put(thd_id, row);
         }
-        row = his->row;
-        his->row = NULL;
-        return_his_entry(his);
-        his = prev;
-        if (type == R_REQ) {
-            rhis_len--;
-        } else {
-            whis_len--;
-        }
-    }
-    *tail = his;
-    if (*tail) {
-        (*tail)->next = NULL;
+        INC_STATS(thd_id, mvcc_gc_cnt, writehis.len - i - 1);
+        writehis.len = i + 1;
+        his_shrink(writehis);
     }
-    if (his == NULL) {
-        *queue = NULL;
-    }
-    return row;
+    gc_ts = t_th;
 }
 
 MVReqEntry * Row_mvcc::get_req_entry() {
@@ -91,18 +106,6 @@ void Row_mvcc::return_req_entry(MVReqEntry * entry) {
     mem_allocator.free(entry, sizeof(MVReqEntry));
 }
 
-MVHisEntry * Row_mvcc::get_his_entry() {
-    return (MVHisEntry *) mem_allocator.alloc(sizeof(MVHisEntry));
-}
-
-void Row_mvcc::return_his_entry(MVHisEntry * entry) {
-    if (entry->row != NULL) {
-        entry->row->free_row();
-        mem_allocator.free(entry->row, sizeof(row_t));
-    }
-    mem_allocator.free(entry, sizeof(MVHisEntry));
-}
-
 void Row_mvcc::buffer_req(TsType type, TxnManager *txn) {
     MVReqEntry * req_entry = get_req_entry();
     assert(req_entry != NULL);
@@ -184,25 +187,21 @@ MVReqEntry * Row_mvcc::debuffer_req( TsType type, TxnManager * txn) {
 }
 
 void Row_mvcc::insert_history(ts_t ts, row_t *row) {
-    MVHisEntry * new_entry = get_his_entry();
-    new_entry->ts = ts;
-    new_entry->row = row;
-    if (row != NULL)
-        whis_len ++;
-    else
-        rhis_len++;
-    MVHisEntry **queue = (row == NULL) ? &(readhis) : &(writehis);
-    MVHisEntry **tail = (row == NULL) ? &(readhistail) : &(writehistail);
-    MVHisEntry * his = *queue;
-    while (his != NULL && ts < his->ts) {
-        his = his->next;
-    }
+    MVVersion ver;
+    ver.ts = ts;
+    ver.row = row;
+    ver.time = (row != NULL) ? get_sys_clock() : 0;
+    his_insert((row == NULL) ? readhis : writehis, ver);
+}
 
-    if (his) {
-        LIST_INSERT_BEFORE(his, new_entry,(*queue));
-        //if (his == *queue)
-        //    *queue = new_entry;
-    } else LIST_PUT_TAIL((*queue), (*tail), new_entry);
+// The version a transaction with timestamp ts reads, the newest one not newer than ts.
+row_t * Row_mvcc::find_version(ts_t ts) {
+    // the common cases, a single version or a read of the newest one
+    if (writehis.len == 0) return _row;
+    if (writehis.vers[0].ts <= ts) return writehis.vers[0].row;
+    uint64_t i = 1;
+    while (i < writehis.len && writehis.vers[i].ts > ts) i++;
+    return (i == writehis.len) ? _row : writehis.vers[i].row;
 }
 
 bool Row_mvcc::conflict(TsType type, ts_t ts) {
@@ -211,8 +210,8 @@ bool Row_mvcc::conflict(TsType type, ts_t ts) {
     // else
     //      if exists writehis between them, NO conflict!!!!
     //      else, CONFLICT!!!
-    ts_t rts;
-    ts_t pts;
+    ts_t rts = 0;
+    ts_t pts = 0;
     if (type == R_REQ) {
         rts = ts;
         pts = 0;
@@ -228,22 +227,15 @@ bool Row_mvcc::conflict(TsType type, ts_t ts) {
     } else if (type == P_REQ) {
         rts = 0;
         pts = ts;
-        MVHisEntry * his = readhis;
-        while (his != NULL) {
-            if (his->ts > ts) {
-                rts = his->ts;
-            } else
-                break;
-            his = his->next;
+        for (uint64_t i = 0; i < readhis.len && readhis.vers[i].ts > ts; i++) {
+            rts = readhis.vers[i].ts;
         }
         if (rts == 0) // no couple exists
             return false;
         assert(rts > pts);
     }
-    MVHisEntry * whis = writehis;
-    while (whis != NULL && whis->ts > pts) {
-    if (whis->ts < rts) return false;
-        whis = whis->next;
+    for (uint64_t i = 0; i < writehis.len && writehis.vers[i].ts > pts; i++) {
+        if (writehis.vers[i].ts < rts) return false;
     }
     return true;
 }
@@ -274,9 +266,7 @@ RC Row_mvcc::access(TxnManager * txn, TsType type, row_t * row) {
         } else {
             // return results immediately.
             rc = RCOK;
-            MVHisEntry * whis = writehis;
-            while (whis != NULL && whis->ts > ts) whis = whis->next;
-            row_t *ret = (whis == NULL) ? _row : whis->row;
+            row_t *ret = find_version(ts);
             txn->cur_row = ret;
             insert_history(ts, NULL);
             assert(strstr(_row->get_table_name(), ret->get_table_name()));
@@ -312,24 +302,11 @@ RC Row_mvcc::access(TxnManager * txn, TsType type, row_t * row) {
     INC_STATS(txn->get_thd_id(), trans_mvcc_access, get_sys_clock() - acesstime);
     if (rc == RCOK) {
         uint64_t clear_his_starttime = get_sys_clock();
-        if (whis_len > g_his_recycle_len || rhis_len > g_his_recycle_len) {
-            ts_t t_th = glob_manager.get_min_ts(txn->get_thd_id());
-            if (readhistail && readhistail->ts < t_th) {
-                clear_history(R_REQ, t_th);
-            }
-            // Here is a tricky bug. The oldest transaction might be
-            // reading an even older version whose timestamp < t_th.
-            // But we cannot recycle that version because it is still being used.
-            // So the HACK here is to make sure that the first version older than
-            // t_th not be recycled.
-            if (whis_len > 1 && writehistail->prev->ts < t_th) {
-                row_t * latest_row = clear_history(W_REQ, t_th);
-                if (latest_row != NULL) {
-                    assert(_row != latest_row);
-                    _row->copy(latest_row);
-                }
-            }
-        }
+        // versions only become garbage when the watermark moves
+        ts_t t_th = glob_manager.get_min_ts(txn->get_thd_id());
+        if (t_th > gc_ts) clear_history(txn->get_thd_id(), t_th);
+        INC_STATS(txn->get_thd_id(), mvcc_version_len, writehis.len);
+        INC_STATS(txn->get_thd_id(), mvcc_version_cnt, 1);
         uint64_t clear_his_timespan = get_sys_clock() - clear_his_starttime;
         INC_STATS(txn->get_thd_id(), trans_mvcc_clear_history, clear_his_timespan);
     }
@@ -354,11 +331,7 @@ void Row_mvcc::update_buffer(TxnManager * txn) {
 
     while (req != NULL) {
         // find the version for the request
-        MVHisEntry * whis = writehis;
-        while (whis != NULL && whis->ts > req->ts) {
-            whis = whis->next;
-        }
-        row_t *row = (whis == NULL) ? _row : whis->row;
+        row_t *row = find_version(req->ts);
         req->txn->cur_row = row;
         insert_history(req->ts, NULL);
         assert(row->get_data() != NULL);
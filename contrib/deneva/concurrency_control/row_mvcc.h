@@ -28,15 +28,23 @@ struct MVReqEntry {
     MVReqEntry * next;
 };
 
-struct MVHisEntry {
+struct MVVersion {
     ts_t ts;
     // only for write history. The value needs to be stored.
-//    char * data;
     row_t * row;
-    MVHisEntry * next;
-    MVHisEntry * prev;
+    // only for write history. When the version was installed, which is also when the version
+    // before it became garbage.
+    uint64_t time;
 };
 
+// A history sorted newest-first. Most rows have at most MVCC_INLINE_VERS versions, which are
+// kept in the row itself; longer histories move to an array that doubles.
+struct MVHistory {
+    MVVersion * vers;
+    uint64_t len;
+    uint64_t cap;
+    MVVersion inline_vers[MVCC_INLINE_VERS];
+};
 
 
 class Row_mvcc {
@@ -50,25 +58,22 @@ private:
     row_t * _row;
     MVReqEntry * get_req_entry();
     void return_req_entry(MVReqEntry * entry);
-    MVHisEntry * get_his_entry();
-    void return_his_entry(MVHisEntry * entry);
 
     bool conflict(TsType type, ts_t ts);
     void buffer_req(TsType type, TxnManager * txn);
     MVReqEntry * debuffer_req( TsType type, TxnManager * txn = NULL);
     void update_buffer(TxnManager * txn);
     void insert_history( ts_t ts, row_t * row);
+    row_t * find_version(ts_t ts);
 
-    row_t * clear_history(TsType type, ts_t ts);
+    void clear_history(uint64_t thd_id, ts_t ts);
 
     MVReqEntry * readreq_mvcc;
     MVReqEntry * prereq_mvcc;
-    MVHisEntry * readhis;
-    MVHisEntry * writehis;
-    MVHisEntry * readhistail;
-    MVHisEntry * writehistail;
-    uint64_t whis_len;
-    uint64_t rhis_len;
+    MVHistory readhis;
+    MVHistory writehis;
+    // watermark of the last clear_history
+    ts_t gc_ts;
     uint64_t rreq_len;
     uint64_t preq_len;
 };
@@ -44,11 +44,9 @@
 // ! Parameters used to locate distributed performance bottlenecks.
 #define SECOND 100 // Set the queue monitoring time.
 // #define LESS_DIS // Reduce the number of yCSB remote data to 1
-// #define NEW_WORK_QUEUE  // The workQueue data structure has been modified to perform 10,000 better than the original implementation.
 // #define NO_2PC  // Removing 2PC, of course, would be problematic in distributed transactions.
 // #define FAKE_PROCESS  // Io_thread returns as soon as it gets the request from the remote. Avoid waiting in the WORK_queue.
 // #define NO_REMOTE // remove all remote txn
-#define TXN_QUEUE_PERCENT 0.9 // The proportion of the transaction to take from txn_queue firstly.
 // ! end of these parameters
 //
 
@@ -70,6 +68,8 @@
 #define CLIENT_REM_THREAD_CNT 1
 #define CLIENT_SEND_THREAD_CNT 1
 #define CLIENT_RUNTIME false
+// slots in each of the two work queues (continuations, new transactions) of a worker thread
+#define WORK_QUEUE_CAPACITY 65536
 
 #define LOAD_METHOD LOAD_MAX
 #define LOAD_PER_SERVER 100
@@ -127,8 +127,12 @@
 /***********************************************/
 // Message Passing
 /***********************************************/
-#define TPORT_TYPE tcp
+// TCP, IPC: nanomsg sockets polled by the input threads
+// EPOLL: plain TCP connections, idle input threads sleep in epoll_wait
+#define TPORT_TYPE TCP
 #define TPORT_PORT 7000
+// Nodes whose ifconfig.txt address belongs to this machine talk through shared memory rings
+#define SHM_TPORT false
 #define SET_AFFINITY true
 
 #define MAX_TPORT_NAME 128
@@ -145,22 +149,33 @@
 #define PRIORITY PRIORITY_ACTIVE
 #define MSG_SIZE_MAX 4096
 #define MSG_TIME_LIMIT 0
+// Adaptive batching: keep a batch open while more messages for its destination are queued or
+// expected soon, for at most MSG_BATCH_MAX_DELAY ns. MSG_TIME_LIMIT is not used then.
+#define MSG_BATCH_ADAPTIVE false
+#define MSG_BATCH_MAX_DELAY 100000UL
+// buckets of the batch size and flush delay histograms, bucket i counts values in [2^i,2^(i+1))
+#define MSG_BATCH_HIST_SIZE 16
 
 /***********************************************/
 // Concurrency Control
 /***********************************************/
 
-// WAIT_DIE, NO_WAIT, TIMESTAMP, MVCC, CALVIN, MAAT, SUNDIAL, SILO, BOCC, FOCC, SSI, WSI
+// WAIT_DIE, NO_WAIT, DL_DETECT, TIMESTAMP, MVCC, CALVIN, MAAT, SUNDIAL, SILO, BOCC, FOCC, SSI, WSI
 #define ISOLATION_LEVEL SERIALIZABLE
 #define CC_ALG DLI_IDENTIFY_CHAIN
 #define YCSB_ABORT_MODE false
-#define QUEUE_CAPACITY_NEW 1000000
 // all transactions acquire tuples according to the primary key order.
 #define KEY_ORDER         false
 // transaction roll back changes after abort
 #define ROLL_BACK         true
 // per-row lock/ts management or central lock/ts management
 #define CENTRAL_MAN         false
+// [NO_WAIT, WAIT_DIE] take and release uncontended row locks with a CAS on a lock word
+#define ROW_LOCK_WORD       true
+// [DL_DETECT] look for cycles in the waits-for graph every DL_DETECT_INTVL, and abort the waits
+// longer than DL_DETECT_TIMEOUT, which can be cycles across nodes
+#define DL_DETECT_INTVL     100000UL // 100us
+#define DL_DETECT_TIMEOUT   100 * 1000000UL // 100ms
 #define BUCKET_CNT          31
 #define ABORT_PENALTY 10 * 1000000UL   // in ns.
 #define ABORT_PENALTY_MAX 5 * 100 * 1000000UL   // in ns.
@@ -179,8 +194,10 @@
 #define TS_BATCH_NUM        1
 // [MVCC]
 // when read/write history is longer than HIS_RECYCLE_LEN
-// the history should be recycled.
+// the history should be recycled. MVCC recycles whenever the low watermark
+// has moved, and keeps up to MVCC_INLINE_VERS versions in the row itself.
 #define HIS_RECYCLE_LEN       10
+#define MVCC_INLINE_VERS      2
 #define MAX_PRE_REQ         MAX_TXN_IN_FLIGHT * NODE_CNT//1024
 #define MAX_READ_REQ        MAX_TXN_IN_FLIGHT * NODE_CNT//1024
 #define MIN_TS_INTVL        10 * 1000000UL // 10ms
@@ -206,8 +223,13 @@
 #define LOG_COMMAND         false
 #define LOG_REDO          false
 #define LOGGING false
+// The log thread writes a group commit every LOG_BUF_TIMEOUT, or once LOG_BUF_MAX commits wait.
+// Every thread buffers LOG_THD_BUF_SIZE bytes of records, groups start at multiples of
+// LOG_GROUP_ALIGN in the log file.
 #define LOG_BUF_MAX 10
 #define LOG_BUF_TIMEOUT 10 * 1000000UL // 10ms
+#define LOG_THD_BUF_SIZE (1UL << 20)
+#define LOG_GROUP_ALIGN 4096UL
 
 /***********************************************/
 // Benchmark
@@ -407,6 +429,14 @@ enum PPSTxnType {
 
 #define LTS_TCP_IP  "10.77.110.147"
 #define LTS_TCP_PORT  62389
+// With LTS_TCP_CLOCK, the threads of a node share one connection and ask for ranges of
+// timestamps in batches, up to LTS_PIPELINE_DEPTH of them at a time (see lts_client.h).
+#define LTS_TCP_BATCH  true
+#define LTS_PIPELINE_DEPTH  4
+#define LTS_BATCH_MAX  1024
+// LtsClient takes an LTS that has not answered for LTS_RECV_TIMEOUT for lost, reconnects and asks
+// again, so it must be well above the round trip to the LTS. 0 waits forever.
+#define LTS_RECV_TIMEOUT  5000000000UL // in ns
 // MODES
 // NORMAL < NOCC < QRY_ONLY < SETUP < SIMPLE
 #define NORMAL_MODE 1
@@ -430,6 +460,7 @@ enum PPSTxnType {
 // Transport
 #define TCP 1
 #define IPC 2
+#define EPOLL 3
 // Isolation levels
 #define SERIALIZABLE 1
 #define READ_COMMITTED 2
@@ -0,0 +1,51 @@
+#!/bin/bash
+
+# Throughput against the group commit interval (LOG_BUF_TIMEOUT) with LOGGING on, one server and
+# one client on this machine. The log goes to logfile.log in this directory, so it measures the
+# file system this directory is on. Run from contrib/deneva:
+#
+#     ./log_bench.sh [INTERVAL_US...]
+#
+# config.h and ifconfig.txt are restored on exit, also when a build fails or the script is
+# interrupted. Results go to log_bench/.
+
+intervals=${@:-"0 100 1000 10000"}
+out=log_bench
+mkdir -p $out
+cp config.h $out/config.h.orig
+rm -f $out/ifconfig.txt.orig
+[ -f ifconfig.txt ] && cp ifconfig.txt $out/ifconfig.txt.orig
+
+restore() {
+    cp $out/config.h.orig config.h
+    if [ -f $out/ifconfig.txt.orig ]; then
+        cp $out/ifconfig.txt.orig ifconfig.txt
+    else
+        rm -f ifconfig.txt
+    fi
+}
+trap restore EXIT
+printf "127.0.0.1\n127.0.0.1\n" > ifconfig.txt
+
+for intv in $intervals
+do
+    cp $out/config.h.orig config.h
+    sed -i -e "s/^#define LOGGING .*/#define LOGGING true/" \
+           -e "s/^#define LOG_BUF_TIMEOUT .*/#define LOG_BUF_TIMEOUT ${intv} * 1000UL/" \
+           -e "s/^#define NODE_CNT .*/#define NODE_CNT 1/" \
+           -e "s/^#define CLIENT_NODE_CNT .*/#define CLIENT_NODE_CNT 1/" config.h
+    make clean > /dev/null
+    make -j > /dev/null || exit 1
+
+    ./rundb -nid0 > $out/intv_${intv}_server.txt &
+    server=$!
+    ./runcl -nid1 > $out/intv_${intv}_client.txt &
+    client=$!
+    wait $server $client
+
+    grep "\[summary\]" $out/intv_${intv}_server.txt | tr ',' '\n' | awk -F= -v intv=$intv '
+        $1 == "tput" || $1 == "log_write_cnt" || $1 == "log_write_avg_bytes" ||
+        $1 == "log_flush_avg_time" { v[$1] = $2 }
+        END { printf "LOG_BUF_TIMEOUT=%sus: tput=%f log_write_cnt=%d log_write_avg_bytes=%f log_flush_avg_time=%f\n",
+                     intv, v["tput"], v["log_write_cnt"], v["log_write_avg_bytes"], v["log_flush_avg_time"] }'
+done
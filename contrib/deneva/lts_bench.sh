@@ -0,0 +1,71 @@
+#!/bin/bash
+
+# Compare the per-thread LTS connections with the batched client (LTS_TCP_BATCH), against the
+# stand-in LTS of tools/lts_server.cpp on this machine. Run from contrib/deneva:
+#
+#     ./lts_bench.sh [DELAY_US] [SERVER_NODES] [CLIENT_NODES]
+#
+# DELAY_US is the round trip the stand-in adds to every request. config.h and ifconfig.txt are
+# restored and the stand-in is stopped on exit, also when a build fails or the script is
+# interrupted. Results go to lts_bench/.
+
+delay=${1:-100}
+nodes=${2:-1}
+clients=${3:-1}
+out=lts_bench
+mkdir -p $out
+cp config.h $out/config.h.orig
+rm -f $out/ifconfig.txt.orig
+[ -f ifconfig.txt ] && cp ifconfig.txt $out/ifconfig.txt.orig
+
+lts_pid=""
+restore() {
+    [ -n "$lts_pid" ] && kill $lts_pid
+    cp $out/config.h.orig config.h
+    if [ -f $out/ifconfig.txt.orig ]; then
+        cp $out/ifconfig.txt.orig ifconfig.txt
+    else
+        rm -f ifconfig.txt
+    fi
+}
+trap restore EXIT
+
+rm -f ifconfig.txt
+for ((i = 0; i < nodes + clients; i++)); do
+    echo 127.0.0.1 >> ifconfig.txt
+done
+
+make lts_server > /dev/null || exit 1
+./lts_server -d $delay > $out/lts_server.txt &
+lts_pid=$!
+
+for batch in false true
+do
+    cp $out/config.h.orig config.h
+    sed -i -e "s/^#define TS_ALLOC .*/#define TS_ALLOC LTS_TCP_CLOCK/" \
+           -e "s/^#define LTS_TCP_IP .*/#define LTS_TCP_IP \"127.0.0.1\"/" \
+           -e "s/^#define LTS_TCP_BATCH .*/#define LTS_TCP_BATCH ${batch}/" \
+           -e "s/^#define NODE_CNT .*/#define NODE_CNT ${nodes}/" \
+           -e "s/^#define CLIENT_NODE_CNT .*/#define CLIENT_NODE_CNT ${clients}/" config.h
+    make clean > /dev/null
+    make -j > /dev/null || exit 1
+
+    pids=""
+    for ((i = 0; i < nodes; i++)); do
+        ./rundb -nid$i > $out/batch_${batch}_server_$i.txt &
+        pids="$pids $!"
+    done
+    for ((i = nodes; i < nodes + clients; i++)); do
+        ./runcl -nid$i > $out/batch_${batch}_client_$i.txt &
+        pids="$pids $!"
+    done
+    wait $pids
+
+    # throughput summed over the servers, time spent getting timestamps and batch sizes
+    cat $out/batch_${batch}_server_*.txt | grep "\[summary\]" | tr ',' '\n' | awk -F= -v batch=$batch '
+        $1 == "tput" { tput += $2 }
+        $1 == "ts_alloc_time" { ts += $2 }
+        $1 == "lts_batch_size_avg" { size += $2; n++ }
+        END { printf "LTS_TCP_BATCH=%s: tput=%f ts_alloc_time=%f lts_batch_size_avg=%f\n",
+                     batch, tput, ts, n ? size / n : 0 }'
+done
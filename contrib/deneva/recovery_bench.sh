@@ -0,0 +1,53 @@
+#!/bin/bash
+
+# Recovery time against the number of replay threads. One server and one client on this machine
+# run with LOGGING on, starting from a table snapshot in recovery_bench/snap; then the server
+# replays their logfile.log on the same snapshot with each thread count. Run from contrib/deneva:
+#
+#     ./recovery_bench.sh [THREADS...]
+#
+# config.h and ifconfig.txt are restored on exit, also when the build fails or the script is
+# interrupted. Results go to recovery_bench/.
+
+threads=${@:-"1 2 4 8"}
+out=recovery_bench
+mkdir -p $out/snap
+cp config.h $out/config.h.orig
+rm -f $out/ifconfig.txt.orig
+[ -f ifconfig.txt ] && cp ifconfig.txt $out/ifconfig.txt.orig
+
+restore() {
+    cp $out/config.h.orig config.h
+    if [ -f $out/ifconfig.txt.orig ]; then
+        cp $out/ifconfig.txt.orig ifconfig.txt
+    else
+        rm -f ifconfig.txt
+    fi
+}
+trap restore EXIT
+printf "127.0.0.1\n127.0.0.1\n" > ifconfig.txt
+
+sed -i -e "s/^#define LOGGING .*/#define LOGGING true/" \
+       -e "s/^#define NODE_CNT .*/#define NODE_CNT 1/" \
+       -e "s/^#define CLIENT_NODE_CNT .*/#define CLIENT_NODE_CNT 1/" config.h
+make clean > /dev/null
+make -j > /dev/null || exit 1
+
+# the first run saves the snapshot, the logged run starts from it
+./rundb -nid0 -snap $out/snap > $out/snap_server.txt &
+server=$!
+./runcl -nid1 > $out/snap_client.txt &
+client=$!
+wait $server $client
+./rundb -nid0 -snap $out/snap > $out/run_server.txt &
+server=$!
+./runcl -nid1 > $out/run_client.txt &
+client=$!
+wait $server $client
+cp logfile.log $out/logfile.log
+
+for thd in $threads
+do
+    ./rundb -nid0 -t$thd -snap $out/snap -recover $out/logfile.log > $out/recover_${thd}.txt
+    echo "threads=$thd: $(grep -E "^Recover" $out/recover_${thd}.txt | tr '\n' ' ')"
+done
@@ -52,6 +52,13 @@ void Stats_thd::init(uint64_t thd_id) {
     DEBUG_M("Stats_thd::init work_queue_dtx_cnt alloc\n");
     work_queue_dtx_cnt= (uint64_t *) mem_allocator.align_alloc(sizeof(uint64_t) * SECOND);
 
+    DEBUG_M("Stats_thd::init msg_batch_size_hist alloc\n");
+    msg_batch_size_hist=
+        (uint64_t *) mem_allocator.align_alloc(sizeof(uint64_t) * MSG_BATCH_HIST_SIZE);
+    DEBUG_M("Stats_thd::init msg_batch_delay_hist alloc\n");
+    msg_batch_delay_hist=
+        (uint64_t *) mem_allocator.align_alloc(sizeof(uint64_t) * MSG_BATCH_HIST_SIZE);
+
     DEBUG_M("Stats_thd::init mtx alloc\n");
     mtx= (double *) mem_allocator.align_alloc(sizeof(double) * 40);
 
@@ -89,10 +96,15 @@ void Stats_thd::clear() {
     single_part_txn_run_time=0;
     txn_write_cnt=0;
     record_write_cnt=0;
+    undo_log_bytes=0;
+    txn_scan_cnt=0;
+    txn_scan_row_cnt=0;
     parts_touched=0;
 
     // Breakdown
     ts_alloc_time=0;
+    lts_batch_cnt=0;
+    lts_batch_size=0;
     abort_time=0;
     txn_manager_time=0;
     txn_index_time=0;
@@ -112,6 +124,10 @@ void Stats_thd::clear() {
     // trans mvcc
     trans_mvcc_clear_history=0;
     trans_mvcc_access=0;
+    mvcc_version_len=0;
+    mvcc_version_cnt=0;
+    mvcc_gc_cnt=0;
+    mvcc_gc_lag_time=0;
 
     // Transaction stats
     txn_total_process_time=0;
@@ -147,6 +163,7 @@ void Stats_thd::clear() {
     work_queue_enqueue_time=0;
     work_queue_dequeue_time=0;
     work_queue_conflict_cnt=0;
+    work_queue_steal_cnt=0;
 
     // Worker thread
     worker_idle_time=0;
@@ -183,8 +200,15 @@ void Stats_thd::clear() {
     msg_send_cnt=0;
     msg_recv_cnt=0;
     msg_unpack_time=0;
+    msg_recv_msg_cnt=0;
+    msg_recv_alloc_cnt=0;
+    msg_recv_copy_bytes=0;
     mbuf_send_intv_time=0;
     msg_copy_output_time=0;
+    for(uint64_t i = 0; i < MSG_BATCH_HIST_SIZE; i ++) {
+        msg_batch_size_hist[i]=0;
+        msg_batch_delay_hist[i]=0;
+    }
 
     // Concurrency control, general
     cc_conflict_cnt=0;
@@ -207,6 +231,14 @@ void Stats_thd::clear() {
     twopl_release_cnt=0;
     twopl_release_time=0;
 
+    dl_detect_cnt=0;
+    dl_detect_time=0;
+    dl_detect_intvl_time=0;
+    dl_cycle_cnt=0;
+    dl_timeout_cnt=0;
+    dl_wait_cnt=0;
+    dl_wait_time=0;
+
     // Calvin
     seq_txn_cnt=0;
     seq_batch_cnt=0;
@@ -274,6 +306,7 @@ void Stats_thd::clear() {
     // Logging
     log_write_cnt=0;
     log_write_time=0;
+    log_write_bytes=0;
     log_flush_cnt=0;
     log_flush_time=0;
     log_process_time=0;
@@ -418,6 +451,30 @@ void Stats_thd::print_client(FILE * outf, bool prog) {
         msg_send_cnt, msg_recv_cnt, msg_unpack_time / BILLION, msg_unpack_time_avg / BILLION,
         mbuf_send_intv_time / BILLION, mbuf_send_intv_time_avg / BILLION,
         msg_copy_output_time / BILLION);
+    double msg_recv_alloc_per_msg = 0;
+    double msg_recv_copy_bytes_per_msg = 0;
+    if (msg_recv_msg_cnt > 0) {
+        msg_recv_alloc_per_msg = (double)msg_recv_alloc_cnt / msg_recv_msg_cnt;
+        msg_recv_copy_bytes_per_msg = (double)msg_recv_copy_bytes / msg_recv_msg_cnt;
+    }
+    fprintf(outf,
+        ",msg_recv_msg_cnt=%ld"
+        ",msg_recv_alloc_cnt=%ld"
+        ",msg_recv_alloc_per_msg=%f"
+        ",msg_recv_copy_bytes=%ld"
+        ",msg_recv_copy_bytes_per_msg=%f",
+        msg_recv_msg_cnt, msg_recv_alloc_cnt, msg_recv_alloc_per_msg, msg_recv_copy_bytes,
+        msg_recv_copy_bytes_per_msg);
+    for(uint64_t i = 0; i < MSG_BATCH_HIST_SIZE; i ++) {
+        fprintf(outf,
+        ",msg_batch_size_hist%ld=%ld"
+        ",msg_batch_delay_hist%ld=%ld"
+        ,i
+        ,msg_batch_size_hist[i]
+        ,i
+        ,msg_batch_delay_hist[i]
+        );
+    }
 
     if (!prog) {
     client_client_latency.quicksort(0,client_client_latency.cnt-1);
@@ -493,6 +550,9 @@ void Stats_thd::print(FILE * outf, bool prog) {
     ",single_part_txn_avg_time=%f"
     ",txn_write_cnt=%ld"
     ",record_write_cnt=%ld"
+    ",undo_log_bytes=%ld"
+    ",txn_scan_cnt=%ld"
+    ",txn_scan_row_cnt=%ld"
     ",parts_touched=%ld"
           ",avg_parts_touched=%f",
           tput, txn_cnt, remote_txn_cnt, local_txn_cnt, local_txn_start_cnt, total_txn_commit_cnt,
@@ -501,7 +561,7 @@ void Stats_thd::print(FILE * outf, bool prog) {
           txn_run_avg_time / BILLION, multi_part_txn_cnt, multi_part_txn_run_time / BILLION,
           multi_part_txn_avg_time / BILLION, single_part_txn_cnt,
           single_part_txn_run_time / BILLION, single_part_txn_avg_time / BILLION, txn_write_cnt,
-          record_write_cnt, parts_touched, avg_parts_touched);
+          record_write_cnt, undo_log_bytes, txn_scan_cnt, txn_scan_row_cnt, parts_touched, avg_parts_touched);
 
     // Breakdown
     fprintf(outf,
@@ -513,6 +573,13 @@ void Stats_thd::print(FILE * outf, bool prog) {
         ",txn_cleanup_time=%f",
         ts_alloc_time / BILLION, abort_time / BILLION, txn_manager_time / BILLION,
         txn_index_time / BILLION, txn_validate_time / BILLION, txn_cleanup_time / BILLION);
+    // LTS batches
+    double lts_batch_size_avg = 0;
+    if (lts_batch_cnt > 0) lts_batch_size_avg = (double)lts_batch_size / lts_batch_cnt;
+    fprintf(outf,
+    ",lts_batch_cnt=%ld"
+    ",lts_batch_size_avg=%f",
+        lts_batch_cnt, lts_batch_size_avg);
     // trans
     fprintf(outf,
     ",trans_total_run_time=%f"
@@ -531,6 +598,19 @@ void Stats_thd::print(FILE * outf, bool prog) {
         trans_commit_time / BILLION, trans_abort_time / BILLION, trans_access_lock_wait_time / BILLION,
         trans_mvcc_clear_history / BILLION, trans_mvcc_access / BILLION);
 
+    // versions in a write history per MVCC access, and how long a replaced version waits for GC
+    double mvcc_version_len_avg = 0;
+    double mvcc_gc_lag_time_avg = 0;
+    if (mvcc_version_cnt > 0) mvcc_version_len_avg = (double)mvcc_version_len / mvcc_version_cnt;
+    if (mvcc_gc_cnt > 0) mvcc_gc_lag_time_avg = mvcc_gc_lag_time / mvcc_gc_cnt;
+    fprintf(outf,
+    ",mvcc_version_len_avg=%f"
+    ",mvcc_gc_cnt=%ld"
+    ",mvcc_gc_lag_time=%f"
+    ",mvcc_gc_lag_time_avg=%f",
+        mvcc_version_len_avg, mvcc_gc_cnt, mvcc_gc_lag_time / BILLION,
+        mvcc_gc_lag_time_avg / BILLION);
+
 
   // Transaction stats
     double txn_total_process_time_avg=0;
@@ -628,14 +708,15 @@ void Stats_thd::print(FILE * outf, bool prog) {
         ",work_queue_old_wait_avg_time=%f"
         ",work_queue_enqueue_time=%f"
         ",work_queue_dequeue_time=%f"
-        ",work_queue_conflict_cnt=%ld",
+        ",work_queue_conflict_cnt=%ld"
+        ",work_queue_steal_cnt=%ld",
         work_queue_wait_time / BILLION, work_queue_cnt, work_queue_enq_cnt,
         work_queue_wait_avg_time / BILLION, work_queue_mtx_wait_time / BILLION,
         work_queue_mtx_wait_avg / BILLION, work_queue_new_cnt, work_queue_new_wait_time / BILLION,
         work_queue_new_wait_avg_time / BILLION, work_queue_old_cnt,
         work_queue_old_wait_time / BILLION, work_queue_old_wait_avg_time / BILLION,
         work_queue_enqueue_time / BILLION, work_queue_dequeue_time / BILLION,
-        work_queue_conflict_cnt);
+        work_queue_conflict_cnt, work_queue_steal_cnt);
 
     // Worker thread
     double worker_process_avg_time = 0;
@@ -744,6 +825,30 @@ void Stats_thd::print(FILE * outf, bool prog) {
         msg_send_cnt, msg_recv_cnt, msg_unpack_time / BILLION, msg_unpack_time_avg / BILLION,
         mbuf_send_intv_time / BILLION, mbuf_send_intv_time_avg / BILLION,
         msg_copy_output_time / BILLION);
+    double msg_recv_alloc_per_msg = 0;
+    double msg_recv_copy_bytes_per_msg = 0;
+    if (msg_recv_msg_cnt > 0) {
+        msg_recv_alloc_per_msg = (double)msg_recv_alloc_cnt / msg_recv_msg_cnt;
+        msg_recv_copy_bytes_per_msg = (double)msg_recv_copy_bytes / msg_recv_msg_cnt;
+    }
+    fprintf(outf,
+        ",msg_recv_msg_cnt=%ld"
+        ",msg_recv_alloc_cnt=%ld"
+        ",msg_recv_alloc_per_msg=%f"
+        ",msg_recv_copy_bytes=%ld"
+        ",msg_recv_copy_bytes_per_msg=%f",
+        msg_recv_msg_cnt, msg_recv_alloc_cnt, msg_recv_alloc_per_msg, msg_recv_copy_bytes,
+        msg_recv_copy_bytes_per_msg);
+    for(uint64_t i = 0; i < MSG_BATCH_HIST_SIZE; i ++) {
+        fprintf(outf,
+        ",msg_batch_size_hist%ld=%ld"
+        ",msg_batch_delay_hist%ld=%ld"
+        ,i
+        ,msg_batch_size_hist[i]
+        ,i
+        ,msg_batch_delay_hist[i]
+        );
+    }
 
   // Concurrency control, general
     fprintf(outf,
@@ -781,6 +886,23 @@ void Stats_thd::print(FILE * outf, bool prog) {
           twopl_getlock_cnt, twopl_getlock_time / BILLION, twopl_release_cnt,
           twopl_release_time / BILLION);
 
+    // DL_DETECT
+    double dl_detect_intvl_avg = 0;
+    if (dl_detect_cnt > 0) dl_detect_intvl_avg = dl_detect_intvl_time / dl_detect_cnt;
+    double dl_wait_avg_time = 0;
+    if (dl_wait_cnt > 0) dl_wait_avg_time = dl_wait_time / dl_wait_cnt;
+    fprintf(outf,
+        ",dl_detect_cnt=%ld"
+        ",dl_detect_time=%f"
+        ",dl_detect_intvl_avg=%f"
+        ",dl_cycle_cnt=%ld"
+        ",dl_timeout_cnt=%ld"
+        ",dl_wait_cnt=%ld"
+        ",dl_wait_time=%f"
+        ",dl_wait_avg_time=%f",
+          dl_detect_cnt, dl_detect_time / BILLION, dl_detect_intvl_avg / BILLION, dl_cycle_cnt,
+          dl_timeout_cnt, dl_wait_cnt, dl_wait_time / BILLION, dl_wait_avg_time / BILLION);
+
     // Calvin
     double seq_queue_wait_avg_time = 0;
     if (seq_queue_cnt > 0) seq_queue_wait_avg_time = seq_queue_wait_time / seq_queue_cnt;
@@ -880,16 +1002,21 @@ void Stats_thd::print(FILE * outf, bool prog) {
     if (log_write_cnt > 0) log_write_avg_time = log_write_time / log_write_cnt;
     double log_flush_avg_time = 0;
     if (log_flush_cnt > 0) log_flush_avg_time = log_flush_time / log_flush_cnt;
+    double log_write_avg_bytes = 0;
+    if (log_write_cnt > 0) log_write_avg_bytes = (double)log_write_bytes / log_write_cnt;
     fprintf(outf,
         ",log_write_cnt=%ld"
         ",log_write_time=%f"
         ",log_write_avg_time=%f"
+        ",log_write_bytes=%ld"
+        ",log_write_avg_bytes=%f"
         ",log_flush_cnt=%ld"
         ",log_flush_time=%f"
         ",log_flush_avg_time=%f"
         ",log_process_time=%f",
-        log_write_cnt, log_write_time / BILLION, log_write_avg_time / BILLION, log_flush_cnt,
-        log_flush_time / BILLION, log_flush_avg_time / BILLION, log_process_time / BILLION);
+        log_write_cnt, log_write_time / BILLION, log_write_avg_time / BILLION, log_write_bytes,
+        log_write_avg_bytes, log_flush_cnt, log_flush_time / BILLION, log_flush_avg_time / BILLION,
+        log_process_time / BILLION);
 
   // Transaction Table
     double txn_table_get_avg_time = 0;
@@ -1120,10 +1247,15 @@ void Stats_thd::combine(Stats_thd * stats) {
     single_part_txn_run_time+=stats->single_part_txn_run_time;
     txn_write_cnt+=stats->txn_write_cnt;
     record_write_cnt+=stats->record_write_cnt;
+    undo_log_bytes+=stats->undo_log_bytes;
+    txn_scan_cnt+=stats->txn_scan_cnt;
+    txn_scan_row_cnt+=stats->txn_scan_row_cnt;
     parts_touched+=stats->parts_touched;
 
     // Breakdown
     ts_alloc_time+=stats->ts_alloc_time;
+    lts_batch_cnt+=stats->lts_batch_cnt;
+    lts_batch_size+=stats->lts_batch_size;
     abort_time+=stats->abort_time;
     txn_manager_time+=stats->txn_manager_time;
     txn_index_time+=stats->txn_index_time;
@@ -1142,6 +1274,10 @@ void Stats_thd::combine(Stats_thd * stats) {
     // trans mvcc
     trans_mvcc_clear_history+=stats->trans_mvcc_clear_history;
     trans_mvcc_access+=stats->trans_mvcc_access;
+    mvcc_version_len+=stats->mvcc_version_len;
+    mvcc_version_cnt+=stats->mvcc_version_cnt;
+    mvcc_gc_cnt+=stats->mvcc_gc_cnt;
+    mvcc_gc_lag_time+=stats->mvcc_gc_lag_time;
     // Transaction stats
     txn_total_process_time+=stats->txn_total_process_time;
     txn_process_time+=stats->txn_process_time;
@@ -1176,6 +1312,7 @@ void Stats_thd::combine(Stats_thd * stats) {
     work_queue_enqueue_time+=stats->work_queue_enqueue_time;
     work_queue_dequeue_time+=stats->work_queue_dequeue_time;
     work_queue_conflict_cnt+=stats->work_queue_conflict_cnt;
+    work_queue_steal_cnt+=stats->work_queue_steal_cnt;
 
     // Worker thread
     worker_idle_time+=stats->worker_idle_time;
@@ -1212,8 +1349,15 @@ void Stats_thd::combine(Stats_thd * stats) {
     msg_send_cnt+=stats->msg_send_cnt;
     msg_recv_cnt+=stats->msg_recv_cnt;
     msg_unpack_time+=stats->msg_unpack_time;
+    msg_recv_msg_cnt+=stats->msg_recv_msg_cnt;
+    msg_recv_alloc_cnt+=stats->msg_recv_alloc_cnt;
+    msg_recv_copy_bytes+=stats->msg_recv_copy_bytes;
     mbuf_send_intv_time+=stats->mbuf_send_intv_time;
     msg_copy_output_time+=stats->msg_copy_output_time;
+    for(uint64_t i = 0; i < MSG_BATCH_HIST_SIZE; i ++) {
+        msg_batch_size_hist[i]+=stats->msg_batch_size_hist[i];
+        msg_batch_delay_hist[i]+=stats->msg_batch_delay_hist[i];
+    }
 
     // Concurrency control, general
     cc_conflict_cnt+=stats->cc_conflict_cnt;
@@ -1236,6 +1380,14 @@ void Stats_thd::combine(Stats_thd * stats) {
     twopl_release_time+=stats->twopl_release_time;
     twopl_getlock_time+=stats->twopl_getlock_time;
 
+    dl_detect_cnt+=stats->dl_detect_cnt;
+    dl_detect_time+=stats->dl_detect_time;
+    dl_detect_intvl_time+=stats->dl_detect_intvl_time;
+    dl_cycle_cnt+=stats->dl_cycle_cnt;
+    dl_timeout_cnt+=stats->dl_timeout_cnt;
+    dl_wait_cnt+=stats->dl_wait_cnt;
+    dl_wait_time+=stats->dl_wait_time;
+
     // Calvin
     seq_txn_cnt+=stats->seq_txn_cnt;
     seq_batch_cnt+=stats->seq_batch_cnt;
@@ -1291,6 +1443,7 @@ void Stats_thd::combine(Stats_thd * stats) {
     // Logging
     log_write_cnt+=stats->log_write_cnt;
     log_write_time+=stats->log_write_time;
+    log_write_bytes+=stats->log_write_bytes;
     log_flush_cnt+=stats->log_flush_cnt;
     log_flush_time+=stats->log_flush_time;
     log_process_time+=stats->log_process_time;
@@ -70,6 +70,9 @@ public:
     double single_part_txn_run_time;
     uint64_t txn_write_cnt;
     uint64_t record_write_cnt;
+    uint64_t undo_log_bytes;
+    uint64_t txn_scan_cnt;
+    uint64_t txn_scan_row_cnt;
 
     // Transaction stats
     double txn_total_process_time;
@@ -87,6 +90,8 @@ public:
 
     // Breakdown
     double ts_alloc_time;
+    uint64_t lts_batch_cnt;
+    uint64_t lts_batch_size;
     double abort_time;
     double txn_manager_time;
     double txn_index_time;
@@ -106,6 +111,10 @@ public:
     // trans mvcc
     double trans_mvcc_clear_history=0;
     double trans_mvcc_access=0;
+    uint64_t mvcc_version_len=0;
+    uint64_t mvcc_version_cnt=0;
+    uint64_t mvcc_gc_cnt=0;
+    double mvcc_gc_lag_time=0;
     // Work queue
     double work_queue_wait_time;
     uint64_t work_queue_cnt;
@@ -118,6 +127,7 @@ public:
     double work_queue_enqueue_time;
     double work_queue_dequeue_time;
     uint64_t work_queue_conflict_cnt;
+    uint64_t work_queue_steal_cnt;
 
     // Abort queue
     uint64_t abort_queue_enqueue_cnt;
@@ -158,8 +168,13 @@ public:
     uint64_t msg_send_cnt;
     uint64_t msg_recv_cnt;
     double msg_unpack_time;
+    uint64_t msg_recv_msg_cnt;
+    uint64_t msg_recv_alloc_cnt;
+    uint64_t msg_recv_copy_bytes;
     double mbuf_send_intv_time;
     double msg_copy_output_time;
+    uint64_t * msg_batch_size_hist;   // messages per batch
+    uint64_t * msg_batch_delay_hist;  // us from the first message of a batch until it is sent
 
     // Concurrency control, general
     uint64_t cc_conflict_cnt;
@@ -183,6 +198,15 @@ public:
     double twopl_getlock_time;
     double twopl_release_time;
 
+    // DL_DETECT
+    uint64_t dl_detect_cnt;
+    double dl_detect_time;
+    double dl_detect_intvl_time;
+    uint64_t dl_cycle_cnt;
+    uint64_t dl_timeout_cnt;
+    uint64_t dl_wait_cnt;
+    double dl_wait_time;
+
     // Calvin
     uint64_t seq_txn_cnt;
     uint64_t seq_batch_cnt;
@@ -255,6 +279,7 @@ public:
     // Logging
     uint64_t log_write_cnt;
     double log_write_time;
+    uint64_t log_write_bytes;
     uint64_t log_flush_cnt;
     double log_flush_time;
     double log_process_time;
@@ -53,6 +53,21 @@ char* Catalog::get_field_type(char* name) { return get_field_type(get_field_id(n
 
 uint64_t Catalog::get_field_index(char* name) { return get_field_index(get_field_id(name)); }
 
+bool Catalog::match_layout(const row_layout & layout) {
+    if (strcmp(table_name, layout.table_name) != 0 || tuple_size != layout.tuple_size ||
+        field_cnt != layout.field_cnt) {
+        return false;
+    }
+    for (UInt32 i = 0; i < field_cnt; i++) {
+        if (strcmp(_columns[i].name, layout.columns[i].name) != 0 ||
+            _columns[i].index != layout.columns[i].offset ||
+            _columns[i].size != layout.columns[i].size) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void Catalog::print_schema() {
     printf("\n[Catalog] %s\n", table_name);
     for (UInt32 i = 0; i < field_cnt; i++) {
@@ -46,6 +46,30 @@ public:
     char pad[CL_SIZE - sizeof(uint64_t)*3 - sizeof(char *)*2];
 };
 
+// Compile-time layouts of the tables in the benchmarks/*_schema.txt files, generated into
+// benchmarks/schema_layout.h by benchmarks/gen_schema_layout.sh. A row_field names one column and
+// is passed to row_t::get_field()/set_field(), which then compile to a single load or store.
+// Strings have type char and are accessed through row_t::get_field_ptr().
+template <uint32_t OFFSET, uint32_t SIZE, typename T>
+struct row_field {
+    typedef T type;
+    static constexpr uint32_t offset = OFFSET;
+    static constexpr uint32_t size = SIZE;
+};
+
+struct row_column {
+    const char * name;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct row_layout {
+    const char * table_name;
+    uint32_t tuple_size;
+    uint32_t field_cnt;
+    const row_column * columns;
+};
+
 class Catalog {
 public:
     // abandoned init function
@@ -76,6 +100,9 @@ public:
     char *             get_field_type(char * name);
     uint64_t         get_field_index(char * name);
 
+    // Whether the columns are those of the compiled layout, i.e. the schema file read at runtime
+    // is the one the layout was generated from.
+    bool             match_layout(const row_layout & layout);
     void             print_schema();
     Column *         _columns;
     UInt32             tuple_size;
@@ -18,9 +18,22 @@
 #define _INDEX_BASE_H_
 
 #include "global.h"
+#include "helper.h"
+
+#include <functional>
+#include <vector>
 
 class table_t;
 
+// A key and its item, the unit of bulk loading.
+struct idx_entry {
+    idx_key_t key;
+    itemid_t * item;
+};
+
+// Called by index_visit() with each key, item and partition.
+typedef std::function<void(idx_key_t, itemid_t *, int)> idx_visitor;
+
 class index_base {
 public:
     virtual RC init() {
@@ -41,6 +54,22 @@ public:
 
     virtual RC index_read(idx_key_t key, itemid_t *&item, int part_id = -1, int thd_id = 0) = 0;
 
+    // Bulk loading during table initialization. Loader threads call index_load() concurrently,
+    // each with its own batches of entries, and index_load_finish() is called once per partition
+    // after all loaders are done. The index must not be read or modified in between.
+    virtual RC index_load(idx_entry * entries, uint64_t cnt, int part_id) {
+        for (uint64_t i = 0; i < cnt; i++) index_insert(entries[i].key, entries[i].item, part_id);
+        return RCOK;
+    };
+
+    virtual RC index_load_finish(int part_id) {
+        return RCOK;
+    };
+
+    // Visit every item in the index, the items of a key in the order they were inserted. The index
+    // must not change meanwhile.
+    virtual void index_visit(const idx_visitor & visit) = 0;
+
         // TODO implement index_remove
     virtual RC index_remove(idx_key_t key) {
         return RCOK;
@@ -48,6 +77,15 @@ public:
 
     // the index in on "table". The key is the merged key of "fields"
     table_t *             table;
+
+protected:
+    // items of the same key are chained from the last inserted one, visit them in reverse
+    static void visit_items(idx_key_t key, itemid_t * items, int part_id,
+                            const idx_visitor & visit) {
+        std::vector<itemid_t *> chain;
+        for (itemid_t * item = items; item != NULL; item = item->next) chain.push_back(item);
+        for (auto it = chain.rbegin(); it != chain.rend(); it++) visit(key, *it, part_id);
+    }
 };
 
 #endif
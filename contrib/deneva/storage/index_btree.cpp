@@ -14,6 +14,8 @@
    limitations under the License.
 */
 
+#include <algorithm>
+
 #include "mem_alloc.h"
 #include "index_btree.h"
 #include "row.h"
@@ -22,15 +24,17 @@ RC index_btree::init(uint64_t part_cnt) {
     this->part_cnt = part_cnt;
     order = BTREE_ORDER;
     // these pointers can be mapped anywhere. They won't be changed
-    roots = (bt_node **) malloc(part_cnt * sizeof(bt_node *));
-    // "cur_xxx_per_thd" is only for SCAN queries.
-    ARR_PTR(bt_node *, cur_leaf_per_thd, g_thread_cnt);
-    ARR_PTR(UInt32, cur_idx_per_thd, g_thread_cnt);
+    roots = new std::atomic<bt_node *> [part_cnt];
+    // "cursor_per_thd" is only for index_next(), range scans keep their own cursor.
+    ARR_PTR(bt_cursor, cursor_per_thd, g_thread_cnt);
+    load_runs = new std::vector<bt_run> [part_cnt];
+    pthread_mutex_init(&load_latch, NULL);
     // the index tree of each partition musted be mapped to corresponding l2 slices
     for (UInt32 part_id = 0; part_id < part_cnt; part_id ++) {
-        RC rc;
-        rc = make_lf(part_id, roots[part_id]);
+        bt_node * root;
+        RC rc = make_lf(part_id, root);
         assert (rc == RCOK);
+        roots[part_id].store(root, std::memory_order_relaxed);
     }
     return RCOK;
 }
@@ -41,122 +45,336 @@ RC index_btree::init(uint64_t part_cnt, table_t * table) {
     return RCOK;
 }
 
-bt_node * index_btree::find_root(uint64_t part_id) {
+bool index_btree::read_latch(const bt_node * node, uint64_t & version) {
+    version = node->version.load(std::memory_order_acquire);
+    return (version & BT_NODE_LATCHED) == 0;
+}
+
+bool index_btree::validate(const bt_node * node, uint64_t version) {
+    // order the reads of the node before the second load of its version
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return node->version.load(std::memory_order_relaxed) == version;
+}
+
+bool index_btree::upgrade_latch(bt_node * node, uint64_t version) {
+    return node->version.compare_exchange_strong(version, version + BT_NODE_LATCHED,
+                                                 std::memory_order_acquire);
+}
+
+void index_btree::release_latch(bt_node * node) {
+    uint64_t version = node->version.fetch_add(BT_NODE_LATCHED, std::memory_order_release);
+    assert(version & BT_NODE_LATCHED);
+    (void) version;
+}
+
+bt_node * index_btree::find_root(uint64_t part_id, uint64_t & version) {
     assert (part_id < part_cnt);
-    return roots[part_id];
+    while (true) {
+        bt_node * root = roots[part_id].load(std::memory_order_acquire);
+        // a root split latches the old root until the new one is installed, so the root is
+        // still current if it is unlatched and roots[part_id] did not change meanwhile
+        if (read_latch(root, version) && root == roots[part_id].load(std::memory_order_acquire))
+            return root;
+        PAUSE_SILO
+    }
+}
+
+UInt32 index_btree::key_cnt(const bt_node * node) {
+    // a concurrent writer may be changing num_keys, clamp it so the reader stays in bounds until
+    // it validates the version
+    return std::min(__atomic_load_n(&node->num_keys, __ATOMIC_RELAXED), order - 1);
+}
+
+UInt32 index_btree::find_child(const bt_node * node, idx_key_t key) {
+    const UInt32 num_keys = key_cnt(node);
+    UInt32 i = 0;
+    while (i < num_keys && key >= node->keys[i]) i++;
+    return i;
+}
+
+bt_node * index_btree::find_leaf(uint64_t part_id, idx_key_t key, uint64_t & version) {
+restart:
+    bt_node * node = find_root(part_id, version);
+    while (!node->is_leaf) {
+        bt_node * child = (bt_node *) node->pointers[find_child(node, key)];
+        // check the parent both before following the pointer and after reading the version of
+        // the child, in case the child was split in between
+        uint64_t child_version;
+        if (!validate(node, version) || !read_latch(child, child_version) ||
+                !validate(node, version))
+            goto restart;
+        node = child;
+        version = child_version;
+    }
+    return node;
+}
+
+itemid_t * index_btree::lookup(uint64_t part_id, idx_key_t key, bt_node *& leaf) {
+    itemid_t * item;
+    uint64_t version;
+    do {
+        leaf = find_leaf(part_id, key, version);
+        int idx = leaf_has_key(leaf, key);
+        item = idx < 0 ? NULL : (itemid_t *) leaf->pointers[idx];
+    } while (!validate(leaf, version));
+    return item;
 }
 
 bool index_btree::index_exist(idx_key_t key) {
     assert(false); // part_id is not correct now.
-    glob_param params;
-    params.part_id = key_to_part(key) % part_cnt;
     bt_node * leaf;
-    // does not matter which thread check existence
-    find_leaf(params, key, INDEX_NONE, leaf);
-    if (leaf == NULL) return false;
-    for (UInt32 i = 0; i < leaf->num_keys; i++)
-        if (leaf->keys[i] == key) {
-            // the record is found!
-            return true;
-        }
-    return false;
+    return lookup(key_to_part(key) % part_cnt, key, leaf) != NULL;
 }
 
-RC index_btree::index_next(uint64_t thd_id, itemid_t * &item, bool samekey) {
-    int idx = *cur_idx_per_thd[thd_id];
-    bt_node * leaf = *cur_leaf_per_thd[thd_id];
-    idx_key_t cur_key = leaf->keys[idx] ;
-
-    *cur_idx_per_thd[thd_id] += 1;
-    if (*cur_idx_per_thd[thd_id] >= leaf->num_keys) {
-        leaf = leaf->next;
-        *cur_leaf_per_thd[thd_id] = leaf;
-        *cur_idx_per_thd[thd_id] = 0;
-    }
-    if (leaf == NULL)
-        item = NULL;
-    else {
-        assert( leaf->is_leaf );
-        if ( samekey && leaf->keys[ *cur_idx_per_thd[thd_id] ] != cur_key)
-            item = NULL;
-        else
-            item = (itemid_t *) leaf->pointers[ *cur_idx_per_thd[thd_id] ];
+void index_btree::scan(bt_cursor & cursor, bool inclusive, itemid_t *& item) {
+    bt_node * leaf = cursor.leaf;
+    while (true) {
+        uint64_t version;
+        if (!read_latch(leaf, version)) continue;
+        const UInt32 num_keys = key_cnt(leaf);
+        UInt32 idx = 0;
+        while (idx < num_keys && (leaf->keys[idx] < cursor.key ||
+                                  (!inclusive && leaf->keys[idx] == cursor.key)))
+            idx++;
+        if (idx == num_keys) {
+            bt_node * next = leaf->next;
+            if (!validate(leaf, version)) continue;
+            if (next == NULL) {
+                cursor.leaf = leaf;
+                item = NULL;
+                return;
+            }
+            // leaves are visited in order, start fetching the one after next while reading next
+            __builtin_prefetch(next->next);
+            leaf = next;
+            continue;
+        }
+        idx_key_t key = leaf->keys[idx];
+        itemid_t * next_item = (itemid_t *) leaf->pointers[idx];
+        if (idx + 1 < num_keys) __builtin_prefetch(leaf->pointers[idx + 1]);
+        if (!validate(leaf, version)) continue;
+        assert(leaf->is_leaf);
+        cursor.leaf = leaf;
+        cursor.key = key;
+        item = next_item;
+        return;
     }
+}
+
+RC index_btree::index_scan(bt_cursor & cursor, idx_key_t key, itemid_t *& item, int part_id) {
+    assert(part_id != -1);
+    uint64_t version;
+    cursor.leaf = find_leaf(part_id % part_cnt, key, version);
+    cursor.key = key;
+    scan(cursor, true, item);
     return RCOK;
 }
 
-RC index_btree::index_read(idx_key_t key, itemid_t *& item) {
-    assert(false);
+RC index_btree::index_scan_next(bt_cursor & cursor, itemid_t *& item) {
+    scan(cursor, false, item);
     return RCOK;
 }
 
-RC index_btree::index_read(idx_key_t key, itemid_t *&item, int part_id) {
+RC index_btree::index_next(uint64_t thd_id, itemid_t * &item, bool samekey) {
+    bt_cursor * cursor = cursor_per_thd[thd_id];
+    idx_key_t cur_key = cursor->key;
+    scan(*cursor, false, item);
+    if (samekey && item != NULL && cursor->key != cur_key) item = NULL;
+    return RCOK;
+}
 
-    return index_read(key, item, 0, part_id);
+RC index_btree::index_read(idx_key_t key, itemid_t *&item, int part_id) {
+    assert(part_id != -1);
+    bt_node * leaf;
+    item = lookup(part_id % part_cnt, key, leaf);
+    M_ASSERT_V(item != NULL, "the key %ld does not exist!\n", key);
+    return RCOK;
 }
 
-RC index_btree::index_read(idx_key_t key, itemid_t *&item, uint64_t thd_id, int64_t part_id) {
-    RC rc = Abort;
-    glob_param params;
+RC index_btree::index_read(idx_key_t key, int count, itemid_t *&item, int64_t part_id) {
     assert(part_id != -1);
-    params.part_id = part_id;
     bt_node * leaf;
-    find_leaf(params, key, INDEX_READ, leaf);
-  if (leaf == NULL) M_ASSERT(false, "the leaf does not exist!");
-    for (UInt32 i = 0; i < leaf->num_keys; i++)
-        if (leaf->keys[i] == key) {
-            item = (itemid_t *)leaf->pointers[i];
-            release_latch(leaf);
-            (*cur_leaf_per_thd[thd_id]) = leaf;
-            *cur_idx_per_thd[thd_id] = i;
-            return RCOK;
-        }
-    // release the latch after reading the node
+    item = lookup(part_id % part_cnt, key, leaf);
+    // items of the same key are chained through itemid_t::next
+    for (; item != NULL && count > 0; count --) item = item->next;
+    return RCOK;
+}
 
-    printf("key = %ld\n", key);
-    M_ASSERT(false, "the key does not exist!");
-    return rc;
+RC index_btree::index_read(idx_key_t key, itemid_t *&item, int part_id, int thd_id) {
+    assert(part_id != -1);
+    bt_node * leaf;
+    item = lookup(part_id % part_cnt, key, leaf);
+    M_ASSERT_V(item != NULL, "the key %ld does not exist!\n", key);
+    cursor_per_thd[thd_id]->leaf = leaf;
+    cursor_per_thd[thd_id]->key = key;
+    return RCOK;
 }
 
 RC index_btree::index_insert(idx_key_t key, itemid_t * item, int part_id) {
-    glob_param params;
     if (WORKLOAD == TPCC) assert(part_id != -1);
     assert(part_id != -1);
-    params.part_id = part_id;
-    // create a tree if there does not exist one already
-    RC rc = RCOK;
-    bt_node * root = find_root(params.part_id);
-    assert(root != NULL);
-    int depth = 0;
-    // TODO tree depth < 100
-    bt_node * ex_list[100];
-    bt_node * leaf = NULL;
-    bt_node * last_ex = NULL;
-    rc = find_leaf(params, key, INDEX_INSERT, leaf, last_ex);
-    assert(rc == RCOK);
-
-    bt_node * tmp_node = leaf;
-    if (last_ex != NULL) {
-        while (tmp_node != last_ex) {
-            ex_list[depth++] = tmp_node;
-            tmp_node = tmp_node->parent;
-            assert (depth < 100);
+    uint64_t pid = part_id % part_cnt;
+restart:
+    uint64_t version;
+    bt_node * node = find_root(pid, version);
+    bt_node * parent = NULL;
+    uint64_t parent_version = 0;
+    while (true) {
+        if (key_cnt(node) == order - 1) {
+            // split full nodes on the way down, so the parent of a split always has room
+            if (parent != NULL && !upgrade_latch(parent, parent_version)) goto restart;
+            if (!upgrade_latch(node, version)) {
+                if (parent != NULL) release_latch(parent);
+                goto restart;
+            }
+            split(pid, parent, node);
+            release_latch(node);
+            if (parent != NULL) release_latch(parent);
+            goto restart;
+        }
+        if (node->is_leaf) break;
+        bt_node * child = (bt_node *) node->pointers[find_child(node, key)];
+        uint64_t child_version;
+        if (!validate(node, version) || !read_latch(child, child_version) ||
+                !validate(node, version))
+            goto restart;
+        parent = node;
+        parent_version = version;
+        node = child;
+        version = child_version;
+    }
+    if (!upgrade_latch(node, version)) goto restart;
+    insert_into_leaf(node, key, item);
+    release_latch(node);
+    return RCOK;
+}
+
+RC index_btree::index_load(idx_entry * entries, uint64_t cnt, int part_id) {
+    assert(part_id != -1);
+    if (cnt == 0) return RCOK;
+    uint64_t pid = part_id % part_cnt;
+    // chain the items of equal keys as index_insert() does, leaving one entry per key
+    uint64_t distinct_cnt = 0;
+    for (uint64_t i = 0; i < cnt; i++) {
+        assert(i == 0 || entries[i - 1].key <= entries[i].key);
+        if (distinct_cnt > 0 && entries[i].key == entries[distinct_cnt - 1].key) {
+            entries[i].item->next = entries[distinct_cnt - 1].item;
+            entries[distinct_cnt - 1].item = entries[i].item;
+        } else {
+            entries[i].item->next = NULL;
+            entries[distinct_cnt++] = entries[i];
+        }
+    }
+    // fill the leaves evenly, rather than leaving the last one nearly empty
+    const uint64_t leaf_cnt = (distinct_cnt + order - 2) / (order - 1);
+    bt_run run;
+    run.first = NULL;
+    bt_node * prev = NULL;
+    uint64_t pos = 0;
+    for (uint64_t i = 0; i < leaf_cnt; i++) {
+        bt_node * leaf;
+        make_lf(pid, leaf);
+        UInt32 num_keys = distinct_cnt / leaf_cnt + (i < distinct_cnt % leaf_cnt ? 1 : 0);
+        for (UInt32 j = 0; j < num_keys; j++, pos++) {
+            leaf->keys[j] = entries[pos].key;
+            leaf->pointers[j] = (void *) entries[pos].item;
+        }
+        leaf->num_keys = num_keys;
+        if (prev == NULL)
+            run.first = leaf;
+        else
+            prev->next = leaf;
+        prev = leaf;
+    }
+    assert(pos == distinct_cnt);
+    run.last = prev;
+    run.min_key = entries[0].key;
+    run.max_key = entries[distinct_cnt - 1].key;
+    pthread_mutex_lock(&load_latch);
+    load_runs[pid].push_back(run);
+    pthread_mutex_unlock(&load_latch);
+    return RCOK;
+}
+
+RC index_btree::index_load_finish(int part_id) {
+    assert(part_id != -1);
+    uint64_t pid = part_id % part_cnt;
+    std::vector<bt_run> & runs = load_runs[pid];
+    if (runs.empty()) return RCOK;
+    std::sort(runs.begin(), runs.end(),
+              [](const bt_run & a, const bt_run & b) { return a.min_key < b.min_key; });
+    bt_node * root = roots[pid].load(std::memory_order_relaxed);
+    bool sorted = root->is_leaf && root->num_keys == 0;
+    for (uint64_t i = 1; i < runs.size() && sorted; i++)
+        sorted = runs[i - 1].max_key < runs[i].min_key;
+    if (!sorted) {
+        for (const bt_run & run : runs) load_items(pid, run);
+        std::vector<bt_run>().swap(runs);
+        return RCOK;
+    }
+
+    // the leaf level is the runs linked in key order, every upper level packs up to order
+    // children of the level below into each node
+    std::vector<bt_node *> level;
+    std::vector<idx_key_t> low_keys; // the smallest key under each node of level
+    for (uint64_t i = 0; i < runs.size(); i++) {
+        if (i > 0) runs[i - 1].last->next = runs[i].first;
+        for (bt_node * leaf = runs[i].first; ; leaf = leaf->next) {
+            level.push_back(leaf);
+            low_keys.push_back(leaf->keys[0]);
+            if (leaf == runs[i].last) break;
+        }
+    }
+    std::vector<bt_run>().swap(runs);
+    while (level.size() > 1) {
+        const uint64_t node_cnt = (level.size() + order - 1) / order;
+        std::vector<bt_node *> parents;
+        std::vector<idx_key_t> parent_low_keys;
+        parents.reserve(node_cnt);
+        parent_low_keys.reserve(node_cnt);
+        uint64_t pos = 0;
+        for (uint64_t i = 0; i < node_cnt; i++) {
+            bt_node * node;
+            make_nl(pid, node);
+            UInt32 child_cnt = level.size() / node_cnt + (i < level.size() % node_cnt ? 1 : 0);
+            for (UInt32 j = 0; j < child_cnt; j++) {
+                node->pointers[j] = level[pos + j];
+                if (j > 0) node->keys[j - 1] = low_keys[pos + j];
+            }
+            node->num_keys = child_cnt - 1;
+            parents.push_back(node);
+            parent_low_keys.push_back(low_keys[pos]);
+            pos += child_cnt;
+        }
+        level.swap(parents);
+        low_keys.swap(parent_low_keys);
+    }
+    // the old root is an empty leaf, nodes are never freed
+    roots[pid].store(level[0], std::memory_order_release);
+    return RCOK;
+}
+
+void index_btree::load_items(uint64_t part_id, const bt_run & run) {
+    for (bt_node * leaf = run.first; ; leaf = leaf->next) {
+        for (UInt32 i = 0; i < leaf->num_keys; i++) {
+            visit_items(leaf->keys[i], (itemid_t *) leaf->pointers[i], part_id,
+                        [this](idx_key_t key, itemid_t * item, int part_id) {
+                item->next = NULL;
+                index_insert(key, item, part_id);
+            });
+        }
+        if (leaf == run.last) break;
+    }
+}
+
+void index_btree::index_visit(const idx_visitor & visit) {
+    for (UInt32 part_id = 0; part_id < part_cnt; part_id ++) {
+        uint64_t version;
+        for (bt_node * leaf = find_leaf(part_id, 0, version); leaf != NULL; leaf = leaf->next) {
+            for (UInt32 i = 0; i < leaf->num_keys; i++)
+                visit_items(leaf->keys[i], (itemid_t *) leaf->pointers[i], part_id, visit);
         }
-        ex_list[depth ++] = last_ex;
-    } else
-        ex_list[depth++] = leaf;
-    // from this point, the required data structures are all latched,
-    // so the system should not abort anymore.
-    // insert into btree if the leaf is not full
-    if (leaf->num_keys < order - 1 || leaf_has_key(leaf, key) >= 0) {
-        rc = insert_into_leaf(params, leaf, key, item);
-        // only the leaf should be ex latched.
-        for (int i = 0; i < depth; i++) release_latch(ex_list[i]);
-    } else {  // split the nodes when necessary
-        rc = split_lf_insert(params, leaf, key, item);
-        for (int i = 0; i < depth; i++) release_latch(ex_list[i]);
     }
-    return rc;
 }
 
 RC index_btree::make_lf(uint64_t part_id, bt_node *& node) {
@@ -183,188 +401,21 @@ RC index_btree::make_node(uint64_t part_id, bt_node *& node) {
     assert (new_node->keys != NULL && new_node->pointers != NULL);
     new_node->is_leaf = false;
     new_node->num_keys = 0;
-    new_node->parent = NULL;
     new_node->next = NULL;
-    new_node->latch = false;
-    new_node->latch_type = LATCH_NONE;
+    new (&new_node->version) std::atomic<uint64_t>(0);
 
     node = new_node;
     return RCOK;
 }
 
-RC index_btree::start_new_tree(glob_param params, idx_key_t key, itemid_t * item) {
-    RC rc;
-    uint64_t part_id = params.part_id;
-    rc = make_lf(part_id, roots[part_id % part_cnt]);
-    if (rc != RCOK) return rc;
-    bt_node * root = roots[part_id % part_cnt];
-    assert(root != NULL);
-    root->keys[0] = key;
-    root->pointers[0] = (void *)item;
-    root->parent = NULL;
-    root->num_keys++;
-    return RCOK;
-}
-
-bool index_btree::latch_node(bt_node * node, latch_t latch_type) {
-    // TODO latch is disabled
-    if (!ENABLE_LATCH) return true;
-        bool success = false;
-
-    while (!ATOM_CAS(node->latch, false, true)) {
-    }
-
-
-    latch_t node_latch = node->latch_type;
-    if (node_latch == LATCH_NONE || (node_latch == LATCH_SH && latch_type == LATCH_SH)) {
-        node->latch_type = latch_type;
-        if (node_latch == LATCH_NONE) M_ASSERT((node->share_cnt == 0), "share cnt none 0!");
-        if (node->latch_type == LATCH_SH) node->share_cnt++;
-            success = true;
-    } else  // latch_type incompatible
-            success = false;
-
-    bool ok = ATOM_CAS(node->latch, true, false);
-    assert(ok);
-
-    return success;
-}
-
-latch_t index_btree::release_latch(bt_node * node) {
-    if (!ENABLE_LATCH) return LATCH_SH;
-        latch_t type = node->latch_type;
-
-    while (!ATOM_CAS(node->latch, false, true)) {
-    }
-
-    M_ASSERT((node->latch_type != LATCH_NONE), "release latch fault");
-    if (node->latch_type == LATCH_EX)
-        node->latch_type = LATCH_NONE;
-    else if (node->latch_type == LATCH_SH) {
-        node->share_cnt --;
-    if (node->share_cnt == 0) node->latch_type = LATCH_NONE;
-    }
-    bool ok = ATOM_CAS(node->latch, true, false);
-    assert(ok);
-    return type;
-}
-
-RC index_btree::upgrade_latch(bt_node * node) {
-    if (!ENABLE_LATCH) return RCOK;
-        bool success = false;
-
-    while (!ATOM_CAS(node->latch, false, true)) {
-    }
-
-    M_ASSERT( (node->latch_type == LATCH_SH), "" );
-    if (node->share_cnt > 1)
-        success = false;
-    else { // share_cnt == 1
-        success = true;
-        node->latch_type = LATCH_EX;
-        node->share_cnt = 0;
-    }
-
-    bool ok = ATOM_CAS(node->latch, true, false);
-    assert(ok);
-
-    if (success)
-        return RCOK;
-    else
-        return Abort;
-}
-
-RC index_btree::cleanup(bt_node * node, bt_node * last_ex) {
-    if (last_ex != NULL) {
-        do {
-            node = node->parent;
-            release_latch(node);
-        } while (node != last_ex);
-    }
-    return RCOK;
-}
-
-RC index_btree::find_leaf(glob_param params, idx_key_t key, idx_acc_t access_type, bt_node *& leaf) {
-    bt_node * last_ex = NULL;
-    assert(access_type != INDEX_INSERT);
-    RC rc = find_leaf(params, key, access_type, leaf, last_ex);
-    return rc;
-}
-
-RC index_btree::find_leaf(glob_param params, idx_key_t key, idx_acc_t access_type, bt_node *&leaf,
-                          bt_node *&last_ex) {
-    UInt32 i;
-    bt_node * c = find_root(params.part_id);
-    assert(c != NULL);
-    bt_node * child;
-    if (access_type == INDEX_NONE) {
-        while (!c->is_leaf) {
-            for (i = 0; i < c->num_keys; i++) {
-        if (key < c->keys[i]) break;
-            }
-            c = (bt_node *)c->pointers[i];
-        }
-        leaf = c;
-        return RCOK;
-    }
-
-    if (!latch_node(c, LATCH_SH)) return Abort;
-    while (!c->is_leaf) {
-        assert(get_part_id(c) == params.part_id);
-        assert(get_part_id(c->keys) == params.part_id);
-        for (i = 0; i < c->num_keys; i++) {
-            if (key < c->keys[i]) break;
-        }
-        child = (bt_node *)c->pointers[i];
-        if (!latch_node(child, LATCH_SH)) {
-            release_latch(c);
-            cleanup(c, last_ex);
-            last_ex = NULL;
-            return Abort;
-        }
-        if (access_type == INDEX_INSERT) {
-            if (child->num_keys == order - 1) {
-                if (upgrade_latch(c) != RCOK) {
-                    release_latch(c);
-                    release_latch(child);
-                    cleanup(c, last_ex);
-                    last_ex = NULL;
-                    return Abort;
-                }
-                if (last_ex == NULL) last_ex = c;
-            } else {
-                cleanup(c, last_ex);
-                last_ex = NULL;
-                release_latch(c);
-            }
-        } else
-            release_latch(c); // release the LATCH_SH on c
-        c = child;
-    }
-    // c is leaf
-    // at this point, if the access is a read, then only the leaf is latched by LATCH_SH
-    // if the access is an insertion, then the leaf is sh latched and related nodes in the tree
-    // are ex latched.
-    if (access_type == INDEX_INSERT) {
-        if (upgrade_latch(c) != RCOK) {
-            release_latch(c);
-            cleanup(c, last_ex);
-            return Abort;
-        }
-    }
-    leaf = c;
-    assert (leaf->is_leaf);
-    return RCOK;
-}
-
-RC index_btree::insert_into_leaf(glob_param params, bt_node * leaf, idx_key_t key, itemid_t * item) {
+void index_btree::insert_into_leaf(bt_node * leaf, idx_key_t key, itemid_t * item) {
     UInt32 i, insertion_point;
     insertion_point = 0;
     int idx = leaf_has_key(leaf, key);
     if (idx >= 0) {
         item->next = (itemid_t *)leaf->pointers[idx];
         leaf->pointers[idx] = (void *) item;
-        return RCOK;
+        return;
     }
     while (insertion_point < leaf->num_keys && leaf->keys[insertion_point] < key) insertion_point++;
     for (i = leaf->num_keys; i > insertion_point; i--) {
@@ -375,198 +426,65 @@ RC index_btree::insert_into_leaf(glob_param params, bt_node * leaf, idx_key_t ke
     leaf->pointers[insertion_point] = (void *)item;
     leaf->num_keys++;
     M_ASSERT( (leaf->num_keys < order), "too many keys in leaf" );
-    return RCOK;
 }
 
-RC index_btree::split_lf_insert(glob_param params, bt_node * leaf, idx_key_t key, itemid_t * item) {
-    RC rc;
-    UInt32 insertion_index, split, i, j;
+void index_btree::split(uint64_t part_id, bt_node * parent, bt_node * node) {
+    UInt32 i, split;
     idx_key_t new_key;
-
-    uint64_t part_id = params.part_id;
-    bt_node * new_leaf;
-
-    rc = make_lf(part_id, new_leaf);
-    if (rc != RCOK) return rc;
-
-    M_ASSERT(leaf->num_keys == order - 1, "trying to split non-full leaf!");
-
-    idx_key_t temp_keys[BTREE_ORDER];
-    itemid_t * temp_pointers[BTREE_ORDER];
-    insertion_index = 0;
-    while (insertion_index < order - 1 && leaf->keys[insertion_index] < key) insertion_index++;
-
-    for (i = 0, j = 0; i < leaf->num_keys; i++, j++) {
-        if (j == insertion_index) j++;
-
-        temp_keys[j] = leaf->keys[i];
-        temp_pointers[j] = (itemid_t *)leaf->pointers[i];
-    }
-
-    temp_keys[insertion_index] = key;
-    temp_pointers[insertion_index] = item;
-
-    split = cut(order - 1);
-    leaf->num_keys = 0;
-    for (i = 0; i < split; i++) {
-        leaf->pointers[i] = temp_pointers[i];
-        leaf->keys[i] = temp_keys[i];
-        leaf->num_keys++;
-        M_ASSERT( (leaf->num_keys < order), "too many keys in leaf" );
-    }
-    for (i = split, j = 0; i < order; i++, j++) {
-
-        new_leaf->pointers[j] = temp_pointers[i];
-        new_leaf->keys[j] = temp_keys[i];
-        new_leaf->num_keys++;
-        M_ASSERT( (leaf->num_keys < order), "too many keys in leaf" );
-    }
-
-    new_leaf->next = leaf->next;
-    leaf->next = new_leaf;
-
-    for (i = leaf->num_keys; i < order - 1; i++) leaf->pointers[i] = NULL;
-    for (i = new_leaf->num_keys; i < order - 1; i++) new_leaf->pointers[i] = NULL;
-
-    new_leaf->parent = leaf->parent;
-    new_key = new_leaf->keys[0];
-
-    rc = insert_into_parent(params, leaf, new_key, new_leaf);
-    return rc;
-}
-
-RC index_btree::insert_into_parent(glob_param params, bt_node *left, idx_key_t key,
-    bt_node * right) {
-
-    bt_node * parent = left->parent;
-
-    /* Case: new root. */
-    if (parent == NULL) return insert_into_new_root(params, left, key, right);
-
-    UInt32 insert_idx = 0;
-    while (parent->keys[insert_idx] < key && insert_idx < parent->num_keys) insert_idx++;
-    // the parent has enough space, just insert into it
-    if (parent->num_keys < order - 1) {
-        for (UInt32 i = parent->num_keys-1; i >= insert_idx; i--) {
-            parent->keys[i + 1] = parent->keys[i];
-            parent->pointers[i+2] = parent->pointers[i+1];
+    bt_node * new_node;
+
+    M_ASSERT(node->num_keys == order - 1, "trying to split non-full node!");
+    // fill the new right node before it becomes reachable from the parent or node->next
+    if (node->is_leaf) {
+        make_lf(part_id, new_node);
+        split = cut(node->num_keys);
+        for (i = split; i < node->num_keys; i++) {
+            new_node->keys[i - split] = node->keys[i];
+            new_node->pointers[i - split] = node->pointers[i];
         }
-        parent->num_keys ++;
-        parent->keys[insert_idx] = key;
-        parent->pointers[insert_idx + 1] = right;
-        return RCOK;
-    }
-
-    /* Harder case:  split a node in order
-     * to preserve the B+ tree properties.
-     */
-
-    return split_nl_insert(params, parent, insert_idx, key, right);
-}
-
-RC index_btree::insert_into_new_root(glob_param params, bt_node *left, idx_key_t key,
-                                     bt_node *right) {
-    RC rc;
-    uint64_t part_id = params.part_id;
-    bt_node * new_root;
-
-    rc = make_nl(part_id, new_root);
-    if (rc != RCOK) return rc;
-    new_root->keys[0] = key;
-    new_root->pointers[0] = left;
-    new_root->pointers[1] = right;
-    new_root->num_keys++;
-    M_ASSERT( (new_root->num_keys < order), "too many keys in leaf" );
-    new_root->parent = NULL;
-    left->parent = new_root;
-    right->parent = new_root;
-    left->next = right;
-
-    this->roots[part_id] = new_root;
-    // TODO this new root is not latched, at this point, other threads
-    // may start to access this new root. Is this ok?
-    return RCOK;
-}
-
-RC index_btree::split_nl_insert(glob_param params, bt_node *old_node, UInt32 left_index,
-                                idx_key_t key, bt_node *right) {
-    RC rc;
-    uint64_t i, j, split, k_prime;
-    bt_node * new_node, * child;
-
-    uint64_t part_id = params.part_id;
-    rc = make_node(part_id, new_node);
-
-    /* First create a temporary set of keys and pointers
-     * to hold everything in order, including
-     * the new key and pointer, inserted in their
-     * correct places.
-     * Then create a new node and copy half of the
-     * keys and pointers to the old node and
-     * the other half to the new.
-     */
-
-    idx_key_t temp_keys[BTREE_ORDER];
-    bt_node * temp_pointers[BTREE_ORDER + 1];
-    for (i = 0, j = 0; i < old_node->num_keys + 1; i++, j++) {
-        if (j == left_index + 1) j++;
-        temp_pointers[j] = (bt_node *)old_node->pointers[i];
-    }
-
-    for (i = 0, j = 0; i < old_node->num_keys; i++, j++) {
-        if (j == left_index) j++;
-
-        temp_keys[j] = old_node->keys[i];
-    }
-
-    temp_pointers[left_index + 1] = right;
-    temp_keys[left_index] = key;
-
-    /* Create the new node and copy
-     * half the keys and pointers to the
-     * old and half to the new.
-     */
-    split = cut(order);
-    if (rc != RCOK) return rc;
-
-    old_node->num_keys = 0;
-    for (i = 0; i < split - 1; i++) {
-        old_node->pointers[i] = temp_pointers[i];
-        old_node->keys[i] = temp_keys[i];
-        old_node->num_keys++;
-        M_ASSERT( (old_node->num_keys < order), "too many keys in leaf" );
+        new_node->num_keys = node->num_keys - split;
+        new_key = new_node->keys[0];
+        new_node->next = node->next;
+        node->next = new_node;
+    } else {
+        // the middle key moves up to the parent
+        make_nl(part_id, new_node);
+        split = node->num_keys / 2;
+        for (i = split + 1; i < node->num_keys; i++) {
+            new_node->keys[i - split - 1] = node->keys[i];
+            new_node->pointers[i - split - 1] = node->pointers[i];
+        }
+        new_node->pointers[node->num_keys - split - 1] = node->pointers[node->num_keys];
+        new_node->num_keys = node->num_keys - split - 1;
+        new_key = node->keys[split];
     }
-
-    new_node->next = old_node->next;
-    old_node->next = new_node;
-
-    old_node->pointers[i] = temp_pointers[i];
-    k_prime = temp_keys[split - 1];
-    for (++i, j = 0; i < order; i++, j++) {
-        new_node->pointers[j] = temp_pointers[i];
-        new_node->keys[j] = temp_keys[i];
-
-        new_node->num_keys++;
-        M_ASSERT( (old_node->num_keys < order), "too many keys in leaf" );
+    node->num_keys = split;
+
+    if (parent == NULL) {
+        bt_node * new_root;
+        make_nl(part_id, new_root);
+        new_root->keys[0] = new_key;
+        new_root->pointers[0] = node;
+        new_root->pointers[1] = new_node;
+        new_root->num_keys = 1;
+        roots[part_id].store(new_root, std::memory_order_release);
+        return;
     }
-    new_node->pointers[j] = temp_pointers[i];
-
-    new_node->parent = old_node->parent;
-    for (i = 0; i <= new_node->num_keys; i++) {
-        child = (bt_node *)new_node->pointers[i];
-        child->parent = new_node;
+    UInt32 insert_idx = find_child(parent, new_key);
+    assert(parent->pointers[insert_idx] == node);
+    for (i = parent->num_keys; i > insert_idx; i--) {
+        parent->keys[i] = parent->keys[i - 1];
+        parent->pointers[i + 1] = parent->pointers[i];
     }
-
-    /* Insert a new key into the parent of the two
-     * nodes resulting from the split, with
-     * the old node to the left and the new to the right.
-     */
-
-    return insert_into_parent(params, old_node, k_prime, new_node);
+    parent->keys[insert_idx] = new_key;
+    parent->pointers[insert_idx + 1] = new_node;
+    parent->num_keys ++;
+    M_ASSERT( (parent->num_keys < order), "too many keys in node" );
 }
 
 int index_btree::leaf_has_key(bt_node * leaf, idx_key_t key) {
-    for (UInt32 i = 0; i < leaf->num_keys; i++)
+    const UInt32 num_keys = key_cnt(leaf);
+    for (UInt32 i = 0; i < num_keys; i++)
     if (leaf->keys[i] == key) return i;
     return -1;
 }
@@ -21,25 +21,46 @@
 #include "helper.h"
 #include "index_base.h"
 
+#include <atomic>
+#include <pthread.h>
+#include <vector>
+
+// The lowest bit of bt_node::version is the write latch. Unlatching adds one more, so every
+// modification of a node moves its version forward by two.
+#define BT_NODE_LATCHED         1ULL
 
 typedef struct bt_node {
     // TODO bad hack!
        void ** pointers; // for non-leaf nodes, point to bt_nodes
     bool is_leaf;
     idx_key_t * keys;
-    bt_node * parent;
     UInt32 num_keys;
     bt_node * next;
-    bool latch;
-    pthread_mutex_t locked;
-    latch_t latch_type;
-    UInt32 share_cnt;
+    std::atomic<uint64_t> version;
 } bt_node;
 
-struct glob_param {
-    uint64_t part_id;
+// Position of a range scan: the leaf and the last key it returned. Splits only move keys into new
+// right siblings, so the cursor finds its place again by key rather than by slot, and a cursor
+// stays valid while the tree changes.
+struct bt_cursor {
+    bt_node * leaf;
+    idx_key_t key;
+};
+
+// Leaves built by one index_load() call, chained through bt_node::next.
+struct bt_run {
+    bt_node * first;
+    bt_node * last;
+    idx_key_t min_key;
+    idx_key_t max_key;
 };
 
+// B+tree with optimistic lock coupling. Readers take no latch and write nothing: they remember the
+// version of each node they visit and restart from the root if it changed before they are done.
+// Inserters descend the same way, latch only the leaf they modify, and split full nodes on the way
+// down so that a split never needs more than the node and its parent latched.
+// Nodes are never freed, so a reader holding a stale node pointer only reads stale data, which the
+// version check rejects.
 class index_btree : public index_base {
 public:
     RC            init(uint64_t part_cnt);
@@ -47,10 +68,21 @@ public:
     bool          index_exist(idx_key_t key); // check if the key exist.
     RC            index_insert(idx_key_t key, itemid_t * item, int part_id = -1);
     RC            index_insert_nonunique(idx_key_t key, itemid_t * item, int part_id = -1) { return RCOK;}
-    RC            index_read(idx_key_t key, itemid_t *&item, uint64_t thd_id, int64_t part_id = -1);
+    RC            index_read(idx_key_t key, itemid_t *&item, int part_id, int thd_id);
     RC            index_read(idx_key_t key, itemid_t * &item, int part_id = -1);
-    RC            index_read(idx_key_t key, itemid_t * &item);
+    RC            index_read(idx_key_t key, int count, itemid_t * &item, int64_t part_id = -1);
     RC            index_next(uint64_t thd_id, itemid_t * &item, bool samekey = false);
+    // Range scan. index_scan() places cursor on the first key >= key and index_scan_next() moves
+    // it to the next key; both return the items of the key in item, or NULL at the end of the tree.
+    RC            index_scan(bt_cursor & cursor, idx_key_t key, itemid_t * &item, int part_id = -1);
+    RC            index_scan_next(bt_cursor & cursor, itemid_t * &item);
+    // Bottom-up bulk loading. The entries of one call must be sorted by key. Each call packs its
+    // entries into a run of leaves; index_load_finish() links the runs of the partition and builds
+    // the inner levels on top. If the partition is not empty or the runs overlap, the items are
+    // inserted one by one instead.
+    RC            index_load(idx_entry * entries, uint64_t cnt, int part_id);
+    RC            index_load_finish(int part_id);
+    void          index_visit(const idx_visitor & visit);
 
 private:
     // index structures may have part_cnt = 1 or PART_CNT.
@@ -59,34 +91,37 @@ private:
     RC            make_nl(uint64_t part_id, bt_node *& node);
     RC            make_node(uint64_t part_id, bt_node *& node);
 
-    RC            start_new_tree(glob_param params, idx_key_t key, itemid_t * item);
-    RC            find_leaf(glob_param params, idx_key_t key, idx_acc_t access_type, bt_node *&leaf,
-               bt_node *&last_ex);
-    RC            find_leaf(glob_param params, idx_key_t key, idx_acc_t access_type, bt_node *& leaf);
-    RC            insert_into_leaf(glob_param params, bt_node * leaf, idx_key_t key, itemid_t * item);
-    // handle split
-    RC            split_lf_insert(glob_param params, bt_node * leaf, idx_key_t key, itemid_t * item);
-    RC            split_nl_insert(glob_param params, bt_node *node, UInt32 left_index, idx_key_t key,
-                     bt_node *right);
-    RC            insert_into_parent(glob_param params, bt_node * left, idx_key_t key, bt_node * right);
-    RC            insert_into_new_root(glob_param params, bt_node * left, idx_key_t key, bt_node * right);
+    // returns the leaf that may hold key and the version it was read at
+    bt_node *     find_leaf(uint64_t part_id, idx_key_t key, uint64_t & version);
+    itemid_t *    lookup(uint64_t part_id, idx_key_t key, bt_node *& leaf);
+    UInt32        find_child(const bt_node * node, idx_key_t key);
+    UInt32        key_cnt(const bt_node * node);
+    // move cursor to the first key after (or at, if inclusive) cursor.key
+    void          scan(bt_cursor & cursor, bool inclusive, itemid_t *& item);
+    void          insert_into_leaf(bt_node * leaf, idx_key_t key, itemid_t * item);
+    // split a full node into itself and a new right sibling, both parent and node are latched
+    void          split(uint64_t part_id, bt_node * parent, bt_node * node);
 
     int           leaf_has_key(bt_node * leaf, idx_key_t key);
 
     UInt32        cut(UInt32 length);
     UInt32        order; // # of keys in a node(for both leaf and non-leaf)
-    bt_node **    roots; // each partition has a different root
-    bt_node *     find_root(uint64_t part_id);
-
-    bool          latch_node(bt_node * node, latch_t latch_type);
-    latch_t       release_latch(bt_node * node);
-    RC            upgrade_latch(bt_node * node);
-    // clean up all the LATCH_EX up tp last_ex
-    RC            cleanup(bt_node * node, bt_node * last_ex);
-
-    // the leaf and the idx within the leaf that the thread last accessed.
-    bt_node ***   cur_leaf_per_thd;
-    UInt32 **     cur_idx_per_thd;
+    std::atomic<bt_node *> * roots; // each partition has a different root
+    bt_node *     find_root(uint64_t part_id, uint64_t & version);
+
+    // optimistic latching, all return false if the caller must restart
+    static bool   read_latch(const bt_node * node, uint64_t & version);
+    static bool   validate(const bt_node * node, uint64_t version);
+    static bool   upgrade_latch(bt_node * node, uint64_t version);
+    static void   release_latch(bt_node * node);
+
+    // runs of each partition waiting for index_load_finish()
+    std::vector<bt_run> * load_runs;
+    pthread_mutex_t load_latch;
+    void          load_items(uint64_t part_id, const bt_run & run);
+
+    // the position that each thread last read, used by index_next()
+    bt_cursor **  cursor_per_thd;
 };
 
 #endif
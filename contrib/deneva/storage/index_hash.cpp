@@ -14,23 +14,31 @@
    limitations under the License.
 */
 
+#include <emmintrin.h>
+
 #include "global.h"
 #include "index_hash.h"
 #include "mem_alloc.h"
 #include "row.h"
 
+// Bitmask of the slots whose fingerprint equals tag, all seven compared in one SSE2 instruction.
+static inline uint32_t match_tags(uint64_t tags, uint8_t tag) {
+    const __m128i word = _mm_cvtsi64_si128((int64_t) tags);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(word, _mm_set1_epi8((char) tag))) & HASH_SLOT_MASK;
+}
+
 RC IndexHash::init(uint64_t bucket_cnt) {
-    _bucket_cnt = bucket_cnt;
-    _bucket_cnt_per_part = bucket_cnt;
-
-    _buckets = new BucketHeader * [1];
-    _buckets[0] = (BucketHeader *) mem_allocator.alloc(sizeof(BucketHeader) * _bucket_cnt_per_part);
-    uint64_t buckets_init_cnt = 0;
-    for (UInt32 n = 0; n < _bucket_cnt_per_part; n ++) {
-                _buckets[0][n].init();
-        ++buckets_init_cnt;
+    // bucket_cnt is the expected number of keys
+    const uint64_t min_bucket_cnt =
+        bucket_cnt * HASH_MAX_LOAD_DEN / HASH_MAX_LOAD_NUM / HASH_BUCKET_SLOT_CNT + 1;
+    uint64_t table_bucket_cnt = 1;
+    while (table_bucket_cnt < min_bucket_cnt) {
+        table_bucket_cnt <<= 1;
     }
-    printf("Index init with %ld buckets\n",buckets_init_cnt);
+    _table = alloc_table(table_bucket_cnt);
+    _item_cnt = 0;
+    pthread_rwlock_init(&_resize_latch, NULL);
+    printf("Index init with %ld buckets\n",table_bucket_cnt);
     return RCOK;
 }
 
@@ -41,207 +49,231 @@ RC IndexHash::init(int part_cnt, table_t *table, uint64_t bucket_cnt) {
 }
 
 void IndexHash::index_delete() {
-    for (UInt32 n = 0; n < _bucket_cnt_per_part; n ++) {
-        _buckets[0][n].delete_bucket();
+    HashTable * const table = _table.load(std::memory_order_relaxed);
+    free_rows(table);
+    free_table(table);
+    for (HashTable * const retired_table : _retired_tables) {
+        free_table(retired_table);
     }
-    mem_allocator.free(_buckets[0],sizeof(BucketHeader) * _bucket_cnt_per_part);
-    delete _buckets;
+    _retired_tables.clear();
+    pthread_rwlock_destroy(&_resize_latch);
 }
 
 void IndexHash::index_reset() {
-    for (UInt32 n = 0; n < _bucket_cnt_per_part; n ++) {
-        _buckets[0][n].delete_bucket();
-    }
+    HashTable * const table = _table.load(std::memory_order_relaxed);
+    free_rows(table);
+    memset((void *) table->buckets, 0, sizeof(HashBucket) * (table->bucket_mask + 1));
+    _item_cnt = 0;
 }
 
 bool IndexHash::index_exist(idx_key_t key) {
-    assert(false);
+    return lookup(_table.load(std::memory_order_acquire), key, 0) != NULL;
 }
 
-void
-IndexHash::get_latch(BucketHeader * bucket) {
-    while (!ATOM_CAS(bucket->locked, false, true)) {}
+HashTable * IndexHash::alloc_table(uint64_t bucket_cnt) {
+    HashTable * const table = (HashTable *) mem_allocator.alloc(sizeof(HashTable));
+    table->raw = mem_allocator.alloc(sizeof(HashBucket) * bucket_cnt + CL_SIZE);
+    table->buckets = (HashBucket *) (((uint64_t) table->raw + CL_SIZE - 1) & ~(CL_SIZE - 1));
+    table->bucket_mask = bucket_cnt - 1;
+    memset((void *) table->buckets, 0, sizeof(HashBucket) * bucket_cnt);
+    return table;
 }
 
-void
-IndexHash::release_latch(BucketHeader * bucket) {
-    bool ok = ATOM_CAS(bucket->locked, true, false);
-    assert(ok);
+void IndexHash::free_table(HashTable * table) {
+    mem_allocator.free(table->raw, sizeof(HashBucket) * (table->bucket_mask + 1) + CL_SIZE);
+    mem_allocator.free(table, sizeof(HashTable));
 }
 
-
-RC IndexHash::index_insert(idx_key_t key, itemid_t * item, int part_id) {
-    RC rc = RCOK;
-    uint64_t bkt_idx = hash(key);
-    assert(bkt_idx < _bucket_cnt_per_part);
-    //BucketHeader * cur_bkt = &_buckets[part_id][bkt_idx];
-    BucketHeader * cur_bkt = &_buckets[0][bkt_idx];
-    // 1. get the ex latch
-    get_latch(cur_bkt);
-
-    // 2. update the latch list
-    cur_bkt->insert_item(key, item, part_id);
-
-    // 3. release the latch
-    release_latch(cur_bkt);//delete 
-    return rc;
+void IndexHash::free_rows(const HashTable * table) {
+    for (uint64_t idx = 0; idx <= table->bucket_mask; idx ++) {
+        const HashBucket & bucket = table->buckets[idx];
+        for (uint32_t slots = ~match_tags(bucket.tags, 0) & HASH_SLOT_MASK; slots != 0;
+             slots &= slots - 1) {
+            ((row_t *)bucket.items[__builtin_ctz(slots)].load()->location)->free_row();
+        }
+    }
 }
-RC IndexHash::index_insert_nonunique(idx_key_t key, itemid_t * item, int part_id) {
-    RC rc = RCOK;
-    uint64_t bkt_idx = hash(key);
-    assert(bkt_idx < _bucket_cnt_per_part);
-    //BucketHeader * cur_bkt = &_buckets[part_id][bkt_idx];
-    BucketHeader * cur_bkt = &_buckets[0][bkt_idx];
-    // 1. get the ex latch
-    get_latch(cur_bkt);
 
-    // 2. update the latch list
-    cur_bkt->insert_item_nonunique(key, item, part_id);
-
-    // 3. release the latch
-    release_latch(cur_bkt);
-    return rc;
+void
+IndexHash::get_latch(HashBucket * bucket) {
+    while (bucket->tags.fetch_or(HASH_BUCKET_LATCH, std::memory_order_acquire) &
+           HASH_BUCKET_LATCH) {
+    }
 }
 
-RC IndexHash::index_read(idx_key_t key, itemid_t * &item, int part_id) {
-    uint64_t bkt_idx = hash(key);
-    assert(bkt_idx < _bucket_cnt_per_part);
-    //BucketHeader * cur_bkt = &_buckets[part_id][bkt_idx];
-    BucketHeader * cur_bkt = &_buckets[0][bkt_idx];
-    RC rc = RCOK;
-    // 1. get the sh latch
-
-    cur_bkt->read_item(key, item);
-
-    // 3. release the latch
-    return rc;
-
+void
+IndexHash::release_latch(HashBucket * bucket) {
+    uint64_t tags = bucket->tags.fetch_and(~HASH_BUCKET_LATCH, std::memory_order_release);
+    assert(tags & HASH_BUCKET_LATCH);
+    (void) tags;
 }
 
-RC IndexHash::index_read(idx_key_t key, int count, itemid_t * &item, int part_id) {
-    uint64_t bkt_idx = hash(key);
-    assert(bkt_idx < _bucket_cnt_per_part);
-    //BucketHeader * cur_bkt = &_buckets[part_id][bkt_idx];
-    BucketHeader * cur_bkt = &_buckets[0][bkt_idx];
-    RC rc = RCOK;
-    // 1. get the sh latch
-
-    cur_bkt->read_item(key, count, item);
-
-    // 3. release the latch
-    return rc;
-
+itemid_t * IndexHash::lookup(const HashTable * table, idx_key_t key, uint32_t count) {
+    const uint64_t hash_val = hash(key);
+    const uint8_t tag = get_tag(hash_val);
+    for (uint64_t idx = hash_val & table->bucket_mask; ; idx = (idx + 1) & table->bucket_mask) {
+        const HashBucket & bucket = table->buckets[idx];
+        // items are published before their tags, so acquiring tags makes the items visible
+        const uint64_t tags = bucket.tags.load(std::memory_order_acquire);
+        for (uint32_t matches = match_tags(tags, tag); matches != 0; matches &= matches - 1) {
+            itemid_t * const item =
+                bucket.items[__builtin_ctz(matches)].load(std::memory_order_acquire);
+            if (item->key == key && count-- == 0) {
+                return item;
+            }
+        }
+        if (match_tags(tags, 0) != 0) {
+            return NULL;  // a bucket with an empty slot ends the probe
+        }
+    }
 }
 
-
-RC IndexHash::index_read(idx_key_t key, itemid_t * &item,
-                        int part_id, int thd_id) {
-    uint64_t bkt_idx = hash(key);
-    assert(bkt_idx < _bucket_cnt_per_part);
-    //BucketHeader * cur_bkt = &_buckets[part_id][bkt_idx];
-    BucketHeader * cur_bkt = &_buckets[0][bkt_idx];
-    RC rc = RCOK;
-    // 1. get the sh latch
-
-
-    cur_bkt->read_item(key, item);
-
-    // 3. release the latch
-    return rc;
+void IndexHash::insert_item(HashTable * table, idx_key_t key, itemid_t * item,
+                            bool merge_same_key) {
+    const uint64_t hash_val = hash(key);
+    const uint8_t tag = get_tag(hash_val);
+    // Inserts of the same key serialize on the home bucket, which is held until the item is in.
+    // Other buckets are latched one at a time in probing order. The table is never full, so the
+    // probe cannot wrap around to a bucket latched by another inserter and deadlock.
+    HashBucket * const home_bucket = &table->buckets[hash_val & table->bucket_mask];
+    get_latch(home_bucket);
+    for (uint64_t idx = hash_val & table->bucket_mask; ; idx = (idx + 1) & table->bucket_mask) {
+        HashBucket * const bucket = &table->buckets[idx];
+        if (bucket != home_bucket) {
+            get_latch(bucket);
+        }
+        const uint64_t tags = bucket->tags.load(std::memory_order_relaxed);
+        bool inserted = false;
+        if (merge_same_key) {
+            for (uint32_t matches = match_tags(tags, tag); matches != 0; matches &= matches - 1) {
+                std::atomic<itemid_t *> & slot = bucket->items[__builtin_ctz(matches)];
+                if (slot.load(std::memory_order_relaxed)->key == key) {
+                    item->next = slot.load(std::memory_order_relaxed);
+                    slot.store(item, std::memory_order_release);
+                    inserted = true;
+                    break;
+                }
+            }
+        }
+        const uint32_t empty_slots = match_tags(tags, 0);
+        if (!inserted && empty_slots != 0) {
+            const uint32_t slot = __builtin_ctz(empty_slots);
+            bucket->items[slot].store(item, std::memory_order_relaxed);
+            bucket->tags.store(tags | ((uint64_t) tag << (8 * slot)), std::memory_order_release);
+            inserted = true;
+        }
+        if (bucket != home_bucket) {
+            release_latch(bucket);
+        }
+        if (inserted) {
+            break;
+        }
+    }
+    release_latch(home_bucket);
 }
 
-/************** BucketHeader Operations ******************/
-
-void BucketHeader::init() {
-    node_cnt = 0;
-    first_node = NULL;
-    locked = false;
+void IndexHash::insert(idx_key_t key, itemid_t * item, bool merge_same_key) {
+    item->key = key;
+    while (true) {
+        pthread_rwlock_rdlock(&_resize_latch);
+        HashTable * const table = _table.load(std::memory_order_relaxed);
+        const uint64_t max_item_cnt = (table->bucket_mask + 1) * HASH_BUCKET_SLOT_CNT *
+                                      HASH_MAX_LOAD_NUM / HASH_MAX_LOAD_DEN;
+        // reserve a slot first so that concurrent inserters never overfill the table
+        if (_item_cnt.fetch_add(1, std::memory_order_relaxed) < max_item_cnt) {
+            insert_item(table, key, item, merge_same_key);
+            pthread_rwlock_unlock(&_resize_latch);
+            return;
+        }
+        _item_cnt.fetch_sub(1, std::memory_order_relaxed);
+        pthread_rwlock_unlock(&_resize_latch);
+        resize(table);
+    }
 }
 
-void BucketHeader::delete_bucket() {
-    BucketNode * cur_node = first_node;
-    while (cur_node != NULL) {
-    ((row_t *)cur_node->items->location)->free_row();
-        cur_node = cur_node->next;
+void IndexHash::resize(HashTable * old_table) {
+    pthread_rwlock_wrlock(&_resize_latch);
+    if (_table.load(std::memory_order_relaxed) == old_table) {
+        HashTable * const new_table = alloc_table((old_table->bucket_mask + 1) * 2);
+        for (uint64_t idx = 0; idx <= old_table->bucket_mask; idx ++) {
+            const HashBucket & bucket = old_table->buckets[idx];
+            for (uint32_t slots = ~match_tags(bucket.tags, 0) & HASH_SLOT_MASK; slots != 0;
+                 slots &= slots - 1) {
+                itemid_t * const item = bucket.items[__builtin_ctz(slots)];
+                // A slot moves as it is: the items index_insert() chained stay in one slot, and
+                // the items of index_insert_nonunique() in slots of their own.
+                insert_item(new_table, item->key, item, false);
+            }
+        }
+        _table.store(new_table, std::memory_order_release);
+        // lock-free readers may still be probing the old table
+        _retired_tables.push_back(old_table);
     }
-    first_node=NULL;
+    pthread_rwlock_unlock(&_resize_latch);
 }
 
+RC IndexHash::index_insert(idx_key_t key, itemid_t * item, int part_id) {
+    insert(key, item, true);
+    return RCOK;
+}
 
-void BucketHeader::insert_item(idx_key_t key,
-        itemid_t * item,
-        int part_id)
-{
-
-    BucketNode * cur_node = first_node;
-    BucketNode * prev_node = NULL;
-    while (cur_node != NULL) {
-        if (cur_node->key == key)
+RC IndexHash::index_load(idx_entry * entries, uint64_t cnt, int part_id) {
+    HashTable * table;
+    while (true) {
+        pthread_rwlock_rdlock(&_resize_latch);
+        table = _table.load(std::memory_order_relaxed);
+        const uint64_t max_item_cnt = (table->bucket_mask + 1) * HASH_BUCKET_SLOT_CNT *
+                                      HASH_MAX_LOAD_NUM / HASH_MAX_LOAD_DEN;
+        if (_item_cnt.fetch_add(cnt, std::memory_order_relaxed) + cnt <= max_item_cnt) {
             break;
-        prev_node = cur_node;
-        cur_node = cur_node->next;
+        }
+        _item_cnt.fetch_sub(cnt, std::memory_order_relaxed);
+        pthread_rwlock_unlock(&_resize_latch);
+        resize(table);
     }
-    if (cur_node == NULL) {
-        BucketNode * new_node = (BucketNode *)
-            mem_allocator.alloc(sizeof(BucketNode));
-        new_node->init(key);
-        new_node->items = item;
-        if (prev_node != NULL) {
-            new_node->next = prev_node->next;
-            prev_node->next = new_node;
-        } else {
-            new_node->next = first_node;
-            first_node = new_node;
+    for (uint64_t i = 0; i < cnt; i ++) {
+        if (i + HASH_LOAD_PREFETCH_DIST < cnt) {
+            const uint64_t hash_val = hash(entries[i + HASH_LOAD_PREFETCH_DIST].key);
+            __builtin_prefetch(&table->buckets[hash_val & table->bucket_mask], 1);
         }
-    } else {
-        item->next = cur_node->items;
-        cur_node->items = item;
+        entries[i].item->key = entries[i].key;
+        insert_item(table, entries[i].key, entries[i].item, true);
     }
+    pthread_rwlock_unlock(&_resize_latch);
+    return RCOK;
 }
 
+void IndexHash::index_visit(const idx_visitor & visit) {
+    const HashTable * const table = _table.load(std::memory_order_acquire);
+    for (uint64_t idx = 0; idx <= table->bucket_mask; idx ++) {
+        const HashBucket & bucket = table->buckets[idx];
+        for (uint32_t slots = ~match_tags(bucket.tags, 0) & HASH_SLOT_MASK; slots != 0;
+             slots &= slots - 1) {
+            itemid_t * const items = bucket.items[__builtin_ctz(slots)];
+            visit_items(items->key, items, 0, visit);
+        }
+    }
+}
 
-void BucketHeader::insert_item_nonunique(idx_key_t key,
-        itemid_t * item,
-        int part_id)
-{
-
-    BucketNode * new_node = (BucketNode *)
-    mem_allocator.alloc(sizeof(BucketNode));
-    new_node->init(key);
-    new_node->items = item;
-    new_node->next = first_node;
-    first_node = new_node;
+RC IndexHash::index_insert_nonunique(idx_key_t key, itemid_t * item, int part_id) {
+    insert(key, item, false);
+    return RCOK;
 }
 
-void BucketHeader::read_item(idx_key_t key, itemid_t *&item) {
-    BucketNode * cur_node = first_node;
-    while (cur_node != NULL) {
-    if (cur_node->key == key) break;
-        cur_node = cur_node->next;
-    }
-    M_ASSERT_V(cur_node != NULL, "Key does not exist! %ld\n",key);
+RC IndexHash::index_read(idx_key_t key, itemid_t * &item, int part_id) {
+    item = lookup(_table.load(std::memory_order_acquire), key, 0);
+    M_ASSERT_V(item != NULL, "Key does not exist! %ld\n",key);
+    return RCOK;
+}
 
-    assert(cur_node->key == key);
-    item = cur_node->items;
+RC IndexHash::index_read(idx_key_t key, int count, itemid_t * &item, int part_id) {
+    item = lookup(_table.load(std::memory_order_acquire), key, count);
+    return RCOK;
 }
 
-void BucketHeader::read_item(idx_key_t key, uint32_t count, itemid_t *&item) {
-    BucketNode * cur_node = first_node;
-    uint32_t ctr = 0;
-    while (cur_node != NULL) {
-        if (cur_node->key == key) {
-            if (ctr == count) {
-                break;
-            }
-            ++ctr;
-        }
-        cur_node = cur_node->next;
-    }
-    if (cur_node == NULL) {
-        item = NULL;
-        return;
-    }
-    M_ASSERT_V(cur_node != NULL, "Key does not exist! %ld\n",key);
-    assert(cur_node->key == key);
-    item = cur_node->items;
+RC IndexHash::index_read(idx_key_t key, itemid_t * &item,
+                        int part_id, int thd_id) {
+    item = lookup(_table.load(std::memory_order_acquire), key, 0);
+    M_ASSERT_V(item != NULL, "Key does not exist! %ld\n",key);
+    return RCOK;
 }
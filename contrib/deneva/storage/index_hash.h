@@ -21,39 +21,39 @@
 #include "helper.h"
 #include "index_base.h"
 
-// each BucketNode contains items sharing the same key
-class BucketNode {
-public:
-    BucketNode(idx_key_t key) {
-        init(key);
-    };
-    void init(idx_key_t key) {
-        this->key = key;
-        next = NULL;
-        items = NULL;
-    }
-    idx_key_t         key;
-    // The node for the next key
-    BucketNode *     next;
-    // NOTE. The items can be a list of items connected by the next pointer.
-    itemid_t *         items;
-};
+#include <atomic>
+#include <pthread.h>
+#include <vector>
 
-// BucketHeader does concurrency control of Hash
-class BucketHeader {
-public:
-    void init();
-    void delete_bucket();
-    void insert_item(idx_key_t key, itemid_t * item, int part_id);
-    void insert_item_nonunique(idx_key_t key, itemid_t * item, int part_id);
-    void read_item(idx_key_t key, itemid_t * &item);
-    void read_item(idx_key_t key, uint32_t count, itemid_t * &item);
-    BucketNode *     first_node;
-    uint64_t         node_cnt;
-    bool             locked;
+// Slots per bucket. The eighth byte of the tag word is the writer latch.
+#define HASH_BUCKET_SLOT_CNT    7
+#define HASH_SLOT_MASK          ((1U << HASH_BUCKET_SLOT_CNT) - 1)
+#define HASH_BUCKET_LATCH       (0x80ULL << 56)
+// grow the table when more than 3/4 of the slots are used
+#define HASH_MAX_LOAD_NUM       3
+#define HASH_MAX_LOAD_DEN       4
+// index_load() prefetches the home bucket of the entry this far ahead
+#define HASH_LOAD_PREFETCH_DIST 8
+
+// One cache line. Each slot has a one byte fingerprint of its key in tags (0 means empty) and
+// points to the items of the key. Slots are filled in order and never emptied, so a probe can stop
+// at the first bucket with an empty slot.
+struct alignas(CL_SIZE) HashBucket {
+    std::atomic<uint64_t> tags;
+    std::atomic<itemid_t *> items[HASH_BUCKET_SLOT_CNT];
+};
 
+struct HashTable {
+    HashBucket * buckets;
+    uint64_t bucket_mask;
+    void * raw;  // unaligned allocation of buckets
 };
 
+// Open addressing hash index with linear probing over buckets.
+// Readers are lock-free: they load the tag word of a bucket and compare all fingerprints at once
+// with SSE2. Inserters latch the bucket they write. When the table is too full it is doubled under
+// an exclusive resize latch. Readers may still probe the old table, so old tables are only freed
+// in index_delete().
 // TODO Hash index does not support partition yet.
 class IndexHash  : public index_base
 {
@@ -65,8 +65,15 @@ public:
     void    index_delete();
     void index_reset();
     bool         index_exist(idx_key_t key); // check if the key exist.
+    // items inserted with the same key are chained through itemid_t::next
     RC             index_insert(idx_key_t key, itemid_t * item, int part_id=-1);
+    // every item takes its own slot, index_read(key, count, ...) returns the count-th one
     RC             index_insert_nonunique(idx_key_t key, itemid_t * item, int part_id=-1);
+    // same as index_insert() for each entry, with the table grown once for the whole batch and the
+    // bucket misses of consecutive entries overlapped
+    RC             index_load(idx_entry * entries, uint64_t cnt, int part_id=-1);
+    // the hash index is not partitioned, all items are visited with part_id 0
+    void           index_visit(const idx_visitor & visit);
     // the following call returns a single item
     RC             index_read(idx_key_t key, itemid_t * &item, int part_id=-1);
     RC             index_read(idx_key_t key, int count, itemid_t * &item, int part_id=-1);
@@ -79,20 +86,36 @@ public:
 
 
 private:
-    void get_latch(BucketHeader * bucket);
-    void release_latch(BucketHeader * bucket);
-    // TODO implement more complex hash function
-    uint64_t hash(idx_key_t key) {
-#if WORKLOAD == YCSB
-        return (key / g_part_cnt) % _bucket_cnt_per_part;
-#else
-        return key % _bucket_cnt_per_part;
-#endif
+    static HashTable * alloc_table(uint64_t bucket_cnt);
+    static void free_table(HashTable * table);
+    // Return the count-th item with the key, or NULL.
+    static itemid_t * lookup(const HashTable * table, idx_key_t key, uint32_t count);
+    // Insert into table. With merge_same_key, an item whose key is in the table already is
+    // chained in front of the items of the key, otherwise every item takes a slot of its own.
+    static void insert_item(HashTable * table, idx_key_t key, itemid_t * item,
+                            bool merge_same_key);
+    static void get_latch(HashBucket * bucket);
+    static void release_latch(HashBucket * bucket);
+    void insert(idx_key_t key, itemid_t * item, bool merge_same_key);
+    void resize(HashTable * old_table);
+    void free_rows(const HashTable * table);
+
+    static uint64_t hash(idx_key_t key) {
+        // Fibonacci hashing, the top byte is the fingerprint; folding the high bits down makes the
+        // low bits that pick the bucket depend on the whole key
+        const uint64_t hash_val = key * 0x9e3779b97f4a7c15ULL;
+        return hash_val ^ (hash_val >> 29);
+    }
+
+    static uint8_t get_tag(uint64_t hash_val) {
+        const uint8_t tag = hash_val >> 56;
+        return tag == 0 ? 1 : tag;
     }
 
-    BucketHeader **     _buckets;
-    uint64_t             _bucket_cnt;
-    uint64_t             _bucket_cnt_per_part;
+    std::atomic<HashTable *>     _table;
+    std::vector<HashTable *>     _retired_tables;
+    std::atomic<uint64_t>        _item_cnt;
+    pthread_rwlock_t             _resize_latch;
 };
 
 #endif
@@ -46,6 +46,7 @@
 #include "row_unified.h"
 #include "mem_alloc.h"
 #include "manager.h"
+#include "pool.h"
 
 #define SIM_FULL_ROW true
 
@@ -57,9 +58,9 @@ RC row_t::init(table_t *host_table, uint64_t part_id, uint64_t row_id) {
     Catalog * schema = host_table->get_schema();
     tuple_size = schema->get_tuple_size();
 #if SIM_FULL_ROW
-    data = (char *) mem_allocator.alloc(sizeof(char) * tuple_size);
+    data = (char *) mem_allocator.alloc(sizeof(char) * tuple_size, part_id);
 #else
-    data = (char *) mem_allocator.alloc(sizeof(uint64_t) * 1);
+    data = (char *) mem_allocator.alloc(sizeof(uint64_t) * 1, part_id);
 #endif
     return RCOK;
 }
@@ -74,28 +75,28 @@ void row_t::init_manager(row_t * row) {
     return;
 #endif
     DEBUG_M("row_t::init_manager alloc \n");
-#if CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == CALVIN
-    manager = (Row_lock *) mem_allocator.align_alloc(sizeof(Row_lock));
+#if CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == CALVIN
+    manager = (Row_lock *) mem_allocator.align_alloc(sizeof(Row_lock), _part_id);
 #elif CC_ALG == TIMESTAMP
-    manager = (Row_ts *) mem_allocator.align_alloc(sizeof(Row_ts));
+    manager = (Row_ts *) mem_allocator.align_alloc(sizeof(Row_ts), _part_id);
 #elif CC_ALG == MVCC
-    manager = (Row_mvcc *) mem_allocator.align_alloc(sizeof(Row_mvcc));
+    manager = (Row_mvcc *) mem_allocator.align_alloc(sizeof(Row_mvcc), _part_id);
 #elif CC_ALG == OCC || CC_ALG == BOCC || CC_ALG == FOCC
-    manager = (Row_occ *) mem_allocator.align_alloc(sizeof(Row_occ));
+    manager = (Row_occ *) mem_allocator.align_alloc(sizeof(Row_occ), _part_id);
 #elif CC_ALG == MAAT
-    manager = (Row_maat *) mem_allocator.align_alloc(sizeof(Row_maat));
+    manager = (Row_maat *) mem_allocator.align_alloc(sizeof(Row_maat), _part_id);
 #elif CC_ALG == SUNDIAL
     manager = new Row_sundial(this);
 #elif CC_ALG == SSI
-    manager = (Row_ssi *) mem_allocator.align_alloc(sizeof(Row_ssi));
+    manager = (Row_ssi *) mem_allocator.align_alloc(sizeof(Row_ssi), _part_id);
 #elif CC_ALG == WSI
-    manager = (Row_wsi *) mem_allocator.align_alloc(sizeof(Row_wsi));
+    manager = (Row_wsi *) mem_allocator.align_alloc(sizeof(Row_wsi), _part_id);
 #elif CC_ALG == CNULL
-    manager = (Row_null *) mem_allocator.align_alloc(sizeof(Row_null));
+    manager = (Row_null *) mem_allocator.align_alloc(sizeof(Row_null), _part_id);
 #elif CC_ALG == SILO
-    manager = (Row_silo *) mem_allocator.align_alloc(sizeof(Row_silo));
+    manager = (Row_silo *) mem_allocator.align_alloc(sizeof(Row_silo), _part_id);
 #elif IS_GENERIC_ALG
-    void* const p = mem_allocator.align_alloc(sizeof(Row_unified<CC_ALG>));
+    void* const p = mem_allocator.align_alloc(sizeof(Row_unified<CC_ALG>), _part_id);
     manager = new(p) Row_unified<CC_ALG>();
 #endif
 
@@ -252,7 +253,7 @@ RC row_t::get_row(access_t type, TxnManager *txn, Access *access) {
     goto end;
 #endif
 
-#if CC_ALG == WAIT_DIE || CC_ALG == NO_WAIT
+#if CC_ALG == WAIT_DIE || CC_ALG == NO_WAIT || CC_ALG == DL_DETECT
     //uint64_t thd_id = txn->get_thd_id();
     lock_t lt = (type == RD || type == SCAN) ? LOCK_SH : LOCK_EX; // ! this may be wrong
     rc = this->manager->lock_get(lt, txn);
@@ -260,7 +261,7 @@ RC row_t::get_row(access_t type, TxnManager *txn, Access *access) {
         access->data = this;
     } else if (rc == Abort) {
     } else if (rc == WAIT) {
-        ASSERT(CC_ALG == WAIT_DIE);
+        ASSERT(CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT);
     }
     goto end;
 #elif CC_ALG == TIMESTAMP || CC_ALG == MVCC || CC_ALG == SSI || CC_ALG == WSI
@@ -298,7 +299,8 @@ RC row_t::get_row(access_t type, TxnManager *txn, Access *access) {
     }
     if (rc != Abort && (CC_ALG == MVCC || CC_ALG == SSI || CC_ALG == WSI) && type == WR) {
         DEBUG_M("row_t::get_row MVCC alloc \n");
-        row_t * newr = (row_t *) mem_allocator.alloc(sizeof(row_t));
+        row_t * newr;
+        row_pool.get(txn->get_thd_id(), newr);
         newr->init(this->get_table(), get_part_id());
         newr->copy(access->data);
         access->data = newr;
@@ -386,8 +388,8 @@ RC row_t::get_row(access_t type, TxnManager * txn, row_t *& row, uint64_t &orig_
 // Return call for get_row if waiting
 RC row_t::get_row_post_wait(access_t type, TxnManager * txn, row_t *& row) {
     RC rc = RCOK;
-    assert(CC_ALG == WAIT_DIE || CC_ALG == MVCC || CC_ALG == TIMESTAMP || CC_ALG == SUNDIAL || CC_ALG == SSI || CC_ALG == WSI || CC_ALG == TIMESTAMP || CC_ALG == FOCC || CC_ALG == BOCC);
-#if CC_ALG == WAIT_DIE
+    assert(CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == MVCC || CC_ALG == TIMESTAMP || CC_ALG == SUNDIAL || CC_ALG == SSI || CC_ALG == WSI || CC_ALG == TIMESTAMP || CC_ALG == FOCC || CC_ALG == BOCC);
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT
     assert(txn->lock_ready);
     rc = RCOK;
     //ts_t endtime = get_sys_clock();
@@ -404,7 +406,8 @@ RC row_t::get_row_post_wait(access_t type, TxnManager * txn, row_t *& row) {
     assert(row->get_table_name() != NULL);
     if (( CC_ALG == MVCC || CC_ALG == SUNDIAL || CC_ALG == SSI || CC_ALG == WSI) && type == WR) {
         DEBUG_M("row_t::get_row_post_wait MVCC alloc \n");
-        row_t * newr = (row_t *) mem_allocator.alloc(sizeof(row_t));
+        row_t * newr;
+        row_pool.get(txn->get_thd_id(), newr);
         newr->init(this->get_table(), get_part_id());
 
         newr->copy(row);
@@ -429,12 +432,9 @@ uint64_t row_t::return_row(RC rc, access_t type, TxnManager *txn, row_t *row) {
     return 0;
 #endif
 
-#if CC_ALG == WAIT_DIE || CC_ALG == NO_WAIT || CC_ALG == CALVIN
-    assert (row == NULL || row == this || type == XP);
-    if (CC_ALG != CALVIN && ROLL_BACK &&
-            type == XP) {  // recover from previous writes. should not happen w/ Calvin
-        this->copy(row);
-    }
+#if CC_ALG == WAIT_DIE || CC_ALG == NO_WAIT || CC_ALG == DL_DETECT || CC_ALG == CALVIN
+    // with ROLL_BACK an aborted transaction restored the row from its undo log already
+    assert (row == NULL || row == this);
     this->manager->lock_release(txn);
     return 0;
 #elif CC_ALG == TIMESTAMP || CC_ALG == MVCC || CC_ALG == SSI || CC_ALG == WSI
@@ -449,7 +449,9 @@ uint64_t row_t::return_row(RC rc, access_t type, TxnManager *txn, row_t *row) {
     if (type == XP) {
         row->free_row();
         DEBUG_M("row_t::return_row XP free \n");
-        mem_allocator.free(row, sizeof(row_t));
+        // the copies of MVCC, SSI and WSI come from the row pool
+        if (CC_ALG == TIMESTAMP) mem_allocator.free(row, sizeof(row_t));
+        else row_pool.put(txn->get_thd_id(), row);
         this->manager->access(txn, XP_REQ, NULL);
     } else if (type == WR) {
         assert (type == WR && row != NULL);
@@ -507,9 +509,6 @@ uint64_t row_t::return_row(RC rc, access_t type, TxnManager *txn, row_t *row) {
 
 #elif CC_ALG == HSTORE || CC_ALG == HSTORE_SPEC
     assert (row != NULL);
-    if (ROLL_BACK && type == XP) {// recover from previous writes.
-        this->copy(row);
-    }
     return 0;
 #elif CC_ALG == SILO
     assert (row != NULL);
@@ -75,6 +75,7 @@ public:
     uint64_t get_field_cnt();
     uint64_t get_tuple_size();
     uint64_t get_row_id() { return _row_id; };
+    void set_row_id(uint64_t row_id) { _row_id = row_id; };
 
     void copy(row_t * src);
 
@@ -101,6 +102,24 @@ public:
     DECL_GET_VALUE(SInt32);
 
 
+    // Typed access to a column of a compiled layout (row_field in catalog.h), e.g.
+    // row->get_field<tpcc_schema::WAREHOUSE::W_YTD>(). Unlike get_value()/set_value() these do not
+    // consult the Catalog.
+    template <typename F>
+    typename F::type get_field() {
+        static_assert(sizeof(typename F::type) == F::size, "use get_field_ptr() for strings");
+        return *(typename F::type *)&data[F::offset];
+    }
+    template <typename F>
+    void set_field(typename F::type value) {
+        static_assert(sizeof(typename F::type) == F::size, "use get_field_ptr() for strings");
+        *(typename F::type *)&data[F::offset] = value;
+    }
+    template <typename F>
+    char * get_field_ptr() {
+        return &data[F::offset];
+    }
+
     void set_data(char * data);
     char * get_data();
 
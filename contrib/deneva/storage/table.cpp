@@ -43,7 +43,7 @@ RC table_t::get_new_row(row_t *& row) {
 RC table_t::get_new_row(row_t *& row, uint64_t part_id, uint64_t &row_id) {
     RC rc = RCOK;
     DEBUG_M("table_t::get_new_row alloc\n");
-    void * ptr = mem_allocator.alloc(sizeof(row_t));
+    void * ptr = mem_allocator.alloc(sizeof(row_t), part_id);
     assert (ptr != NULL);
 
     row = (row_t *) ptr;
@@ -0,0 +1,25 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "global.h"
+#include "helper.h"
+#include "thread.h"
+#include "dl_detect_thread.h"
+#include "dl_detect.h"
+
+void DlDetectThread::setup() {}
+
+RC DlDetectThread::run() {
+    tsetup();
+    printf("Running DlDetectThread %ld\n",_thd_id);
+    while (!simulation->is_done()) {
+        heartbeat();
+        dl_detector.detect(get_thd_id());
+    }
+    return FINISH;
+}
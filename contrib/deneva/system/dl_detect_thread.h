@@ -0,0 +1,23 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _DL_DETECT_THREAD_H_
+#define _DL_DETECT_THREAD_H_
+
+#include "global.h"
+#include "thread.h"
+
+class Workload;
+
+class DlDetectThread : public Thread {
+public:
+    RC             run();
+    void setup();
+};
+
+#endif
@@ -51,6 +51,7 @@
 #include "maat.h"
 #include "sundial.h"
 #include "http.h"
+#include "dl_detect.h"
 
 
 #include <boost/lockfree/queue.hpp>
@@ -89,6 +90,7 @@ MessageQueue msg_queue;
 Client_txn client_man;
 Sequencer seq_man;
 Logger logger;
+DlDetector dl_detector;
 TimeTable time_table;
 DtaTimeTable dta_time_table;
 InOutTable inout_table;
@@ -132,6 +134,8 @@ double g_txn_write_perc = TXN_WRITE_PERC;
 double g_tup_read_perc = 1.0 - TUP_WRITE_PERC;
 double g_tup_write_perc = TUP_WRITE_PERC;
 double g_zipf_theta = ZIPF_THETA;
+double g_scan_perc = SCAN_PERC;
+UInt32 g_scan_len = SCAN_LEN;
 double g_data_perc = DATA_PERC;
 double g_access_perc = ACCESS_PERC;
 bool g_prt_lat_distr = PRT_LAT_DISTR;
@@ -153,12 +157,17 @@ UInt32 g_logger_thread_cnt = 1;
 #else
 UInt32 g_logger_thread_cnt = 0;
 #endif
+#if CC_ALG == DL_DETECT
+UInt32 g_dl_detect_thread_cnt = 1;
+#else
+UInt32 g_dl_detect_thread_cnt = 0;
+#endif
 UInt32 g_send_thread_cnt = SEND_THREAD_CNT;
 #if CC_ALG == CALVIN
 // sequencer + scheduler thread
-UInt32 g_total_thread_cnt = g_thread_cnt + g_rem_thread_cnt + g_send_thread_cnt + g_abort_thread_cnt + g_logger_thread_cnt + 3;
+UInt32 g_total_thread_cnt = g_thread_cnt + g_rem_thread_cnt + g_send_thread_cnt + g_abort_thread_cnt + g_logger_thread_cnt + g_dl_detect_thread_cnt + 3;
 #else
-UInt32 g_total_thread_cnt = g_thread_cnt + g_rem_thread_cnt + g_send_thread_cnt + g_abort_thread_cnt + g_logger_thread_cnt + 1;
+UInt32 g_total_thread_cnt = g_thread_cnt + g_rem_thread_cnt + g_send_thread_cnt + g_abort_thread_cnt + g_logger_thread_cnt + g_dl_detect_thread_cnt + 1;
 #endif
 
 UInt32 g_total_client_thread_cnt = g_client_thread_cnt + g_client_rem_thread_cnt + g_client_send_thread_cnt;
@@ -189,6 +198,7 @@ UInt64 g_seq_batch_time_limit = SEQ_BATCH_TIMER;
 UInt64 g_prog_timer = PROG_TIMER;
 UInt64 g_warmup_timer = WARMUP_TIMER;
 UInt64 g_msg_time_limit = MSG_TIME_LIMIT;
+UInt64 g_msg_batch_max_delay = MSG_BATCH_MAX_DELAY;
 
 UInt64 g_log_buf_max = LOG_BUF_MAX;
 UInt64 g_log_flush_timeout = LOG_BUF_TIMEOUT;
@@ -228,6 +238,10 @@ bool g_wh_update = WH_UPDATE;
 char * output_file = NULL;
 char * input_file = NULL;
 char * txn_file = NULL;
+// directory of table snapshots, NULL disables them
+char * snapshot_dir = NULL;
+// log to replay on the table snapshot instead of running, NULL for a normal run
+char * recover_log = NULL;
 
 #if TPCC_SMALL
 UInt32 g_max_items = MAX_ITEMS_SMALL;
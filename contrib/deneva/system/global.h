@@ -85,6 +85,7 @@ class Client_query_queue;
 class Client_txn;
 class Sequencer;
 class Logger;
+class DlDetector;
 class TimeTable;
 class DtaTimeTable;
 class InOutTable;
@@ -141,6 +142,7 @@ extern MessageQueue msg_queue;
 extern Client_txn client_man;
 extern Sequencer seq_man;
 extern Logger logger;
+extern DlDetector dl_detector;
 extern TimeTable time_table;
 extern DtaTimeTable dta_time_table;
 extern InOutTable inout_table;
@@ -187,6 +189,7 @@ extern UInt32 g_this_total_thread_cnt;
 extern UInt32 g_thread_cnt;
 extern UInt32 g_abort_thread_cnt;
 extern UInt32 g_logger_thread_cnt;
+extern UInt32 g_dl_detect_thread_cnt;
 extern UInt32 g_tcp_thread_cnt;
 extern UInt32 g_send_thread_cnt;
 extern UInt32 g_rem_thread_cnt;
@@ -213,6 +216,7 @@ extern UInt64 g_seq_batch_time_limit;
 extern UInt64 g_prog_timer;
 extern UInt64 g_warmup_timer;
 extern UInt64 g_msg_time_limit;
+extern UInt64 g_msg_batch_max_delay;
 
 // MVCC
 extern UInt64 g_max_read_req;
@@ -229,6 +233,8 @@ extern double g_txn_write_perc;
 extern double g_tup_read_perc;
 extern double g_tup_write_perc;
 extern double g_zipf_theta;
+extern double g_scan_perc;
+extern UInt32 g_scan_len;
 extern double g_data_perc;
 extern double g_access_perc;
 extern UInt64 g_synth_table_size;
@@ -246,6 +252,8 @@ extern bool g_wh_update;
 extern char * output_file;
 extern char * input_file;
 extern char * txn_file;
+extern char * snapshot_dir;
+extern char * recover_log;
 extern UInt32 g_max_items;
 extern UInt32 g_dist_per_wh;
 extern UInt32 g_cust_per_dist;
@@ -252,6 +252,7 @@ public:
     void * location; // points to the table | page | row
     itemid_t * next;
     bool valid;
+    uint64_t key; // set by IndexHash to verify fingerprint matches
     void init();
     bool operator==(const itemid_t &other) const;
     bool operator!=(const itemid_t &other) const;
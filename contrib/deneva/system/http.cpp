@@ -68,6 +68,11 @@ uint64_t CurlGetTimeStamp(void)
 
 void TcpTimestamp::init(int all_thd_num)
 {
+#if LTS_TCP_BATCH
+    batch_client.init(LTS_TCP_IP, LTS_TCP_PORT);
+    socket_num = 0;
+    return;
+#endif
     socket = (TcpLtsSocket*)mem_allocator.align_alloc(sizeof(TcpLtsSocket) * all_thd_num);
     socket_num = all_thd_num;
     for (int i = 0; i < all_thd_num; i ++) {
@@ -94,6 +99,10 @@ void TcpTimestamp::ConnectToLts(uint64_t thd_id)
 
 void TcpTimestamp::CloseToLts(uint64_t thd_id)
 {
+#if LTS_TCP_BATCH
+    batch_client.close_lts();
+    return;
+#endif
     int result = 0;
     result = socket[thd_id].closeConnection();
     if (result != 0)
@@ -106,7 +115,11 @@ uint64_t TcpTimestamp::TcpGetTimeStamp(uint64_t thd_id)
 {
     uint64_t start_ts = get_sys_clock();
     uint64_t ts = 0;
+#if LTS_TCP_BATCH
+    ts = batch_client.get_ts(thd_id);
+#else
     ts = socket[thd_id].getTimestamp();
+#endif
 
     if (ts == (uint64_t)-1)
     {
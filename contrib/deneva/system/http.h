@@ -18,6 +18,7 @@
 
 #include <cinttypes>
 #include "libtcpforcpp.h"
+#include "lts_client.h"
 
 uint64_t CurlGetTimeStamp(void);
 uint64_t TcpGetTimeStamp(void);
@@ -34,6 +35,7 @@ public:
 private:
   TcpLtsSocket * socket;
   int socket_num;
+  LtsClient batch_client;
   // pthread_mutex_t ** lock_;
 };
 
@@ -47,6 +47,7 @@ void InputThread::setup() {
                 printf("Received INIT_DONE from node %ld\n",msg->return_node_id);
                 fflush(stdout);
                 simulation->process_setup_msg();
+                Message::release_message(msg);
             } else {
                 assert(ISSERVER || ISREPLICA);
                 //printf("Received Msg %d from node %ld\n",msg->rtype,msg->return_node_id);
@@ -128,7 +129,7 @@ RC InputThread::client_recv_loop() {
             DEBUG("Recv %ld from %ld, %ld -- %f\n", ((ClientResponseMessage *)msg)->txn_id,
                         msg->return_node_id, inf, float(timespan) / BILLION);
             assert(inf >=0);
-            // delete message here
+            Message::release_message(msg);
             msgs->erase(msgs->begin());
         }
         delete msgs;
@@ -204,6 +205,7 @@ RC InputThread::server_recv_loop() {
         while(!msgs->empty()) {
             Message * msg = msgs->front();
             if(msg->rtype == INIT_DONE) {
+                Message::release_message(msg);
                 msgs->erase(msgs->begin());
                 continue;
             }
@@ -25,7 +25,7 @@ void LogThread::setup() {}
 RC LogThread::run() {
     tsetup();
         while (!simulation->is_done()) {
-        logger.processRecord(get_thd_id());
+        logger.groupCommit(get_thd_id());
     }
     return FINISH;
 }
@@ -3,21 +3,42 @@
 #include "message.h"
 #include "mem_alloc.h"
 #include <fstream>
+#include <fcntl.h>
 
 
 void Logger::init(const char * log_file_name) {
     this->log_file_name = log_file_name;
-    log_file.open(log_file_name, ios::out | ios::app | ios::binary);
-    assert(log_file.is_open());
-    pthread_mutex_init(&mtx,NULL);
+    // every run starts from freshly generated or loaded tables
+    log_fd = open(log_file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    assert(log_fd >= 0);
+    file_offset = 0;
+    lsn = 0;
+    durable_lsn = 0;
+    last_flush = get_sys_clock();
+
+    buf_cnt = g_total_thread_cnt;
+    bufs = (LogBuffer *) mem_allocator.align_alloc(sizeof(LogBuffer) * buf_cnt);
+    for (uint64_t i = 0; i < buf_cnt; i++) {
+        bufs[i].data = (char *) mem_allocator.align_alloc(LOG_THD_BUF_SIZE);
+        bufs[i].filled = 0;
+        bufs[i].flushed = 0;
+        bufs[i].commits = (LogCommit *) mem_allocator.alloc(sizeof(LogCommit) * LOG_THD_COMMIT_CNT);
+        bufs[i].commit_filled = 0;
+        bufs[i].commit_flushed = 0;
+        bufs[i].busy_lsn = UINT64_MAX;
+    }
+    buf_ends = (uint64_t *) mem_allocator.alloc(sizeof(uint64_t) * buf_cnt);
+    // the header, two pieces of every ring and the padding
+    iovs = (iovec *) mem_allocator.alloc(sizeof(iovec) * (2 * buf_cnt + 2));
+    pad_zeros = (char *) mem_allocator.alloc(LOG_GROUP_ALIGN);
+    memset(pad_zeros, 0, LOG_GROUP_ALIGN);
 }
 
-void Logger::release() { log_file.close(); }
+void Logger::release() { close(log_fd); }
 
 LogRecord* Logger::createRecord(uint64_t txn_id, LogIUD iud, uint64_t table_id, uint64_t key) {
     LogRecord * record = (LogRecord*)mem_allocator.alloc(sizeof(LogRecord));
     record->rcd.init();
-    record->rcd.lsn = ATOM_FETCH_ADD(lsn,1);
     record->rcd.iud = iud;
     record->rcd.txn_id = txn_id;
     record->rcd.table_id = table_id;
@@ -40,105 +61,223 @@ void LogRecord::copyRecord(LogRecord* record) {
     rcd.txn_id = record->rcd.txn_id;
     rcd.table_id = record->rcd.table_id;
     rcd.key = record->rcd.key;
+    // the image stays behind, a replica only sees the record
 }
 
 
-void Logger::enqueueRecord(LogRecord* record) {
-    DEBUG("Enqueue Log Record %ld\n",record->rcd.txn_id);
-    pthread_mutex_lock(&mtx);
-    log_queue.push(record);
-    pthread_mutex_unlock(&mtx);
+void Logger::writeToBuffer(LogBuffer & buf, uint64_t & pos, const void * data, uint64_t size) {
+    // a commit record has no image, and memcpy must not see its NULL
+    if (size == 0) return;
+    uint64_t start = pos % LOG_THD_BUF_SIZE;
+    uint64_t first = std::min(size, LOG_THD_BUF_SIZE - start);
+    memcpy(&buf.data[start], data, first);
+    memcpy(buf.data, (const char *) data + first, size - first);
+    pos += size;
 }
 
-void Logger::processRecord(uint64_t thd_id) {
-    if (log_queue.empty()) return;
-    LogRecord * record = NULL;
-    pthread_mutex_lock(&mtx);
-    if(!log_queue.empty()) {
-        record = log_queue.front();
-        log_queue.pop();
-    }
-    pthread_mutex_unlock(&mtx);
-
-    if(record) {
-        uint64_t starttime = get_sys_clock();
-        DEBUG("Dequeue Log Record %ld\n",record->rcd.txn_id);
-        if(record->rcd.iud == L_NOTIFY) {
-        flushBuffer(thd_id);
-        work_queue.enqueue(thd_id,Message::create_message(record->rcd.txn_id,LOG_FLUSHED),false);
+#define LOG_WRITE_VAL(buf, pos, v) writeToBuffer(buf, pos, &(v), sizeof(v));
 
+void Logger::enqueueRecord(uint64_t thd_id, LogRecord* record) {
+    DEBUG("Enqueue Log Record %ld\n",record->rcd.txn_id);
+    uint64_t starttime = get_sys_clock();
+    LogBuffer & buf = bufs[thd_id];
+    uint64_t size = record->size();
+    assert(size <= LOG_THD_BUF_SIZE);
+    // wait for the log thread to make room
+    while (buf.filled + size - buf.flushed > LOG_THD_BUF_SIZE ||
+           buf.commit_filled - buf.commit_flushed == LOG_THD_COMMIT_CNT) {
+        if (simulation->is_done()) {
+            mem_allocator.free(record,sizeof(LogRecord));
+            return;
         }
-        writeToBuffer(thd_id,record);
-        //writeToBuffer((char*)(&record->rcd),sizeof(record->rcd));
-        log_buf_cnt++;
-        mem_allocator.free(record,sizeof(LogRecord));
-        INC_STATS(thd_id,log_process_time,get_sys_clock() - starttime);
     }
 
-}
+    // ATOM_FETCH_ADD is a full barrier, so the log thread sees busy_lsn before it can miss
+    // the record. The release keeps the previous append of the thread before it.
+    __atomic_store_n(&buf.busy_lsn, lsn, __ATOMIC_RELEASE);
+    record->rcd.lsn = ATOM_FETCH_ADD(lsn,1);
+    uint64_t pos = buf.filled;
+#if LOG_COMMAND
+
+    LOG_WRITE_VAL(buf,pos,record->rcd.checksum);
+    LOG_WRITE_VAL(buf,pos,record->rcd.lsn);
+    LOG_WRITE_VAL(buf,pos,record->rcd.type);
+    LOG_WRITE_VAL(buf,pos,record->rcd.txn_id);
+    //LOG_WRITE_VAL(buf,pos,record->rcd.partid);
+#if WORKLOAD == TPCC
+    LOG_WRITE_VAL(buf,pos,record->rcd.txntype);
+#endif
+    writeToBuffer(buf,pos,record->rcd.params,record->rcd.params_size);
 
-uint64_t Logger::reserveBuffer(uint64_t size) { return ATOM_FETCH_ADD(aries_write_offset, size); }
+#else
 
+    LOG_WRITE_VAL(buf,pos,record->rcd.checksum);
+    LOG_WRITE_VAL(buf,pos,record->rcd.lsn);
+    LOG_WRITE_VAL(buf,pos,record->rcd.type);
+    LOG_WRITE_VAL(buf,pos,record->rcd.iud);
+    LOG_WRITE_VAL(buf,pos,record->rcd.txn_id);
+    //LOG_WRITE_VAL(buf,pos,record->rcd.partid);
+    LOG_WRITE_VAL(buf,pos,record->rcd.table_id);
+    LOG_WRITE_VAL(buf,pos,record->rcd.key);
+    LOG_WRITE_VAL(buf,pos,record->rcd.image_size);
+    writeToBuffer(buf,pos,record->rcd.image,record->rcd.image_size);
 
-void Logger::writeToBuffer(uint64_t thd_id, char * data, uint64_t size) {
-    uint64_t starttime = get_sys_clock();
-    log_file.write(data,size);
-    INC_STATS(thd_id,log_write_time,get_sys_clock() - starttime);
-    INC_STATS(thd_id,log_write_cnt,1);
+#endif
+    __atomic_store_n(&buf.filled, pos, __ATOMIC_RELEASE);
+    // published after the record, so the log thread never takes a commit without its record
+    if(record->rcd.iud == L_NOTIFY) {
+        LogCommit & commit = buf.commits[buf.commit_filled % LOG_THD_COMMIT_CNT];
+        commit.lsn = record->rcd.lsn;
+        commit.txn_id = record->rcd.txn_id;
+        __atomic_store_n(&buf.commit_filled, buf.commit_filled + 1, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&buf.busy_lsn, UINT64_MAX, __ATOMIC_RELEASE);
+
+    mem_allocator.free(record,sizeof(LogRecord));
+    INC_STATS(thd_id,log_process_time,get_sys_clock() - starttime);
 }
 
-void Logger::notify_on_sync(uint64_t txn_id) {
+void Logger::notify_on_sync(uint64_t thd_id, uint64_t txn_id) {
     LogRecord * record = (LogRecord*)mem_allocator.alloc(sizeof(LogRecord));
     record->rcd.init();
     record->rcd.txn_id = txn_id;
     record->rcd.iud = L_NOTIFY;
-    enqueueRecord(record);
+    enqueueRecord(thd_id,record);
 }
 
-void Logger::writeToBuffer(uint64_t thd_id, LogRecord * record) {
-    DEBUG("Buffer Write\n");
-    uint64_t starttime = get_sys_clock();
-#if LOG_COMMAND
-
-    WRITE_VAL(log_file,record->rcd.checksum);
-    WRITE_VAL(log_file,record->rcd.lsn);
-    WRITE_VAL(log_file,record->rcd.type);
-    WRITE_VAL(log_file,record->rcd.txn_id);
-    //WRITE_VAL(log_file,record->rcd.partid);
-#if WORKLOAD == TPCC
-    WRITE_VAL(log_file,record->rcd.txntype);
-#endif
-    WRITE_VAL_SIZE(log_file,record->rcd.params,record->rcd.params_size);
-
-#else
+bool Logger::groupDue() {
+    if (get_sys_clock() - last_flush >= g_log_flush_timeout) return true;
+    uint64_t commit_cnt = 0;
+    for (uint64_t i = 0; i < buf_cnt; i++) {
+        // a full buffer holds up its thread
+        if (bufs[i].filled - bufs[i].flushed >= LOG_THD_BUF_SIZE / 2) return true;
+        commit_cnt += bufs[i].commit_filled - bufs[i].commit_flushed;
+    }
+    return commit_cnt >= g_log_buf_max;
+}
 
-    WRITE_VAL(log_file,record->rcd.checksum);
-    WRITE_VAL(log_file,record->rcd.lsn);
-    WRITE_VAL(log_file,record->rcd.type);
-    WRITE_VAL(log_file,record->rcd.iud);
-    WRITE_VAL(log_file,record->rcd.txn_id);
-    //WRITE_VAL(log_file,record->rcd.partid);
-    WRITE_VAL(log_file,record->rcd.table_id);
-    WRITE_VAL(log_file,record->rcd.key);
+#define LOG_CHECKSUM_PRIME 0x100000001b3ULL
 
-#endif
-    INC_STATS(thd_id,log_write_time,get_sys_clock() - starttime);
+void LogChecksum::add(const char * data, uint64_t len) {
+    // complete the word of the previous piece
+    for (; len > 0 && size % 8 != 0; len--, size++) {
+        word |= (uint64_t) (uint8_t) *data++ << (size % 8 * 8);
+        if (size % 8 == 7) {
+            hash = (hash ^ word) * LOG_CHECKSUM_PRIME;
+            word = 0;
+        }
+    }
+    for (; len >= 8; len -= 8, size += 8, data += 8) {
+        uint64_t w;
+        memcpy(&w, data, sizeof(w));
+        hash = (hash ^ w) * LOG_CHECKSUM_PRIME;
+    }
+    for (; len > 0; len--, size++) word |= (uint64_t) (uint8_t) *data++ << (size % 8 * 8);
+}
 
+uint64_t LogChecksum::value() {
+    return size % 8 == 0 ? hash : (hash ^ word) * LOG_CHECKSUM_PRIME;
 }
 
-void Logger::flushBufferCheck(uint64_t thd_id) {
-    if(log_buf_cnt >= g_log_buf_max || get_sys_clock() - last_flush > g_log_flush_timeout) {
-        flushBuffer(thd_id);
+static void write_group(int fd, iovec * iov, int iov_cnt, uint64_t offset) {
+    while (iov_cnt > 0) {
+        ssize_t rc = pwritev(fd, iov, iov_cnt, offset);
+        if (rc < 0 && errno == EINTR) continue;
+        M_ASSERT_V(rc >= 0, "Log write error: %d %s\n", errno, strerror(errno));
+        offset += rc;
+        while (iov_cnt > 0 && (size_t) rc >= iov[0].iov_len) {
+            rc -= iov[0].iov_len;
+            iov++;
+            iov_cnt--;
+        }
+        if (iov_cnt > 0) {
+            iov[0].iov_base = (char *) iov[0].iov_base + rc;
+            iov[0].iov_len -= rc;
+        }
     }
 }
 
-void Logger::flushBuffer(uint64_t thd_id) {
-    DEBUG("Flush Buffer\n");
+void Logger::groupCommit(uint64_t thd_id) {
+    if (!groupDue()) return;
     uint64_t starttime = get_sys_clock();
-    log_file.flush();
-    INC_STATS(thd_id,log_flush_time,get_sys_clock() - starttime);
-    INC_STATS(thd_id,log_flush_cnt,1);
+    last_flush = starttime;
 
-    last_flush = get_sys_clock();
-    log_buf_cnt = 0;
+    // Every record below this LSN is in the group, unless its thread is still appending it when
+    // busy_lsn is loaded below, and then busy_lsn is not above its LSN.
+    uint64_t durable = __atomic_load_n(&lsn, __ATOMIC_ACQUIRE);
+    LogGroupHeader hdr;
+    hdr.magic = LOG_GROUP_MAGIC;
+    hdr.size = 0;
+    hdr.checksum = 0;
+    iovs[0].iov_base = &hdr;
+    iovs[0].iov_len = sizeof(hdr);
+    int iov_cnt = 1;
+    for (uint64_t i = 0; i < buf_cnt; i++) {
+        LogBuffer & buf = bufs[i];
+        // in the reverse order of the stores: an append that busy_lsn shows as finished is in
+        // filled, and so is the record of every commit in commit_filled
+        uint64_t busy = __atomic_load_n(&buf.busy_lsn, __ATOMIC_ACQUIRE);
+        if (busy < durable) durable = busy;
+        uint64_t commit_end = __atomic_load_n(&buf.commit_filled, __ATOMIC_ACQUIRE);
+        uint64_t end = __atomic_load_n(&buf.filled, __ATOMIC_ACQUIRE);
+
+        for (uint64_t c = buf.commit_flushed; c < commit_end; c++) {
+            waiting_commits.push_back(buf.commits[c % LOG_THD_COMMIT_CNT]);
+        }
+        __atomic_store_n(&buf.commit_flushed, commit_end, __ATOMIC_RELEASE);
+
+        buf_ends[i] = end;
+        if (end == buf.flushed) continue;
+        uint64_t start = buf.flushed % LOG_THD_BUF_SIZE;
+        uint64_t len = end - buf.flushed;
+        uint64_t first = std::min(len, LOG_THD_BUF_SIZE - start);
+        iovs[iov_cnt].iov_base = &buf.data[start];
+        iovs[iov_cnt++].iov_len = first;
+        if (len > first) {
+            iovs[iov_cnt].iov_base = buf.data;
+            iovs[iov_cnt++].iov_len = len - first;
+        }
+        hdr.size += len;
+    }
+
+    if (hdr.size > 0) {
+        LogChecksum checksum;
+        checksum.init();
+        for (int i = 1; i < iov_cnt; i++) {
+            checksum.add((const char *) iovs[i].iov_base, iovs[i].iov_len);
+        }
+        hdr.checksum = checksum.value();
+        uint64_t size = sizeof(hdr) + hdr.size;
+        uint64_t aligned = (size + LOG_GROUP_ALIGN - 1) / LOG_GROUP_ALIGN * LOG_GROUP_ALIGN;
+        if (aligned > size) {
+            iovs[iov_cnt].iov_base = pad_zeros;
+            iovs[iov_cnt++].iov_len = aligned - size;
+        }
+        write_group(log_fd, iovs, iov_cnt, file_offset);
+        file_offset += aligned;
+        uint64_t write_time = get_sys_clock();
+        INC_STATS(thd_id,log_write_time,write_time - starttime);
+        INC_STATS(thd_id,log_write_cnt,1);
+        INC_STATS(thd_id,log_write_bytes,size);
+
+        fdatasync(log_fd);
+        INC_STATS(thd_id,log_flush_time,get_sys_clock() - write_time);
+        INC_STATS(thd_id,log_flush_cnt,1);
+        for (uint64_t i = 0; i < buf_cnt; i++) {
+            __atomic_store_n(&bufs[i].flushed, buf_ends[i], __ATOMIC_RELEASE);
+        }
+    }
+    durable_lsn = durable;
+
+    for (uint64_t i = 0; i < waiting_commits.size();) {
+        if (waiting_commits[i].lsn >= durable) {
+            i++;
+            continue;
+        }
+        DEBUG("Log Flushed %ld\n",waiting_commits[i].txn_id);
+        work_queue.enqueue(thd_id,Message::create_message(waiting_commits[i].txn_id,LOG_FLUSHED),
+                           false);
+        waiting_commits[i] = waiting_commits.back();
+        waiting_commits.pop_back();
+    }
 }
@@ -4,8 +4,10 @@
 #include "global.h"
 #include "helper.h"
 #include "concurrentqueue.h"
+#include <sys/uio.h>
 #include <set>
 #include <queue>
+#include <vector>
 #include <fstream>
 
 enum LogRecType {
@@ -47,6 +49,8 @@ struct AriesLogRecord {
         txn_id = UINT64_MAX;
         table_id = 0;
         key = UINT64_MAX;
+        image_size = 0;
+        image = NULL;
     }
 
     uint32_t checksum;
@@ -56,7 +60,10 @@ struct AriesLogRecord {
     uint64_t txn_id; // transaction id
     //uint32_t partid; // partition id
     uint32_t table_id; // table being updated
-    uint64_t key; // primary key (determines the partition ID)
+    uint64_t key; // row id, the position of the row in the table snapshot
+    uint32_t image_size;
+    // the row after the update, copied into the log by enqueueRecord and not owned by the record
+    const char * image;
 };
 
 class LogRecord {
@@ -64,6 +71,20 @@ public:
     //LogRecord();
     LogRecType getType() { return rcd.type; }
     void copyRecord( LogRecord * record);
+    // bytes the record takes in the log
+    uint64_t size() {
+#if LOG_COMMAND
+        return sizeof(rcd.checksum) + sizeof(rcd.lsn) + sizeof(rcd.type) + sizeof(rcd.txn_id) +
+#if WORKLOAD == TPCC
+               sizeof(rcd.txntype) +
+#endif
+               rcd.params_size;
+#else
+        return sizeof(rcd.checksum) + sizeof(rcd.lsn) + sizeof(rcd.type) + sizeof(rcd.iud) +
+               sizeof(rcd.txn_id) + sizeof(rcd.table_id) + sizeof(rcd.key) +
+               sizeof(rcd.image_size) + rcd.image_size;
+#endif
+    }
     // TODO: compute a reasonable checksum
     uint64_t computeChecksum() {
         return (uint64_t)rcd.txn_id;
@@ -78,11 +99,65 @@ private:
 
 };
 
+#define LOG_THD_COMMIT_CNT (LOG_THD_BUF_SIZE / 32)
+
+// Every group commit starts at a multiple of LOG_GROUP_ALIGN in the log file with this header,
+// followed by size bytes of records and zeros up to the next multiple.
+#define LOG_GROUP_MAGIC 0x4c4f4748
+struct LogGroupHeader {
+    uint32_t magic;
+    uint32_t size;
+    // LogChecksum of the records, tells a group that was not completely written
+    uint64_t checksum;
+};
+
+// FNV-1a over the 8-byte words of the records of a group, the last word padded with zeros. The
+// records can be added in pieces of any size.
+struct LogChecksum {
+    void init() {
+        hash = 0xcbf29ce484222325ULL;
+        word = 0;
+        size = 0;
+    }
+    void add(const char * data, uint64_t len);
+    uint64_t value();
+
+    uint64_t hash;
+    // the bytes of the word not complete yet
+    uint64_t word;
+    uint64_t size;
+};
+
+struct LogCommit {
+    uint64_t lsn;
+    uint64_t txn_id;
+};
+
+// The records of one thread, waiting to be written. The counters only grow; data is a ring of
+// LOG_THD_BUF_SIZE bytes and commits one of LOG_THD_COMMIT_CNT entries.
+struct LogBuffer {
+    char * data;
+    volatile uint64_t filled;
+    volatile uint64_t flushed;
+    // the commit records among them, to acknowledge once they are durable
+    LogCommit * commits;
+    volatile uint64_t commit_filled;
+    volatile uint64_t commit_flushed;
+    // at most the LSN of the record being appended, UINT64_MAX if there is none
+    volatile uint64_t busy_lsn;
+    char pad[CL_SIZE - 7 * sizeof(uint64_t)];
+};
+
+/*
+   Threads append their records to their own LogBuffer and take LSNs from one counter. The log
+   thread gathers what all of them appended into one pwritev and fdatasync every LOG_BUF_TIMEOUT,
+   or as soon as LOG_BUF_MAX commits wait, and then acknowledges the commits below the durable
+   LSN, the lowest LSN that can still be missing from the file.
+*/
 class Logger {
 public:
     void init(const char * log_file);
     void release();
-    void flushBufferCheck(uint64_t thd_id);
     LogRecord * createRecord(LogRecord* record);
 
     LogRecord * createRecord(
@@ -90,24 +165,27 @@ public:
         uint64_t txn_id, LogIUD iud,
         //uint64_t partid,
         uint64_t table_id, uint64_t key);
-    void enqueueRecord(LogRecord* record);
-    void processRecord(uint64_t thd_id);
-    void writeToBuffer(uint64_t thd_id,char * data, uint64_t size);
-    void writeToBuffer(uint64_t thd_id,LogRecord* record);
-    uint64_t reserveBuffer(uint64_t size);
-    void notify_on_sync(uint64_t txn_id);
+    void enqueueRecord(uint64_t thd_id, LogRecord* record);
+    void groupCommit(uint64_t thd_id);
+    void notify_on_sync(uint64_t thd_id, uint64_t txn_id);
+    uint64_t getDurableLsn() { return durable_lsn; }
 private:
-    pthread_mutex_t mtx;
-    uint64_t lsn;
+    volatile uint64_t lsn;
+    volatile uint64_t durable_lsn;
 
-    void flushBuffer(uint64_t thd_id);
-    std::queue<LogRecord*> log_queue;
+    bool groupDue();
+    void writeToBuffer(LogBuffer & buf, uint64_t & pos, const void * data, uint64_t size);
+    LogBuffer * bufs;
+    uint64_t buf_cnt;
+    // for the log thread
+    uint64_t * buf_ends;
+    iovec * iovs;
+    std::vector<LogCommit> waiting_commits;
     const char * log_file_name;
-    std::ofstream log_file;
-    uint64_t aries_write_offset;
-    std::set<uint64_t> txns_to_notify;
+    int log_fd;
+    uint64_t file_offset;
+    char * pad_zeros;
     uint64_t last_flush;
-    uint64_t log_buf_cnt;
 };
 
 
@@ -0,0 +1,162 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "global.h"
+#include "helper.h"
+#include "lts_client.h"
+#include "lts_wire.h"
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+void LtsClient::init(const char * ip, uint16_t port) {
+    this->ip = ip;
+    this->port = port;
+    pthread_mutex_init(&mtx, NULL);
+    pthread_cond_init(&cond, NULL);
+    next_ticket = 0;
+    sent_ticket = 0;
+    inflight = 0;
+    receiving = false;
+    fd = -1;
+    connect_lts();
+}
+
+void LtsClient::connect_lts() {
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = inet_addr(ip);
+    while (true) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (connect(fd, (sockaddr *) &sa, sizeof(sa)) == 0) break;
+        close(fd);
+        printf("LTS: connection to %s:%d failed, retrying\n", ip, port);
+        usleep(100000);
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    if (LTS_RECV_TIMEOUT > 0) {
+        timeval tv = {(time_t) (LTS_RECV_TIMEOUT / BILLION),
+                      (suseconds_t) (LTS_RECV_TIMEOUT % BILLION / 1000)};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    }
+}
+
+void LtsClient::close_lts() {
+    if (fd == -1) return;
+    close(fd);
+    fd = -1;
+}
+
+// Called with the mutex held. A failed send shows up as a failed receive.
+void LtsClient::send_batch(const lts_batch & batch) {
+    char frame[LTS_REQ_LEN];
+    bool rc = lts_encode(frame, LTS_REQ_LEN, 0, 0, batch.cnt);
+    assert(rc);
+    for (uint64_t sent = 0; sent < LTS_REQ_LEN;) {
+        ssize_t bytes = send(fd, frame + sent, LTS_REQ_LEN - sent, MSG_NOSIGNAL);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return;
+        sent += bytes;
+    }
+}
+
+// Called without the mutex, by one thread at a time. No answer within LTS_RECV_TIMEOUT (EAGAIN)
+// counts as a lost connection.
+bool LtsClient::recv_batch(uint64_t & ts, uint64_t & cnt) {
+    char frame[LTS_RESP_LEN];
+    for (uint64_t recvd = 0; recvd < LTS_RESP_LEN;) {
+        ssize_t bytes = recv(fd, frame + recvd, LTS_RESP_LEN - recvd, 0);
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) return false;
+        recvd += bytes;
+    }
+    uint64_t txn_id;
+    return lts_decode(frame, LTS_RESP_LEN, txn_id, ts, cnt);
+}
+
+LtsClient::lts_batch * LtsClient::find_batch(uint64_t ticket) {
+    for (uint64_t i = 0; i < batches.size(); i++) {
+        lts_batch & batch = batches[i];
+        if (ticket >= batch.first_ticket && ticket < batch.first_ticket + batch.cnt) return &batch;
+    }
+    return NULL;
+}
+
+uint64_t LtsClient::get_ts(uint64_t thd_id) {
+    pthread_mutex_lock(&mtx);
+    uint64_t ticket = next_ticket++;
+    while (true) {
+        lts_batch * batch = find_batch(ticket);
+        if (batch && batch->done) {
+            uint64_t idx = ticket - batch->first_ticket;
+            uint64_t ts = batch->ts + idx;
+            bool granted = idx < batch->granted;
+            batch->taken++;
+            while (!batches.empty() && batches.front().done &&
+                   batches.front().taken == batches.front().cnt) {
+                batches.pop_front();
+            }
+            if (granted) {
+                pthread_mutex_unlock(&mtx);
+                return ts;
+            }
+            // the LTS handed out fewer timestamps than asked for
+            ticket = next_ticket++;
+            continue;
+        }
+        if (!batch && inflight < LTS_PIPELINE_DEPTH) {
+            lts_batch nb;
+            nb.first_ticket = sent_ticket;
+            nb.cnt = std::min(next_ticket - sent_ticket, (uint64_t) LTS_BATCH_MAX);
+            nb.ts = 0;
+            nb.granted = 0;
+            nb.taken = 0;
+            nb.done = false;
+            sent_ticket += nb.cnt;
+            inflight++;
+            batches.push_back(nb);
+            send_batch(nb);
+            continue;
+        }
+        if (!receiving && inflight > 0) {
+            receiving = true;
+            pthread_mutex_unlock(&mtx);
+            uint64_t ts = 0;
+            uint64_t cnt = 0;
+            bool ok = recv_batch(ts, cnt);
+            pthread_mutex_lock(&mtx);
+            receiving = false;
+            uint64_t i = 0;
+            while (batches[i].done) i++;
+            if (ok) {
+                lts_batch & done = batches[i];
+                done.ts = ts;
+                // an LTS without batching leaves the count out
+                done.granted = std::min(std::max(cnt, (uint64_t) 1), done.cnt);
+                done.done = true;
+                inflight--;
+                INC_STATS(thd_id, lts_batch_cnt, 1);
+                INC_STATS(thd_id, lts_batch_size, done.cnt);
+            } else {
+                // the answers to the outstanding batches are lost with the connection
+                printf("LTS: connection lost or timed out, reconnecting\n");
+                close_lts();
+                connect_lts();
+                for (; i < batches.size(); i++) send_batch(batches[i]);
+            }
+            pthread_cond_broadcast(&cond);
+            continue;
+        }
+        pthread_cond_wait(&cond, &mtx);
+    }
+}
@@ -0,0 +1,58 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _LTS_CLIENT_H_
+#define _LTS_CLIENT_H_
+
+#include <pthread.h>
+#include <stdint.h>
+#include <deque>
+
+/*
+   One connection to the LTS for all threads of a node. Every caller of get_ts takes a ticket. A
+   batch asks the LTS for a range covering all tickets that are not in a batch yet, and up to
+   LTS_PIPELINE_DEPTH batches are outstanding. Responses come back in order; whoever is waiting
+   reads the next one and wakes up the owners of its tickets. A timestamp is never handed to a
+   ticket taken after its batch was sent. An LTS that does not answer within LTS_RECV_TIMEOUT
+   counts as lost: the client reconnects and sends the outstanding batches again.
+*/
+class LtsClient {
+public:
+    void init(const char * ip, uint16_t port);
+    uint64_t get_ts(uint64_t thd_id);
+    void close_lts();
+
+private:
+    struct lts_batch {
+        uint64_t first_ticket;
+        uint64_t cnt;
+        // valid once done
+        uint64_t ts;
+        uint64_t granted;
+        uint64_t taken;
+        bool done;
+    };
+    void connect_lts();
+    void send_batch(const lts_batch & batch);
+    bool recv_batch(uint64_t & ts, uint64_t & cnt);
+    lts_batch * find_batch(uint64_t ticket);
+
+    const char * ip;
+    uint16_t port;
+    int fd;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    // oldest first, kept until every ticket has taken its timestamp
+    std::deque<lts_batch> batches;
+    uint64_t next_ticket;
+    uint64_t sent_ticket;
+    uint64_t inflight;
+    bool receiving;
+};
+
+#endif
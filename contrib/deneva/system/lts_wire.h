@@ -0,0 +1,90 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _LTS_WIRE_H_
+#define _LTS_WIRE_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+/*
+   The frames the LTS exchanges over TCP. A request is 24 bytes and a response 18 bytes, each a
+   2-byte big endian length and a GetTxnTimestampCtx (ltsrpc.proto) padded with zeros. The
+   batched client asks for count timestamps and gets back the first one of a range of count; an
+   LTS that does not know the count field answers with a single timestamp.
+
+   The message is coded by hand rather than through ltsrpc.pb.h, so that the mock server in tools/
+   can share the code without depending on the protobuf version the generated files were made for.
+*/
+
+#define LTS_REQ_LEN 24
+#define LTS_RESP_LEN 18
+
+static inline char * lts_put_varint(char * p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (char) (v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (char) v;
+    return p;
+}
+
+static inline bool lts_get_varint(const char *& p, const char * end, uint64_t & v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t) (b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+// Fields that are 0 are left out, as proto3 does. Returns false if they do not fit.
+static inline bool lts_encode(char * frame, uint64_t frame_len, uint64_t txn_id, uint64_t txn_ts,
+                              uint64_t count) {
+    char body[32];
+    char * p = body;
+    if (txn_id) p = lts_put_varint(lts_put_varint(p, 1 << 3), txn_id);
+    if (txn_ts) p = lts_put_varint(lts_put_varint(p, 2 << 3), txn_ts);
+    if (count) p = lts_put_varint(lts_put_varint(p, 3 << 3), count);
+    uint16_t len = p - body;
+    if (len + sizeof(len) > frame_len) return false;
+    memset(frame, 0, frame_len);
+    uint16_t nlen = htons(len);
+    memcpy(frame, &nlen, sizeof(nlen));
+    memcpy(frame + sizeof(nlen), body, len);
+    return true;
+}
+
+static inline bool lts_decode(const char * frame, uint64_t frame_len, uint64_t & txn_id,
+                              uint64_t & txn_ts, uint64_t & count) {
+    uint16_t nlen;
+    memcpy(&nlen, frame, sizeof(nlen));
+    uint16_t len = ntohs(nlen);
+    if (len + sizeof(len) > frame_len) return false;
+    const char * p = frame + sizeof(len);
+    const char * end = p + len;
+    txn_id = txn_ts = count = 0;
+    while (p < end) {
+        uint64_t tag, v;
+        // every field of the message is a varint
+        if (!lts_get_varint(p, end, tag) || (tag & 7) != 0 || !lts_get_varint(p, end, v)) {
+            return false;
+        }
+        switch (tag >> 3) {
+        case 1: txn_id = v; break;
+        case 2: txn_ts = v; break;
+        case 3: count = v; break;
+        default: break;
+        }
+    }
+    return true;
+}
+
+#endif
@@ -25,6 +25,8 @@
 #include "abort_thread.h"
 #include "calvin_thread.h"
 #include "client_query.h"
+#include "dl_detect.h"
+#include "dl_detect_thread.h"
 #include "global.h"
 #include "io_thread.h"
 #include "log_thread.h"
@@ -56,6 +58,9 @@
 #include "client_query.h"
 #include "sundial.h"
 #include "http.h"
+#include "recovery.h"
+
+#include <sys/resource.h>
 
 void network_test();
 void network_test_recv();
@@ -67,6 +72,7 @@ InputThread * input_thds;
 OutputThread * output_thds;
 AbortThread * abort_thds;
 LogThread * log_thds;
+DlDetectThread * dl_detect_thds;
 #if CC_ALG == CALVIN
 CalvinLockThread * calvin_lock_thds;
 CalvinSequencerThread * calvin_seq_thds;
@@ -78,6 +84,7 @@ void parser(int argc, char * argv[]);
 int main(int argc, char *argv[]) {
     // 0. initialize global data structure
     parser(argc, argv);
+    mem_allocator.init();
 #if SEED != 0
     uint64_t seed = SEED + g_node_id;
 #else
@@ -127,9 +134,24 @@ int main(int argc, char *argv[]) {
         default:
             assert(false);
     }
+    if (recover_log != NULL && snapshot_dir == NULL) {
+        printf("-recover needs the table snapshot of the logged run, see -snap\n");
+        return 1;
+    }
+    uint64_t wl_init_start = get_sys_clock();
     m_wl->init();
-    printf("Workload initialized!\n");
-    fflush(stdout);
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // ru_maxrss is in KB on Linux
+    printf("Workload initialized in %f s, peak RSS %ld MB!\n",
+           (float)(get_sys_clock() - wl_init_start) / BILLION, usage.ru_maxrss / 1024);
+    fflush(stdout);
+    if (recover_log != NULL) {
+        bool ok = LogRecovery::recover(m_wl, recover_log);
+        printf("Recovery %s in %f s, snapshot included\n", ok ? "done" : "failed",
+               (float)(get_sys_clock() - wl_init_start) / BILLION);
+        return ok ? 0 : 1;
+    }
 #if NETWORK_TEST
     tport_man.init(g_node_id,m_wl);
     sleep(3);
@@ -253,6 +275,9 @@ int main(int argc, char *argv[]) {
 #if LOGGING
         all_thd_cnt += 1; // logger thread
 #endif
+#if CC_ALG == DL_DETECT
+        all_thd_cnt += 1; // deadlock detector thread
+#endif
 #if CC_ALG == CALVIN
         all_thd_cnt += 2; // sequencer + scheduler thread
 #endif
@@ -279,6 +304,7 @@ int main(int argc, char *argv[]) {
     output_thds = new OutputThread[sthd_cnt];
     abort_thds = new AbortThread[1];
     log_thds = new LogThread[1];
+    dl_detect_thds = new DlDetectThread[1];
 #if CC_ALG == CALVIN
     calvin_lock_thds = new CalvinLockThread[1];
     calvin_seq_thds = new CalvinSequencerThread[1];
@@ -294,6 +320,12 @@ int main(int argc, char *argv[]) {
     printf("Done\n");
 #endif
 
+#if CC_ALG == DL_DETECT
+    printf("Initializing deadlock detector... ");
+    dl_detector.init();
+    printf("Done\n");
+#endif
+
 #if CC_ALG == BOCC
     printf("Initializing occ lock manager... ");
     bocc_man.init();
@@ -362,6 +394,10 @@ int main(int argc, char *argv[]) {
     log_thds[0].init(id,g_node_id,m_wl);
     pthread_create(&p_thds[id++], NULL, run_thread, (void *)&log_thds[0]);
 #endif
+#if CC_ALG == DL_DETECT
+    dl_detect_thds[0].init(id,g_node_id,m_wl);
+    pthread_create(&p_thds[id++], NULL, run_thread, (void *)&dl_detect_thds[0]);
+#endif
 
 #if CC_ALG != CALVIN && WORKLOAD != DA
     abort_thds[0].init(id,g_node_id,m_wl);
@@ -403,6 +439,7 @@ int main(int argc, char *argv[]) {
     fflush(stdout);
 
     m_wl->index_delete_all();
+    tport_man.shutdown();
 
     if (g_ts_alloc == LTS_TCP_CLOCK) {
         for (uint32_t i = 0; i < all_thd_cnt; i++) {
@@ -78,12 +78,13 @@ uint64_t Manager::get_ts(uint64_t thread_id) {
     return time;
 }
 
+// The low watermark. One thread per interval recomputes it, the others read the last one.
 ts_t Manager::get_min_ts(uint64_t tid) {
     uint64_t now = get_sys_clock();
-    if (now - last_min_ts_time > MIN_TS_INTVL) {
-        last_min_ts_time = now;
-    uint64_t min = txn_table.get_min_ts(tid);
-    if (min > min_ts) min_ts = min;
+    ts_t last = last_min_ts_time;
+    if (now - last > MIN_TS_INTVL && ATOM_CAS(last_min_ts_time, last, now)) {
+        uint64_t min = txn_table.get_min_ts(tid);
+        if (min > min_ts) min_ts = min;
     }
     return min_ts;
 }
@@ -59,8 +59,8 @@ private:
     uint64_t         hash(row_t * row);
     ts_t * volatile all_ts;
     TxnManager **         _all_txns;
-    ts_t            last_min_ts_time;
-    ts_t            min_ts;
+    volatile ts_t    last_min_ts_time;
+    volatile ts_t    min_ts;
 
     static __thread uint64_t _max_cts; // max commit timestamp seen by the thread so far.
 };
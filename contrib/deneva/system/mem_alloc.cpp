@@ -16,61 +16,326 @@
 
 #include "mem_alloc.h"
 
+#include <sys/mman.h>
+
 #include "global.h"
 #include "helper.h"
 //#include "jemalloc/jemalloc.h"
 
 #define N_MALLOC
 
-void mem_alloc::free(void * ptr, uint64_t size) {
-    if (NO_FREE) {
+static_assert(THREAD_ARENA_SIZE % SLAB_SIZE == 0, "thread arena must hold whole slabs");
+
+// Size classes are 16 byte steps up to 256 bytes, then four steps per power of two. align_alloc()
+// rounds sizes up to a multiple of CL_SIZE, and such a size maps to a class that is a multiple of
+// CL_SIZE too (64, 128, 192, 256, 320, ...), so its objects are cache line aligned.
+struct slab_size_classes {
+    uint32_t size[SLAB_SIZE_CLASS_CNT];
+    uint8_t size_to_class[SLAB_MAX_OBJ_SIZE / 16 + 1];
+};
+
+static constexpr slab_size_classes make_slab_size_classes() {
+    slab_size_classes classes{};
+    uint32_t cnt = 0;
+    for (uint32_t size = 16; size <= 256; size += 16) {
+        classes.size[cnt++] = size;
     }
-    DEBUG_M("free %ld 0x%lx\n",size,(uint64_t)ptr);
+    for (uint32_t base = 256; base < SLAB_MAX_OBJ_SIZE; base *= 2) {
+        for (uint32_t i = 1; i <= 4; i++) {
+            classes.size[cnt++] = base + base / 4 * i;
+        }
+    }
+    uint32_t size_class = 0;
+    for (uint32_t i = 0; i <= SLAB_MAX_OBJ_SIZE / 16; i++) {
+        while (classes.size[size_class] < i * 16) {
+            size_class++;
+        }
+        classes.size_to_class[i] = size_class;
+    }
+    return classes;
+}
+
+static constexpr slab_size_classes slab_classes = make_slab_size_classes();
+static_assert(slab_classes.size[SLAB_SIZE_CLASS_CNT - 1] == SLAB_MAX_OBJ_SIZE,
+              "size classes must cover SLAB_MAX_OBJ_SIZE");
+
+static inline uint32_t get_size_class(uint64_t size) {
+    return slab_classes.size_to_class[(size + 15) / 16];
+}
+
+// The slabs of one thread in one arena.
+struct slab_arena_cache {
+    slab_free_obj * free_list[SLAB_SIZE_CLASS_CNT];
+    // unused part of the slab currently being carved for each size class
+    char * slab_cur[SLAB_SIZE_CLASS_CNT];
+    char * slab_end[SLAB_SIZE_CLASS_CNT];
+    // unused part of the thread arena chunk, cut into slabs on demand
+    char * chunk_cur;
+    char * chunk_end;
+};
+
+// Per-thread state of the slab allocator. Only the owner thread touches it, except for
+// remote_batches which other threads push freed objects onto.
+struct slab_thread_cache {
+    uint16_t id;
+    slab_arena_cache * arenas;
+    std::atomic<slab_free_obj *> remote_batches;
+    // objects freed by this thread but owned by other threads, waiting for a full batch
+    slab_free_obj * pending_head[SLAB_MAX_THREAD_CNT];
+    uint32_t pending_cnt[SLAB_MAX_THREAD_CNT];
+};
+
+static __thread slab_thread_cache * tl_thread_cache = NULL;
+static __thread bool tl_thread_cache_full = false;
+
+mem_alloc::mem_alloc()
+    : _region(NULL), _region_end(NULL), _arena_cnt(0), _shared_arena(0), _arena_size(0),
+      _arena_used(NULL),
+      _slab_metas(NULL), _thread_cache_cnt(0), _thread_caches() {}
+
+void mem_alloc::init() {
+    if (!THREAD_ALLOC && !g_part_alloc) {
+        return;
+    }
+    _arena_cnt = g_part_alloc ? std::max<uint64_t>(g_part_cnt / g_node_cnt, 1) + 1 : 1;
+    _shared_arena = _arena_cnt - 1;
+    _arena_size = std::max<uint64_t>(MEM_SIZE / _arena_cnt / THREAD_ARENA_SIZE, 1) *
+                  THREAD_ARENA_SIZE;
+    const uint64_t region_size = _arena_cnt * _arena_size;
+    // Address space is only reserved here, pages are backed when slabs are first written.
+    void * const reserved = mmap(NULL, region_size + SLAB_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) {
+        printf("Reserve slab region failed, fall back to malloc\n");
+        return;
+    }
+    _arena_used = new std::atomic<uint64_t>[_arena_cnt]();
+    _slab_metas = (slab_meta *) sys_alloc(sizeof(slab_meta) * (region_size >> SLAB_SIZE_SHIFT));
+    memset(_slab_metas, 0, sizeof(slab_meta) * (region_size >> SLAB_SIZE_SHIFT));
+    _region = (char *) (((uint64_t) reserved + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1));
+    _region_end = _region + region_size;
+    printf("Slab allocator: %ld arenas of %ld MB\n", _arena_cnt, _arena_size >> 20);
+}
+
+slab_thread_cache * mem_alloc::get_thread_cache() {
+    if (tl_thread_cache != NULL || tl_thread_cache_full) {
+        return tl_thread_cache;
+    }
+    const uint32_t id = _thread_cache_cnt.fetch_add(1, std::memory_order_relaxed);
+    if (id >= SLAB_MAX_THREAD_CNT) {
+        // too many threads, the rest of them allocate from malloc
+        tl_thread_cache_full = true;
+        return NULL;
+    }
+    slab_thread_cache * const cache =
+        new (sys_alloc(sizeof(slab_thread_cache))) slab_thread_cache();
+    cache->id = id;
+    cache->arenas = (slab_arena_cache *) sys_alloc(sizeof(slab_arena_cache) * _arena_cnt);
+    memset(cache->arenas, 0, sizeof(slab_arena_cache) * _arena_cnt);
+    _thread_caches[id] = cache;
+    tl_thread_cache = cache;
+    return cache;
+}
+
+void * mem_alloc::slab_alloc(slab_thread_cache * cache, uint64_t arena, uint32_t size_class) {
+    slab_arena_cache & ac = cache->arenas[arena];
+    slab_free_obj * const obj = ac.free_list[size_class];
+    if (obj != NULL) {
+        ac.free_list[size_class] = obj->next;
+        return obj;
+    }
+    return slab_alloc_slow(cache, arena, size_class);
+}
+
+void * mem_alloc::slab_alloc_slow(slab_thread_cache * cache, uint64_t arena,
+                                  uint32_t size_class) {
+    slab_arena_cache & ac = cache->arenas[arena];
+    collect_remote_frees(cache);
+    if (ac.free_list[size_class] != NULL) {
+        return slab_alloc(cache, arena, size_class);
+    }
+    const uint32_t size = slab_classes.size[size_class];
+    if ((uint64_t) (ac.slab_end[size_class] - ac.slab_cur[size_class]) < size) {
+        if (ac.chunk_cur == ac.chunk_end) {
+            // Hand back pending remote frees before growing, so they do not stay stranded in a
+            // thread which rarely frees to their owners.
+            const uint32_t thread_cache_cnt = std::min<uint32_t>(
+                    _thread_cache_cnt.load(std::memory_order_relaxed), SLAB_MAX_THREAD_CNT);
+            for (uint32_t owner = 0; owner < thread_cache_cnt; owner++) {
+                flush_remote_frees(cache, owner);
+            }
+            const uint64_t offset = _arena_used[arena].fetch_add(
+                    THREAD_ARENA_SIZE, std::memory_order_relaxed);
+            if (offset + THREAD_ARENA_SIZE > _arena_size) {
+                return NULL;  // arena is exhausted
+            }
+            ac.chunk_cur = _region + arena * _arena_size + offset;
+            ac.chunk_end = ac.chunk_cur + THREAD_ARENA_SIZE;
+        }
+        char * const slab = ac.chunk_cur;
+        ac.chunk_cur += SLAB_SIZE;
+        slab_meta & meta = get_slab_meta(slab);
+        meta.owner = cache->id;
+        meta.arena = arena;
+        meta.size_class = size_class;
+        ac.slab_cur[size_class] = slab;
+        ac.slab_end[size_class] = slab + SLAB_SIZE;
+    }
+    void * const ptr = ac.slab_cur[size_class];
+    ac.slab_cur[size_class] += size;
+    return ptr;
+}
+
+void mem_alloc::slab_free(void * ptr) {
+    const slab_meta & meta = get_slab_meta(ptr);
+    slab_free_obj * const obj = (slab_free_obj *) ptr;
+    slab_thread_cache * const cache = get_thread_cache();
+    if (cache == NULL) {
+        obj->next = NULL;
+        push_remote_batch(meta.owner, obj);
+    } else if (cache->id == meta.owner) {
+        obj->next = cache->arenas[meta.arena].free_list[meta.size_class];
+        cache->arenas[meta.arena].free_list[meta.size_class] = obj;
+    } else {
+        obj->next = cache->pending_head[meta.owner];
+        cache->pending_head[meta.owner] = obj;
+        if (++cache->pending_cnt[meta.owner] == SLAB_REMOTE_FREE_BATCH) {
+            flush_remote_frees(cache, meta.owner);
+        }
+    }
+}
+
+void mem_alloc::collect_remote_frees(slab_thread_cache * cache) {
+    slab_free_obj * batch = cache->remote_batches.exchange(NULL, std::memory_order_acquire);
+    while (batch != NULL) {
+        slab_free_obj * const next_batch = batch->next_batch;
+        for (slab_free_obj * obj = batch; obj != NULL;) {
+            slab_free_obj * const next = obj->next;
+            const slab_meta & meta = get_slab_meta(obj);
+            obj->next = cache->arenas[meta.arena].free_list[meta.size_class];
+            cache->arenas[meta.arena].free_list[meta.size_class] = obj;
+            obj = next;
+        }
+        batch = next_batch;
+    }
+}
+
+void mem_alloc::flush_remote_frees(slab_thread_cache * cache, uint16_t owner) {
+    slab_free_obj * const head = cache->pending_head[owner];
+    if (head == NULL) {
+        return;
+    }
+    cache->pending_head[owner] = NULL;
+    cache->pending_cnt[owner] = 0;
+    push_remote_batch(owner, head);
+}
+
+void mem_alloc::push_remote_batch(uint16_t owner, slab_free_obj * head) {
+    std::atomic<slab_free_obj *> & batches = _thread_caches[owner]->remote_batches;
+    head->next_batch = batches.load(std::memory_order_relaxed);
+    while (!batches.compare_exchange_weak(head->next_batch, head, std::memory_order_release,
+                                          std::memory_order_relaxed)) {
+    }
+}
+
+void * mem_alloc::sys_alloc(uint64_t size) {
 #ifdef N_MALLOC
-    std::free(ptr);
+    return malloc(size);
 #else
-    je_free(ptr);
+    return je_malloc(size);
 #endif
 }
 
-void mem_alloc::free(void * ptr) {
-    if (NO_FREE) {
-    }
-    DEBUG_M("free 0x%lx\n", (uint64_t)ptr);
+void * mem_alloc::sys_realloc(void * ptr, uint64_t size) {
 #ifdef N_MALLOC
-    std::free(ptr);
+    return std::realloc(ptr,size);
 #else
-    je_free(ptr);
+    return je_realloc(ptr,size);
 #endif
 }
 
-void * mem_alloc::alloc(uint64_t size) {
-    void * ptr;
-
+void mem_alloc::sys_free(void * ptr) {
 #ifdef N_MALLOC
-    ptr = malloc(size);
+    std::free(ptr);
 #else
-    ptr = je_malloc(size);
+    je_free(ptr);
 #endif
+}
+
+void mem_alloc::free(void * ptr, uint64_t size) {
+    if (NO_FREE) {
+    }
+    DEBUG_M("free %ld 0x%lx\n",size,(uint64_t)ptr);
+    if (in_slab_region(ptr)) {
+        slab_free(ptr);
+    } else {
+        sys_free(ptr);
+    }
+}
+
+void mem_alloc::free(void * ptr) {
+    if (NO_FREE) {
+    }
+    DEBUG_M("free 0x%lx\n", (uint64_t)ptr);
+    if (in_slab_region(ptr)) {
+        slab_free(ptr);
+    } else {
+        sys_free(ptr);
+    }
+}
+
+void * mem_alloc::arena_alloc(uint64_t size, uint64_t arena) {
+    void * ptr = NULL;
+    if (_region != NULL && size <= SLAB_MAX_OBJ_SIZE) {
+        slab_thread_cache * const cache = get_thread_cache();
+        if (cache != NULL) {
+            ptr = slab_alloc(cache, arena, get_size_class(size));
+        }
+    }
+    if (ptr == NULL) {
+        ptr = sys_alloc(size);
+    }
     DEBUG_M("alloc %ld 0x%lx\n",size,(uint64_t)ptr);
     assert(ptr != NULL);
     return ptr;
 }
 
+void * mem_alloc::alloc(uint64_t size) { return arena_alloc(size, _shared_arena); }
+
+void * mem_alloc::alloc(uint64_t size, uint64_t part_id) {
+    if (_arena_cnt == 1) {
+        return arena_alloc(size, _shared_arena);
+    }
+    return arena_alloc(size, GET_PART_ID_IDX(part_id) % (_arena_cnt - 1));
+}
+
 void * mem_alloc::align_alloc(uint64_t size) {
     uint64_t aligned_size = size + CL_SIZE - (size % CL_SIZE);
     return alloc(aligned_size);
 }
 
+void * mem_alloc::align_alloc(uint64_t size, uint64_t part_id) {
+    uint64_t aligned_size = size + CL_SIZE - (size % CL_SIZE);
+    return alloc(aligned_size, part_id);
+}
+
 
 void * mem_alloc::realloc(void * ptr, uint64_t size) {
-#ifdef N_MALLOC
-    void * _ptr = std::realloc(ptr,size);
-#else
-    void * _ptr = je_realloc(ptr,size);
-#endif
+    void * _ptr;
+    if (in_slab_region(ptr)) {
+        const uint32_t size_class = get_slab_meta(ptr).size_class;
+        if (size <= SLAB_MAX_OBJ_SIZE && get_size_class(size) == size_class) {
+            return ptr;
+        }
+        // stays in the arena of the block
+        _ptr = arena_alloc(size, get_slab_meta(ptr).arena);
+        memcpy(_ptr, ptr, std::min<uint64_t>(size, slab_classes.size[size_class]));
+        slab_free(ptr);
+    } else if (ptr == NULL) {
+        _ptr = alloc(size);
+    } else {
+        _ptr = sys_realloc(ptr,size);
+    }
     DEBUG_M("realloc %ld 0x%lx\n",size,(uint64_t)_ptr);
     return _ptr;
 }
-
-
@@ -18,12 +18,51 @@
 #define _MEM_ALLOC_H_
 
 #include "global.h"
+#include <atomic>
 #include <memory>
 
+// Slab allocator behind THREAD_ALLOC and PART_ALLOC.
+// Small objects (Message, Access, row_t, txn_node, version entries, ...) are carved from 64KB
+// slabs, each holding objects of a single size class and owned by the thread that carved it.
+// Slabs live in one reserved region. When g_part_alloc is set, the region is split into one arena
+// per local partition, for the rows and row managers of that partition, which callers name with
+// alloc(size, part_id), and one shared arena for everything else. Threads take THREAD_ARENA_SIZE
+// chunks from an arena and cut them into slabs. A block outside the region comes from malloc, so
+// free() only needs a range check to tell them apart.
+#define SLAB_SIZE_SHIFT         16
+#define SLAB_SIZE               (1UL << SLAB_SIZE_SHIFT)
+#define SLAB_MAX_OBJ_SIZE       8192
+#define SLAB_SIZE_CLASS_CNT     36
+#define SLAB_MAX_THREAD_CNT     256
+// objects freed by a thread other than the owner are handed back in batches of this size
+#define SLAB_REMOTE_FREE_BATCH  32
+
+// A free object is linked through its first two words, so the smallest size class is 16 bytes.
+struct slab_free_obj {
+    slab_free_obj * next;
+    slab_free_obj * next_batch;  // only set on the head object of a remote free batch
+};
+
+struct slab_meta {
+    uint16_t owner;
+    uint16_t arena;
+    uint8_t size_class;
+};
+
+struct slab_arena_cache;
+struct slab_thread_cache;
+
 class mem_alloc {
 public:
+    mem_alloc();
+    // Reserve the slab region if THREAD_ALLOC or g_part_alloc is set. Must be called after the
+    // arguments are parsed. Blocks allocated before init() come from malloc.
+    void init();
     void * alloc(uint64_t size);
+    // with g_part_alloc, from the arena of the partition
+    void * alloc(uint64_t size, uint64_t part_id);
     void * align_alloc(uint64_t size);
+    void * align_alloc(uint64_t size, uint64_t part_id);
     void * realloc(void * ptr, uint64_t size);
     void free(void * block, uint64_t size);
     void free(void * block);
@@ -35,6 +74,33 @@ public:
         return std::shared_ptr<T>(construct<T>(std::forward<Args>(args)...),
                 [this](T* const ptr) { free(ptr, sizeof(T)); });
     }
+private:
+    bool in_slab_region(const void * ptr) const { return ptr >= _region && ptr < _region_end; }
+    slab_meta & get_slab_meta(const void * ptr) {
+        return _slab_metas[((const char *)ptr - _region) >> SLAB_SIZE_SHIFT];
+    }
+    slab_thread_cache * get_thread_cache();
+    void * arena_alloc(uint64_t size, uint64_t arena);
+    void * slab_alloc(slab_thread_cache * cache, uint64_t arena, uint32_t size_class);
+    void * slab_alloc_slow(slab_thread_cache * cache, uint64_t arena, uint32_t size_class);
+    void slab_free(void * ptr);
+    void collect_remote_frees(slab_thread_cache * cache);
+    void flush_remote_frees(slab_thread_cache * cache, uint16_t owner);
+    void push_remote_batch(uint16_t owner, slab_free_obj * head);
+    void * sys_alloc(uint64_t size);
+    void * sys_realloc(void * ptr, uint64_t size);
+    void sys_free(void * ptr);
+
+    char * _region;
+    char * _region_end;
+    // with g_part_alloc, arenas [0, _arena_cnt - 1) are those of the local partitions
+    uint64_t _arena_cnt;
+    uint64_t _shared_arena;
+    uint64_t _arena_size;
+    std::atomic<uint64_t> * _arena_used;
+    slab_meta * _slab_metas;
+    std::atomic<uint32_t> _thread_cache_cnt;
+    slab_thread_cache * _thread_caches[SLAB_MAX_THREAD_CNT];
 };
 
 #endif
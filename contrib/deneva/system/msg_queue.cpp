@@ -39,6 +39,11 @@ void MessageQueue::init() {
         *ctr[i] = i % g_thread_cnt;
     }
     for (uint64_t i = 0; i < g_this_send_thread_cnt; i++) sthd_m_cache.push_back(NULL);
+    pending = new volatile uint64_t * [g_this_send_thread_cnt];
+    for(uint64_t i = 0; i < g_this_send_thread_cnt; i++) {
+        pending[i] = (uint64_t*) mem_allocator.align_alloc(sizeof(uint64_t) * g_total_node_cnt);
+        memset((void *) pending[i], 0, sizeof(uint64_t) * g_total_node_cnt);
+    }
 }
 
 void MessageQueue::enqueue(uint64_t thd_id, Message * msg,uint64_t dest) {
@@ -61,6 +66,7 @@ void MessageQueue::enqueue(uint64_t thd_id, Message * msg,uint64_t dest) {
 #else
     uint64_t rand = mtx_time_start % g_this_send_thread_cnt;
 #endif
+    ATOM_ADD(pending[rand][dest],1);
 #if NETWORK_DELAY_TEST
     if(ISCLIENTN(dest)) {
         while (!cl_m_queue[rand]->push(entry) && !simulation->is_done()) {
@@ -117,6 +123,11 @@ uint64_t MessageQueue::dequeue(uint64_t thd_id, Message *& msg) {
 #endif
         dest = entry->dest;
         assert(dest < g_total_node_cnt);
+#if WORKLOAD == DA
+        ATOM_SUB(pending[0][dest],1);
+#else
+        ATOM_SUB(pending[thd_id % g_this_send_thread_cnt][dest],1);
+#endif
         msg = entry->msg;
         DEBUG("MQ Dequeue %ld\n",dest)
         INC_STATS(thd_id,msg_queue_delay_time,curr_time - entry->starttime);
@@ -132,3 +143,11 @@ uint64_t MessageQueue::dequeue(uint64_t thd_id, Message *& msg) {
     INC_STATS(thd_id,mtx[5],get_sys_clock() - curr_time);
     return dest;
 }
+
+uint64_t MessageQueue::get_pending(uint64_t thd_id, uint64_t dest) {
+#if WORKLOAD == DA
+    return pending[0][dest];
+#else
+    return pending[thd_id % g_this_send_thread_cnt][dest];
+#endif
+}
@@ -39,6 +39,8 @@ public:
     void init();
     void enqueue(uint64_t thd_id, Message * msg, uint64_t dest);
     uint64_t dequeue(uint64_t thd_id, Message *& msg);
+    // messages for dest waiting in the queue of send thread thd_id
+    uint64_t get_pending(uint64_t thd_id, uint64_t dest);
 private:
  //LockfreeQueue m_queue;
 // This is close to max capacity for boost
@@ -48,6 +50,8 @@ private:
     boost::lockfree::queue<msg_entry*> ** m_queue;
     std::vector<msg_entry*> sthd_m_cache;
     uint64_t ** ctr;
+    // per queue and destination
+    volatile uint64_t ** pending;
 
 };
 
@@ -54,6 +54,8 @@ void print_usage() {
     printf("\t-o STRING   ; output file\n");
     printf("\t-i STRING   ; input file\n");
     printf("\t-cf STRING   ; txn file\n");
+    printf("\t-snap STRING   ; table snapshot directory\n");
+    printf("\t-recover STRING   ; replay this log on the table snapshot and exit\n");
     printf("\t-ndly   ; NETWORK_DELAY\n");
     printf("  [YCSB]:\n");
     printf("\t-dpFLOAT       ; DATA_PERC\n");
@@ -63,6 +65,8 @@ void print_usage() {
     printf("\t-eINT       ; PERC_MULTI_PART\n");
     printf("\t-wFLOAT     ; WRITE_PERC\n");
     printf("\t-zipfFLOAT     ; ZIPF_THETA\n");
+    printf("\t-scnpFLOAT     ; SCAN_PERC\n");
+    printf("\t-scnlINT     ; SCAN_LEN\n");
     printf("\t-sINT       ; SYNTH_TABLE_SIZE\n");
     printf("\t-rpqINT       ; REQ_PER_QUERY\n");
     printf("\t-fINT       ; FIELD_PER_TUPLE\n");
@@ -96,6 +100,14 @@ void parser(int argc, char * argv[]) {
             g_abort_penalty = atoi( &argv[i][5] );
         else if (argv[i][1] == 'z' && argv[i][2] == 'i' && argv[i][3] == 'p' && argv[i][4] == 'f')
             g_zipf_theta = atof( &argv[i][5] );
+        else if (argv[i][1] == 's' && argv[i][2] == 'n' && argv[i][3] == 'a' && argv[i][4] == 'p')
+            snapshot_dir = argv[++i];
+        else if (argv[i][1] == 'r' && argv[i][2] == 'e' && argv[i][3] == 'c' && argv[i][4] == 'o')
+            recover_log = argv[++i];
+        else if (argv[i][1] == 's' && argv[i][2] == 'c' && argv[i][3] == 'n' && argv[i][4] == 'p')
+            g_scan_perc = atof( &argv[i][5] );
+        else if (argv[i][1] == 's' && argv[i][2] == 'c' && argv[i][3] == 'n' && argv[i][4] == 'l')
+            g_scan_len = atoi( &argv[i][5] );
         else if (argv[i][1] == 'n' && argv[i][2] == 'i' && argv[i][3] == 'd')
             g_node_id = atoi( &argv[i][4] );
         else if (argv[i][1] == 'c' && argv[i][2] == 't' && argv[i][3] == 'r')
@@ -190,6 +202,7 @@ void parser(int argc, char * argv[]) {
 #if LOGGING
     g_total_thread_cnt += g_logger_thread_cnt; // logger thread
 #endif
+    g_total_thread_cnt += g_dl_detect_thread_cnt; // deadlock detector thread
 #if CC_ALG == CALVIN
     g_total_thread_cnt += 2; // sequencer + scheduler thread
     // Remove abort thread
@@ -221,6 +234,8 @@ void parser(int argc, char * argv[]) {
     printf("g_thread_cnt %d\n",g_thread_cnt );
     printf("g_abort_penalty %ld\n",g_abort_penalty);
     printf("g_zipf_theta %f\n",g_zipf_theta );
+    printf("g_scan_perc %f\n",g_scan_perc );
+    printf("g_scan_len %d\n",g_scan_len );
     printf("g_node_id %d\n",g_node_id );
     printf("g_client_rem_thread_cnt %d\n",g_client_rem_thread_cnt );
     printf("g_client_send_thread_cnt %d\n",g_client_send_thread_cnt );
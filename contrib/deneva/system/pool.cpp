@@ -289,7 +289,6 @@ void AccessPool::get(uint64_t thd_id, Access *& item) {
         item = (Access*)mem_allocator.alloc(sizeof(Access));
         item->orig_row = NULL;
         item->data = NULL;
-        item->orig_data = NULL;
     #if CC_ALG == SUNDIAL
         item->orig_rts = 0;
         item->orig_wts = 0;
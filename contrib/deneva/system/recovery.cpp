@@ -0,0 +1,275 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "recovery.h"
+#include "global.h"
+#include "helper.h"
+#include "index_btree.h"
+#include "index_hash.h"
+#include "logger.h"
+#include "row.h"
+#include "snapshot.h"
+#include "table.h"
+#include "wl.h"
+
+struct recovery_update {
+    uint64_t lsn;
+    uint64_t txn_id;
+    row_t * row;
+    const char * image;
+};
+
+// The groups one thread parses, and later the partition it replays.
+struct recovery_task {
+    const char * log;
+    const std::vector<uint64_t> * groups;
+    uint64_t begin;
+    uint64_t end;
+    // rows of a table by id, the table by table_id
+    const std::vector<std::vector<row_t *>> * rows;
+    // results of the scan
+    std::vector<uint64_t> committed;
+    std::vector<std::vector<recovery_update>> parts;
+    uint64_t record_cnt;
+    int64_t bad_group;
+    // the first group whose records do not match the checksum, UINT64_MAX if there is none
+    uint64_t torn_group;
+    // for the replay, committed of all tasks merged and sorted
+    uint64_t part;
+    recovery_task * tasks;
+    const std::vector<uint64_t> * all_committed;
+    uint64_t applied_cnt;
+};
+
+// in the order Logger::enqueueRecord writes them
+#define LOG_READ_VAL(p, v) { memcpy(&(v), p, sizeof(v)); p += sizeof(v); }
+
+static uint64_t partition(uint32_t table_id, uint64_t key) {
+    return ((((uint64_t) table_id << 48) ^ key) * 0x9e3779b97f4a7c15ULL >> 32) % g_thread_cnt;
+}
+
+void LogRecovery::run_parallel(void * (*func)(void *), recovery_task * tasks) {
+    pthread_t * p_thds = new pthread_t[g_thread_cnt - 1];
+    for (UInt32 i = 0; i < g_thread_cnt - 1; i++) {
+        pthread_create(&p_thds[i], NULL, func, &tasks[i]);
+    }
+    func(&tasks[g_thread_cnt - 1]);
+    for (UInt32 i = 0; i < g_thread_cnt - 1; i++) {
+        int rc = pthread_join(p_thds[i], NULL);
+        if (rc) {
+            printf("ERROR; return code from pthread_join() is %d\n", rc);
+            exit(-1);
+        }
+    }
+    delete [] p_thds;
+}
+
+void * LogRecovery::scan_groups(void * arg) {
+    recovery_task * task = (recovery_task *) arg;
+    AriesLogRecord rcd;
+    const uint64_t head_size = sizeof(rcd.checksum) + sizeof(rcd.lsn) + sizeof(rcd.type) +
+                               sizeof(rcd.iud) + sizeof(rcd.txn_id) + sizeof(rcd.table_id) +
+                               sizeof(rcd.key) + sizeof(rcd.image_size);
+    for (uint64_t g = task->begin; g < task->end; g++) {
+        const uint64_t offset = (*task->groups)[g];
+        LogGroupHeader hdr;
+        memcpy(&hdr, task->log + offset, sizeof(hdr));
+        const char * p = task->log + offset + sizeof(hdr);
+        const char * end = p + hdr.size;
+        LogChecksum checksum;
+        checksum.init();
+        checksum.add(p, hdr.size);
+        if (checksum.value() != hdr.checksum) {
+            task->torn_group = g;
+            break;
+        }
+        while (p < end) {
+            if ((uint64_t) (end - p) < head_size) break;
+            LOG_READ_VAL(p, rcd.checksum);
+            LOG_READ_VAL(p, rcd.lsn);
+            LOG_READ_VAL(p, rcd.type);
+            LOG_READ_VAL(p, rcd.iud);
+            LOG_READ_VAL(p, rcd.txn_id);
+            LOG_READ_VAL(p, rcd.table_id);
+            LOG_READ_VAL(p, rcd.key);
+            LOG_READ_VAL(p, rcd.image_size);
+            if (rcd.image_size > (uint64_t) (end - p)) break;
+            rcd.image = p;
+            p += rcd.image_size;
+            task->record_cnt++;
+            if (rcd.iud == L_NOTIFY) {
+                task->committed.push_back(rcd.txn_id);
+                continue;
+            }
+            // the log has no inserts or deletes, the rows inserted by transactions are dropped
+            // when they finish
+            if (rcd.iud != L_UPDATE || rcd.table_id >= task->rows->size()) break;
+            const std::vector<row_t *> & rows = (*task->rows)[rcd.table_id];
+            if (rcd.key >= rows.size() || rows[rcd.key] == NULL) break;
+            // a replica logs the records of its primary without the images
+            if (rcd.image_size == 0) continue;
+            if (rcd.image_size != rows[rcd.key]->get_tuple_size()) break;
+            task->parts[partition(rcd.table_id, rcd.key)].push_back(
+                recovery_update{rcd.lsn, rcd.txn_id, rows[rcd.key], rcd.image});
+        }
+        if (p != end) {
+            task->bad_group = offset;
+            break;
+        }
+    }
+    return NULL;
+}
+
+void * LogRecovery::replay_partition(void * arg) {
+    recovery_task * task = (recovery_task *) arg;
+    std::vector<recovery_update> updates;
+    for (UInt32 i = 0; i < g_thread_cnt; i++) {
+        for (const recovery_update & update : task->tasks[i].parts[task->part]) {
+            if (std::binary_search(task->all_committed->begin(), task->all_committed->end(),
+                                   update.txn_id))
+                updates.push_back(update);
+        }
+    }
+    std::sort(updates.begin(), updates.end(),
+              [](const recovery_update & a, const recovery_update & b) { return a.lsn < b.lsn; });
+    for (const recovery_update & update : updates) {
+        memcpy(update.row->get_data(), update.image, update.row->get_tuple_size());
+    }
+    task->applied_cnt = updates.size();
+    return NULL;
+}
+
+bool LogRecovery::recover(Workload * wl, const char * log_file) {
+#if LOG_COMMAND
+    printf("Recovery replays ARIES-style records only, not the command log\n");
+    return false;
+#endif
+    if (!TableSnapshot::loaded) {
+        printf("No snapshot was loaded, the log cannot be replayed on freshly generated tables\n");
+        return false;
+    }
+    uint64_t start_time = get_sys_clock();
+    FILE * file = fopen(log_file, "rb");
+    if (file == NULL) {
+        printf("Cannot open log %s\n", log_file);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0) {
+        fclose(file);
+        return false;
+    }
+    const uint64_t file_size = st.st_size;
+    char * log = NULL;
+    if (file_size > 0) {
+        log = (char *) mmap(NULL, file_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                            fileno(file), 0);
+    }
+    fclose(file);
+    if (log == MAP_FAILED) return false;
+
+    // the rows have their position in the snapshot as id
+    std::vector<std::vector<row_t *>> rows;
+    for (auto & table : wl->tables) {
+        if (table.second->get_table_id() >= rows.size())
+            rows.resize(table.second->get_table_id() + 1);
+    }
+    for (auto & index : wl->indexes) {
+        std::vector<row_t *> & table_rows = rows[index.second->table->get_table_id()];
+        index.second->index_visit([&](idx_key_t key, itemid_t * item, int part_id) {
+            row_t * row = (row_t *) item->location;
+            if (row->get_row_id() >= table_rows.size()) table_rows.resize(row->get_row_id() + 1);
+            table_rows[row->get_row_id()] = row;
+        });
+    }
+
+    // A group whose header was not completely written ends the log. If only its records were
+    // not, the scan finds that by the checksum.
+    std::vector<uint64_t> groups;
+    uint64_t offset = 0;
+    while (file_size - offset >= sizeof(LogGroupHeader)) {
+        LogGroupHeader hdr;
+        memcpy(&hdr, log + offset, sizeof(hdr));
+        if (hdr.magic != LOG_GROUP_MAGIC || hdr.size > file_size - offset - sizeof(hdr)) break;
+        groups.push_back(offset);
+        offset += (sizeof(hdr) + hdr.size + LOG_GROUP_ALIGN - 1) / LOG_GROUP_ALIGN *
+                  LOG_GROUP_ALIGN;
+        if (offset > file_size) break;
+    }
+
+    recovery_task * tasks = new recovery_task[g_thread_cnt];
+    for (UInt32 i = 0; i < g_thread_cnt; i++) {
+        tasks[i].log = log;
+        tasks[i].groups = &groups;
+        tasks[i].begin = groups.size() * i / g_thread_cnt;
+        tasks[i].end = groups.size() * (i + 1) / g_thread_cnt;
+        tasks[i].rows = &rows;
+        tasks[i].parts.resize(g_thread_cnt);
+        tasks[i].record_cnt = 0;
+        tasks[i].bad_group = -1;
+        tasks[i].torn_group = UINT64_MAX;
+    }
+    run_parallel(scan_groups, tasks);
+    uint64_t scan_time = get_sys_clock() - start_time;
+
+    bool ok = true;
+    uint64_t record_cnt = 0;
+    std::vector<uint64_t> committed;
+    for (UInt32 i = 0; i < g_thread_cnt; i++) {
+        // The write of the last group may have been cut short by a crash; its transactions were
+        // never acknowledged, so it is dropped. Any other group was made durable.
+        if (tasks[i].torn_group != UINT64_MAX) {
+            const uint64_t offset = groups[tasks[i].torn_group];
+            if (tasks[i].torn_group + 1 == groups.size()) {
+                printf("Log %s ends in a group that was not completely written, at %ld, which "
+                       "is dropped\n", log_file, offset);
+            } else {
+                printf("Log %s has a corrupt group at %ld\n", log_file, offset);
+                ok = false;
+            }
+        }
+        if (tasks[i].bad_group >= 0) {
+            printf("Log %s has a bad record in the group at %ld\n", log_file, tasks[i].bad_group);
+            ok = false;
+        }
+        record_cnt += tasks[i].record_cnt;
+        committed.insert(committed.end(), tasks[i].committed.begin(), tasks[i].committed.end());
+    }
+    std::sort(committed.begin(), committed.end());
+
+    uint64_t applied_cnt = 0;
+    if (ok) {
+        for (UInt32 i = 0; i < g_thread_cnt; i++) {
+            tasks[i].part = i;
+            tasks[i].tasks = tasks;
+            tasks[i].all_committed = &committed;
+            tasks[i].applied_cnt = 0;
+        }
+        run_parallel(replay_partition, tasks);
+        for (UInt32 i = 0; i < g_thread_cnt; i++) applied_cnt += tasks[i].applied_cnt;
+    }
+    delete [] tasks;
+    if (log != NULL) munmap(log, file_size);
+
+    const float total_time = (float) (get_sys_clock() - start_time) / BILLION;
+    const float log_mb = (float) file_size / (1 << 20);
+    printf("Replayed %s (%f MB, %ld groups, %ld records) with %d threads: scan %f s, "
+           "replay %f s\n", log_file, log_mb, groups.size(), record_cnt, g_thread_cnt,
+           (float) scan_time / BILLION, total_time - (float) scan_time / BILLION);
+    printf("Recovered %ld committed transactions, %ld updates in %f s: %f records/s, %f MB/s\n",
+           committed.size(), applied_cnt, total_time,
+           total_time > 0 ? record_cnt / total_time : 0, total_time > 0 ? log_mb / total_time : 0);
+    return ok;
+}
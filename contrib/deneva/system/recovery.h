@@ -0,0 +1,38 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _RECOVERY_H_
+#define _RECOVERY_H_
+
+#include "global.h"
+
+class Workload;
+struct recovery_task;
+
+/*
+   Replays a log written by Logger on the tables loaded from the snapshot the logged run started
+   from. g_thread_cnt threads each parse a share of the group commits, collecting the committed
+   transactions and sorting the update records into g_thread_cnt partitions by (table_id, key).
+   Then each thread sorts a partition by LSN and copies the after-images of the committed
+   transactions into the rows, so that every row ends up with its last committed write.
+
+   Only the ARIES-style records of LOGGING carry what replay needs; with LOG_COMMAND there is
+   nothing to replay yet.
+*/
+class LogRecovery {
+public:
+    // Returns false if the log cannot be read or does not belong to the tables.
+    static bool recover(Workload * wl, const char * log_file);
+
+private:
+    static void run_parallel(void * (*func)(void *), recovery_task * tasks);
+    static void * scan_groups(void * task);
+    static void * replay_partition(void * task);
+};
+
+#endif
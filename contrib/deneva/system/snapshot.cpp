@@ -0,0 +1,385 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "snapshot.h"
+#include "catalog.h"
+#include "global.h"
+#include "helper.h"
+#include "index_btree.h"
+#include "index_hash.h"
+#include "mem_alloc.h"
+#include "row.h"
+#include "table.h"
+#include "wl.h"
+
+// A range of rows or index entries loaded by one thread.
+struct snapshot_task {
+    const char * records;
+    uint64_t begin;
+    uint64_t end;
+    table_t * table;
+    row_t ** rows;
+    INDEX * index;
+};
+
+bool TableSnapshot::loaded = false;
+
+// An index entry while saving, before the row is replaced by its position.
+struct snapshot_save_entry {
+    idx_key_t key;
+    uint64_t part_id;
+    itemid_t * item;
+};
+
+// FNV-1a
+static uint64_t hash_bytes(uint64_t hash, const void * data, uint64_t size) {
+    for (uint64_t i = 0; i < size; i++) {
+        hash = (hash ^ ((const uint8_t *) data)[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint64_t hash_string(uint64_t hash, const char * str) {
+    return hash_bytes(hash, str, strlen(str) + 1);
+}
+
+static bool same_key(const snapshot_entry & a, const snapshot_entry & b) {
+    return a.part_id == b.part_id && a.key == b.key;
+}
+
+uint64_t TableSnapshot::config_hash(Workload * wl) {
+    // everything that changes the generated rows or their index keys
+    const uint64_t params[] = {
+        WORKLOAD, INDEX_STRUCT, CENTRAL_INDEX, TPCC_SMALL, g_node_id, g_node_cnt, g_part_cnt,
+        g_synth_table_size, g_field_per_tuple, g_num_wh, g_dist_per_wh, g_cust_per_dist,
+        g_max_items, g_max_part_key, g_max_product_key, g_max_supplier_key
+    };
+    uint64_t hash = hash_bytes(0xcbf29ce484222325ULL, params, sizeof(params));
+    for (auto & table : wl->tables) {
+        Catalog * schema = table.second->get_schema();
+        hash = hash_string(hash, table.first.c_str());
+        for (UInt32 fid = 0; fid < schema->get_field_cnt(); fid ++) {
+            const uint64_t field_size = schema->get_field_size(fid);
+            hash = hash_string(hash, schema->get_field_name(fid));
+            hash = hash_bytes(hash, &field_size, sizeof(field_size));
+        }
+    }
+    for (auto & index : wl->indexes) {
+        hash = hash_string(hash, index.first.c_str());
+        hash = hash_string(hash, index.second->table->get_table_name());
+    }
+    return hash;
+}
+
+string TableSnapshot::get_path(uint64_t hash) {
+    char name[64];
+    snprintf(name, sizeof(name), "/deneva_%016lx.snap", hash);
+    return string(snapshot_dir) + name;
+}
+
+void TableSnapshot::run_parallel(void * (*func)(void *), snapshot_task * tasks) {
+    pthread_t * p_thds = new pthread_t[g_init_parallelism - 1];
+    for (UInt32 i = 0; i < g_init_parallelism - 1; i++) {
+        pthread_create(&p_thds[i], NULL, func, &tasks[i]);
+    }
+    func(&tasks[g_init_parallelism - 1]);
+    for (UInt32 i = 0; i < g_init_parallelism - 1; i++) {
+        int rc = pthread_join(p_thds[i], NULL);
+        if (rc) {
+            printf("ERROR; return code from pthread_join() is %d\n", rc);
+            exit(-1);
+        }
+    }
+    delete [] p_thds;
+}
+
+void * TableSnapshot::load_rows(void * arg) {
+    snapshot_task * task = (snapshot_task *) arg;
+    const uint64_t size = row_size(task->table->get_schema()->get_tuple_size());
+    for (uint64_t i = task->begin; i < task->end; i++) {
+        const snapshot_row * rec = (const snapshot_row *) (task->records + i * size);
+        row_t * row;
+        uint64_t row_id = i;
+        RC rc = task->table->get_new_row(row, rec->part_id, row_id);
+        assert(rc == RCOK);
+        row->set_primary_key(rec->primary_key);
+        row->set_data((char *) (rec + 1));
+        task->rows[i] = row;
+    }
+    return NULL;
+}
+
+void * TableSnapshot::load_entries(void * arg) {
+    snapshot_task * task = (snapshot_task *) arg;
+    const snapshot_entry * entries = (const snapshot_entry *) task->records;
+    IndexLoader loader(task->index);
+    for (uint64_t i = task->begin; i < task->end; i++) {
+        loader.load(entries[i].key, task->rows[entries[i].row_idx], entries[i].part_id);
+    }
+    loader.flush();
+    return NULL;
+}
+
+bool TableSnapshot::load(Workload * wl) {
+    if (snapshot_dir == NULL) return false;
+    uint64_t start_time = get_sys_clock();
+    const string path = get_path(config_hash(wl));
+    FILE * file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        printf("No snapshot %s\n", path.c_str());
+        return false;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0 || (uint64_t) st.st_size < sizeof(snapshot_header)) {
+        fclose(file);
+        return false;
+    }
+    const uint64_t file_size = st.st_size;
+    // the rows copy their data out, the image is only read
+    char * image = (char *) mmap(NULL, file_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE,
+                                 fileno(file), 0);
+    fclose(file);
+    if (image == MAP_FAILED) return false;
+
+    // check the whole image before changing wl, so that a bad snapshot can still be regenerated
+    const snapshot_header * header = (const snapshot_header *) image;
+    bool valid = header->magic == SNAPSHOT_MAGIC && header->version == SNAPSHOT_VERSION &&
+                 header->config_hash == config_hash(wl) && header->file_size == file_size &&
+                 header->table_cnt == wl->tables.size() &&
+                 header->index_cnt == wl->indexes.size();
+    uint64_t pos = sizeof(snapshot_header);
+    auto take = [&](uint64_t size) -> const char * {
+        if (!valid || size > file_size - pos) {
+            valid = false;
+            return NULL;
+        }
+        pos += size;
+        return image + pos - size;
+    };
+    std::vector<const snapshot_table *> table_secs;
+    std::vector<const snapshot_index *> index_secs;
+    map<string, uint64_t> table_row_cnts;
+    for (uint64_t i = 0; valid && i < header->table_cnt; i++) {
+        const snapshot_table * sec = (const snapshot_table *) take(sizeof(snapshot_table));
+        if (sec == NULL) break;
+        auto table = wl->tables.find(string(sec->name, strnlen(sec->name, SNAPSHOT_NAME_LEN)));
+        valid = table != wl->tables.end() &&
+                sec->tuple_size == table->second->get_schema()->get_tuple_size() &&
+                sec->row_cnt <= file_size / row_size(sec->tuple_size);
+        take(sec->row_cnt * row_size(sec->tuple_size));
+        if (valid) table_row_cnts[table->first] = sec->row_cnt;
+        table_secs.push_back(sec);
+    }
+    for (uint64_t i = 0; valid && i < header->index_cnt; i++) {
+        const snapshot_index * sec = (const snapshot_index *) take(sizeof(snapshot_index));
+        if (sec == NULL) break;
+        auto index = wl->indexes.find(string(sec->name, strnlen(sec->name, SNAPSHOT_NAME_LEN)));
+        valid = index != wl->indexes.end() &&
+                !strncmp(sec->table_name, index->second->table->get_table_name(),
+                         SNAPSHOT_NAME_LEN) &&
+                sec->entry_cnt <= file_size / sizeof(snapshot_entry);
+        const snapshot_entry * entries =
+            (const snapshot_entry *) take(sec->entry_cnt * sizeof(snapshot_entry));
+        if (entries == NULL) break;
+        // the loaders index the rows of the table and the partitions with the entries unchecked
+        auto row_cnt = table_row_cnts.find(index->second->table->get_table_name());
+        valid = row_cnt != table_row_cnts.end();
+        for (uint64_t j = 0; valid && j < sec->entry_cnt; j++) {
+            valid = entries[j].row_idx < row_cnt->second && entries[j].part_id < g_part_cnt;
+        }
+        index_secs.push_back(sec);
+    }
+    if (!valid || pos != file_size) {
+        printf("Snapshot %s does not match the configuration, ignored\n", path.c_str());
+        munmap(image, file_size);
+        return false;
+    }
+
+    snapshot_task * tasks = new snapshot_task[g_init_parallelism];
+    map<string, row_t **> table_rows;
+    for (const snapshot_table * sec : table_secs) {
+        table_t * table = wl->tables[sec->name];
+        row_t ** rows = new row_t * [sec->row_cnt];
+        for (UInt32 i = 0; i < g_init_parallelism; i++) {
+            tasks[i].records = (const char *) (sec + 1);
+            tasks[i].begin = sec->row_cnt * i / g_init_parallelism;
+            tasks[i].end = sec->row_cnt * (i + 1) / g_init_parallelism;
+            tasks[i].table = table;
+            tasks[i].rows = rows;
+        }
+        run_parallel(load_rows, tasks);
+        table_rows[sec->name] = rows;
+    }
+    for (const snapshot_index * sec : index_secs) {
+        INDEX * index = wl->indexes[sec->name];
+        const snapshot_entry * entries = (const snapshot_entry *) (sec + 1);
+        row_t ** rows = table_rows[sec->table_name];
+        if (sec->nonunique) {
+            for (uint64_t i = 0; i < sec->entry_cnt; i++) {
+                itemid_t * m_item = (itemid_t *) mem_allocator.alloc(sizeof(itemid_t));
+                m_item->init();
+                m_item->type = DT_row;
+                m_item->location = rows[entries[i].row_idx];
+                m_item->valid = true;
+                index->index_insert_nonunique(entries[i].key, m_item, entries[i].part_id);
+            }
+            continue;
+        }
+        // the items of a key go to the same thread, the loaders then pass disjoint key ranges
+        uint64_t begin = 0;
+        for (UInt32 i = 0; i < g_init_parallelism; i++) {
+            uint64_t end = std::max(begin, sec->entry_cnt * (i + 1) / g_init_parallelism);
+            while (end > 0 && end < sec->entry_cnt && same_key(entries[end - 1], entries[end]))
+                end++;
+            tasks[i].records = (const char *) entries;
+            tasks[i].begin = begin;
+            tasks[i].end = end;
+            tasks[i].rows = rows;
+            tasks[i].index = index;
+            begin = end;
+        }
+        run_parallel(load_entries, tasks);
+        for (UInt32 part_id = 0; part_id < g_part_cnt; part_id ++)
+            index->index_load_finish(part_id);
+    }
+    for (auto & rows : table_rows) delete [] rows.second;
+    delete [] tasks;
+    munmap(image, file_size);
+    loaded = true;
+    printf("Loaded snapshot %s (%ld MB) in %f s\n", path.c_str(), file_size >> 20,
+           (float)(get_sys_clock() - start_time) / BILLION);
+    return true;
+}
+
+void TableSnapshot::save(Workload * wl) {
+    if (snapshot_dir == NULL) return;
+    uint64_t start_time = get_sys_clock();
+    const string path = get_path(config_hash(wl));
+    for (auto & table : wl->tables) {
+        if (table.first.size() >= SNAPSHOT_NAME_LEN) {
+            printf("Table name %s is too long for a snapshot\n", table.first.c_str());
+            return;
+        }
+    }
+    for (auto & index : wl->indexes) {
+        if (index.first.size() >= SNAPSHOT_NAME_LEN) {
+            printf("Index name %s is too long for a snapshot\n", index.first.c_str());
+            return;
+        }
+    }
+
+    // the rows of a table are all rows its indexes point to, numbered in address order
+    map<string, std::vector<snapshot_save_entry>> index_entries;
+    map<string, bool> index_nonunique;
+    map<string, std::vector<row_t *>> table_rows;
+    for (auto & index : wl->indexes) {
+        std::vector<snapshot_save_entry> & entries = index_entries[index.first];
+        std::vector<row_t *> & rows = table_rows[index.second->table->get_table_name()];
+        index.second->index_visit([&](idx_key_t key, itemid_t * item, int part_id) {
+            entries.push_back(snapshot_save_entry{key, (uint64_t) part_id, item});
+            rows.push_back((row_t *) item->location);
+        });
+        // keep the items of a key in insertion order
+        std::stable_sort(entries.begin(), entries.end(),
+                         [](const snapshot_save_entry & a, const snapshot_save_entry & b) {
+            return a.part_id < b.part_id || (a.part_id == b.part_id && a.key < b.key);
+        });
+        bool nonunique = false;
+        for (uint64_t i = 1; i < entries.size() && !nonunique; i++) {
+            // the items of a key are chained unless they were inserted with index_insert_nonunique
+            nonunique = entries[i].part_id == entries[i - 1].part_id &&
+                        entries[i].key == entries[i - 1].key &&
+                        entries[i].item->next != entries[i - 1].item;
+        }
+        index_nonunique[index.first] = nonunique;
+    }
+    for (auto & rows : table_rows) {
+        std::sort(rows.second.begin(), rows.second.end());
+        rows.second.erase(std::unique(rows.second.begin(), rows.second.end()), rows.second.end());
+        // the ids a load gives them, so that the log of this run can be replayed on the snapshot
+        for (uint64_t i = 0; i < rows.second.size(); i++) rows.second[i]->set_row_id(i);
+    }
+
+    snapshot_header header;
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.config_hash = config_hash(wl);
+    header.table_cnt = wl->tables.size();
+    header.index_cnt = wl->indexes.size();
+    header.file_size = sizeof(snapshot_header);
+    for (auto & table : wl->tables) {
+        header.file_size += sizeof(snapshot_table) + table_rows[table.first].size() *
+                            row_size(table.second->get_schema()->get_tuple_size());
+    }
+    for (auto & index : wl->indexes) {
+        header.file_size += sizeof(snapshot_index) +
+                            index_entries[index.first].size() * sizeof(snapshot_entry);
+    }
+
+    // write a temporary file and rename it, so a crash never leaves a partial snapshot behind
+    const string tmp_path = path + ".tmp";
+    FILE * file = fopen(tmp_path.c_str(), "wb");
+    if (file == NULL) {
+        printf("Cannot write snapshot %s\n", tmp_path.c_str());
+        return;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    const char padding[8] = {};
+    for (auto & table : wl->tables) {
+        const std::vector<row_t *> & rows = table_rows[table.first];
+        snapshot_table sec;
+        memset(&sec, 0, sizeof(sec));
+        strncpy(sec.name, table.first.c_str(), SNAPSHOT_NAME_LEN - 1);
+        sec.tuple_size = table.second->get_schema()->get_tuple_size();
+        sec.row_cnt = rows.size();
+        ok = ok && fwrite(&sec, sizeof(sec), 1, file) == 1;
+        const uint64_t pad_size = row_size(sec.tuple_size) - sizeof(snapshot_row) - sec.tuple_size;
+        for (uint64_t i = 0; ok && i < rows.size(); i++) {
+            snapshot_row rec;
+            rec.part_id = rows[i]->get_part_id();
+            rec.primary_key = rows[i]->get_primary_key();
+            ok = fwrite(&rec, sizeof(rec), 1, file) == 1 &&
+                 fwrite(rows[i]->get_data(), sec.tuple_size, 1, file) == 1 &&
+                 (pad_size == 0 || fwrite(padding, pad_size, 1, file) == 1);
+        }
+    }
+    for (auto & index : wl->indexes) {
+        const std::vector<snapshot_save_entry> & entries = index_entries[index.first];
+        const std::vector<row_t *> & rows = table_rows[index.second->table->get_table_name()];
+        snapshot_index sec;
+        memset(&sec, 0, sizeof(sec));
+        strncpy(sec.name, index.first.c_str(), SNAPSHOT_NAME_LEN - 1);
+        strncpy(sec.table_name, index.second->table->get_table_name(), SNAPSHOT_NAME_LEN - 1);
+        sec.entry_cnt = entries.size();
+        sec.nonunique = index_nonunique[index.first];
+        ok = ok && fwrite(&sec, sizeof(sec), 1, file) == 1;
+        for (uint64_t i = 0; ok && i < entries.size(); i++) {
+            snapshot_entry rec;
+            rec.key = entries[i].key;
+            rec.part_id = entries[i].part_id;
+            rec.row_idx = std::lower_bound(rows.begin(), rows.end(),
+                                           (row_t *) entries[i].item->location) - rows.begin();
+            ok = fwrite(&rec, sizeof(rec), 1, file) == 1;
+        }
+    }
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        printf("Cannot write snapshot %s\n", tmp_path.c_str());
+        unlink(tmp_path.c_str());
+        return;
+    }
+    printf("Saved snapshot %s (%ld MB) in %f s\n", path.c_str(), header.file_size >> 20,
+           (float)(get_sys_clock() - start_time) / BILLION);
+}
@@ -0,0 +1,87 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include "global.h"
+
+class Workload;
+struct snapshot_task;
+
+#define SNAPSHOT_MAGIC      0x50414e5341564e44ULL // "DNVASNAP"
+#define SNAPSHOT_VERSION    1 // bump when the file layout or the data generators change
+#define SNAPSHOT_NAME_LEN   48
+
+// Layout of a snapshot file. All records are 8-byte aligned.
+//   snapshot_header
+//   for each table: snapshot_table, row_cnt rows of snapshot_row followed by the row data padded to
+//                   a multiple of 8 bytes
+//   for each index: snapshot_index, entry_cnt snapshot_entry sorted by partition and key
+struct snapshot_header {
+    uint64_t magic;
+    uint64_t version;
+    // hash of the configuration and schema the data was generated with
+    uint64_t config_hash;
+    uint64_t table_cnt;
+    uint64_t index_cnt;
+    uint64_t file_size;
+};
+
+struct snapshot_table {
+    char name[SNAPSHOT_NAME_LEN];
+    uint64_t tuple_size;
+    uint64_t row_cnt;
+};
+
+struct snapshot_row {
+    uint64_t part_id;
+    uint64_t primary_key;
+};
+
+struct snapshot_index {
+    char name[SNAPSHOT_NAME_LEN];
+    char table_name[SNAPSHOT_NAME_LEN];
+    uint64_t entry_cnt;
+    // the items of a key have their own slots (index_insert_nonunique) rather than a chain
+    uint64_t nonunique;
+};
+
+struct snapshot_entry {
+    idx_key_t key;
+    uint64_t part_id;
+    uint64_t row_idx; // position of the row in its table's section
+};
+
+// Snapshot of the tables and indexes of a workload, so that runs with the same configuration
+// skip generating the data. A snapshot is written to snapshot_dir after init_table(), named after
+// the hash of the configuration. Later runs mmap it and rebuild the rows and indexes in parallel;
+// rows reference each other only by position, so nothing in the image needs fixing up.
+// Rows that no index points to (e.g. TPCC HISTORY) are not saved, nothing can read them anyway.
+// The id of a row is its position in its table's section, also in the run that saves it.
+class TableSnapshot {
+public:
+    // Load the snapshot for the current configuration into wl, whose indexes must be empty.
+    // Returns false if there is none, or it does not match, and wl is left unchanged.
+    static bool load(Workload * wl);
+    static void save(Workload * wl);
+    // whether the tables came from load()
+    static bool loaded;
+
+private:
+    static uint64_t config_hash(Workload * wl);
+    static string get_path(uint64_t hash);
+    static uint64_t row_size(uint64_t tuple_size) {
+        return sizeof(snapshot_row) + (tuple_size + 7) / 8 * 8;
+    }
+    static void run_parallel(void * (*func)(void *), snapshot_task * tasks);
+    static void * load_rows(void * task);
+    static void * load_entries(void * task);
+};
+
+#endif
@@ -275,6 +275,7 @@ void Transaction::init() {
     insert_rows.init(g_max_items_per_txn + 10);
     DEBUG_M("Transaction::reset array accesses\n");
     accesses.init(MAX_ROW_PER_TXN);
+    undo_log.init();
 
     reset(0);
 }
@@ -284,6 +285,7 @@ void Transaction::reset(uint64_t thd_id) {
     accesses.clear();
     //release_inserts(thd_id);
     insert_rows.clear();
+    undo_log.clear();
     write_cnt = 0;
     row_cnt = 0;
     twopc_state = START;
@@ -317,6 +319,7 @@ void Transaction::release(uint64_t thd_id) {
     release_inserts(thd_id);
     DEBUG_M("Transaction::release array insert_rows free\n")
     insert_rows.release();
+    undo_log.release();
 }
 
 void TxnManager::init(uint64_t thd_id, Workload * h_wl) {
@@ -375,6 +378,9 @@ void TxnManager::init(uint64_t thd_id, Workload * h_wl) {
     registed_ = false;
     txn_ready = true;
     twopl_wait_start = 0;
+    dl_wait_seq = 0;
+    dl_restart_cnt = 0;
+    dl_victim = false;
 
     txn_stats.init();
 }
@@ -390,6 +396,8 @@ void TxnManager::reset() {
     aborted = false;
     return_id = UINT64_MAX;
     twopl_wait_start = 0;
+    dl_restart_cnt++;
+    dl_victim = false;
 
     //ready = true;
 
@@ -457,6 +465,18 @@ void TxnManager::reset_query() {
 
 RC TxnManager::commit() {
     DEBUG("Commit %ld\n",get_txn_id());
+#if LOGGING
+    log_writes();
+    // The commit record goes in while the locks are held, so a transaction that read or wrote
+    // after this one also commits at a larger LSN. The worker holds the transaction until
+    // commit() returns, so LOG_FLUSHED cannot overtake it.
+    LogRecord * record = logger.createRecord(get_txn_id(),L_NOTIFY,0,0);
+    if(g_repl_cnt > 0) {
+        msg_queue.enqueue(get_thd_id(), Message::create_message(record, LOG_MSG),
+                                            g_node_id + g_node_cnt + g_client_node_cnt);
+    }
+    logger.enqueueRecord(get_thd_id(), record);
+#endif
     release_locks(RCOK);
 #if CC_ALG == MAAT
     time_table.release(get_thd_id(),get_txn_id());
@@ -471,12 +491,6 @@ RC TxnManager::commit() {
 #endif
     commit_stats();
 #if LOGGING
-    LogRecord * record = logger.createRecord(get_txn_id(),L_NOTIFY,0,0);
-    if(g_repl_cnt > 0) {
-        msg_queue.enqueue(get_thd_id(), Message::create_message(record, LOG_MSG),
-                                            g_node_id + g_node_cnt + g_client_node_cnt);
-    }
-    logger.enqueueRecord(record);
     return WAIT;
 #endif
     return Commit;
@@ -819,32 +833,19 @@ void TxnManager::cleanup_row(RC rc, uint64_t rid) {
 #if CC_ALG != CALVIN
 #if ISOLATION_LEVEL != READ_UNCOMMITTED
     row_t * orig_r = txn->accesses[rid]->orig_row;
-    if (ROLL_BACK && type == XP &&
-            (CC_ALG == DL_DETECT || CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == HSTORE ||
-             CC_ALG == HSTORE_SPEC)) {
-        orig_r->return_row(rc,type, this, txn->accesses[rid]->orig_data);
-    } else {
 #if ISOLATION_LEVEL == READ_COMMITTED
-        if(type == WR) {
-            version = orig_r->return_row(rc, type, this, txn->accesses[rid]->data);
-        }
-#else
+    if(type == WR) {
         version = orig_r->return_row(rc, type, this, txn->accesses[rid]->data);
-#endif
     }
+#else
+    version = orig_r->return_row(rc, type, this, txn->accesses[rid]->data);
+#endif
 #endif
 
-#if ROLL_BACK && \
-        (CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || CC_ALG == HSTORE || CC_ALG == HSTORE_SPEC)
-    if (type == WR) {
-        //printf("free 10 %ld\n",get_txn_id());
-                txn->accesses[rid]->orig_data->free_row();
-        DEBUG_M("TxnManager::cleanup row_t free\n");
-        row_pool.put(get_thd_id(),txn->accesses[rid]->orig_data);
-        if(rc == RCOK) {
-            INC_STATS(get_thd_id(),record_write_cnt,1);
-            ++txn_stats.write_cnt;
-        }
+#if UNDO_LOG
+    if (type == WR && rc == RCOK) {
+        INC_STATS(get_thd_id(),record_write_cnt,1);
+        ++txn_stats.write_cnt;
     }
 #endif
 
@@ -899,6 +900,14 @@ void TxnManager::cleanup(RC rc) {
     // g_max_items_per_txn*2 + 3));
 
     DEBUG("Cleanup %ld %ld\n",get_txn_id(),row_cnt);
+#if UNDO_LOG
+    // the rows are restored before cleanup_row() releases their locks
+    if (rc == Abort) {
+        txn->undo_log.rollback();
+    } else {
+        txn->undo_log.clear();
+    }
+#endif
     for (int rid = row_cnt - 1; rid >= 0; rid --) {
         cleanup_row(rc,rid);
     }
@@ -1002,30 +1011,6 @@ RC TxnManager::get_row(row_t * row, access_t type, row_t *& row_rtn) {
     access->tid = last_tid;
 #endif
 
-#if ROLL_BACK && (CC_ALG == DL_DETECT || CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || \
-                                    CC_ALG == HSTORE || CC_ALG == HSTORE_SPEC)
-    if (type == WR) {
-
-    uint64_t part_id = row->get_part_id();
-    DEBUG_M("TxnManager::get_row row_t alloc\n")
-    row_pool.get(get_thd_id(),access->orig_data);
-    access->orig_data->init(row->get_table(), part_id, 0);
-    access->orig_data->copy(row);
-    assert(access->orig_data->get_schema() == row->get_schema());
-
-    // ARIES-style physiological logging
-#if LOGGING
-        LogRecord *record = logger.createRecord(
-                get_txn_id(), L_UPDATE, row->get_table()->get_table_id(), row->get_primary_key());
-        if(g_repl_cnt > 0) {
-            msg_queue.enqueue(get_thd_id(), Message::create_message(record, LOG_MSG),
-                                                g_node_id + g_node_cnt + g_client_node_cnt);
-        }
-        logger.enqueueRecord(record);
-#endif
-    }
-#endif
-
 #if CC_ALG == SUNDIAL
     if (!isexist) {
         ++txn->row_cnt;
@@ -1062,16 +1047,6 @@ RC TxnManager::get_row_post_wait(row_t *& row_rtn) {
 
     access->type = type;
     access->orig_row = row;
-#if ROLL_BACK && (CC_ALG == DL_DETECT || CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE)
-    if (type == WR) {
-        uint64_t part_id = row->get_part_id();
-        DEBUG_M("TxnManager::get_row_post_wait row_t alloc\n")
-        row_pool.get(get_thd_id(),access->orig_data);
-        access->orig_data->init(row->get_table(), part_id, 0);
-        access->orig_data->copy(row);
-    }
-#endif
-
     ++txn->row_cnt;
     if (type == WR) ++txn->write_cnt;
     txn->accesses.add(access);
@@ -1082,6 +1057,36 @@ RC TxnManager::get_row_post_wait(row_t *& row_rtn) {
     return RCOK;
 }
 
+#if LOGGING
+// ARIES-style physiological logging of the rows the transaction writes, as they are before
+// release_locks() installs them. The records of the writers of a row are in the order they
+// install it, so replaying them by LSN leaves the last write.
+void TxnManager::log_writes() {
+    for (uint64_t rid = 0; rid < txn->accesses.get_count(); rid++) {
+        Access * access = txn->accesses[rid];
+        if (access->type != WR) continue;
+        row_t * row = access->orig_row;
+        LogRecord * record = logger.createRecord(get_txn_id(), L_UPDATE,
+                                                 row->get_table()->get_table_id(),
+                                                 row->get_row_id());
+        if(g_repl_cnt > 0) {
+            msg_queue.enqueue(get_thd_id(), Message::create_message(record, LOG_MSG),
+                                                g_node_id + g_node_cnt + g_client_node_cnt);
+        }
+        record->rcd.image = access->data->get_data();
+        record->rcd.image_size = row->get_tuple_size();
+        logger.enqueueRecord(get_thd_id(), record);
+    }
+}
+#endif
+
+void TxnManager::log_undo(row_t * row, uint32_t offset, uint32_t size) {
+#if UNDO_LOG
+    txn->undo_log.add(row, offset, size);
+    INC_STATS(get_thd_id(), undo_log_bytes, size);
+#endif
+}
+
 // This function is useless
 void TxnManager::insert_row(row_t * row, table_t * table) {
     if (CC_ALG == HSTORE || CC_ALG == HSTORE_SPEC) return;
@@ -30,6 +30,8 @@
 #include "helper.h"
 #include "semaphore.h"
 #include "array.h"
+#include "row.h"
+#include "undo_log.h"
 #include "transport/message.h"
 #include "../concurrency_control/unified_util.h"
 //#include "wl.h"
@@ -53,7 +55,6 @@ public:
     access_t     type;
     row_t *     orig_row;
     row_t *     data;
-    row_t *     orig_data;
     uint64_t version;
 #if CC_ALG == SUNDIAL
     uint64_t    orig_wts;
@@ -86,6 +87,7 @@ public:
     // Internal state
     TxnState twopc_state;
     Array<row_t*> insert_rows;
+    UndoLog undo_log;
     txnid_t         txn_id;
     uint64_t batch_id;
     RC rc;
@@ -199,6 +201,14 @@ public:
     row_t * volatile cur_row;
     // [DL_DETECT, NO_WAIT, WAIT_DIE]
     int volatile   lock_ready;
+    // [DL_DETECT] the number of the current or last wait for a lock, bumped in Row_lock::lock_get
+    // when a wait starts; the events of a wait and lock_abort() carry it
+    uint64_t volatile dl_wait_seq;
+    // [DL_DETECT] the number of restarts, bumped in reset(). The transaction keeps its txn_id, and
+    // the waits-for graph tells its runs apart by this.
+    uint64_t dl_restart_cnt;
+    // [DL_DETECT] set when the deadlock detector aborts the txn while it waits
+    bool volatile dl_victim;
     // [TIMESTAMP, MVCC]
     bool volatile   ts_ready;
     // [HSTORE, HSTORE_SPEC]
@@ -314,6 +324,17 @@ protected:
     RC get_lock(row_t * row, access_t type);
     RC get_row(row_t * row, access_t type, row_t *& row_rtn);
     RC get_row_post_wait(row_t *& row_rtn);
+    // Write a field of a row got with WR. With UNDO_LOG the row is written in place, so the old
+    // value is logged first; writes that bypass write_field() must call log_undo() themselves.
+    template <typename F>
+    void write_field(row_t * row, typename F::type value) {
+        log_undo(row, F::offset, F::size);
+        row->set_field<F>(value);
+    }
+    void log_undo(row_t * row, uint32_t offset, uint32_t size);
+#if LOGGING
+    void log_writes();
+#endif
 
     // For Waiting
     row_t * last_row;
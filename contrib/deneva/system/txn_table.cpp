@@ -29,115 +29,227 @@
 #include "ycsb.h"
 #include "ycsb_query.h"
 
+static __thread txn_epoch * tl_epoch = NULL;
+
+static bool is_removed(txn_node_t t_node) { return (uint64_t) t_node & 1; }
+static txn_node_t removed(txn_node_t t_node) { return (txn_node_t) ((uint64_t) t_node | 1); }
+static txn_node_t unmarked(txn_node_t t_node) { return (txn_node_t) ((uint64_t) t_node & ~1UL); }
+
+static uint64_t key_batch_id(uint64_t batch_id) {
+#if CC_ALG == CALVIN
+    return batch_id;
+#else
+    return 0;
+#endif
+}
+
+static bool key_less(txn_node_t t_node, uint64_t txn_id, uint64_t batch_id) {
+    return t_node->txn_id < txn_id || (t_node->txn_id == txn_id && t_node->batch_id < batch_id);
+}
+
+static void lower_min_ts(txn_node_t t_node, uint64_t ts) {
+    uint64_t min_ts = t_node->min_ts;
+    while (ts < min_ts && !ATOM_CAS(t_node->min_ts, min_ts, ts)) min_ts = t_node->min_ts;
+}
+
 void TxnTable::init() {
     //pool_size = g_inflight_max * g_node_cnt * 2 + 1;
     pool_size = g_inflight_max + 1;
-    DEBUG_M("TxnTable::init pool_node alloc\n");
-    pool = (pool_node **) mem_allocator.align_alloc(sizeof(pool_node*) * pool_size);
-    for(uint32_t i = 0; i < pool_size;i++) {
-        pool[i] = (pool_node *) mem_allocator.align_alloc(sizeof(struct pool_node));
-        pool[i]->head = NULL;
-        pool[i]->tail = NULL;
-        pool[i]->cnt = 0;
-        pool[i]->modify = false;
-        pool[i]->min_ts = UINT64_MAX;
+    DEBUG_M("TxnTable::init pool alloc\n");
+    pool = (txn_node_t volatile *) mem_allocator.align_alloc(sizeof(txn_node_t) * pool_size);
+    for(uint64_t i = 0; i < pool_size;i++) {
+        pool[i] = NULL;
+    }
+    uint64_t occupied_size = (pool_size + 63) / 64;
+    occupied = (uint64_t *) mem_allocator.align_alloc(sizeof(uint64_t) * occupied_size);
+    for(uint64_t i = 0; i < occupied_size;i++) {
+        occupied[i] = 0;
+    }
+
+    // every thread of the node and the main thread
+    global_epoch = 0;
+    epoch_cnt = 0;
+    epoch_size = g_total_thread_cnt + 1;
+    epochs = (txn_epoch *) mem_allocator.align_alloc(sizeof(txn_epoch) * epoch_size);
+    for(uint64_t i = 0; i < epoch_size;i++) {
+        epochs[i].epoch = UINT64_MAX;
+        epochs[i].limbo = NULL;
+        epochs[i].limbo_cnt = 0;
+    }
+}
+
+txn_epoch * TxnTable::enter() {
+    if (!tl_epoch) {
+        uint64_t id = ATOM_FETCH_ADD(epoch_cnt, 1);
+        M_ASSERT_V(id < epoch_size, "TxnTable used by more than %ld threads\n", epoch_size);
+        tl_epoch = &epochs[id];
+    }
+    tl_epoch->epoch = global_epoch;
+    // announce the epoch before reading any node
+    __sync_synchronize();
+    return tl_epoch;
+}
+
+void TxnTable::leave(txn_epoch * e) {
+    __sync_synchronize();
+    e->epoch = UINT64_MAX;
+}
+
+void TxnTable::retire(uint64_t thd_id, txn_node_t t_node) {
+    txn_epoch * e = tl_epoch;
+    t_node->retire_epoch = global_epoch;
+    t_node->retire_next = e->limbo;
+    e->limbo = t_node;
+    if (++e->limbo_cnt >= TXN_TABLE_RETIRE_BATCH) reclaim(thd_id, e);
+}
+
+void TxnTable::reclaim(uint64_t thd_id, txn_epoch * e) {
+    // the epoch moves on once every thread in the table has seen it
+    uint64_t epoch = global_epoch;
+    bool advance = true;
+    uint64_t cnt = std::min((uint64_t) epoch_cnt, epoch_size);
+    for (uint64_t i = 0; i < cnt && advance; i++) {
+        uint64_t thd_epoch = epochs[i].epoch;
+        if (thd_epoch != UINT64_MAX && thd_epoch != epoch) advance = false;
+    }
+    if (advance) ATOM_CAS(global_epoch, epoch, epoch + 1);
+
+    // A node retired in epoch e was unlinked before any thread announced e + 1, and all threads
+    // that announced e or earlier have left once the epoch is e + 2.
+    epoch = global_epoch;
+    txn_node_t * link = &e->limbo;
+    while (*link != NULL) {
+        txn_node_t t_node = *link;
+        if (t_node->retire_epoch + 2 <= epoch) {
+            *link = t_node->retire_next;
+            e->limbo_cnt--;
+            txn_table_pool.put(thd_id, t_node);
+        } else {
+            link = &t_node->retire_next;
+        }
     }
 }
 
 void TxnTable::dump() {
+    txn_epoch * e = enter();
     for(uint64_t i = 0; i < pool_size;i++) {
-        if (pool[i]->cnt == 0) continue;
-        txn_node_t t_node = pool[i]->head;
+        for (txn_node_t t_node = pool[i]; t_node != NULL; t_node = unmarked(t_node->next)) {
+            if (is_removed(t_node->next)) continue;
+            printf("TT (%ld,%ld)\n", t_node->txn_id, t_node->batch_id);
+        }
+    }
+    leave(e);
+}
 
-        while (t_node != NULL) {
-            printf("TT (%ld,%ld)\n", t_node->txn_man->get_txn_id(), t_node->txn_man->get_batch_id());
-                t_node = t_node->next;
+// Position of (txn_id, batch_id) in its bucket: cur is the first node that is not smaller, prev
+// the link to it. Removed nodes on the way are unlinked. cnt is the number of nodes passed.
+bool TxnTable::find(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id,
+                    txn_node_t volatile *& prev, txn_node_t & cur, uint64_t & cnt) {
+    uint64_t pool_id = txn_id % pool_size;
+retry:
+    cnt = 0;
+    prev = &pool[pool_id];
+    cur = *prev;
+    while (cur != NULL) {
+        txn_node_t next = cur->next;
+        if (is_removed(next)) {
+            if (!ATOM_CAS(*prev, cur, unmarked(next))) goto retry;
+            retire(thd_id, cur);
+            cur = unmarked(next);
+            continue;
         }
+        if (!key_less(cur, txn_id, batch_id)) {
+            return cur->txn_id == txn_id && cur->batch_id == batch_id;
+        }
+        cnt++;
+        prev = &cur->next;
+        cur = next;
     }
+    return false;
 }
 
-bool TxnTable::is_matching_txn_node(txn_node_t t_node, uint64_t txn_id, uint64_t batch_id){
-    assert(t_node);
-#if CC_ALG == CALVIN
-    return (t_node->txn_man->get_txn_id() == txn_id && t_node->txn_man->get_batch_id() == batch_id);
-#else
-    return (t_node->txn_man->get_txn_id() == txn_id);
-#endif
+txn_node_t TxnTable::lookup(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) {
+    txn_node_t volatile * prev;
+    txn_node_t cur;
+    uint64_t cnt;
+    return find(thd_id, txn_id, batch_id, prev, cur, cnt) ? cur : NULL;
 }
 
 void TxnTable::update_min_ts(uint64_t thd_id, uint64_t txn_id,uint64_t batch_id,uint64_t ts){
-    uint64_t pool_id = txn_id % pool_size;
-    while (!ATOM_CAS(pool[pool_id]->modify, false, true)) {
-    };
-    if (ts < pool[pool_id]->min_ts) pool[pool_id]->min_ts = ts;
-    ATOM_CAS(pool[pool_id]->modify,true,false);
+    txn_epoch * e = enter();
+    txn_node_t t_node = lookup(thd_id, txn_id, key_batch_id(batch_id));
+    if (t_node) lower_min_ts(t_node, ts);
+    leave(e);
 }
 
 TxnManager * TxnTable::get_transaction_manager(uint64_t thd_id, uint64_t txn_id,uint64_t batch_id){
     DEBUG("TxnTable::get_txn_manager %ld / %ld\n",txn_id,pool_size);
     uint64_t starttime = get_sys_clock();
     uint64_t pool_id = txn_id % pool_size;
+    batch_id = key_batch_id(batch_id);
+    txn_epoch * e = enter();
 
-    uint64_t mtx_starttime = starttime;
-    // set modify bit for this pool: txn_id % pool_size
-    while (!ATOM_CAS(pool[pool_id]->modify, false, true)) {
-    };
-    INC_STATS(thd_id,mtx[7],get_sys_clock()-mtx_starttime);
-
-    txn_node_t t_node = pool[pool_id]->head;
-    TxnManager * txn_man = NULL;
+    txn_node_t volatile * prev;
+    txn_node_t cur;
+    uint64_t cnt;
+    txn_node_t t_node = NULL;
+    // prepared node, if the transaction is not there yet
+    txn_node_t new_node = NULL;
 
     uint64_t prof_starttime = get_sys_clock();
-    while (t_node != NULL) {
-        if(is_matching_txn_node(t_node,txn_id,batch_id)) {
-            txn_man = t_node->txn_man;
+    while (true) {
+        if (find(thd_id, txn_id, batch_id, prev, cur, cnt)) {
+            t_node = cur;
             break;
         }
-        t_node = t_node->next;
-    }
-    INC_STATS(thd_id,mtx[20],get_sys_clock()-prof_starttime);
-
-
-    if(!txn_man) {
-        prof_starttime = get_sys_clock();
+        if (!new_node) {
+            INC_STATS(thd_id,mtx[20],get_sys_clock()-prof_starttime);
+            prof_starttime = get_sys_clock();
 
-        txn_table_pool.get(thd_id,t_node);
+            txn_table_pool.get(thd_id,new_node);
 
-        INC_STATS(thd_id,mtx[21],get_sys_clock()-prof_starttime);
-        prof_starttime = get_sys_clock();
+            INC_STATS(thd_id,mtx[21],get_sys_clock()-prof_starttime);
+            prof_starttime = get_sys_clock();
 
-        txn_man_pool.get(thd_id,txn_man);
+            txn_man_pool.get(thd_id,new_node->txn_man);
 
-        INC_STATS(thd_id,mtx[22],get_sys_clock()-prof_starttime);
-        prof_starttime = get_sys_clock();
+            INC_STATS(thd_id,mtx[22],get_sys_clock()-prof_starttime);
+            prof_starttime = get_sys_clock();
 
-        txn_man->set_txn_id(txn_id);
-        txn_man->set_batch_id(batch_id);
-        t_node->txn_man = txn_man;
-        txn_man->txn_stats.starttime = get_sys_clock();
-        txn_man->txn_stats.restart_starttime = txn_man->txn_stats.starttime;
-        LIST_PUT_TAIL(pool[pool_id]->head,pool[pool_id]->tail,t_node);
-
-        INC_STATS(thd_id,mtx[23],get_sys_clock()-prof_starttime);
-        prof_starttime = get_sys_clock();
-
-        ++pool[pool_id]->cnt;
-        if(pool[pool_id]->cnt > 1) {
-            INC_STATS(thd_id,txn_table_cflt_cnt,1);
-            INC_STATS(thd_id,txn_table_cflt_size,pool[pool_id]->cnt-1);
+            new_node->txn_man->set_txn_id(txn_id);
+            new_node->txn_man->set_batch_id(batch_id);
+            new_node->txn_man->txn_stats.starttime = get_sys_clock();
+            new_node->txn_man->txn_stats.restart_starttime =
+                new_node->txn_man->txn_stats.starttime;
+            new_node->txn_id = txn_id;
+            new_node->batch_id = batch_id;
+            new_node->min_ts = UINT64_MAX;
+        }
+        new_node->next = cur;
+        if (ATOM_CAS(*prev, cur, new_node)) {
+            t_node = new_node;
+            new_node = NULL;
+            // after linking, see get_min_ts
+            __sync_fetch_and_or(&occupied[pool_id / 64], 1UL << (pool_id % 64));
+            if(cnt > 0) {
+                INC_STATS(thd_id,txn_table_cflt_cnt,1);
+                INC_STATS(thd_id,txn_table_cflt_size,cnt);
+            }
+            INC_STATS(thd_id,txn_table_new_cnt,1);
+            break;
         }
-        INC_STATS(thd_id,txn_table_new_cnt,1);
-        INC_STATS(thd_id,mtx[24],get_sys_clock()-prof_starttime);
     }
+    if (new_node) {
+        // somebody else added the transaction first
+        txn_man_pool.put(thd_id,new_node->txn_man);
+        txn_table_pool.put(thd_id,new_node);
+    }
+    TxnManager * txn_man = t_node->txn_man;
 
 #if CC_ALG == MVCC
-    if(txn_man->get_timestamp() < pool[pool_id]->min_ts)
-        pool[pool_id]->min_ts = txn_man->get_timestamp();
+    lower_min_ts(t_node, txn_man->get_timestamp());
 #endif
-
-
-    // unset modify bit for this pool: txn_id % pool_size
-    ATOM_CAS(pool[pool_id]->modify,true,false);
+    leave(e);
 
     INC_STATS(thd_id,txn_table_get_time,get_sys_clock() - starttime);
     INC_STATS(thd_id,txn_table_get_cnt,1);
@@ -149,110 +261,89 @@ extern std::vector<Message*> DA_delayed_operations;
 #endif
 
 void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id,uint64_t batch_id){
-    uint64_t pool_id = txn_id % pool_size;
-    // set modify bit for this pool: txn_id % pool_size
-    while (!ATOM_CAS(pool[pool_id]->modify, false, true)) {
-    };
-
-    txn_node_t t_node = pool[pool_id]->head;
-
-    while (t_node != NULL) {
-        if(is_matching_txn_node(t_node,txn_id,batch_id)) {
+    txn_epoch * e = enter();
+    txn_node_t t_node = lookup(thd_id, txn_id, key_batch_id(batch_id));
+    if (t_node) {
 #if CC_ALG == CALVIN
-            work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RTXN),false);
+        work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RTXN),false);
 #elif WORKLOAD == DA
-            //TODO: if DA run distributedly, we need judge IS_LOCAL
-            DA_delayed_operations.push_back(Message::create_message(t_node->txn_man,RTXN_CONT));
+        //TODO: if DA run distributedly, we need judge IS_LOCAL
+        DA_delayed_operations.push_back(Message::create_message(t_node->txn_man,RTXN_CONT));
 #else
-            if(IS_LOCAL(txn_id))
-                work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RTXN_CONT),false);
-            else
-                work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RQRY_CONT),false);
+        if(IS_LOCAL(txn_id))
+            work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RTXN_CONT),false);
+        else
+            work_queue.enqueue(thd_id,Message::create_message(t_node->txn_man,RQRY_CONT),false);
 #endif
-            break;
-        }
-        t_node = t_node->next;
     }
-
-    // unset modify bit for this pool: txn_id % pool_size
-    ATOM_CAS(pool[pool_id]->modify,true,false);
-
+    leave(e);
 }
 
 void TxnTable::release_transaction_manager(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id){
     uint64_t starttime = get_sys_clock();
+    batch_id = key_batch_id(batch_id);
+    txn_epoch * e = enter();
 
-    uint64_t pool_id = txn_id % pool_size;
-    uint64_t mtx_starttime = starttime;
-    // set modify bit for this pool: txn_id % pool_size
-    while (!ATOM_CAS(pool[pool_id]->modify, false, true)) {
-    };
-    INC_STATS(thd_id,mtx[8],get_sys_clock()-mtx_starttime);
-
-    txn_node_t t_node = pool[pool_id]->head;
-
-#if CC_ALG == MVCC
-    uint64_t min_ts = UINT64_MAX;
-    txn_node_t saved_t_node = NULL;
-#endif
+    txn_node_t volatile * prev;
+    txn_node_t cur;
+    uint64_t cnt;
+    txn_node_t t_node = NULL;
 
     uint64_t prof_starttime = get_sys_clock();
-    while (t_node != NULL) {
-        if(is_matching_txn_node(t_node,txn_id,batch_id)) {
-            LIST_REMOVE_HT(t_node,pool[txn_id % pool_size]->head,pool[txn_id % pool_size]->tail);
-            --pool[pool_id]->cnt;
-#if CC_ALG == MVCC
-            saved_t_node = t_node;
-            t_node = t_node->next;
-            continue;
-#else
-            break;
-#endif
+    while (find(thd_id, txn_id, batch_id, prev, cur, cnt)) {
+        txn_node_t next = cur->next;
+        if (is_removed(next) || !ATOM_CAS(cur->next, next, removed(next))) continue;
+        t_node = cur;
+        // unlink it, or let find do it
+        if (ATOM_CAS(*prev, cur, next)) {
+            retire(thd_id, cur);
+        } else {
+            find(thd_id, txn_id, batch_id, prev, cur, cnt);
         }
-#if CC_ALG == MVCC
-        if (t_node->txn_man->get_timestamp() < min_ts) min_ts = t_node->txn_man->get_timestamp();
-#endif
-        t_node = t_node->next;
+        break;
     }
     INC_STATS(thd_id,mtx[25],get_sys_clock()-prof_starttime);
-    prof_starttime = get_sys_clock();
-
-#if CC_ALG == MVCC
-    t_node = saved_t_node;
-    pool[pool_id]->min_ts = min_ts;
-#endif
-
-    // unset modify bit for this pool: txn_id % pool_size
-    ATOM_CAS(pool[pool_id]->modify,true,false);
 
-    prof_starttime = get_sys_clock();
     assert(t_node);
     assert(t_node->txn_man);
+    // the node may go back to the pool as soon as we leave
+    TxnManager * txn_man = t_node->txn_man;
+    leave(e);
 
-    txn_man_pool.put(thd_id,t_node->txn_man);
-
-    INC_STATS(thd_id,mtx[26],get_sys_clock()-prof_starttime);
     prof_starttime = get_sys_clock();
-
-    txn_table_pool.put(thd_id,t_node);
-    INC_STATS(thd_id,mtx[27],get_sys_clock()-prof_starttime);
-
+    txn_man_pool.put(thd_id,txn_man);
+    INC_STATS(thd_id,mtx[26],get_sys_clock()-prof_starttime);
 
     INC_STATS(thd_id,txn_table_release_time,get_sys_clock() - starttime);
     INC_STATS(thd_id,txn_table_release_cnt,1);
-
 }
 
+// Smallest timestamp registered by an active transaction. Only the buckets marked occupied are
+// visited, and a bucket that turns out empty is unmarked.
 uint64_t TxnTable::get_min_ts(uint64_t thd_id) {
     uint64_t starttime = get_sys_clock();
     uint64_t min_ts = UINT64_MAX;
-    for(uint64_t i = 0 ; i < pool_size; i++) {
-        uint64_t pool_min_ts = pool[i]->min_ts;
-        if (pool_min_ts < min_ts) min_ts = pool_min_ts;
+    txn_epoch * e = enter();
+    for(uint64_t i = 0; i < (pool_size + 63) / 64; i++) {
+        uint64_t bits = occupied[i];
+        while (bits) {
+            uint64_t bit = __builtin_ctzll(bits);
+            bits &= bits - 1;
+            uint64_t pool_id = i * 64 + bit;
+            if (pool[pool_id] == NULL) {
+                // an insert sets the bit after linking its node, so look again after clearing it
+                __sync_fetch_and_and(&occupied[i], ~(1UL << bit));
+                if (pool[pool_id] == NULL) continue;
+                __sync_fetch_and_or(&occupied[i], 1UL << bit);
+            }
+            for (txn_node_t t_node = pool[pool_id]; t_node != NULL;
+                 t_node = unmarked(t_node->next)) {
+                if (t_node->min_ts < min_ts && !is_removed(t_node->next)) min_ts = t_node->min_ts;
+            }
+        }
     }
+    leave(e);
 
     INC_STATS(thd_id,txn_table_min_ts_time,get_sys_clock() - starttime);
     return min_ts;
-
 }
-
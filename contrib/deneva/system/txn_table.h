@@ -24,35 +24,48 @@ class TxnManager;
 class BaseQuery;
 class row_t;
 
+// Reclaim the removed nodes of a thread once it has this many, the tests reclaim on every removal
+#ifndef TXN_TABLE_RETIRE_BATCH
+#define TXN_TABLE_RETIRE_BATCH 64
+#endif
+
 struct txn_node {
     txn_node() {
         next = NULL;
-        prev = NULL;
     }
     ~txn_node() {}
     TxnManager * txn_man;
     uint64_t return_id; // Client ID or Home partition ID
     uint64_t client_startts; // For sequencer
     uint64_t abort_penalty;
-    txn_node * next;
-    txn_node * prev;
-
+    // the key, batch_id is always 0 unless CC_ALG is CALVIN
+    uint64_t txn_id;
+    uint64_t batch_id;
+    // lowest timestamp registered for the transaction, see get_min_ts
+    volatile uint64_t min_ts;
+    // the low bit is set once the node is removed
+    txn_node * volatile next;
+    // removed nodes wait on the limbo list of a thread until nobody can see them any more
+    txn_node * retire_next;
+    uint64_t retire_epoch;
 };
 
 typedef txn_node * txn_node_t;
 
-
-struct pool_node {
-public:
-    txn_node_t head;
-    txn_node_t tail;
-    volatile bool modify;
-    uint64_t cnt;
-    uint64_t min_ts;
-
+// Announced epoch of a thread that uses the table, UINT64_MAX outside of it
+struct txn_epoch {
+    volatile uint64_t epoch;
+    txn_node_t limbo;
+    uint64_t limbo_cnt;
+    char _pad[CL_SIZE - sizeof(uint64_t) * 2 - sizeof(txn_node_t)];
 };
-typedef pool_node * pool_node_t;
 
+/*
+   Lock-free hash map of the active transactions. Each bucket is a list sorted by
+   (txn_id, batch_id), where a node is first marked removed in its next pointer and then unlinked
+   (Harris and Michael). Readers do not lock anything, so a removed node goes back to
+   txn_table_pool only after every thread that was in the table at the time has left it.
+*/
 class TxnTable {
 public:
     void init();
@@ -64,12 +77,25 @@ public:
     uint64_t get_min_ts(uint64_t thd_id);
 
 private:
-    bool is_matching_txn_node(txn_node_t t_node, uint64_t txn_id, uint64_t batch_id);
+    bool find(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id, txn_node_t volatile *& prev,
+              txn_node_t & cur, uint64_t & cnt);
+    txn_node_t lookup(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id);
 
-    //  TxnMap pool;
-    uint64_t pool_size;
-    pool_node ** pool;
+    // epoch based reclamation
+    txn_epoch * enter();
+    void leave(txn_epoch * e);
+    void retire(uint64_t thd_id, txn_node_t t_node);
+    void reclaim(uint64_t thd_id, txn_epoch * e);
 
+    uint64_t pool_size;
+    txn_node_t volatile * pool;
+    // one bit per bucket that may be non-empty, so get_min_ts skips the empty ones
+    volatile uint64_t * occupied;
+
+    volatile uint64_t global_epoch;
+    volatile uint64_t epoch_cnt;
+    uint64_t epoch_size;
+    txn_epoch * epochs;
 };
 
 #endif
@@ -0,0 +1,59 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "undo_log.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "row.h"
+
+void UndoLog::init() {
+    buf = (char *) mem_allocator.alloc(UNDO_LOG_INIT_SIZE);
+    capacity = UNDO_LOG_INIT_SIZE;
+    clear();
+}
+
+void UndoLog::release() {
+    mem_allocator.free(buf, capacity);
+    buf = NULL;
+    capacity = 0;
+    clear();
+}
+
+void UndoLog::grow(uint64_t min_capacity) {
+    uint64_t new_capacity = capacity * 2;
+    while (new_capacity < min_capacity) new_capacity *= 2;
+    char * new_buf = (char *) mem_allocator.alloc(new_capacity);
+    memcpy(new_buf, buf, size);
+    mem_allocator.free(buf, capacity);
+    buf = new_buf;
+    capacity = new_capacity;
+}
+
+void UndoLog::add(row_t * row, uint32_t offset, uint32_t len) {
+    assert(offset + len <= (uint32_t) row->tuple_size);
+    uint64_t entry_size = sizeof(undo_entry) + (len + 7) / 8 * 8;
+    if (size + entry_size > capacity) grow(size + entry_size);
+    undo_entry * entry = (undo_entry *) &buf[size];
+    entry->row = row;
+    entry->offset = offset;
+    entry->size = len;
+    entry->prev = last;
+    memcpy(entry + 1, &row->data[offset], len);
+    last = size;
+    size += entry_size;
+}
+
+void UndoLog::rollback() {
+    // an older entry may cover the same bytes, so it has to be applied last
+    for (uint64_t pos = last; pos != UINT64_MAX;) {
+        undo_entry * entry = (undo_entry *) &buf[pos];
+        memcpy(&entry->row->data[entry->offset], entry + 1, entry->size);
+        pos = entry->prev;
+    }
+    clear();
+}
@@ -0,0 +1,59 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#ifndef _UNDO_LOG_H_
+#define _UNDO_LOG_H_
+
+#include "global.h"
+
+class row_t;
+
+// Initial size of the undo log of a transaction, in bytes. It doubles when full.
+#define UNDO_LOG_INIT_SIZE 4096
+
+// Lock-based CC with ROLL_BACK lets transactions write the rows they locked in place. Before a
+// write the old bytes of the written range go to the undo log of the transaction, and an abort
+// copies them back in reverse order while the rows are still locked.
+#define UNDO_LOG (ROLL_BACK && (CC_ALG == DL_DETECT || CC_ALG == NO_WAIT || CC_ALG == WAIT_DIE || \
+                                CC_ALG == HSTORE || CC_ALG == HSTORE_SPEC))
+
+struct undo_entry {
+    row_t * row;
+    uint32_t offset;
+    uint32_t size;
+    // position of the previous entry in the log, UINT64_MAX for the first one
+    uint64_t prev;
+};
+
+// Byte arena of undo_entry records, each followed by the old bytes padded to 8. Like Array it is
+// part of a pooled Transaction, so it has init()/release() instead of a constructor and keeps its
+// buffer across transactions.
+class UndoLog {
+public:
+    void init();
+    void release();
+    void clear() {
+        size = 0;
+        last = UINT64_MAX;
+    }
+    bool empty() { return size == 0; }
+
+    // Save the bytes [offset, offset + len) of row before they are overwritten.
+    void add(row_t * row, uint32_t offset, uint32_t len);
+    // Restore the saved bytes, newest first, and clear the log.
+    void rollback();
+
+private:
+    void grow(uint64_t min_capacity);
+    char * buf;
+    uint64_t size;
+    uint64_t capacity;
+    uint64_t last;
+};
+
+#endif
@@ -51,7 +51,10 @@ RC Workload::init_schema(const char * schema_file) {
             }
             cout<<"Has "<<lines.size()<<" column"<<endl;
 
-            schema->init( tname.c_str(), id++, lines.size() );
+            // the schema keeps the name, tname goes away with this iteration
+            char * table_name = new char [tname.length() + 1];
+            strcpy(table_name, tname.c_str());
+            schema->init( table_name, id++, lines.size() );
             for (UInt32 i = 0; i < lines.size(); i++) {
                 string line = lines[i];
                 vector<string> items;
@@ -189,3 +192,54 @@ void Workload::index_insert_nonunique(INDEX * index, uint64_t key, row_t * row,
     assert(index);
     assert( index->index_insert_nonunique(key, m_item, pid) == RCOK );
 }
+
+void Workload::check_layouts(const row_layout * layouts, uint64_t cnt) {
+    for (uint64_t i = 0; i < cnt; i++) {
+        auto it = tables.find(layouts[i].table_name);
+        M_ASSERT_V(it != tables.end() && it->second->get_schema()->match_layout(layouts[i]),
+                   "Table %s differs from benchmarks/schema_layout.h, run make to regenerate it\n",
+                   layouts[i].table_name);
+    }
+}
+
+void Workload::index_load_finish(INDEX * index) {
+    for (UInt32 part_id = 0; part_id < g_part_cnt; part_id ++)
+        assert( index->index_load_finish(part_id) == RCOK );
+}
+
+IndexLoader::IndexLoader(INDEX * index) : index(index) {
+    batches = new idx_entry * [g_part_cnt]();
+    batch_sizes = new uint64_t [g_part_cnt]();
+}
+
+IndexLoader::~IndexLoader() {
+    flush();
+    for (UInt32 part_id = 0; part_id < g_part_cnt; part_id ++) delete [] batches[part_id];
+    delete [] batches;
+    delete [] batch_sizes;
+}
+
+void IndexLoader::load(uint64_t key, row_t * row, int part_id) {
+    assert(part_id >= 0 && (UInt32) part_id < g_part_cnt);
+    itemid_t *m_item = (itemid_t *)mem_allocator.alloc(sizeof(itemid_t));
+    m_item->init();
+    m_item->type = DT_row;
+    m_item->location = row;
+    m_item->valid = true;
+
+    if (batches[part_id] == NULL) batches[part_id] = new idx_entry [INDEX_LOAD_BATCH_SIZE];
+    batches[part_id][batch_sizes[part_id]].key = key;
+    batches[part_id][batch_sizes[part_id]].item = m_item;
+    if (++batch_sizes[part_id] == INDEX_LOAD_BATCH_SIZE) load_batch(part_id);
+}
+
+void IndexLoader::flush() {
+    for (UInt32 part_id = 0; part_id < g_part_cnt; part_id ++) {
+        if (batch_sizes[part_id] > 0) load_batch(part_id);
+    }
+}
+
+void IndexLoader::load_batch(uint64_t part_id) {
+    assert( index->index_load(batches[part_id], batch_sizes[part_id], part_id) == RCOK );
+    batch_sizes[part_id] = 0;
+}
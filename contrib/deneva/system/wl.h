@@ -18,6 +18,7 @@
 #define _WORKLOAD_H_
 
 #include "global.h"
+#include "index_base.h"
 
 class row_t;
 class table_t;
@@ -30,6 +31,28 @@ class Thread;
 class index_base;
 class Timestamp;
 class Mvcc;
+struct row_layout;
+
+// Batch size of IndexLoader, in entries per partition.
+#define INDEX_LOAD_BATCH_SIZE 4096
+
+// Feeds the rows of one loader thread to INDEX::index_load() in per-partition batches. Between two
+// calls of flush() the keys of a partition must be ascending, and for the B-tree their range must
+// not overlap the keys other loaders pass to the same index and partition. After all loaders
+// flushed (the destructor flushes too), Workload::index_load_finish() makes the index readable.
+class IndexLoader
+{
+public:
+    IndexLoader(INDEX * index);
+    ~IndexLoader();
+    void load(uint64_t key, row_t * row, int part_id);
+    void flush();
+private:
+    void load_batch(uint64_t part_id);
+    INDEX * index;
+    idx_entry ** batches;
+    uint64_t * batch_sizes;
+};
 
 class Workload
 {
@@ -53,6 +76,12 @@ protected:
     void index_insert(string index_name, uint64_t key, row_t * row);
     void index_insert(INDEX * index, uint64_t key, row_t * row, int64_t part_id = -1);
     void index_insert_nonunique(INDEX * index, uint64_t key, row_t * row, int64_t part_id = -1);
+    void index_load_finish(INDEX * index);
+    // Fail if the tables read by init_schema() are not those of the compiled layouts, which the
+    // transactions access fields through.
+    template <size_t N>
+    void check_layouts(const row_layout (&layouts)[N]) { check_layouts(layouts, N); }
+    void check_layouts(const row_layout * layouts, uint64_t cnt);
 };
 
 #endif
@@ -29,24 +29,54 @@
 #include "client_query.h"
 #include <boost/lockfree/queue.hpp>
 
+void WorkerQueue::init(uint64_t capacity) {
+    buf = new Message * [capacity];
+    this->capacity = capacity;
+    head = 0;
+    tail = 0;
+    pthread_mutex_init(&mtx, NULL);
+}
+
+bool WorkerQueue::push(Message * msg) {
+    pthread_mutex_lock(&mtx);
+    bool success = tail - head < capacity;
+    if (success) {
+        buf[tail % capacity] = msg;
+        tail++;
+    }
+    pthread_mutex_unlock(&mtx);
+    return success;
+}
+
+Message * WorkerQueue::pop() {
+    // cheap check without the latch, so idle workers can probe the others while stealing
+    if (size() == 0) return NULL;
+    Message * msg = NULL;
+    pthread_mutex_lock(&mtx);
+    if (tail != head) {
+        msg = buf[head % capacity];
+        head++;
+    }
+    pthread_mutex_unlock(&mtx);
+    return msg;
+}
+
 void QWorkQueue::init() {
 
     last_sched_dq = NULL;
     sched_ptr = 0;
-#ifdef NEW_WORK_QUEUE
-    work_queue.set_capacity(QUEUE_CAPACITY_NEW);
-    new_txn_queue.set_capacity(QUEUE_CAPACITY_NEW);
-    sem_init(&mt, 0, 1);
-    sem_init(&mw, 0, 1);
-#else
+    work_queue = new WorkerQueue[g_thread_cnt];
+    new_txn_queue = new WorkerQueue[g_thread_cnt];
+    for (uint64_t i = 0; i < g_thread_cnt; i++) {
+        work_queue[i].init(WORK_QUEUE_CAPACITY);
+        new_txn_queue[i].init(WORK_QUEUE_CAPACITY);
+    }
+    new_txn_ptr = 0;
     seq_queue = new boost::lockfree::queue<work_queue_entry* > (0);
-    work_queue = new boost::lockfree::queue<work_queue_entry* > (0);
-    new_txn_queue = new boost::lockfree::queue<work_queue_entry* >(0);
     sched_queue = new boost::lockfree::queue<work_queue_entry* > * [g_node_cnt];
     for ( uint64_t i = 0; i < g_node_cnt; i++) {
         sched_queue[i] = new boost::lockfree::queue<work_queue_entry* > (0);
     }
-#endif
     txn_queue_size = 0;
     work_queue_size = 0;
 
@@ -54,16 +84,12 @@ void QWorkQueue::init() {
     work_dequeue_size = 0;
     txn_enqueue_size = 0;
     txn_dequeue_size = 0;
-
-    sem_init(&_semaphore, 0, 1);
-    top_element=NULL;
 }
 
 void QWorkQueue::sequencer_enqueue(uint64_t thd_id, Message * msg) {
     uint64_t starttime = get_sys_clock();
     assert(msg);
-    DEBUG_M("SeqQueue::enqueue work_queue_entry alloc\n");
-    work_queue_entry * entry = (work_queue_entry*)mem_allocator.align_alloc(sizeof(work_queue_entry));
+    work_queue_entry * entry = &msg->wq_entry;
     entry->msg = msg;
     entry->rtype = msg->rtype;
     entry->txn_id = msg->txn_id;
@@ -94,8 +120,6 @@ Message * QWorkQueue::sequencer_dequeue(uint64_t thd_id) {
         uint64_t queue_time = get_sys_clock() - entry->starttime;
         INC_STATS(thd_id,seq_queue_wait_time,queue_time);
         INC_STATS(thd_id,seq_queue_cnt,1);
-        DEBUG_M("SeqQueue::dequeue work_queue_entry free\n");
-        mem_allocator.free(entry,sizeof(work_queue_entry));
         INC_STATS(thd_id,seq_queue_dequeue_time,get_sys_clock() - starttime);
     }
 
@@ -109,8 +133,7 @@ void QWorkQueue::sched_enqueue(uint64_t thd_id, Message * msg) {
     assert(ISSERVERN(msg->return_node_id));
     uint64_t starttime = get_sys_clock();
 
-    DEBUG_M("QWorkQueue::sched_enqueue work_queue_entry alloc\n");
-    work_queue_entry * entry = (work_queue_entry*)mem_allocator.alloc(sizeof(work_queue_entry));
+    work_queue_entry * entry = &msg->wq_entry;
     entry->msg = msg;
     entry->rtype = msg->rtype;
     entry->txn_id = msg->txn_id;
@@ -144,9 +167,6 @@ Message * QWorkQueue::sched_dequeue(uint64_t thd_id) {
         INC_STATS(thd_id,sched_queue_wait_time,queue_time);
         INC_STATS(thd_id,sched_queue_cnt,1);
 
-        DEBUG_M("QWorkQueue::sched_enqueue work_queue_entry free\n");
-        mem_allocator.free(entry,sizeof(work_queue_entry));
-
         if(msg->rtype == RDONE) {
             // Advance to next queue or next epoch
             DEBUG("Sched RDONE %ld %ld\n",sched_ptr,simulation->get_worker_epoch());
@@ -173,207 +193,28 @@ Message * QWorkQueue::sched_dequeue(uint64_t thd_id) {
     return msg;
 }
 
-
-#ifdef NEW_WORK_QUEUE
-void QWorkQueue::enqueue(uint64_t thd_id, Message * msg,bool busy) {
-    uint64_t starttime = get_sys_clock();
-    assert(msg);
-    DEBUG_M("QWorkQueue::enqueue work_queue_entry alloc\n");
-    work_queue_entry * entry = (work_queue_entry*)mem_allocator.align_alloc(sizeof(work_queue_entry));
-    entry->msg = msg;
-    entry->rtype = msg->rtype;
-    entry->txn_id = msg->txn_id;
-    entry->batch_id = msg->batch_id;
-    entry->starttime = get_sys_clock();
-    assert(ISSERVER || ISREPLICA);
-    DEBUG("Work Enqueue (%ld,%ld) %d\n",entry->txn_id,entry->batch_id,entry->rtype);
-
-    uint64_t mtx_wait_starttime = get_sys_clock();
-    if(msg->rtype == CL_QRY) {
-        sem_wait(&mt);
-        new_txn_queue.push_back(entry);
-        sem_post(&mt);
-
-        sem_wait(&_semaphore);
-        txn_queue_size ++;
-        txn_enqueue_size ++;
-        sem_post(&_semaphore);
-    } else {
-        sem_wait(&mw);
-        work_queue.push_back(entry);
-        sem_post(&mw);
-
-        sem_wait(&_semaphore);
-        work_queue_size ++;
-        work_enqueue_size ++;
-        sem_post(&_semaphore);
-    }
-    INC_STATS(thd_id,mtx[13],get_sys_clock() - mtx_wait_starttime);
-
-    if(busy) {
-        INC_STATS(thd_id,work_queue_conflict_cnt,1);
-    }
-    INC_STATS(thd_id,work_queue_enqueue_time,get_sys_clock() - starttime);
-    INC_STATS(thd_id,work_queue_enq_cnt,1);
-}
-
-Message * QWorkQueue::dequeue(uint64_t thd_id) {
-    uint64_t starttime = get_sys_clock();
-    assert(ISSERVER || ISREPLICA);
-    Message * msg = NULL;
-    work_queue_entry * entry = NULL;
-    uint64_t mtx_wait_starttime = get_sys_clock();
-    bool valid = false;
-
-    sem_wait(&mw);
-    valid = work_queue.size() > 0;
-    if (valid) {
-        entry = work_queue[0];
-        work_queue.pop_front();
-    }
-    sem_post(&mw);
-
-    if(!valid) {
-#if SERVER_GENERATE_QUERIES
-        if(ISSERVER) {
-            BaseQuery * m_query = client_query_queue.get_next_query(thd_id,thd_id);
-            if(m_query) {
-                assert(m_query);
-                msg = Message::create_message((BaseQuery*)m_query,CL_QRY);
-            }
-        }
-#else
-        sem_wait(&mt);
-        valid = new_txn_queue.size() > 0;
-        if (valid) {
-            entry = new_txn_queue[0];
-            new_txn_queue.pop_front();
-        }
-        sem_post(&mt);
-
-#endif
-    }
-    INC_STATS(thd_id,mtx[14],get_sys_clock() - mtx_wait_starttime);
-
-    if(valid) {
-        msg = entry->msg;
-        assert(msg);
-
-        uint64_t queue_time = get_sys_clock() - entry->starttime;
-        INC_STATS(thd_id,work_queue_wait_time,queue_time);
-        INC_STATS(thd_id,work_queue_cnt,1);
-        if(msg->rtype == CL_QRY) {
-            sem_wait(&_semaphore);
-            txn_queue_size --;
-            txn_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_new_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_new_cnt,1);
-        } else {
-            sem_wait(&_semaphore);
-            work_queue_size --;
-            work_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_old_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_old_cnt,1);
-        }
-        msg->wq_time = queue_time;
-
-        DEBUG("Work Dequeue (%ld,%ld)\n",entry->txn_id,entry->batch_id);
-        DEBUG_M("QWorkQueue::dequeue work_queue_entry free\n");
-
-        INC_STATS(thd_id,work_queue_dequeue_time,get_sys_clock() - starttime);
-    }
-
-#if SERVER_GENERATE_QUERIES
-    if(msg && msg->rtype == CL_QRY) {
-        INC_STATS(thd_id,work_queue_new_wait_time,get_sys_clock() - starttime);
-        INC_STATS(thd_id,work_queue_new_cnt,1);
+void QWorkQueue::push(uint64_t owner, WorkerQueue * queues, Message * msg, bool spill) {
+    // A full queue of new transactions spills over to the next worker, who is as good a thief as
+    // any. A continuation waits for room instead, as one that went to another queue could be
+    // taken after a later message of its transaction.
+    for (uint64_t i = owner; !queues[i].push(msg); i = spill ? (i + 1) % g_thread_cnt : i) {
+        if (simulation->is_done()) return;
     }
-#endif
-    return msg;
 }
 
-//elioyan TODO
-Message * QWorkQueue::queuetop(uint64_t thd_id)
-{
-    uint64_t starttime = get_sys_clock();
-    assert(ISSERVER || ISREPLICA);
-    Message * msg = NULL;
-    work_queue_entry * entry = NULL;
-    uint64_t mtx_wait_starttime = get_sys_clock();
-    bool valid = false;
-    sem_wait(&mw);
-    valid = work_queue.size() > 0;
-    if (valid) {
-        entry = work_queue[0];
-        work_queue.pop_front();
-    }
-    sem_post(&mw);
-    if(!valid) {
-#if SERVER_GENERATE_QUERIES
-        if(ISSERVER) {
-            BaseQuery * m_query = client_query_queue.get_next_query(thd_id,thd_id);
-            if(m_query) {
-                assert(m_query);
-                msg = Message::create_message((BaseQuery*)m_query,CL_QRY);
-            }
-        }
-#else
-        sem_wait(&mt);
-        valid = new_txn_queue.size() > 0;
-        if (valid) {
-            entry = new_txn_queue[0];
-            new_txn_queue.pop_front();
-        }
-        sem_post(&mt);
-#endif
-    }
-    INC_STATS(thd_id,mtx[14],get_sys_clock() - mtx_wait_starttime);
-
-    if(valid) {
-        msg = entry->msg;
-        assert(msg);
-        uint64_t queue_time = get_sys_clock() - entry->starttime;
-        INC_STATS(thd_id,work_queue_wait_time,queue_time);
-        INC_STATS(thd_id,work_queue_cnt,1);
-        if(msg->rtype == CL_QRY) {
-            sem_wait(&_semaphore);
-            txn_queue_size --;
-            txn_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_new_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_new_cnt,1);
-        } else {
-            sem_wait(&_semaphore);
-            work_queue_size --;
-            work_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_old_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_old_cnt,1);
-        }
-        msg->wq_time = queue_time;
-        DEBUG("Work Dequeue (%ld,%ld)\n",entry->txn_id,entry->batch_id);
-        DEBUG_M("QWorkQueue::dequeue work_queue_entry free\n");
-        mem_allocator.free(entry,sizeof(work_queue_entry));
-        INC_STATS(thd_id,work_queue_dequeue_time,get_sys_clock() - starttime);
-    }
-
-#if SERVER_GENERATE_QUERIES
-    if(msg && msg->rtype == CL_QRY) {
-        INC_STATS(thd_id,work_queue_new_wait_time,get_sys_clock() - starttime);
-        INC_STATS(thd_id,work_queue_new_cnt,1);
+Message * QWorkQueue::pop(uint64_t thd_id, WorkerQueue * queues) {
+    Message * msg = queues[thd_id].pop();
+    for (uint64_t i = 1; !msg && i < g_thread_cnt; i++) {
+        msg = queues[(thd_id + i) % g_thread_cnt].pop();
+        if (msg) INC_STATS(thd_id,work_queue_steal_cnt,1);
     }
-#endif
     return msg;
 }
 
-#else
 void QWorkQueue::enqueue(uint64_t thd_id, Message * msg,bool busy) {
     uint64_t starttime = get_sys_clock();
     assert(msg);
-    DEBUG_M("QWorkQueue::enqueue work_queue_entry alloc\n");
-    work_queue_entry * entry = (work_queue_entry*)mem_allocator.align_alloc(sizeof(work_queue_entry));
+    work_queue_entry * entry = &msg->wq_entry;
     entry->msg = msg;
     entry->rtype = msg->rtype;
     entry->txn_id = msg->txn_id;
@@ -384,19 +225,14 @@ void QWorkQueue::enqueue(uint64_t thd_id, Message * msg,bool busy) {
 
     uint64_t mtx_wait_starttime = get_sys_clock();
     if(msg->rtype == CL_QRY) {
-        while (!new_txn_queue->push(entry) && !simulation->is_done()) {
-        }
-        sem_wait(&_semaphore);
-        txn_queue_size ++;
-        txn_enqueue_size ++;
-        sem_post(&_semaphore);
+        push(ATOM_FETCH_ADD(new_txn_ptr, 1) % g_thread_cnt, new_txn_queue, msg, true);
+        ATOM_ADD(txn_queue_size, 1);
+        ATOM_ADD(txn_enqueue_size, 1);
     } else {
-        while (!work_queue->push(entry) && !simulation->is_done()) {
-        }
-        sem_wait(&_semaphore);
-        work_queue_size ++;
-        work_enqueue_size ++;
-        sem_post(&_semaphore);
+        // the transaction is owned by the worker that generated its id
+        push((msg->txn_id / g_node_cnt) % g_thread_cnt, work_queue, msg, false);
+        ATOM_ADD(work_queue_size, 1);
+        ATOM_ADD(work_enqueue_size, 1);
     }
     INC_STATS(thd_id,mtx[13],get_sys_clock() - mtx_wait_starttime);
 
@@ -410,81 +246,12 @@ void QWorkQueue::enqueue(uint64_t thd_id, Message * msg,bool busy) {
 Message * QWorkQueue::dequeue(uint64_t thd_id) {
     uint64_t starttime = get_sys_clock();
     assert(ISSERVER || ISREPLICA);
-    Message * msg = NULL;
-    work_queue_entry * entry = NULL;
+    assert(thd_id < g_thread_cnt);
     uint64_t mtx_wait_starttime = get_sys_clock();
-    bool valid = false;
-
-    double x = (double)(rand() % 10000) / 10000;
-    if (x > TXN_QUEUE_PERCENT)
-        valid = work_queue->pop(entry);
-    else
-        valid = new_txn_queue->pop(entry);
-    if(!valid) {
-#if SERVER_GENERATE_QUERIES
-        if(ISSERVER) {
-            BaseQuery * m_query = client_query_queue.get_next_query(thd_id,thd_id);
-            if(m_query) {
-                assert(m_query);
-                msg = Message::create_message((BaseQuery*)m_query,CL_QRY);
-            }
-        }
-#else
-        if (x > TXN_QUEUE_PERCENT)
-            valid = new_txn_queue->pop(entry);
-        else
-            valid = work_queue->pop(entry);
-#endif
-    }
-    INC_STATS(thd_id,mtx[14],get_sys_clock() - mtx_wait_starttime);
-
-    if(valid) {
-        msg = entry->msg;
-        assert(msg);
-        uint64_t queue_time = get_sys_clock() - entry->starttime;
-        INC_STATS(thd_id,work_queue_wait_time,queue_time);
-        INC_STATS(thd_id,work_queue_cnt,1);
-        if(msg->rtype == CL_QRY) {
-            sem_wait(&_semaphore);
-            txn_queue_size --;
-            txn_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_new_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_new_cnt,1);
-        } else {
-            sem_wait(&_semaphore);
-            txn_queue_size --;
-            txn_dequeue_size ++;
-            sem_post(&_semaphore);
-            INC_STATS(thd_id,work_queue_old_wait_time,queue_time);
-            INC_STATS(thd_id,work_queue_old_cnt,1);
-        }
-        msg->wq_time = queue_time;
-        DEBUG("Work Dequeue (%ld,%ld)\n",entry->txn_id,entry->batch_id);
-        DEBUG_M("QWorkQueue::dequeue work_queue_entry free\n");
-        mem_allocator.free(entry,sizeof(work_queue_entry));
-        INC_STATS(thd_id,work_queue_dequeue_time,get_sys_clock() - starttime);
-    }
-
-#if SERVER_GENERATE_QUERIES
-    if(msg && msg->rtype == CL_QRY) {
-        INC_STATS(thd_id,work_queue_new_wait_time,get_sys_clock() - starttime);
-        INC_STATS(thd_id,work_queue_new_cnt,1);
-    }
-#endif
-    return msg;
-}
-
 
-//elioyan TODO
-Message * QWorkQueue::queuetop(uint64_t thd_id)
-{
-    uint64_t starttime = get_sys_clock();
-    assert(ISSERVER || ISREPLICA);
-    Message * msg = NULL;
-    work_queue_entry * entry = NULL;
-    uint64_t mtx_wait_starttime = get_sys_clock();
-        bool valid = work_queue->pop(entry);
+    // continuations of started transactions first, they hold locks and other resources
+    Message * msg = pop(thd_id, work_queue);
+    bool valid = msg != NULL;
     if(!valid) {
 #if SERVER_GENERATE_QUERIES
         if(ISSERVER) {
@@ -495,36 +262,30 @@ Message * QWorkQueue::queuetop(uint64_t thd_id)
             }
         }
 #else
-        valid = new_txn_queue->pop(entry);
+        msg = pop(thd_id, new_txn_queue);
+        valid = msg != NULL;
 #endif
     }
     INC_STATS(thd_id,mtx[14],get_sys_clock() - mtx_wait_starttime);
 
     if(valid) {
-        msg = entry->msg;
-        assert(msg);
+        work_queue_entry * entry = &msg->wq_entry;
         uint64_t queue_time = get_sys_clock() - entry->starttime;
         INC_STATS(thd_id,work_queue_wait_time,queue_time);
         INC_STATS(thd_id,work_queue_cnt,1);
         if(msg->rtype == CL_QRY) {
-            sem_wait(&_semaphore);
-            txn_queue_size --;
-            txn_dequeue_size ++;
-            sem_post(&_semaphore);
+            ATOM_SUB(txn_queue_size, 1);
+            ATOM_ADD(txn_dequeue_size, 1);
             INC_STATS(thd_id,work_queue_new_wait_time,queue_time);
             INC_STATS(thd_id,work_queue_new_cnt,1);
         } else {
-            sem_wait(&_semaphore);
-            work_queue_size --;
-            work_dequeue_size ++;
-            sem_post(&_semaphore);
+            ATOM_SUB(work_queue_size, 1);
+            ATOM_ADD(work_dequeue_size, 1);
             INC_STATS(thd_id,work_queue_old_wait_time,queue_time);
             INC_STATS(thd_id,work_queue_old_cnt,1);
         }
         msg->wq_time = queue_time;
         DEBUG("Work Dequeue (%ld,%ld)\n",entry->txn_id,entry->batch_id);
-        DEBUG_M("QWorkQueue::dequeue work_queue_entry free\n");
-        mem_allocator.free(entry,sizeof(work_queue_entry));
         INC_STATS(thd_id,work_queue_dequeue_time,get_sys_clock() - starttime);
     }
 
@@ -536,5 +297,3 @@ Message * QWorkQueue::queuetop(uint64_t thd_id)
 #endif
     return msg;
 }
-
-#endif
@@ -27,9 +27,7 @@
 
 #include "global.h"
 #include "helper.h"
-#include <queue>
 #include <boost/lockfree/queue.hpp>
-#include <boost/circular_buffer.hpp>
 #include "semaphore.h"
 //#include "message.h"
 
@@ -37,6 +35,7 @@ class BaseQuery;
 class Workload;
 class Message;
 
+// Embedded in every Message (Message::wq_entry), so queueing a message allocates nothing.
 struct work_queue_entry {
     Message * msg;
     uint64_t batch_id;
@@ -70,21 +69,41 @@ struct CompareWQEntry {
     }
 #endif
 };
-typedef boost::circular_buffer<work_queue_entry*> WCircularBuffer;
+
+// Bounded FIFO of messages of one worker thread. Other threads push at the back; the owner and
+// thieves both pop at the front, so the messages of a transaction keep their arrival order.
+class WorkerQueue {
+public:
+    void init(uint64_t capacity);
+    bool push(Message * msg);
+    Message * pop();
+    uint64_t size() { return tail - head; }
+
+private:
+    Message ** buf;
+    uint64_t capacity;
+    volatile uint64_t head;
+    volatile uint64_t tail;
+    pthread_mutex_t mtx;
+} __attribute__((aligned(64)));
+
+// Every worker thread has a queue for continuations of in-flight transactions and one for new
+// transactions. Messages of a transaction go to the worker that created it (see
+// WorkerThread::get_next_txn_id), new transactions are spread round robin and spill over to the
+// next worker when full. A worker drains continuations before new transactions, and steals from
+// the other workers when its own queue of a kind is empty.
 class QWorkQueue {
 public:
     void init();
     void enqueue(uint64_t thd_id,Message * msg,bool busy);
     Message * dequeue(uint64_t thd_id);
-    Message * queuetop(uint64_t thd_id);
     void sched_enqueue(uint64_t thd_id, Message * msg);
     Message * sched_dequeue(uint64_t thd_id);
     void sequencer_enqueue(uint64_t thd_id, Message * msg);
     Message * sequencer_dequeue(uint64_t thd_id);
 
     uint64_t get_cnt() {return get_wq_cnt() + get_rem_wq_cnt() + get_new_wq_cnt();}
-    uint64_t get_wq_cnt() {return 0;}
-    //uint64_t get_wq_cnt() {return work_queue.size();}
+    uint64_t get_wq_cnt() {return work_queue_size;}
     uint64_t get_txn_cnt() {return txn_queue_size;}
 
     uint64_t get_enwq_cnt() {return work_enqueue_size;}
@@ -99,21 +118,15 @@ public:
     uint64_t get_sched_wq_cnt() {return 0;}
     uint64_t get_rem_wq_cnt() {return 0;}
     uint64_t get_new_wq_cnt() {return 0;}
-    // DA
-    Message* top_element;
-
 
 private:
-#ifdef NEW_WORK_QUEUE
-    WCircularBuffer work_queue;
-    WCircularBuffer new_txn_queue;
-
-    sem_t     mw;
-    sem_t     mt;
-#else
-    boost::lockfree::queue<work_queue_entry* > * work_queue;
-    boost::lockfree::queue<work_queue_entry* > * new_txn_queue;
-#endif
+    void push(uint64_t owner, WorkerQueue * queues, Message * msg, bool spill);
+    Message * pop(uint64_t thd_id, WorkerQueue * queues);
+
+    WorkerQueue * work_queue;
+    WorkerQueue * new_txn_queue;
+    uint64_t new_txn_ptr;
+
     boost::lockfree::queue<work_queue_entry* > * seq_queue;
     boost::lockfree::queue<work_queue_entry* > ** sched_queue;
 
@@ -121,7 +134,6 @@ private:
     BaseQuery * last_sched_dq;
     uint64_t curr_epoch;
 
-    sem_t     _semaphore;
     volatile uint64_t work_queue_size;
     volatile uint64_t txn_queue_size;
 
@@ -471,7 +471,7 @@ RC WorkerThread::run() {
 
         ready_starttime = get_sys_clock();
 #if CC_ALG != CALVIN
-        msg->release();
+        Message::release_message(msg);
 #endif
         INC_STATS(get_thd_id(),worker_release_msg_time,get_sys_clock() - ready_starttime);
     }
@@ -672,6 +672,15 @@ RC WorkerThread::process_rqry_cont(Message * msg) {
     DEBUG("RQRY_CONT %ld\n",msg->get_txn_id());
     assert(!IS_LOCAL(msg->get_txn_id()));
     RC rc = RCOK;
+#if CC_ALG == DL_DETECT
+    // the deadlock detector took the txn out of the lock queue
+    if (txn_man->dl_victim) {
+        rc = txn_man->abort();
+        msg_queue.enqueue(get_thd_id(),Message::create_message(txn_man,RQRY_RSP),
+                          txn_man->return_id);
+        return rc;
+    }
+#endif
 #if CC_ALG != FOCC && CC_ALG != BOCC
     txn_man->run_txn_post_wait();
 #endif
@@ -690,6 +699,13 @@ RC WorkerThread::process_rtxn_cont(Message * msg) {
     assert(IS_LOCAL(msg->get_txn_id()));
 
     txn_man->txn_stats.local_wait_time += get_sys_clock() - txn_man->txn_stats.wait_starttime;
+#if CC_ALG == DL_DETECT
+    // the deadlock detector took the txn out of the lock queue
+    if (txn_man->dl_victim) {
+        check_if_done(txn_man->start_abort());
+        return RCOK;
+    }
+#endif
 #if CC_ALG != FOCC && CC_ALG != BOCC
     txn_man->run_txn_post_wait();
 #endif
@@ -763,7 +779,7 @@ RC WorkerThread::process_rtxn(Message * msg) {
             bool ready = txn_man->unset_ready();
             INC_STATS(get_thd_id(),worker_activate_txn_time,get_sys_clock() - ready_starttime);
             assert(ready);
-            if (CC_ALG == WAIT_DIE) {
+            if (CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT) {
 #if WORKLOAD == DA //mvcc use timestamp
                 if (da_stamp_tab.count(txn_man->get_txn_id())==0)
                 {
@@ -926,7 +942,7 @@ RC WorkerThread::process_log_msg(Message * msg) {
     assert(ISREPLICA);
     DEBUG("REPLICA PROCESS %ld\n",msg->get_txn_id());
     LogRecord * record = logger.createRecord(&((LogMessage*)msg)->record);
-    logger.enqueueRecord(record);
+    logger.enqueueRecord(get_thd_id(), record);
     return RCOK;
 }
 
@@ -0,0 +1,346 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Loopback test of the TPORT_TYPE EPOLL transport of epoll_transport.cpp, between three
+   processes, nodes 0 to 2 of an ifconfig.txt that has them all on 127.0.0.1. It is built with
+   TPORT_TYPE EPOLL.
+
+   Each send thread of nodes 1 and 2 sends batches to node 0, most of them small, some of up to
+   BATCH_MAX bytes, which is more than the socket buffers hold. Every batch has to come in order
+   for its node and send thread, and byte for byte. At last node 1 sends pings that node 0
+   answers, so that input threads on both sides go to sleep in epoll_wait and wake up again.
+
+   sendmsg() and read() are wrapped here to move only a random part of what they are asked to
+   now and then, down to a single byte, so that the length in front of a batch is split across
+   writes and reads as often as the batch itself. Each node checks the id the sender writes first
+   on every connection it accepts; with three nodes a shifted or lost id shows as a wrong one, or
+   as a batch that no longer decodes.
+
+   nanomsg is not used: its allocator is malloc() here, and the decoding of a batch hands over a
+   copy of it in place of its messages.
+
+       ./tests/epoll_transport_test [BATCHES_PER_THREAD] [PINGS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "transport.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define NODES 3
+#define THREADS 2
+#define BATCH_MAX (8UL << 20)
+// one batch in HUGE_EVERY is of up to BATCH_MAX bytes
+#define HUGE_EVERY 40
+// one sendmsg() or read() in SHORT_EVERY moves only a part of what it is asked to
+#define SHORT_EVERY 3
+// seconds after which the run counts as hung
+#define RUN_TIMEOUT 60
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+UInt32 g_node_id;
+UInt32 g_node_cnt = NODES;
+UInt32 g_client_node_cnt = 0;
+UInt32 g_repl_cnt = 0;
+UInt32 g_total_node_cnt = NODES;
+UInt32 g_thread_cnt = 1;
+UInt32 g_rem_thread_cnt = THREADS;
+UInt32 g_send_thread_cnt = THREADS;
+UInt32 g_this_rem_thread_cnt = THREADS;
+UInt32 g_client_thread_cnt = 1;
+UInt32 g_client_rem_thread_cnt = THREADS;
+UInt32 g_client_send_thread_cnt = THREADS;
+UInt32 g_servers_per_client = 0;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+uint64_t g_msg_size = BATCH_MAX;
+
+bool SimManager::is_warmup_done() { return false; }
+bool SimManager::is_setup_done() { return false; }
+bool SimManager::is_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+// no nanomsg sockets are opened
+extern "C" {
+void * nn_allocmsg(size_t size, int type) { return malloc(size); }
+int nn_freemsg(void * msg) {
+    free(msg);
+    return 0;
+}
+void * nn_reallocmsg(void * msg, size_t size) { abort(); }
+int nn_socket(int domain, int protocol) { abort(); }
+int nn_close(int s) { abort(); }
+int nn_setsockopt(int s, int level, int option, const void * val, size_t len) { abort(); }
+int nn_getsockopt(int s, int level, int option, void * val, size_t * len) { abort(); }
+int nn_bind(int s, const char * addr) { abort(); }
+int nn_connect(int s, const char * addr) { abort(); }
+int nn_shutdown(int s, int how) { abort(); }
+int nn_send(int s, const void * buf, size_t len, int flags) { abort(); }
+int nn_recv(int s, void * buf, size_t len, int flags) { abort(); }
+int nn_errno() { return errno; }
+const char * nn_strerror(int errnum) { return strerror(errnum); }
+const char * nn_symbol(int i, int * value) { abort(); }
+void nn_term() { abort(); }
+}
+
+static thread_local unsigned short_seed = 0;
+static volatile uint64_t short_writes = 0;
+static volatile uint64_t short_reads = 0;
+
+// a part of n bytes, at least one, or all of them
+static size_t short_len(size_t n) {
+    if (short_seed == 0) short_seed = getpid() * 31 + pthread_self();
+    if (n <= 1 || rand_r(&short_seed) % SHORT_EVERY != 0) return n;
+    // mostly a few bytes, so that the length in front of a batch is split
+    size_t max = rand_r(&short_seed) % 2 == 0 ? 8 : n;
+    return 1 + rand_r(&short_seed) % std::min(max, n - 1);
+}
+
+extern "C" ssize_t sendmsg(int fd, const msghdr * mh, int flags) {
+    size_t total = 0;
+    for (size_t i = 0; i < mh->msg_iovlen; i++) total += mh->msg_iov[i].iov_len;
+    size_t len = short_len(total);
+    if (len == total) return syscall(SYS_sendmsg, fd, mh, flags);
+    __sync_fetch_and_add(&short_writes, 1);
+    iovec iov[2];
+    msghdr part = *mh;
+    part.msg_iov = iov;
+    part.msg_iovlen = 0;
+    for (size_t i = 0; i < mh->msg_iovlen && len > 0 && i < 2; i++) {
+        iov[i].iov_base = mh->msg_iov[i].iov_base;
+        iov[i].iov_len = std::min(len, mh->msg_iov[i].iov_len);
+        len -= iov[i].iov_len;
+        part.msg_iovlen++;
+    }
+    return syscall(SYS_sendmsg, fd, &part, flags);
+}
+
+// the id read after accept() asks for exactly its size, and is left whole
+extern "C" ssize_t read(int fd, void * buf, size_t count) {
+    if (count > sizeof(uint32_t)) {
+        size_t len = short_len(count);
+        if (len < count) __sync_fetch_and_add(&short_reads, 1);
+        count = len;
+    }
+    return syscall(SYS_read, fd, buf, count);
+}
+
+enum batch_kind { BULK, PING, PONG };
+
+struct batch_hdr {
+    uint32_t len;
+    uint32_t kind;
+    uint64_t node;
+    uint64_t thread;
+    uint64_t seq;
+};
+
+static uint64_t batch_cnt = 400;
+static uint64_t ping_cnt = 2000;
+static Transport tport;
+static volatile uint64_t errors = 0;
+// node 0: the next batch of each node and send thread, and how many have come
+static volatile uint64_t next_seq[NODES][THREADS];
+static volatile uint64_t bulk_cnt = 0;
+static volatile uint64_t pinged_cnt = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (__sync_fetch_and_add(&errors, 1) < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+static uint8_t pattern(const batch_hdr * hdr, uint64_t i) {
+    return (hdr->seq * 31 + hdr->node * 13 + hdr->thread * 7 + i) & 0xff;
+}
+
+// the batch follows its 4 byte length in the buffer of the connection, so it is not aligned
+std::vector<Message*> * Message::create_messages(char * buf) {
+    uint32_t len;
+    memcpy(&len, buf, sizeof(len));
+    char * copy = (char *) malloc(len);
+    memcpy(copy, buf, len);
+    return new std::vector<Message*>(1, (Message *) copy);
+}
+
+static void send_batch(uint64_t thread, uint64_t dest, batch_kind kind, uint64_t seq,
+                       uint32_t len) {
+    char * buf = (char *) nn_allocmsg(len, 0);
+    batch_hdr * hdr = (batch_hdr *) buf;
+    hdr->len = len;
+    hdr->kind = kind;
+    hdr->node = g_node_id;
+    hdr->thread = thread;
+    hdr->seq = seq;
+    for (uint64_t i = sizeof(batch_hdr); i < len; i++) buf[i] = pattern(hdr, i);
+    tport.send_msg(g_thread_cnt + g_rem_thread_cnt + thread, dest, buf, len);
+}
+
+// The next batch of input thread thread, checked byte for byte, or NULL if none came.
+static batch_hdr * recv_batch(uint64_t thread) {
+    std::vector<Message*> * msgs = tport.recv_msg(thread);
+    if (msgs == NULL) return NULL;
+    CHECK(msgs->size() == 1, "%lu batches decoded at once\n", msgs->size());
+    batch_hdr * hdr = (batch_hdr *) msgs->front();
+    delete msgs;
+    CHECK(hdr->node < NODES && hdr->node != g_node_id && hdr->thread < THREADS,
+          "batch of node %lu send thread %lu\n", hdr->node, hdr->thread);
+    for (uint64_t i = sizeof(batch_hdr); i < hdr->len; i++) {
+        if ((uint8_t) ((char *) hdr)[i] != pattern(hdr, i)) {
+            CHECK(false, "batch %lu of node %lu send thread %lu differs at byte %lu\n", hdr->seq,
+                  hdr->node, hdr->thread, i);
+            break;
+        }
+    }
+    return hdr;
+}
+
+// Nodes 1 and 2: send the batches, then node 1 sends the pings from send thread 0, and looks
+// for the answers on all of its input threads.
+static void * run_sender(void * arg) {
+    uint64_t thread = (uint64_t) arg;
+    unsigned seed = g_node_id * THREADS + thread + 1;
+    for (uint64_t seq = 0; seq < batch_cnt; seq++) {
+        uint64_t max = rand_r(&seed) % HUGE_EVERY == 0 ? BATCH_MAX
+                     : rand_r(&seed) % 4 == 0       ? 64 * 1024
+                                                    : 256;
+        uint32_t len = sizeof(batch_hdr) + rand_r(&seed) % (max - sizeof(batch_hdr) + 1);
+        send_batch(thread, 0, BULK, seq, len);
+    }
+    if (g_node_id != 1 || thread != 0) return NULL;
+
+    uint64_t max_ping = 0;
+    for (uint64_t seq = 0; seq < ping_cnt; seq++) {
+        if (rand_r(&seed) % 2 == 0) usleep(rand_r(&seed) % 2000);
+        uint64_t pingtime = get_sys_clock();
+        send_batch(0, 0, PING, seq, sizeof(batch_hdr));
+        batch_hdr * hdr = NULL;
+        for (uint64_t i = 0; hdr == NULL; i++) hdr = recv_batch(i % THREADS);
+        uint64_t rtt = get_sys_clock() - pingtime;
+        CHECK(hdr->kind == PONG && hdr->seq == seq, "ping %lu answered by %u %lu\n", seq,
+              hdr->kind, hdr->seq);
+        max_ping = std::max(max_ping, rtt);
+        free(hdr);
+    }
+    printf("epoll_transport_test: slowest of %lu pings %lu us\n", ping_cnt, max_ping / 1000);
+    return NULL;
+}
+
+// Node 0: receives on input thread thread until all batches and pings came, and answers the
+// pings. They all come on one connection, so only one input thread sends.
+static void * run_receiver(void * arg) {
+    uint64_t thread = (uint64_t) arg;
+    const uint64_t total = (NODES - 1) * THREADS * batch_cnt;
+    while (bulk_cnt < total || pinged_cnt < ping_cnt) {
+        batch_hdr * hdr = recv_batch(thread);
+        if (hdr == NULL) continue;
+        if (hdr->kind == PING) {
+            CHECK(hdr->node == 1 && hdr->seq == pinged_cnt, "ping %lu came as %lu of node %lu\n",
+                  pinged_cnt, hdr->seq, hdr->node);
+            send_batch(0, 1, PONG, hdr->seq, sizeof(batch_hdr));
+            pinged_cnt++;
+        } else {
+            // a stream is read by one input thread only
+            volatile uint64_t & next = next_seq[hdr->node % NODES][hdr->thread % THREADS];
+            CHECK(hdr->kind == BULK && hdr->seq == next,
+                  "batch %lu of node %lu send thread %lu came as %u %lu\n", next, hdr->node,
+                  hdr->thread, hdr->kind, hdr->seq);
+            next = hdr->seq + 1;
+            __sync_fetch_and_add(&bulk_cnt, 1);
+        }
+        free(hdr);
+    }
+    return NULL;
+}
+
+// Runs node node_id in a child process, until it is done or killed.
+static pid_t start_node(uint64_t node_id) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    g_node_id = node_id;
+    tport.init();
+    pthread_t thds[THREADS];
+    for (uint64_t i = 0; i < THREADS; i++) {
+        pthread_create(&thds[i], NULL, node_id == 0 ? run_receiver : run_sender, (void *) i);
+    }
+    for (uint64_t i = 0; i < THREADS; i++) pthread_join(thds[i], NULL);
+    if (node_id != 0) {
+        printf("epoll_transport_test: node %lu, %lu short writes, %lu short reads\n", node_id,
+               short_writes, short_reads);
+    } else {
+        printf("epoll_transport_test: node 0, %lu batches, %lu short reads\n", bulk_cnt,
+               short_reads);
+        CHECK(short_reads > 0, "no read was cut short\n");
+    }
+    fflush(stdout);
+    _exit(errors ? 1 : 0);
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) batch_cnt = atol(argv[1]);
+    if (argc > 2) ping_cnt = atol(argv[2]);
+    mem_allocator.init();
+    simulation = new SimManager;
+    char dir[] = "/tmp/epoll_transport_test.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    string ifconfig = string(dir) + "/ifconfig.txt";
+    FILE * f = fopen(ifconfig.c_str(), "w");
+    for (uint64_t i = 0; i < NODES; i++) fprintf(f, "127.0.0.1\n");
+    fclose(f);
+    setenv("SCHEMA_PATH", (string(dir) + "/").c_str(), 1);
+    fflush(stdout);
+
+    pid_t nodes[NODES];
+    for (uint64_t i = 0; i < NODES; i++) nodes[i] = start_node(i);
+    // a node that fails leaves the others waiting, so the first failure ends the run
+    uint64_t running = NODES;
+    for (uint64_t i = 0; i < RUN_TIMEOUT * 100 && running > 0 && !errors; i++) {
+        int status;
+        if (waitpid(-1, &status, WNOHANG) <= 0) {
+            usleep(10000);
+            continue;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) errors++;
+    }
+    if (running > 0) {
+        if (!errors) printf("epoll_transport_test: not done after %d s\n", RUN_TIMEOUT);
+        for (uint64_t i = 0; i < NODES; i++) kill(nodes[i], SIGKILL);
+        errors++;
+    }
+    unlink(ifconfig.c_str());
+    rmdir(dir);
+    printf("epoll_transport_test: %lu batches per thread, %lu pings, %s\n", batch_cnt, ping_cnt,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,142 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Reader scaling of index_btree. The tree holds the keys 0 to KEYS - 1, bulk-loaded with
+   index_load() as IndexLoader does. For 1, 2, 4, ... up to THREADS threads, each thread reads
+   LOOKUPS keys drawn uniformly, once alone and once next to a thread that keeps inserting new
+   keys, so that readers see splits and restart. Prints Mlookups/s for each, and fails if a lookup
+   returns the wrong item.
+
+       ./tests/index_btree_bench [KEYS] [LOOKUPS] [THREADS]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+#include "helper.h"
+#include "index_btree.h"
+#include "mem_alloc.h"
+
+#define MAX_THREADS 64
+// index_load() batch, as IndexLoader uses
+#define LOAD_BATCH 4096
+
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+// the readers and the inserter
+UInt32 g_thread_cnt = MAX_THREADS + 1;
+bool g_mem_pad = true;
+mem_alloc mem_allocator;
+
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+uint64_t key_to_part(uint64_t key) { return 0; }
+
+static uint64_t now() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+static itemid_t * make_item(uint64_t key) {
+    itemid_t * item = (itemid_t *) mem_allocator.alloc(sizeof(itemid_t));
+    item->init();
+    item->type = DT_row;
+    item->location = (void *) (key + 1);
+    item->valid = true;
+    return item;
+}
+
+static std::atomic<uint64_t> errors{0};
+// the next key the inserter adds, past the loaded ones
+static uint64_t next_key;
+
+// Mlookups/s of thd_cnt readers, with an inserter next to them if insert
+static double run(index_btree & idx, uint64_t key_cnt, uint64_t lookup_cnt, uint64_t thd_cnt,
+                  bool insert) {
+    std::atomic<bool> start{false};
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> thds;
+    for (uint64_t t = 0; t < thd_cnt; t++) {
+        thds.emplace_back([&, t] {
+            std::mt19937_64 rand(t + 1);
+            uint64_t sum = 0;
+            uint64_t expected = 0;
+            while (!start) std::this_thread::yield();
+            for (uint64_t i = 0; i < lookup_cnt; i++) {
+                const uint64_t key = rand() % key_cnt;
+                itemid_t * item;
+                idx.index_read(key, item, 0, t);
+                sum += item != NULL ? (uint64_t) item->location : 0;
+                expected += key + 1;
+            }
+            if (sum != expected) errors++;
+        });
+    }
+    std::thread inserter;
+    if (insert) {
+        inserter = std::thread([&] {
+            while (!start) std::this_thread::yield();
+            while (!stop) {
+                idx.index_insert(next_key, make_item(next_key), 0);
+                next_key++;
+            }
+        });
+    }
+    const uint64_t starttime = now();
+    start = true;
+    for (std::thread & thd : thds) thd.join();
+    const uint64_t ns = now() - starttime;
+    stop = true;
+    if (insert) inserter.join();
+    return (double) (thd_cnt * lookup_cnt) * 1000 / ns;
+}
+
+int main(int argc, char ** argv) {
+    const uint64_t key_cnt = argc > 1 ? atol(argv[1]) : 1000000;
+    const uint64_t lookup_cnt = argc > 2 ? atol(argv[2]) : 200000;
+    const uint64_t max_thd_cnt =
+        std::min(argc > 3 ? (uint64_t) atol(argv[3]) : MAX_THREADS, (uint64_t) MAX_THREADS);
+
+    index_btree idx;
+    idx.init(1);
+    std::vector<idx_entry> batch;
+    for (uint64_t key = 0; key < key_cnt; key++) {
+        batch.push_back(idx_entry{key, make_item(key)});
+        if (batch.size() == LOAD_BATCH || key == key_cnt - 1) {
+            idx.index_load(batch.data(), batch.size(), 0);
+            batch.clear();
+        }
+    }
+    idx.index_load_finish(0);
+    next_key = key_cnt;
+
+    printf("index_btree_bench: %lu keys, %lu uniform lookups per thread, Mlookups/s\n", key_cnt,
+           lookup_cnt);
+    printf("  threads  readers  with an inserter\n");
+    for (uint64_t thd_cnt = 1; thd_cnt <= max_thd_cnt; thd_cnt *= 2) {
+        const double alone = run(idx, key_cnt, lookup_cnt, thd_cnt, false);
+        const double insert = run(idx, key_cnt, lookup_cnt, thd_cnt, true);
+        printf("  %7lu  %7.2f  %7.2f\n", thd_cnt, alone, insert);
+    }
+
+    if (errors) printf("index_btree_bench: wrong items read, FAILED\n");
+    return errors ? 1 : 0;
+}
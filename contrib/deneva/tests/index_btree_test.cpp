@@ -0,0 +1,217 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Concurrent test of index_btree. Inserters add shuffled keys, some of them twice, while readers
+   look keys up and scan with index_next() and index_scan(). Afterwards every key must be in the
+   tree once, with the right number of items, and a full scan must return the keys in order.
+   Then loader threads bulk-load the same kind of keys into a tree of two partitions with
+   index_load() and index_load_finish(), once in disjoint runs and once in overlapping ones, and
+   the tree is checked the same way.
+
+       ./tests/index_btree_test [KEY_CNT]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+#include "helper.h"
+#include "index_btree.h"
+#include "mem_alloc.h"
+
+#define INSERT_THD_CNT 4
+#define READ_THD_CNT 2
+// every DUP_EVERY-th key gets a second item
+#define DUP_EVERY 7
+// the location of the second item of a key
+#define DUP_OFFSET 1000000000UL
+#define LOAD_THD_CNT 4
+#define LOAD_PART_CNT 2
+// entries per index_load() call, as IndexLoader passes them
+#define LOAD_BATCH 4096
+
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt32 g_thread_cnt = INSERT_THD_CNT + READ_THD_CNT;
+bool g_mem_pad = true;
+mem_alloc mem_allocator;
+
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+uint64_t key_to_part(uint64_t key) { return 0; }
+
+static std::atomic<uint64_t> errors{0};
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        if (errors++ < 10) printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+    }
+
+static itemid_t * make_item(uint64_t location) {
+    itemid_t * item = new itemid_t;
+    item->init();
+    item->location = (void *) location;
+    item->valid = true;
+    return item;
+}
+
+static uint64_t key_of(itemid_t * item) { return (uint64_t) item->location % DUP_OFFSET; }
+
+// Bulk-loads keys 3 apart, every DUP_EVERY-th key with a second item in the same batch, the
+// partition of a key being key % LOAD_PART_CNT. Each loader passes ascending batches of a
+// contiguous slice of the keys, so that index_load_finish() links the runs, or with interleaved,
+// of every LOAD_THD_CNT-th key, so that the runs overlap and their items are inserted one by one.
+static void check_load(uint64_t key_cnt, bool interleaved) {
+    index_btree idx;
+    idx.init(LOAD_PART_CNT);
+    std::vector<std::thread> thds;
+    for (uint64_t t = 0; t < LOAD_THD_CNT; t++) {
+        thds.emplace_back([&, t] {
+            std::vector<idx_entry> batches[LOAD_PART_CNT];
+            const uint64_t begin = interleaved ? t : key_cnt * t / LOAD_THD_CNT;
+            const uint64_t end = interleaved ? key_cnt : key_cnt * (t + 1) / LOAD_THD_CNT;
+            for (uint64_t i = begin; i < end; i += interleaved ? LOAD_THD_CNT : 1) {
+                const uint64_t key = i * 3 + 1;
+                std::vector<idx_entry> & batch = batches[key % LOAD_PART_CNT];
+                batch.push_back(idx_entry{key, make_item(key)});
+                if (i % DUP_EVERY == 0) {
+                    batch.push_back(idx_entry{key, make_item(key + DUP_OFFSET)});
+                }
+                if (batch.size() >= LOAD_BATCH) {
+                    idx.index_load(batch.data(), batch.size(), key % LOAD_PART_CNT);
+                    batch.clear();
+                }
+            }
+            for (uint64_t part_id = 0; part_id < LOAD_PART_CNT; part_id++) {
+                std::vector<idx_entry> & batch = batches[part_id];
+                if (!batch.empty()) idx.index_load(batch.data(), batch.size(), part_id);
+            }
+        });
+    }
+    for (std::thread & thd : thds) thd.join();
+    for (uint64_t part_id = 0; part_id < LOAD_PART_CNT; part_id++) idx.index_load_finish(part_id);
+
+    for (uint64_t i = 0; i < key_cnt; i++) {
+        const uint64_t key = i * 3 + 1;
+        itemid_t * item;
+        idx.index_read(key, item, key % LOAD_PART_CNT);
+        uint64_t cnt = 0;
+        for (; item != NULL; item = item->next) {
+            CHECK(key_of(item) == key);
+            cnt++;
+        }
+        CHECK(cnt == (i % DUP_EVERY == 0 ? 2UL : 1UL));
+    }
+    for (uint64_t part_id = 0; part_id < LOAD_PART_CNT; part_id++) {
+        // the next key of the partition
+        uint64_t i = 0;
+        while (i < key_cnt && (i * 3 + 1) % LOAD_PART_CNT != part_id) i++;
+        bt_cursor cursor;
+        itemid_t * item;
+        for (idx.index_scan(cursor, 0, item, part_id); item != NULL;
+             idx.index_scan_next(cursor, item)) {
+            CHECK(i < key_cnt && cursor.key == i * 3 + 1 && key_of(item) == cursor.key);
+            do i++; while (i < key_cnt && (i * 3 + 1) % LOAD_PART_CNT != part_id);
+        }
+        CHECK(i >= key_cnt);
+    }
+}
+
+int main(int argc, char ** argv) {
+    const uint64_t key_cnt = argc > 1 ? atol(argv[1]) : 200000;
+    // keys are 3 apart so that scans can tell a skipped key from a gap
+    std::vector<uint64_t> keys(key_cnt);
+    for (uint64_t i = 0; i < key_cnt; i++) keys[i] = i * 3 + 1;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(1));
+
+    index_btree idx;
+    idx.init(1);
+    // readers start from the first key of inserter 0
+    idx.index_insert(keys[0], make_item(keys[0]), 0);
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> thds;
+    for (uint64_t t = 0; t < INSERT_THD_CNT; t++) {
+        thds.emplace_back([&, t] {
+            for (uint64_t i = t; i < key_cnt; i += INSERT_THD_CNT) {
+                if (i > 0) idx.index_insert(keys[i], make_item(keys[i]), 0);
+                if (i % DUP_EVERY == 0) {
+                    idx.index_insert(keys[i], make_item(keys[i] + DUP_OFFSET), 0);
+                }
+            }
+        });
+    }
+    for (uint64_t r = 0; r < READ_THD_CNT; r++) {
+        thds.emplace_back([&, r] {
+            uint64_t thd_id = INSERT_THD_CNT + r;
+            std::mt19937_64 rand(r);
+            while (!stop) {
+                itemid_t * item;
+                idx.index_read(keys[0], item, 0, thd_id);
+                CHECK(item != NULL && key_of(item) == keys[0]);
+                uint64_t prev = keys[0];
+                for (int i = 0; i < 50; i++) {
+                    idx.index_next(thd_id, item);
+                    if (item == NULL) break;
+                    CHECK(key_of(item) > prev);
+                    prev = key_of(item);
+                }
+                bt_cursor cursor;
+                uint64_t start = rand() % (key_cnt * 3 + 10);
+                idx.index_scan(cursor, start, item, 0);
+                for (int i = 0; i < 50 && item != NULL; i++) {
+                    CHECK(key_of(item) == cursor.key);
+                    CHECK(i == 0 ? cursor.key >= start : cursor.key > prev);
+                    prev = cursor.key;
+                    idx.index_scan_next(cursor, item);
+                }
+            }
+        });
+    }
+    for (uint64_t t = 0; t < INSERT_THD_CNT; t++) thds[t].join();
+    stop = true;
+    for (uint64_t r = 0; r < READ_THD_CNT; r++) thds[INSERT_THD_CNT + r].join();
+
+    for (uint64_t i = 0; i < key_cnt; i++) {
+        itemid_t * item;
+        idx.index_read(keys[i], item, 0);
+        uint64_t cnt = 0;
+        for (; item != NULL; item = item->next) {
+            CHECK(key_of(item) == keys[i]);
+            cnt++;
+        }
+        CHECK(cnt == (i % DUP_EVERY == 0 ? 2UL : 1UL));
+    }
+    bt_cursor cursor;
+    itemid_t * item;
+    uint64_t cnt = 0;
+    for (idx.index_scan(cursor, 0, item, 0); item != NULL; idx.index_scan_next(cursor, item)) {
+        CHECK(cursor.key == cnt * 3 + 1);
+        cnt++;
+    }
+    CHECK(cnt == key_cnt);
+    idx.index_scan(cursor, key_cnt * 3, item, 0);
+    CHECK(item == NULL);
+
+    check_load(key_cnt, false);
+    check_load(key_cnt, true);
+
+    printf("index_btree_test: %lu keys, %s\n", key_cnt, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,152 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   YCSB point lookups on IndexHash. The index holds the primary keys of a YCSB table, 0 to
+   ROWS - 1, bulk-loaded with index_load() as YCSBWorkload does. It then reads LOOKUPS keys drawn
+   uniformly, with the zipfian distribution of YCSBQueryGenerator for ZIPF_THETA, and, for keys
+   that do not fall in consecutive buckets, uniformly from a table of keys 10 apart. Prints
+   ns/lookup for each, the best of RUNS runs, and fails if a lookup returns the wrong item.
+
+       ./tests/index_hash_bench [ROWS] [LOOKUPS] [ZIPF_THETA] [RUNS]
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "global.h"
+#include "helper.h"
+#include "index_hash.h"
+#include "mem_alloc.h"
+#include "row.h"
+
+// index_load() batch, as IndexLoader uses
+#define LOAD_BATCH 1024
+
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+mem_alloc mem_allocator;
+
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+void row_t::free_row() {}
+
+static uint64_t now() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+// YCSBQueryGenerator::zipf(), over keys 0 to n - 1
+class zipf_gen {
+public:
+    zipf_gen(uint64_t n, double theta) : n(n), theta(theta) {
+        zetan = zeta(n, theta);
+        alpha = 1 / (1 - theta);
+        eta = (1 - pow(2.0 / n, 1 - theta)) / (1 - zeta(2, theta) / zetan);
+    }
+    uint64_t next(std::mt19937_64 & rand) {
+        double u = (double) (rand() % 10000000) / 10000000;
+        double uz = u * zetan;
+        if (uz < 1) return 0;
+        if (uz < 1 + pow(0.5, theta)) return 1;
+        return std::min(n - 1, (uint64_t) (n * pow(eta * u - eta + 1, alpha)));
+    }
+
+private:
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; i++) sum += pow(1.0 / i, theta);
+        return sum;
+    }
+    uint64_t n;
+    double theta;
+    double zetan;
+    double alpha;
+    double eta;
+};
+
+static uint64_t errors = 0;
+
+static void load(IndexHash & idx, uint64_t row_cnt, uint64_t stride) {
+    idx.init(row_cnt);
+    std::vector<idx_entry> entries;
+    for (uint64_t row = 0; row < row_cnt; row++) {
+        itemid_t * item = (itemid_t *) mem_allocator.alloc(sizeof(itemid_t));
+        item->init();
+        item->type = DT_row;
+        item->location = (void *) (row + 1);
+        item->valid = true;
+        entries.push_back(idx_entry{row * stride, item});
+        if (entries.size() == LOAD_BATCH || row == row_cnt - 1) {
+            idx.index_load(entries.data(), entries.size());
+            entries.clear();
+        }
+    }
+}
+
+// the best ns/lookup of run_cnt runs over the rows in lookups
+static double run(IndexHash & idx, const std::vector<uint64_t> & lookups, uint64_t stride,
+                  uint64_t run_cnt) {
+    double best = 0;
+    for (uint64_t r = 0; r < run_cnt; r++) {
+        uint64_t sum = 0;
+        const uint64_t start = now();
+        for (uint64_t row : lookups) {
+            itemid_t * item;
+            idx.index_read(row * stride, item, 0, 0);
+            sum += (uint64_t) item->location;
+        }
+        const double ns = (double) (now() - start) / lookups.size();
+        // each lookup adds row + 1
+        uint64_t expected = 0;
+        for (uint64_t row : lookups) expected += row + 1;
+        if (sum != expected) errors++;
+        if (r == 0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+int main(int argc, char ** argv) {
+    const uint64_t row_cnt = argc > 1 ? atol(argv[1]) : 1000000;
+    const uint64_t lookup_cnt = argc > 2 ? atol(argv[2]) : 2000000;
+    const double theta = argc > 3 ? atof(argv[3]) : 0.9;
+    const uint64_t run_cnt = argc > 4 ? atol(argv[4]) : 3;
+
+    std::mt19937_64 rand(1);
+    std::vector<uint64_t> uniform(lookup_cnt);
+    for (uint64_t & row : uniform) row = rand() % row_cnt;
+    zipf_gen zipf(row_cnt, theta);
+    std::vector<uint64_t> skewed(lookup_cnt);
+    for (uint64_t & row : skewed) row = zipf.next(rand);
+
+    printf("index_hash_bench: %lu rows, %lu lookups, ns/lookup, best of %lu runs\n", row_cnt,
+           lookup_cnt, run_cnt);
+    IndexHash dense;
+    load(dense, row_cnt, 1);
+    printf("  uniform        %6.1f\n", run(dense, uniform, 1, run_cnt));
+    printf("  zipf theta %.2f %6.1f\n", theta, run(dense, skewed, 1, run_cnt));
+    dense.index_delete();
+    IndexHash strided;
+    load(strided, row_cnt, 10);
+    printf("  uniform, keys 10 apart %6.1f\n", run(strided, uniform, 10, run_cnt));
+    strided.index_delete();
+
+    if (errors) printf("index_hash_bench: wrong items read, FAILED\n");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Concurrent test of IndexHash, built under TSan. Inserters add keys to a table that starts with
+   one bucket, so it is resized many times, while readers look up the keys the inserters are done
+   with. A third of the keys have one item, a third two items inserted with index_insert(), which
+   are chained in one slot, and a third three items inserted with index_insert_nonunique(), which
+   take a slot each. Afterwards every key must have its items once, and index_visit() must visit
+   every item once.
+
+       ./tests/index_hash_test [KEY_CNT]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+#include "helper.h"
+#include "index_hash.h"
+#include "mem_alloc.h"
+#include "row.h"
+
+#define INSERT_THD_CNT 4
+#define READ_THD_CNT 2
+
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+mem_alloc mem_allocator;
+
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+void row_t::free_row() {}
+
+static std::atomic<uint64_t> errors{0};
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        if (errors++ < 10) printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+    }
+
+// the number of items of a key, and how they are inserted
+static uint64_t item_cnt(uint64_t key) { return key % 3 + 1; }
+static bool nonunique(uint64_t key) { return key % 3 == 2; }
+
+// the location of the n-th item of a key
+static uint64_t location_of(uint64_t key, uint64_t n) { return key * 4 + n + 1; }
+
+static itemid_t * make_item(uint64_t location) {
+    itemid_t * item = new itemid_t;
+    item->init();
+    item->location = (void *) location;
+    item->valid = true;
+    return item;
+}
+
+// checks that key has its items, each once
+static void check_key(IndexHash & idx, uint64_t key) {
+    CHECK(idx.index_exist(key));
+    std::vector<uint64_t> locations;
+    itemid_t * item;
+    if (nonunique(key)) {
+        for (int count = 0; ; count++) {
+            idx.index_read(key, count, item, 0);
+            if (item == NULL) break;
+            CHECK(item->next == NULL);
+            locations.push_back((uint64_t) item->location);
+        }
+    } else {
+        idx.index_read(key, item, 0, 0);
+        for (; item != NULL; item = item->next) locations.push_back((uint64_t) item->location);
+    }
+    std::sort(locations.begin(), locations.end());
+    CHECK(locations.size() == item_cnt(key));
+    for (uint64_t n = 0; n < locations.size(); n++) CHECK(locations[n] == location_of(key, n));
+}
+
+int main(int argc, char ** argv) {
+    const uint64_t key_cnt = argc > 1 ? atol(argv[1]) : 100000;
+    std::vector<uint64_t> keys(key_cnt);
+    for (uint64_t i = 0; i < key_cnt; i++) keys[i] = i;
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(1));
+
+    IndexHash idx;
+    idx.init(1);
+    // the number of keys each inserter is done with
+    std::atomic<uint64_t> done_cnt[INSERT_THD_CNT];
+    for (uint64_t t = 0; t < INSERT_THD_CNT; t++) done_cnt[t] = 0;
+
+    std::atomic<bool> stop{false};
+    std::vector<std::thread> thds;
+    for (uint64_t t = 0; t < INSERT_THD_CNT; t++) {
+        thds.emplace_back([&, t] {
+            uint64_t cnt = 0;
+            for (uint64_t i = t; i < key_cnt; i += INSERT_THD_CNT) {
+                const uint64_t key = keys[i];
+                for (uint64_t n = 0; n < item_cnt(key); n++) {
+                    itemid_t * const item = make_item(location_of(key, n));
+                    if (nonunique(key)) idx.index_insert_nonunique(key, item, 0);
+                    else idx.index_insert(key, item, 0);
+                }
+                done_cnt[t].store(++cnt, std::memory_order_release);
+            }
+        });
+    }
+    for (uint64_t r = 0; r < READ_THD_CNT; r++) {
+        thds.emplace_back([&, r] {
+            std::mt19937_64 rand(r);
+            while (!stop) {
+                const uint64_t t = rand() % INSERT_THD_CNT;
+                const uint64_t cnt = done_cnt[t].load(std::memory_order_acquire);
+                if (cnt > 0) check_key(idx, keys[t + rand() % cnt * INSERT_THD_CNT]);
+                CHECK(!idx.index_exist(key_cnt + rand() % key_cnt));
+            }
+        });
+    }
+    for (uint64_t t = 0; t < INSERT_THD_CNT; t++) thds[t].join();
+    stop = true;
+    for (uint64_t r = 0; r < READ_THD_CNT; r++) thds[INSERT_THD_CNT + r].join();
+
+    for (uint64_t key = 0; key < key_cnt; key++) check_key(idx, key);
+    std::vector<uint64_t> visited(key_cnt, 0);
+    idx.index_visit([&](idx_key_t key, itemid_t * item, int part_id) {
+        CHECK(key < key_cnt && part_id == 0);
+        if (key >= key_cnt) return;
+        const uint64_t n = (uint64_t) item->location - location_of(key, 0);
+        CHECK(n < item_cnt(key) && (visited[key] & (1 << n)) == 0);
+        visited[key] |= 1 << n;
+    });
+    for (uint64_t key = 0; key < key_cnt; key++) {
+        CHECK(visited[key] == (1UL << item_cnt(key)) - 1);
+    }
+
+    printf("index_hash_test: %lu keys, %s\n", key_cnt, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Group commit test of Logger. Worker threads log a few update records per transaction and a
+   commit record, and wait for the commit to be acknowledged, while one log thread runs
+   groupCommit(). An acknowledgement notes how long the log file is at that moment. Afterwards
+   the file must hold every record once, with its image intact and its group checksum right, and
+   every record up to the LSN of an acknowledged commit must lie within the file as it was when
+   the commit was acknowledged.
+
+       ./tests/logger_test [TXNS_PER_THREAD]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "logger.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "stats.h"
+#include "work_queue.h"
+
+// after global.h, whose lock_t has a LOCK_EX of its own
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <random>
+#include <vector>
+
+#define WORKER_CNT 8
+#define MAX_UPDATES 3
+#define MAX_IMAGE_SIZE 64
+#define LOG_FILE "logger_test.log"
+
+mem_alloc mem_allocator;
+Logger logger;
+SimManager * simulation;
+Stats stats;
+QWorkQueue work_queue;
+UInt32 g_total_thread_cnt = WORKER_CNT + 1;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt64 g_log_buf_max = 10;
+UInt64 g_log_flush_timeout = 200000;
+
+static volatile bool done = false;
+bool SimManager::is_done() { return done; }
+bool SimManager::is_warmup_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+static uint64_t txn_cnt;
+static int ack_fd;
+// the size of the log file when the commit of a transaction was acknowledged, 0 before
+static std::vector<uint64_t> ack_size;
+static uint64_t errors = 0;
+
+// The log thread acknowledges a commit with a LOG_FLUSHED message. The test never looks into it,
+// so the "message" is just the transaction id.
+Message * Message::create_message(uint64_t txn_id, RemReqType rtype) {
+    assert(rtype == LOG_FLUSHED);
+    return (Message *) (txn_id + 1);
+}
+void QWorkQueue::enqueue(uint64_t thd_id, Message * msg, bool busy) {
+    uint64_t txn_id = (uint64_t) msg - 1;
+    struct stat st;
+    fstat(ack_fd, &st);
+    if (ack_size[txn_id] != 0) {
+        if (errors++ < 10) printf("txn %lu acknowledged twice\n", txn_id);
+    }
+    __atomic_store_n(&ack_size[txn_id], (uint64_t) st.st_size, __ATOMIC_RELEASE);
+}
+
+static uint8_t image_byte(uint64_t txn_id, uint64_t key) { return (uint8_t) (txn_id * 31 + key); }
+
+static void * run_worker(void * arg) {
+    uint64_t thd_id = (uint64_t) arg;
+    std::mt19937_64 rand(thd_id);
+    char image[MAX_IMAGE_SIZE];
+    for (uint64_t i = 0; i < txn_cnt; i++) {
+        uint64_t txn_id = thd_id * txn_cnt + i;
+        uint64_t update_cnt = 1 + rand() % MAX_UPDATES;
+        for (uint64_t key = 0; key < update_cnt; key++) {
+            LogRecord * record = logger.createRecord(txn_id, L_UPDATE, 0, key);
+            record->rcd.image_size = rand() % MAX_IMAGE_SIZE;
+            memset(image, image_byte(txn_id, key), record->rcd.image_size);
+            record->rcd.image = image;
+            logger.enqueueRecord(thd_id, record);
+        }
+        logger.notify_on_sync(thd_id, txn_id);
+        while (__atomic_load_n(&ack_size[txn_id], __ATOMIC_ACQUIRE) == 0) sched_yield();
+    }
+    return NULL;
+}
+
+static void * run_log_thread(void * arg) {
+    while (!done) {
+        logger.groupCommit(WORKER_CNT);
+        sched_yield();
+    }
+    return NULL;
+}
+
+#define READ_VAL(p, v) \
+    memcpy(&(v), p, sizeof(v)); \
+    p += sizeof(v);
+
+int main(int argc, char ** argv) {
+    txn_cnt = argc > 1 ? atol(argv[1]) : 20000;
+    ack_size.assign(WORKER_CNT * txn_cnt, 0);
+    mem_allocator.init();
+    simulation = new SimManager;
+    logger.init(LOG_FILE);
+    ack_fd = open(LOG_FILE, O_RDONLY);
+    assert(ack_fd >= 0);
+
+    pthread_t workers[WORKER_CNT];
+    pthread_t log_thread;
+    pthread_create(&log_thread, NULL, run_log_thread, NULL);
+    for (uint64_t i = 0; i < WORKER_CNT; i++) {
+        pthread_create(&workers[i], NULL, run_worker, (void *) i);
+    }
+    for (uint64_t i = 0; i < WORKER_CNT; i++) pthread_join(workers[i], NULL);
+    done = true;
+    pthread_join(log_thread, NULL);
+    logger.release();
+
+    struct stat st;
+    fstat(ack_fd, &st);
+    char * file = (char *) malloc(st.st_size);
+    ssize_t bytes = pread(ack_fd, file, st.st_size, 0);
+    assert(bytes == st.st_size);
+    close(ack_fd);
+    unlink(LOG_FILE);
+
+    // the end of the group each LSN is in, and the LSN of each commit
+    std::vector<uint64_t> group_end;
+    std::vector<uint64_t> commit_lsn(WORKER_CNT * txn_cnt, UINT64_MAX);
+    uint64_t group_cnt = 0;
+    for (uint64_t off = 0; off < (uint64_t) st.st_size && errors == 0;) {
+        LogGroupHeader hdr;
+        memcpy(&hdr, file + off, sizeof(hdr));
+        if (hdr.magic != LOG_GROUP_MAGIC) {
+            printf("no group at offset %lu\n", off);
+            errors++;
+            break;
+        }
+        uint64_t end = off + (sizeof(hdr) + hdr.size + LOG_GROUP_ALIGN - 1) / LOG_GROUP_ALIGN *
+                                 LOG_GROUP_ALIGN;
+        const char * p = file + off + sizeof(hdr);
+        const char * group_end_p = p + hdr.size;
+        LogChecksum checksum;
+        checksum.init();
+        checksum.add(p, hdr.size);
+        if (checksum.value() != hdr.checksum) {
+            if (errors++ < 10) printf("bad checksum of the group at offset %lu\n", off);
+        }
+        while (p < group_end_p) {
+            AriesLogRecord rcd;
+            READ_VAL(p, rcd.checksum);
+            READ_VAL(p, rcd.lsn);
+            READ_VAL(p, rcd.type);
+            READ_VAL(p, rcd.iud);
+            READ_VAL(p, rcd.txn_id);
+            READ_VAL(p, rcd.table_id);
+            READ_VAL(p, rcd.key);
+            READ_VAL(p, rcd.image_size);
+            for (uint32_t i = 0; i < rcd.image_size; i++) {
+                if ((uint8_t) p[i] != image_byte(rcd.txn_id, rcd.key)) {
+                    if (errors++ < 10) printf("bad image at LSN %lu\n", rcd.lsn);
+                    break;
+                }
+            }
+            p += rcd.image_size;
+            if (rcd.lsn >= group_end.size()) group_end.resize(rcd.lsn + 1, 0);
+            if (group_end[rcd.lsn] != 0) {
+                if (errors++ < 10) printf("LSN %lu logged twice\n", rcd.lsn);
+            }
+            group_end[rcd.lsn] = end;
+            if (rcd.iud == L_NOTIFY) commit_lsn[rcd.txn_id] = rcd.lsn;
+        }
+        group_cnt++;
+        off = end;
+    }
+
+    uint64_t max_end = 0;
+    for (uint64_t lsn = 0; lsn < group_end.size(); lsn++) {
+        if (group_end[lsn] == 0) {
+            if (errors++ < 10) printf("LSN %lu missing\n", lsn);
+        }
+        // group_end becomes the end of the file the records up to lsn need
+        max_end = std::max(max_end, group_end[lsn]);
+        group_end[lsn] = max_end;
+    }
+    for (uint64_t txn_id = 0; txn_id < WORKER_CNT * txn_cnt; txn_id++) {
+        if (commit_lsn[txn_id] == UINT64_MAX) {
+            if (errors++ < 10) printf("commit of txn %lu missing\n", txn_id);
+        } else if (group_end[commit_lsn[txn_id]] > ack_size[txn_id]) {
+            if (errors++ < 10) printf("txn %lu acknowledged before its log was durable\n", txn_id);
+        }
+    }
+
+    printf("logger_test: %lu commits in %lu groups, %s\n", WORKER_CNT * txn_cnt, group_cnt,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
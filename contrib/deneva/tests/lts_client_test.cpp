@@ -0,0 +1,219 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the LTS frames of lts_wire.h and of LtsClient against the stand-in LTS of
+   tools/lts_server.cpp, which the test starts itself. First the frames are encoded and decoded,
+   including ones that do not fit or are malformed. Then threads take timestamps through one
+   LtsClient, with a round trip delay so that the requests of the threads are batched: every
+   timestamp has to be unique and the timestamps of a thread increasing. This is repeated with an
+   LTS that grants fewer timestamps than asked for and with one that ignores the count field. At
+   last one timestamp is taken from an LTS whose round trip is longer than a second but shorter
+   than LTS_RECV_TIMEOUT, which must not make the client reconnect.
+
+       ./tests/lts_client_test [TS_PER_THREAD] [THREADS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "lts_client.h"
+#include "lts_wire.h"
+#include "sim_manager.h"
+#include "stats.h"
+
+#include <algorithm>
+#include <vector>
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+// seconds after which a run counts as hung
+#define RUN_TIMEOUT 60
+
+SimManager * simulation;
+Stats stats;
+
+bool SimManager::is_warmup_done() { return true; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+static uint64_t ts_cnt = 2000;
+static uint64_t thd_cnt = 16;
+static LtsClient client;
+static std::vector<uint64_t> tss[MAX_THREADS];
+static uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (errors++ < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+static void check_frame(uint64_t txn_id, uint64_t txn_ts, uint64_t count) {
+    char frame[LTS_REQ_LEN];
+    uint64_t id, ts, cnt;
+    CHECK(lts_encode(frame, LTS_REQ_LEN, txn_id, txn_ts, count) &&
+          lts_decode(frame, LTS_REQ_LEN, id, ts, cnt) && id == txn_id && ts == txn_ts &&
+          cnt == count, "frame (%lu, %lu, %lu) does not round trip\n", txn_id, txn_ts, count);
+}
+
+static void test_frames() {
+    check_frame(0, 0, 0);
+    check_frame(1, 0, 0);
+    check_frame(0, 1UL << 40, 0);
+    check_frame(0, 0, 127);
+    check_frame(0, 0, 128);
+    check_frame(7, (1UL << 56) - 1, LTS_BATCH_MAX);
+    // the largest response: a 9-byte timestamp and a 2-byte count
+    char resp[LTS_RESP_LEN];
+    uint64_t id, ts, cnt;
+    CHECK(lts_encode(resp, LTS_RESP_LEN, 0, (1UL << 63) - 1, LTS_BATCH_MAX) &&
+          lts_decode(resp, LTS_RESP_LEN, id, ts, cnt) && ts == (1UL << 63) - 1 &&
+          cnt == LTS_BATCH_MAX, "largest response does not round trip\n");
+    CHECK(!lts_encode(resp, LTS_RESP_LEN, UINT64_MAX, UINT64_MAX, 0),
+          "a response that does not fit was encoded\n");
+
+    // proto3 leaves out the fields that are 0
+    char frame[LTS_REQ_LEN];
+    lts_encode(frame, LTS_REQ_LEN, 0, 0, 3);
+    const char expected[] = {0, 2, 3 << 3, 3};
+    CHECK(memcmp(frame, expected, sizeof(expected)) == 0 && frame[sizeof(expected)] == 0,
+          "count 3 encoded wrongly\n");
+    // fields the client does not know are skipped
+    const char unknown[LTS_REQ_LEN] = {0, 4, 4 << 3, 9, 2 << 3, 5};
+    CHECK(lts_decode(unknown, LTS_REQ_LEN, id, ts, cnt) && ts == 5 && id == 0 && cnt == 0,
+          "unknown field not skipped\n");
+    const char too_long[LTS_REQ_LEN] = {0, LTS_REQ_LEN - 1};
+    CHECK(!lts_decode(too_long, LTS_REQ_LEN, id, ts, cnt), "too long a body decoded\n");
+    const char not_varint[LTS_REQ_LEN] = {0, 2, (2 << 3) | 1, 5};
+    CHECK(!lts_decode(not_varint, LTS_REQ_LEN, id, ts, cnt), "a fixed64 field decoded\n");
+    const char cut_varint[LTS_REQ_LEN] = {0, 2, 2 << 3, (char) 0x80};
+    CHECK(!lts_decode(cut_varint, LTS_REQ_LEN, id, ts, cnt), "a cut off varint decoded\n");
+}
+
+// Starts ./lts_server and waits until it listens, so that the client does not have to retry.
+static pid_t start_server(uint16_t port, const char * delay_us, const char * max_count) {
+    char port_str[16];
+    snprintf(port_str, sizeof(port_str), "%d", port);
+    int out[2];
+    if (pipe(out) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        // also when the test dies
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        dup2(out[1], STDOUT_FILENO);
+        close(out[0]);
+        execl("./lts_server", "lts_server", "-p", port_str, "-d", delay_us, "-m", max_count,
+              (char *) NULL);
+        perror("./lts_server");
+        _exit(1);
+    }
+    close(out[1]);
+    // "LTS listening on port ..."
+    char c;
+    while (read(out[0], &c, 1) == 1 && c != '\n') {}
+    close(out[0]);
+    return pid;
+}
+
+static void stop_server(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+static void * run_thread(void * arg) {
+    uint64_t thd_id = (uint64_t) arg;
+    for (uint64_t i = 0; i < ts_cnt; i++) tss[thd_id].push_back(client.get_ts(thd_id));
+    return NULL;
+}
+
+static void run(uint16_t port, const char * delay_us, const char * max_count) {
+    pid_t server = start_server(port, delay_us, max_count);
+    client.init("127.0.0.1", port);
+    for (uint64_t i = 0; i < thd_cnt; i++) {
+        tss[i].clear();
+        stats._stats[i]->lts_batch_cnt = 0;
+        stats._stats[i]->lts_batch_size = 0;
+    }
+    pthread_t thds[MAX_THREADS];
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_create(&thds[i], NULL, run_thread, (void *) i);
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+    client.close_lts();
+    stop_server(server);
+
+    std::vector<uint64_t> all;
+    uint64_t batch_cnt = 0;
+    uint64_t batch_size = 0;
+    for (uint64_t i = 0; i < thd_cnt; i++) {
+        for (uint64_t j = 1; j < tss[i].size(); j++) {
+            CHECK(tss[i][j] > tss[i][j - 1], "-m %s: thread %lu got %lu after %lu\n", max_count, i,
+                  tss[i][j], tss[i][j - 1]);
+        }
+        all.insert(all.end(), tss[i].begin(), tss[i].end());
+        batch_cnt += stats._stats[i]->lts_batch_cnt;
+        batch_size += stats._stats[i]->lts_batch_size;
+    }
+    std::sort(all.begin(), all.end());
+    CHECK(std::adjacent_find(all.begin(), all.end()) == all.end(),
+          "-m %s: a timestamp was handed out twice\n", max_count);
+    // every ticket is in exactly one batch, which may hand out fewer timestamps than asked for
+    CHECK(batch_size >= thd_cnt * ts_cnt, "-m %s: %lu timestamps in batches of %lu tickets\n",
+          max_count, thd_cnt * ts_cnt, batch_size);
+    printf("-m %s: %lu timestamps in %lu batches of %.1f tickets on average\n", max_count,
+           all.size(), batch_cnt, batch_cnt ? (double) batch_size / batch_cnt : 0.0);
+    if (thd_cnt > 1) {
+        CHECK(batch_size > batch_cnt, "-m %s: requests were not batched\n", max_count);
+    }
+}
+
+// With a round trip between 1 s and LTS_RECV_TIMEOUT, one timestamp takes a round trip.
+static void run_slow(uint16_t port) {
+    pid_t server = start_server(port, "1200000", "1024");
+    client.init("127.0.0.1", port);
+    uint64_t start = get_sys_clock();
+    client.get_ts(0);
+    double secs = (double) (get_sys_clock() - start) / BILLION;
+    client.close_lts();
+    stop_server(server);
+    CHECK(secs < 2.4, "a 1.2 s round trip took %.1f s\n", secs);
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) ts_cnt = atol(argv[1]);
+    if (argc > 2) thd_cnt = std::min((uint64_t) atol(argv[2]), (uint64_t) MAX_THREADS);
+    // a client that keeps reconnecting never returns
+    alarm(RUN_TIMEOUT);
+    simulation = new SimManager;
+    stats._stats = (Stats_thd **) calloc(thd_cnt, sizeof(Stats_thd *));
+    for (uint64_t i = 0; i < thd_cnt; i++) {
+        stats._stats[i] = (Stats_thd *) calloc(1, sizeof(Stats_thd));
+    }
+
+    test_frames();
+    // a port of our own, so that tests running side by side do not share a server
+    uint16_t port = 20000 + getpid() % 20000;
+    run(port, "200", "1024");
+    run(port + 1, "200", "3");
+    run(port + 2, "200", "0");
+    if (LTS_RECV_TIMEOUT == 0 || LTS_RECV_TIMEOUT > 2 * BILLION) run_slow(port + 3);
+
+    printf("lts_client_test: %lu threads x %lu timestamps, %lu errors, %s\n", thd_cnt, ts_cnt,
+           errors, errors == 0 ? "passed" : "FAILED");
+    return errors == 0 ? 0 : 1;
+}
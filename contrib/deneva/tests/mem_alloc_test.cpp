@@ -0,0 +1,232 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Stress test of the slab allocator behind THREAD_ALLOC and PART_ALLOC. Threads allocate blocks
+   of random sizes, some of them for a partition, fill them with a pattern of their own, realloc
+   some and hand others to the next thread to free. A block whose pattern changed before it is
+   freed overlapped another live block. Then the threads allocate until the arenas run out, after
+   which the blocks must come from malloc. With PART_ALLOC, the blocks of each partition must lie
+   in an arena of their own, in the order of the partitions, and the shared arena after them.
+
+   Build it under ASan, which owns the blocks that come from malloc and checks that they are freed
+   with the right call.
+
+       ./tests/mem_alloc_test [OPS_PER_THREAD] [THREADS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mutex>
+#include <vector>
+
+#define MAX_THREADS 64
+#define TEST_PART_CNT 4
+// a block of one thread lives at most for this many of its operations
+#define MAX_LIVE 256
+// sizes above SLAB_MAX_OBJ_SIZE come from malloc
+#define MAX_SIZE 10000
+
+bool g_part_alloc = PART_ALLOC;
+UInt32 g_part_cnt = TEST_PART_CNT;
+UInt32 g_node_cnt = 1;
+mem_alloc mem_allocator;
+
+static uint64_t op_cnt = 200000;
+static uint64_t thd_cnt = 4;
+static volatile uint64_t errors = 0;
+static volatile bool exhausted = false;
+
+static void error(const char * what, uint64_t thd_id) {
+    if (__sync_fetch_and_add(&errors, 1) < 10) printf("%s in thread %lu\n", what, thd_id);
+}
+
+// The first bytes of a block name it, the rest is filled with its low byte.
+struct block_head {
+    uint32_t tag;
+    uint32_t size;
+};
+
+struct block {
+    char * ptr;
+    uint32_t size;
+};
+
+static void fill(const block & b, uint32_t tag) {
+    block_head * const head = (block_head *) b.ptr;
+    head->tag = tag;
+    head->size = b.size;
+    memset(b.ptr + sizeof(block_head), (char) tag, b.size - sizeof(block_head));
+}
+
+// checks the first size bytes of a block filled by fill()
+static bool check(const block & b, uint64_t size) {
+    const block_head * const head = (const block_head *) b.ptr;
+    if (head->size != b.size) return false;
+    for (uint64_t i = sizeof(block_head); i < size; i++) {
+        if (b.ptr[i] != (char) head->tag) return false;
+    }
+    return true;
+}
+
+// from sanitizer/allocator_interface.h, which not every compiler ships
+extern "C" int __sanitizer_get_ownership(const volatile void * p);
+static bool from_malloc(const void * ptr) { return __sanitizer_get_ownership(ptr); }
+
+// blocks handed to a thread to free
+static std::mutex mailbox_latch[MAX_THREADS];
+static std::vector<block> mailbox[MAX_THREADS];
+
+static void check_free(const block & b, uint64_t thd_id) {
+    if (!check(b, b.size)) error("block changed while it was live", thd_id);
+    if (((block_head *) b.ptr)->tag % 2 == 0) mem_allocator.free(b.ptr, b.size);
+    else mem_allocator.free(b.ptr);
+}
+
+static uint32_t random_size(unsigned * seed) {
+    return sizeof(block_head) + rand_r(seed) % (MAX_SIZE - sizeof(block_head));
+}
+
+static void * run_worker(void * arg) {
+    const uint64_t thd_id = (uint64_t) arg;
+    unsigned seed = thd_id + 1;
+    std::vector<block> live;
+    std::vector<block> mail;
+    for (uint64_t i = 0; i < op_cnt; i++) {
+        const uint32_t tag = (thd_id << 24) | (i & 0xffffff);
+        if (i % 64 == 0) {
+            std::lock_guard<std::mutex> guard(mailbox_latch[thd_id]);
+            mail.swap(mailbox[thd_id]);
+        }
+        for (const block & b : mail) check_free(b, thd_id);
+        mail.clear();
+
+        const uint32_t op = rand_r(&seed) % 8;
+        if (live.size() < MAX_LIVE && op < 4) {
+            block b;
+            b.size = random_size(&seed);
+            // a quarter of the blocks in each partition, as rows are
+            const uint32_t part = rand_r(&seed) % (TEST_PART_CNT + 1);
+            if (part == TEST_PART_CNT) b.ptr = (char *) mem_allocator.alloc(b.size);
+            else b.ptr = (char *) mem_allocator.alloc(b.size, part);
+            if (b.ptr == NULL) {
+                error("alloc returned NULL", thd_id);
+                continue;
+            }
+            fill(b, tag);
+            live.push_back(b);
+            continue;
+        }
+        if (live.empty()) continue;
+        const uint64_t idx = rand_r(&seed) % live.size();
+        block b = live[idx];
+        if (op == 4) {
+            const uint32_t size = random_size(&seed);
+            block moved = b;
+            moved.ptr = (char *) mem_allocator.realloc(b.ptr, size);
+            if (!check(moved, std::min(b.size, size))) error("realloc lost the contents", thd_id);
+            moved.size = size;
+            fill(moved, tag);
+            live[idx] = moved;
+            continue;
+        }
+        live[idx] = live.back();
+        live.pop_back();
+        if (op == 5) {
+            const uint64_t to = (thd_id + 1) % thd_cnt;
+            std::lock_guard<std::mutex> guard(mailbox_latch[to]);
+            mailbox[to].push_back(b);
+        } else {
+            check_free(b, thd_id);
+        }
+    }
+    for (const block & b : live) check_free(b, thd_id);
+    return NULL;
+}
+
+// Allocates small blocks until the arenas run out, twice the size of the region in all.
+static void * run_exhaust(void * arg) {
+    const uint64_t thd_id = (uint64_t) arg;
+    std::vector<block> blocks;
+    for (uint64_t i = 0; i < 2 * MEM_SIZE / 64 / thd_cnt; i++) {
+        block b;
+        b.size = 64;
+        if (i % 2 == 0) b.ptr = (char *) mem_allocator.alloc(b.size, thd_id % TEST_PART_CNT);
+        else b.ptr = (char *) mem_allocator.alloc(b.size);
+        if (b.ptr == NULL) {
+            error("alloc returned NULL", thd_id);
+            break;
+        }
+        if (from_malloc(b.ptr)) exhausted = true;
+        fill(b, (thd_id << 24) | (i & 0xffffff));
+        blocks.push_back(b);
+    }
+    for (const block & b : blocks) check_free(b, thd_id);
+    return NULL;
+}
+
+static void run_threads(void * (*fn)(void *)) {
+    pthread_t thds[MAX_THREADS];
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_create(&thds[i], NULL, fn, (void *) i);
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+}
+
+// Checks where the slabs of each partition lie. Run it first, while each arena has room.
+static void check_placement() {
+    char * lo[TEST_PART_CNT + 1];
+    char * hi[TEST_PART_CNT + 1];
+    std::vector<block> blocks;
+    for (uint32_t part = 0; part <= TEST_PART_CNT; part++) {
+        lo[part] = (char *) UINT64_MAX;
+        hi[part] = NULL;
+        // align_alloc() rounds up to the next multiple of CL_SIZE
+        for (uint32_t size = 8; size < SLAB_MAX_OBJ_SIZE - CL_SIZE; size += 24) {
+            block b;
+            b.size = size;
+            if (part == TEST_PART_CNT) b.ptr = (char *) mem_allocator.align_alloc(size);
+            else b.ptr = (char *) mem_allocator.align_alloc(size, part);
+            if (from_malloc(b.ptr)) error("small block from malloc", 0);
+            if ((uint64_t) b.ptr % CL_SIZE != 0) error("align_alloc block not aligned", 0);
+            fill(b, part);
+            lo[part] = std::min(lo[part], b.ptr);
+            hi[part] = std::max(hi[part], b.ptr + size);
+            blocks.push_back(b);
+        }
+    }
+    for (uint32_t part = 0; g_part_alloc && part < TEST_PART_CNT; part++) {
+        if (hi[part] > lo[part + 1]) error("partitions share an arena", 0);
+    }
+    for (const block & b : blocks) check_free(b, 0);
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) op_cnt = atol(argv[1]);
+    if (argc > 2) thd_cnt = std::min((uint64_t) atol(argv[2]), (uint64_t) MAX_THREADS);
+    mem_allocator.init();
+
+    check_placement();
+    run_threads(run_worker);
+    // the blocks left in the mailboxes
+    for (uint64_t i = 0; i < thd_cnt; i++) {
+        for (const block & b : mailbox[i]) check_free(b, i);
+    }
+    run_threads(run_exhaust);
+    if (!exhausted) error("arenas not exhausted", 0);
+
+    printf("mem_alloc_test (THREAD_ALLOC %s, PART_ALLOC %s): %lu ops in %lu threads, %s\n",
+           THREAD_ALLOC ? "true" : "false", PART_ALLOC ? "true" : "false", op_cnt, thd_cnt,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,350 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the decoding of received batches into one msg_batch block, under YCSB. Batches of 1 to
+   MAX_BATCH_MSGS messages are encoded as a node sends them, from a server node with RQRY,
+   RQRY_RSP, RACK_PREP, RFIN and INIT_DONE messages, or from a client node with CL_QRY messages,
+   and decoded with Message::create_messages(). Every message has to lie in the block of its
+   batch and carry what was sent. The ycsb_requests of the RQRY and CL_QRY messages are handed to
+   a transaction with copy_to_txn(), as the worker does, and have to outlive the batch.
+
+   Then the messages of all batches are released in random order from several threads. The
+   allocator is stubbed to keep every live block: a block freed twice, or with another size than
+   it was allocated with, is an error, as is a batch freed before all of its messages were
+   released, or a block left once the transactions are done.
+
+       ./tests/message_test [BATCHES] [THREADS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "logger.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "tpcc.h"
+#include "txn.h"
+#include "ycsb.h"
+#include "ycsb_query.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#define MAX_THREADS 64
+#define MAX_BATCH_MSGS 16
+#define SERVER_NODE 1
+#define CLIENT_NODE 2
+
+UInt32 g_node_cnt = 2;
+UInt32 g_node_id = 0;
+UInt32 g_client_node_cnt = 1;
+UInt32 g_repl_cnt = 0;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_req_per_query = REQ_PER_QUERY;
+UInt64 g_synth_table_size = SYNTH_TABLE_SIZE;
+mem_alloc mem_allocator;
+
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+// the messages are only encoded from what the test sets, not from transactions
+txnid_t TxnManager::get_txn_id() const { ::abort(); }
+void YCSBTxnManager::copy_remote_requests(YCSBQueryMessage * msg) { ::abort(); }
+void TPCCTxnManager::copy_remote_items(TPCCQueryMessage * msg) { ::abort(); }
+void LogRecord::copyRecord(LogRecord * record) { ::abort(); }
+
+static volatile uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (__sync_fetch_and_add(&errors, 1) < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+struct batch_info {
+    uint64_t msg_cnt;
+    // messages whose release has begun
+    volatile uint64_t release_cnt;
+    volatile uint64_t free_cnt;
+};
+
+// every live block of the allocator and its size
+static pthread_mutex_t blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+static std::unordered_map<void *, uint64_t> blocks;
+// filled while decoding, and only read once the messages are released
+static std::unordered_map<void *, batch_info> batches;
+
+// The blocks come from calloc, so that ASan reports a message used after its batch is freed.
+mem_alloc::mem_alloc() {}
+
+void * mem_alloc::alloc(uint64_t size) {
+    void * block = calloc(1, size);
+    pthread_mutex_lock(&blocks_lock);
+    blocks[block] = size;
+    pthread_mutex_unlock(&blocks_lock);
+    return block;
+}
+
+void mem_alloc::free(void * block, uint64_t size) {
+    pthread_mutex_lock(&blocks_lock);
+    auto it = blocks.find(block);
+    const bool live = it != blocks.end();
+    const uint64_t alloc_size = live ? it->second : 0;
+    if (live) blocks.erase(it);
+    pthread_mutex_unlock(&blocks_lock);
+    CHECK(live, "%p freed, but it is not allocated\n", block);
+    if (!live) return;
+    CHECK(size == alloc_size, "%p of %lu bytes freed as %lu bytes\n", block, alloc_size, size);
+    auto batch = batches.find(block);
+    if (batch != batches.end()) {
+        batch_info & info = batch->second;
+        __sync_fetch_and_add(&info.free_cnt, 1);
+        CHECK(info.release_cnt == info.msg_cnt,
+              "batch %p freed after %lu of its %lu messages were released\n", block,
+              info.release_cnt, info.msg_cnt);
+    }
+    ::free(block);
+}
+
+static const RemReqType server_rtypes[] = {RQRY, RQRY_RSP, RACK_PREP, RFIN, INIT_DONE};
+
+// what the sender puts in the message of transaction txn_id
+static uint64_t req_cnt(uint64_t txn_id) { return txn_id % g_req_per_query + 1; }
+static uint64_t req_key(uint64_t txn_id, uint64_t i) {
+    return (txn_id * 31 + i * 7) % g_synth_table_size;
+}
+static RC msg_rc(uint64_t txn_id) { return txn_id % 3 == 0 ? Abort : RCOK; }
+
+static void fill_requests(Array<ycsb_request *> & requests, uint64_t txn_id) {
+    requests.init(req_cnt(txn_id));
+    for (uint64_t i = 0; i < req_cnt(txn_id); i++) {
+        ycsb_request * req = (ycsb_request *) mem_allocator.alloc(sizeof(ycsb_request));
+        req->acctype = i % 2 == 0 ? RD : WR;
+        req->key = req_key(txn_id, i);
+        req->value = 'a' + i;
+        req->scan_len = i;
+        requests.add(req);
+    }
+}
+
+// the sender's transaction frees its requests at commit
+static void free_requests(Array<ycsb_request *> & requests) {
+    for (uint64_t i = 0; i < requests.size(); i++) {
+        mem_allocator.free(requests[i], sizeof(ycsb_request));
+    }
+}
+
+static Message * encode_msg(RemReqType rtype, uint64_t txn_id) {
+    Message * msg = Message::create_message(rtype);
+    msg->txn_id = txn_id;
+    switch (rtype) {
+        case RQRY:
+            fill_requests(((YCSBQueryMessage *) msg)->requests, txn_id);
+            break;
+        case CL_QRY: {
+            YCSBClientQueryMessage * qry = (YCSBClientQueryMessage *) msg;
+            qry->client_startts = txn_id + 1;
+            qry->partitions.init(1);
+            qry->partitions.add(txn_id % 4);
+            fill_requests(qry->requests, txn_id);
+            break;
+        }
+        case RQRY_RSP:
+            ((QueryResponseMessage *) msg)->rc = msg_rc(txn_id);
+            break;
+        case RACK_PREP:
+            ((AckMessage *) msg)->rc = msg_rc(txn_id);
+            break;
+        case RFIN:
+            ((FinishMessage *) msg)->pid = txn_id * 3;
+            ((FinishMessage *) msg)->rc = msg_rc(txn_id);
+            ((FinishMessage *) msg)->readonly = txn_id % 2 == 0;
+            break;
+        default:
+            break;
+    }
+    return msg;
+}
+
+// the messages of a batch as the sender's message thread writes them
+static std::vector<char> encode_batch(uint64_t return_id, const std::vector<RemReqType> & rtypes,
+                                      uint64_t first_txn_id) {
+    std::vector<Message *> msgs;
+    uint64_t size = sizeof(uint32_t) * 3;
+    for (uint64_t i = 0; i < rtypes.size(); i++) {
+        msgs.push_back(encode_msg(rtypes[i], first_txn_id + i));
+        size += msgs.back()->get_size();
+    }
+    std::vector<char> buf(size);
+    uint64_t ptr = 0;
+    uint32_t dest_id = g_node_id;
+    uint32_t src_id = return_id;
+    uint32_t cnt = msgs.size();
+    COPY_BUF(buf.data(), dest_id, ptr);
+    COPY_BUF(buf.data(), src_id, ptr);
+    COPY_BUF(buf.data(), cnt, ptr);
+    for (Message * msg : msgs) {
+        msg->copy_to_buf(&buf[ptr]);
+        ptr += msg->get_size();
+        if (msg->rtype == RQRY) free_requests(((YCSBQueryMessage *) msg)->requests);
+        if (msg->rtype == CL_QRY) free_requests(((YCSBClientQueryMessage *) msg)->requests);
+        Message::release_message(msg);
+    }
+    return buf;
+}
+
+static void check_requests(Array<ycsb_request *> & requests, uint64_t txn_id) {
+    CHECK(requests.size() == req_cnt(txn_id), "txn %lu: %lu requests, %lu sent\n", txn_id,
+          requests.size(), req_cnt(txn_id));
+    for (uint64_t i = 0; i < requests.size() && i < req_cnt(txn_id); i++) {
+        ycsb_request * req = requests[i];
+        CHECK(req->acctype == (i % 2 == 0 ? RD : WR) && req->key == req_key(txn_id, i) &&
+              req->value == (char) ('a' + i) && req->scan_len == i,
+              "txn %lu: request %lu is not the one sent\n", txn_id, i);
+    }
+}
+
+static void check_msg(Message * msg, RemReqType rtype, uint64_t txn_id, uint64_t return_id) {
+    CHECK(msg->rtype == rtype && msg->txn_id == txn_id && msg->return_node_id == return_id,
+          "message of type %d for txn %lu from node %lu decoded as type %d for txn %lu from node "
+          "%lu\n", rtype, txn_id, return_id, msg->rtype, msg->txn_id, msg->return_node_id);
+    switch (msg->rtype) {
+        case RQRY:
+            check_requests(((YCSBQueryMessage *) msg)->requests, txn_id);
+            break;
+        case CL_QRY: {
+            YCSBClientQueryMessage * qry = (YCSBClientQueryMessage *) msg;
+            CHECK(qry->client_startts == txn_id + 1 && qry->partitions.size() == 1 &&
+                  qry->partitions[0] == txn_id % 4, "txn %lu: wrong client query\n", txn_id);
+            check_requests(qry->requests, txn_id);
+            break;
+        }
+        case RQRY_RSP:
+            CHECK(((QueryResponseMessage *) msg)->rc == msg_rc(txn_id), "txn %lu: wrong rc\n",
+                  txn_id);
+            break;
+        case RACK_PREP:
+            CHECK(((AckMessage *) msg)->rc == msg_rc(txn_id), "txn %lu: wrong rc\n", txn_id);
+            break;
+        case RFIN: {
+            FinishMessage * fin = (FinishMessage *) msg;
+            CHECK(fin->pid == txn_id * 3 && fin->rc == msg_rc(txn_id) &&
+                  fin->readonly == (txn_id % 2 == 0), "txn %lu: wrong finish\n", txn_id);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// the transaction the worker sets up for a query, zeroed memory but for the query
+struct handed_txn {
+    TxnManager * txn;
+    uint64_t txn_id;
+};
+
+static handed_txn hand_off(Message * msg) {
+    TxnManager * txn = (TxnManager *) calloc(1, sizeof(TxnManager));
+    YCSBQuery * query = (YCSBQuery *) calloc(1, sizeof(YCSBQuery));
+    query->requests.init(g_req_per_query);
+    query->partitions.init(1);
+    txn->query = query;
+    msg->copy_to_txn(txn);
+    CHECK(txn->return_id == msg->return_node_id, "txn %lu: return id %lu, message from %lu\n",
+          msg->txn_id, txn->return_id, msg->return_node_id);
+    return handed_txn{txn, msg->txn_id};
+}
+
+static std::vector<Message *> msgs;
+static volatile uint64_t next_msg = 0;
+
+static void * run_releaser(void * arg) {
+    for (uint64_t i = __sync_fetch_and_add(&next_msg, 1); i < msgs.size();
+         i = __sync_fetch_and_add(&next_msg, 1)) {
+        Message * msg = msgs[i];
+        __sync_fetch_and_add(&batches.at(msg->batch).release_cnt, 1);
+        Message::release_message(msg);
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv) {
+    const uint64_t batch_cnt = argc > 1 ? atol(argv[1]) : 2000;
+    const uint64_t thd_cnt =
+        std::min(argc > 2 ? (uint64_t) atol(argv[2]) : 8, (uint64_t) MAX_THREADS);
+
+    std::vector<handed_txn> txns;
+    uint64_t txn_id = 1;
+    for (uint64_t b = 0; b < batch_cnt; b++) {
+        const uint64_t return_id = b % 4 == 3 ? CLIENT_NODE : SERVER_NODE;
+        std::vector<RemReqType> rtypes;
+        for (uint64_t i = 0; i < b % MAX_BATCH_MSGS + 1; i++) {
+            rtypes.push_back(return_id == CLIENT_NODE ? CL_QRY : server_rtypes[(b + i) % 5]);
+        }
+        std::vector<char> buf = encode_batch(return_id, rtypes, txn_id);
+        std::vector<Message *> * decoded = Message::create_messages(buf.data());
+
+        CHECK(decoded->size() == rtypes.size(), "batch %lu: %lu messages sent, %lu decoded\n", b,
+              rtypes.size(), decoded->size());
+        msg_batch * batch = decoded->empty() ? NULL : (*decoded)[0]->batch;
+        CHECK(batch != NULL, "batch %lu: decoded without a batch\n", b);
+        if (batch == NULL) continue;
+        batches[batch] = batch_info{decoded->size(), 0, 0};
+        for (uint64_t i = 0; i < decoded->size() && i < rtypes.size(); i++) {
+            Message * msg = (*decoded)[i];
+            const char * start = (const char *) (batch + 1);
+            CHECK(msg->batch == batch && (const char *) msg >= start &&
+                  (const char *) msg + sizeof(Message) <= start + batch->capacity &&
+                  (uint64_t) msg % 8 == 0,
+                  "batch %lu: message %lu at %p, outside of the block at %p of %lu bytes\n", b, i,
+                  (void *) msg, (void *) start, batch->capacity);
+            check_msg(msg, rtypes[i], txn_id + i, return_id);
+            if (msg->rtype == RQRY || msg->rtype == CL_QRY) txns.push_back(hand_off(msg));
+            msgs.push_back(msg);
+        }
+        txn_id += rtypes.size();
+        delete decoded;
+    }
+
+    std::shuffle(msgs.begin(), msgs.end(), std::mt19937_64(1));
+    pthread_t thds[MAX_THREADS];
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_create(&thds[i], NULL, run_releaser, NULL);
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+
+    for (auto & batch : batches) {
+        CHECK(batch.second.free_cnt == 1, "batch %p of %lu messages freed %lu times\n",
+              batch.first, batch.second.msg_cnt, batch.second.free_cnt);
+    }
+    // the requests outlived their batches, and the transactions free them at commit
+    for (handed_txn & handed : txns) {
+        YCSBQuery * query = (YCSBQuery *) handed.txn->query;
+        check_requests(query->requests, handed.txn_id);
+        free_requests(query->requests);
+        query->requests.release();
+        query->partitions.release();
+        free(query);
+        free(handed.txn);
+    }
+    CHECK(blocks.empty(), "%lu blocks left allocated\n", blocks.size());
+
+    printf("message_test: %lu batches, %lu messages released by %lu threads, %lu queries handed "
+           "to transactions, %s\n", batch_cnt, msgs.size(), thd_cnt, txns.size(),
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the batching decision of mbuf in msg_thread.h, on a clock of its own. Messages come in
+   with given gaps, and after every microsecond the batch is sent if ready() says so, the way
+   MessageThread::run() and check_and_send_batches() drive it.
+
+   With MSG_BATCH_ADAPTIVE, a batch to a destination whose rate is not known yet, or whose
+   messages come further apart than MSG_BATCH_MAX_DELAY, has to go at once. One whose messages
+   come often has to stay open for several of them, for at most MSG_BATCH_MAX_DELAY also while
+   more are queued, and has to go soon after the next message is late. After a long pause the
+   rate is unknown again. Without it, a batch goes once it is MSG_TIME_LIMIT old.
+
+       ./tests/msg_batch_test [MESSAGES]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "msg_thread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <random>
+
+#define US 1000UL
+// size of a message in the batch
+#define MSG_LEN 64
+
+UInt32 g_node_id = 0;
+uint64_t g_msg_size = MSG_SIZE_MAX;
+UInt64 g_msg_time_limit = MSG_TIME_LIMIT;
+UInt64 g_msg_batch_max_delay = MSG_BATCH_MAX_DELAY;
+
+static uint64_t now = 0;
+uint64_t get_sys_clock() { return now; }
+
+static uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (errors++ < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// the batches sent
+struct batch_log {
+    uint64_t cnt = 0;
+    uint64_t msgs = 0;
+    uint64_t max_size = 0;
+    uint64_t max_delay = 0;
+    // time of the last send, and of the last message
+    uint64_t last = 0;
+    uint64_t last_msg = 0;
+};
+
+// as MessageThread::init() leaves it
+static void init(mbuf & buf) {
+    buf.buffer = (char *) calloc(1, g_msg_size);
+    buf.reset(1);
+    buf.last_time = 0;
+    buf.arrival_intv = g_msg_batch_max_delay;
+}
+
+// as MessageThread::run() puts a message into the batch
+static void add(mbuf & buf) {
+    if (!buf.fits(MSG_LEN)) buf.reset(1);
+    buf.cnt++;
+    buf.ptr += MSG_LEN;
+    if (buf.starttime == 0) buf.starttime = now;
+    buf.arrive(now);
+}
+
+static void send(mbuf & buf, batch_log & log) {
+    log.cnt++;
+    log.msgs += buf.cnt;
+    log.max_size = std::max(log.max_size, buf.cnt);
+    log.max_delay = std::max(log.max_delay, now - buf.starttime);
+    log.last = now;
+    buf.reset(1);
+}
+
+// Feeds the messages, gap[i] after message i - 1, with pending messages queued behind each one,
+// and then waits for the batch to go.
+static batch_log run(mbuf & buf, const std::vector<uint64_t> & gaps, uint64_t pending = 0) {
+    batch_log log;
+    for (uint64_t i = 0; i < gaps.size(); i++) {
+        for (uint64_t t = 0; t < gaps[i]; t += US) {
+            now += US;
+            if (buf.ready(pending)) send(buf, log);
+        }
+        add(buf);
+        log.last_msg = now;
+        if (buf.ready(pending)) send(buf, log);
+    }
+    for (uint64_t t = 0; t <= 2 * g_msg_batch_max_delay && buf.cnt > 0; t += US) {
+        now += US;
+        if (buf.ready(0)) send(buf, log);
+    }
+    CHECK(buf.cnt == 0, "batch of %lu never sent\n", buf.cnt);
+    return log;
+}
+
+int main(int argc, char ** argv) {
+    uint64_t msg_cnt = argc > 1 ? atol(argv[1]) : 100000;
+    now = 1000 * US;
+    mbuf buf;
+    init(buf);
+
+#if MSG_BATCH_ADAPTIVE
+    const uint64_t max_delay = g_msg_batch_max_delay;
+    // unknown rate
+    batch_log log = run(buf, {0});
+    CHECK(log.cnt == 1 && log.max_delay == 0, "first message waited %lu ns\n", log.max_delay);
+
+    // often, and steadily
+    const uint64_t gap = max_delay / 10;
+    std::vector<uint64_t> gaps(100, gap);
+    log = run(buf, gaps);
+    CHECK(log.msgs == gaps.size(), "%lu of %lu messages sent\n", log.msgs, gaps.size());
+    CHECK(log.max_size >= 5, "batches of at most %lu messages %lu ns apart\n", log.max_size, gap);
+    CHECK(log.max_delay <= max_delay, "batch open for %lu ns\n", log.max_delay);
+    // the flush once the next one is late
+    CHECK(log.last - log.last_msg <= 3 * gap, "last batch sent %lu ns after its message\n",
+          log.last - log.last_msg);
+
+    // while more are queued, up to the deadline only
+    log = run(buf, std::vector<uint64_t>(100, gap), 1);
+    CHECK(log.max_delay == max_delay, "batch with queued messages open for %lu ns\n",
+          log.max_delay);
+
+    // a long pause
+    log = run(buf, {1000000 * US});
+    CHECK(log.max_delay == 0, "message after a long pause waited %lu ns\n", log.max_delay);
+
+    // rarely
+    log = run(buf, std::vector<uint64_t>(20, 5 * max_delay));
+    CHECK(log.max_size == 1 && log.max_delay == 0,
+          "messages %lu ns apart waited %lu ns in batches of up to %lu\n", 5 * max_delay,
+          log.max_delay, log.max_size);
+
+    // random gaps, around the deadline
+    std::mt19937_64 rand(1);
+    std::exponential_distribution<double> exp(1.0 / (max_delay / 4));
+    gaps.clear();
+    for (uint64_t i = 0; i < msg_cnt; i++) gaps.push_back((uint64_t) exp(rand) / US * US);
+    log = run(buf, gaps);
+    CHECK(log.msgs == msg_cnt, "%lu of %lu messages sent\n", log.msgs, msg_cnt);
+    CHECK(log.max_delay <= max_delay, "batch open for %lu ns\n", log.max_delay);
+    printf("msg_batch_test (MSG_BATCH_ADAPTIVE true): %lu batches of %lu random messages, %s\n",
+           log.cnt, log.msgs, errors ? "FAILED" : "passed");
+#else
+    batch_log log = run(buf, std::vector<uint64_t>(msg_cnt, US));
+    CHECK(log.msgs == msg_cnt, "%lu of %lu messages sent\n", log.msgs, msg_cnt);
+    CHECK(log.max_delay == (g_msg_time_limit + US - 1) / US * US,
+          "batch open for %lu ns with MSG_TIME_LIMIT %lu\n", log.max_delay, g_msg_time_limit);
+    printf("msg_batch_test (MSG_BATCH_ADAPTIVE false): %lu batches of %lu messages, %s\n",
+           log.cnt, log.msgs, errors ? "FAILED" : "passed");
+#endif
+    free(buf.buffer);
+    return errors ? 1 : 0;
+}
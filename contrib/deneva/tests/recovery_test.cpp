@@ -0,0 +1,331 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of LogRecovery. Logger writes a log of transactions that update a few rows of a small
+   table, each group commit written by one groupCommit() call. The transactions alternate between
+   two log buffers, so that the records of a group are not in LSN order in the file. Some
+   transactions never commit, and some commit only in the group after their updates. The log is
+   then replayed on the table several times, each time from the original rows:
+
+   - as written: every row must hold the image of its last committed update in LSN order,
+   - with the last group cut short, with its records zeroed and with its header cut short: the
+     last group is dropped, and the transactions that committed in it are not replayed,
+   - with a byte of a group in the middle flipped: recovery fails and leaves the rows alone.
+
+       ./tests/recovery_test [TXNS_PER_GROUP]
+*/
+
+#include "global.h"
+#include "catalog.h"
+#include "helper.h"
+#include "index_hash.h"
+#include "logger.h"
+#include "manager.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "recovery.h"
+#include "row.h"
+#include "sim_manager.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "table.h"
+#include "txn.h"
+#include "txn_table.h"
+#include "wl.h"
+#include "work_queue.h"
+
+// after global.h, whose lock_t has a LOCK_EX of its own
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define FIELD_CNT 4
+#define FIELD_SIZE 8
+#define ROW_CNT 16
+#define GROUPS 8
+#define MAX_UPDATES 3
+#define LOG_BUFS 2
+
+mem_alloc mem_allocator;
+Logger logger;
+SimManager * simulation;
+Stats stats;
+Manager glob_manager;
+TxnTable txn_table;
+QWorkQueue work_queue;
+bool g_central_man = false;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt32 g_node_id = 0;
+UInt32 g_thread_cnt = 4;
+UInt32 g_total_thread_cnt = LOG_BUFS;
+UInt32 g_init_parallelism = 1;
+UInt64 g_synth_table_size = ROW_CNT;
+UInt32 g_field_per_tuple = FIELD_CNT;
+UInt32 g_num_wh = 0;
+UInt32 g_dist_per_wh = 0;
+UInt32 g_cust_per_dist = 0;
+UInt32 g_max_items = 0;
+UInt32 g_max_part_key = 0;
+UInt32 g_max_product_key = 0;
+UInt32 g_max_supplier_key = 0;
+UInt64 g_log_buf_max = 1;
+// every groupCommit() writes a group
+UInt64 g_log_flush_timeout = 0;
+char * snapshot_dir = NULL;
+
+bool SimManager::is_done() { return false; }
+bool SimManager::is_warmup_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+uint64_t get_part_id(void * addr) { assert(false); return 0; }
+
+// row_t links in Row_lock, which no transaction calls here
+void Manager::lock_row(row_t * row) { assert(false); }
+void Manager::release_row(row_t * row) { assert(false); }
+void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) {}
+uint64_t TxnManager::get_thd_id() { return 0; }
+txnid_t TxnManager::get_txn_id() const { return 0; }
+ts_t TxnManager::get_timestamp() { return 0; }
+uint64_t TxnManager::decr_lr() { return 0; }
+
+// the acknowledgements of the commits are not needed
+Message * Message::create_message(uint64_t txn_id, RemReqType rtype) { return NULL; }
+void QWorkQueue::enqueue(uint64_t thd_id, Message * msg, bool busy) {}
+
+static uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (errors++ < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+class TestWorkload : public Workload {
+public:
+    RC init() {
+        init_schema(schema_path);
+        table = tables["MAIN_TABLE"];
+        primary = indexes["PRIMARY"];
+        return RCOK;
+    }
+    // the rows have their position in the table as id, as after loading a snapshot
+    RC init_table() {
+        for (uint64_t key = 0; key < ROW_CNT; key++) {
+            row_t * row;
+            uint64_t row_id = key;
+            table->get_new_row(row, 0, row_id);
+            row->set_row_id(key);
+            row->set_primary_key(key);
+            for (UInt32 fid = 0; fid < FIELD_CNT; fid++) {
+                uint64_t value = key * FIELD_CNT + fid;
+                row->set_value(fid, &value);
+            }
+            index_insert(primary, key, row, 0);
+            rows[key] = row;
+        }
+        return RCOK;
+    }
+    RC get_txn_man(TxnManager *& txn_manager) { return RCOK; }
+
+    static const char * schema_path;
+    table_t * table;
+    INDEX * primary;
+    row_t * rows[ROW_CNT];
+};
+
+const char * TestWorkload::schema_path;
+
+// an update as logged, in LSN order
+struct update {
+    uint64_t txn_id;
+    uint64_t key;
+    uint64_t group;
+};
+
+static uint64_t txns_per_group = 6;
+static TestWorkload wl;
+static std::vector<update> updates;
+// the group each transaction committed in, UINT64_MAX if it did not
+static std::vector<uint64_t> commit_group;
+static char orig[ROW_CNT][FIELD_CNT * FIELD_SIZE];
+
+// The image of the u-th update of the log, different from every other one and from the rows.
+static void make_image(char * image, uint64_t u) {
+    memset(image, 0, FIELD_CNT * FIELD_SIZE);
+    uint64_t value = (1UL << 32) + u;
+    memcpy(image, &value, sizeof(value));
+}
+
+static void log_update(uint64_t txn_id, uint64_t key, uint64_t group) {
+    char image[FIELD_CNT * FIELD_SIZE];
+    make_image(image, updates.size());
+    LogRecord * record = logger.createRecord(txn_id, L_UPDATE, wl.table->get_table_id(), key);
+    record->rcd.image_size = FIELD_CNT * FIELD_SIZE;
+    record->rcd.image = image;
+    logger.enqueueRecord(txn_id % LOG_BUFS, record);
+    updates.push_back(update{txn_id, key, group});
+}
+
+static void log_commit(uint64_t txn_id, uint64_t group) {
+    logger.notify_on_sync(txn_id % LOG_BUFS, txn_id);
+    commit_group[txn_id] = group;
+}
+
+// Writes the log: in each group, most transactions commit at once, one every five never does and
+// one every five commits in the next group. Each group ends with two transactions that update the
+// same row, the second from the buffer that is written first.
+static void write_log(const char * path) {
+    logger.init(path);
+    unsigned seed = 1;
+    const uint64_t pair_txn_id = GROUPS * txns_per_group;
+    commit_group.assign(pair_txn_id + 2 * GROUPS, UINT64_MAX);
+    std::vector<uint64_t> late;
+    for (uint64_t group = 0; group < GROUPS; group++) {
+        for (uint64_t txn_id : late) log_commit(txn_id, group);
+        late.clear();
+        for (uint64_t i = 0; i < txns_per_group; i++) {
+            uint64_t txn_id = group * txns_per_group + i;
+            uint64_t update_cnt = 1 + rand_r(&seed) % MAX_UPDATES;
+            for (uint64_t u = 0; u < update_cnt; u++) {
+                log_update(txn_id, rand_r(&seed) % ROW_CNT, group);
+            }
+            if (txn_id % 5 == 1) continue;
+            if (txn_id % 5 == 3) late.push_back(txn_id);
+            else log_commit(txn_id, group);
+        }
+        uint64_t txn_id = pair_txn_id + 2 * group;
+        for (uint64_t t : {txn_id + 1, txn_id}) {
+            log_update(t, group % ROW_CNT, group);
+            log_commit(t, group);
+        }
+        logger.groupCommit(0);
+    }
+    logger.release();
+}
+
+// the offset of each group in the log
+static std::vector<uint64_t> find_groups(const std::string & log) {
+    std::vector<uint64_t> groups;
+    for (uint64_t off = 0; off + sizeof(LogGroupHeader) <= log.size();) {
+        LogGroupHeader hdr;
+        memcpy(&hdr, &log[off], sizeof(hdr));
+        if (hdr.magic != LOG_GROUP_MAGIC) break;
+        groups.push_back(off);
+        off += (sizeof(hdr) + hdr.size + LOG_GROUP_ALIGN - 1) / LOG_GROUP_ALIGN * LOG_GROUP_ALIGN;
+    }
+    return groups;
+}
+
+static std::string read_file(const std::string & path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string & path, const std::string & data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+// Recovers from log, and checks the result and, if it succeeds, that every row holds its last
+// committed update of the first group_cnt groups in LSN order.
+static void check_recover(const char * what, const std::string & path, const std::string & log,
+                          bool ok, uint64_t group_cnt) {
+    for (uint64_t key = 0; key < ROW_CNT; key++) {
+        memcpy(wl.rows[key]->get_data(), orig[key], FIELD_CNT * FIELD_SIZE);
+    }
+    write_file(path, log);
+    bool rc = LogRecovery::recover(&wl, path.c_str());
+    CHECK(rc == ok, "%s: recovery %s\n", what, rc ? "succeeded" : "failed");
+
+    char expected[ROW_CNT][FIELD_CNT * FIELD_SIZE];
+    memcpy(expected, orig, sizeof(orig));
+    for (uint64_t u = 0; ok && u < updates.size(); u++) {
+        const update & upd = updates[u];
+        if (upd.group < group_cnt && commit_group[upd.txn_id] < group_cnt) {
+            make_image(expected[upd.key], u);
+        }
+    }
+    for (uint64_t key = 0; key < ROW_CNT; key++) {
+        CHECK(memcmp(wl.rows[key]->get_data(), expected[key], FIELD_CNT * FIELD_SIZE) == 0,
+              "%s: row %lu does not hold its last committed update\n", what, key);
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) txns_per_group = atol(argv[1]);
+    char dir[] = "/tmp/recovery_test_XXXXXX";
+    snapshot_dir = mkdtemp(dir);
+    const std::string schema_path = std::string(snapshot_dir) + "/schema.txt";
+    const std::string log_path = std::string(snapshot_dir) + "/recovery_test.log";
+    std::ofstream schema(schema_path);
+    schema << "TABLE=MAIN_TABLE\n";
+    for (UInt32 fid = 0; fid < FIELD_CNT; fid++) {
+        schema << "\t" << FIELD_SIZE << ",int64_t,F" << fid << "\n";
+    }
+    schema << "\nINDEX=PRIMARY\nMAIN_TABLE,0\n\n";
+    schema.close();
+    TestWorkload::schema_path = schema_path.c_str();
+    mem_allocator.init();
+    simulation = new SimManager;
+
+    wl.init();
+    wl.init_table();
+    for (uint64_t key = 0; key < ROW_CNT; key++) {
+        memcpy(orig[key], wl.rows[key]->get_data(), FIELD_CNT * FIELD_SIZE);
+    }
+    TableSnapshot::loaded = true;
+
+    write_log(log_path.c_str());
+    const std::string log = read_file(log_path);
+    const std::vector<uint64_t> groups = find_groups(log);
+    CHECK(groups.size() == GROUPS, "%lu groups written, expected %d\n", groups.size(), GROUPS);
+    if (groups.size() == GROUPS) {
+        check_recover("the log as written", log_path, log, true, GROUPS);
+
+        const uint64_t last = groups[GROUPS - 1];
+        LogGroupHeader hdr;
+        memcpy(&hdr, &log[last], sizeof(hdr));
+        const uint64_t records = last + sizeof(hdr);
+        check_recover("the last group cut short", log_path,
+                      log.substr(0, records + hdr.size / 2), true, GROUPS - 1);
+        std::string zeroed = log;
+        memset(&zeroed[records], 0, hdr.size);
+        check_recover("the records of the last group zeroed", log_path, zeroed, true,
+                      GROUPS - 1);
+        check_recover("the header of the last group cut short", log_path,
+                      log.substr(0, last + sizeof(hdr) / 2), true, GROUPS - 1);
+
+        std::string corrupt = log;
+        corrupt[groups[GROUPS / 2] + sizeof(hdr) + 1] ^= 1;
+        check_recover("a byte of a group in the middle flipped", log_path, corrupt, false, 0);
+    }
+    unlink(log_path.c_str());
+    unlink(schema_path.c_str());
+    rmdir(snapshot_dir);
+
+    printf("recovery_test: %lu updates of %lu transactions in %d groups, %s\n", updates.size(),
+           commit_group.size(), GROUPS, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Read-mostly Row_lock throughput under NO_WAIT or WAIT_DIE, for comparing ROW_LOCK_WORD true
+   and false. For 1, 2, 4, ... up to THREADS threads, each thread takes and releases OPS locks on
+   rows drawn uniformly from ROWS, one in WRITE_RATIO of them LOCK_EX, each lock a transaction of
+   its own. A conflict under NO_WAIT aborts the lock, which is counted and not retried. Prints
+   Mlocks/s and the aborts for each thread count, and fails if two LOCK_EX owners of a row lost
+   one another's updates.
+
+       ./tests/row_lock_bench [OPS] [ROWS] [THREADS] [WRITE_RATIO]
+*/
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "global.h"
+#include "dl_detect.h"
+#include "helper.h"
+#include "manager.h"
+#include "mem_alloc.h"
+#include "row.h"
+#include "row_lock.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "txn.h"
+#include "txn_table.h"
+
+#define MAX_THREADS 64
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+Manager glob_manager;
+TxnTable txn_table;
+DlDetector dl_detector;
+UInt32 g_total_thread_cnt;
+bool g_central_man = false;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+
+bool SimManager::is_done() { return false; }
+// the statistics are counted, as they are in a run after the warmup
+bool SimManager::is_warmup_done() { return true; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+void Manager::lock_row(row_t * row) { assert(false); }
+void Manager::release_row(row_t * row) { assert(false); }
+void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) {}
+
+// the transaction managers are zeroed memory, as in row_lock_test
+static thread_local uint64_t thd_id;
+uint64_t TxnManager::get_thd_id() { return thd_id; }
+txnid_t TxnManager::get_txn_id() const { return txn->txn_id; }
+ts_t TxnManager::get_timestamp() { return txn->timestamp; }
+uint64_t TxnManager::incr_lr() { return __sync_add_and_fetch(&lock_ready_cnt, 1); }
+uint64_t TxnManager::decr_lr() { return __sync_sub_and_fetch(&lock_ready_cnt, 1); }
+
+static uint64_t op_cnt = 200000;
+static uint64_t row_cnt = 16;
+static uint64_t max_thd_cnt = MAX_THREADS;
+static uint64_t write_ratio = 20;
+static uint64_t thd_cnt;
+static Row_lock ** locks;
+// bumped without atomics by each LOCK_EX owner, so two at once lose updates
+static uint64_t * writes;
+static volatile bool start = false;
+static volatile uint64_t ex_cnt = 0;
+static volatile uint64_t abort_cnt = 0;
+
+static void * run_worker(void * arg) {
+    thd_id = (uint64_t) arg;
+    unsigned seed = thd_id + 1;
+    TxnManager * txn_man = (TxnManager *) calloc(1, sizeof(TxnManager));
+    txn_man->txn = (Transaction *) calloc(1, sizeof(Transaction));
+    uint64_t ex = 0;
+    uint64_t aborts = 0;
+    uint64_t sum = 0;
+    while (!start) sched_yield();
+    for (uint64_t i = 0; i < op_cnt; i++) {
+        // unique and rising, without a shared counter
+        txn_man->txn->txn_id = i * thd_cnt + thd_id;
+        txn_man->txn->timestamp = i * thd_cnt + thd_id + 1;
+        txn_man->lock_ready = true;
+        uint64_t row = rand_r(&seed) % row_cnt;
+        lock_t type = rand_r(&seed) % write_ratio == 0 ? LOCK_EX : LOCK_SH;
+        RC rc = locks[row]->lock_get(type, txn_man);
+        if (rc == WAIT) {
+            while (!txn_man->lock_ready) sched_yield();
+            rc = RCOK;
+        }
+        if (rc == Abort) {
+            aborts++;
+            continue;
+        }
+        if (type == LOCK_EX) {
+            writes[row]++;
+            ex++;
+        } else {
+            sum += writes[row];
+        }
+        locks[row]->lock_release(txn_man);
+    }
+    __sync_fetch_and_add(&ex_cnt, ex);
+    __sync_fetch_and_add(&abort_cnt, aborts);
+    return (void *) sum;
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) op_cnt = atol(argv[1]);
+    if (argc > 2) row_cnt = atol(argv[2]);
+    if (argc > 3) max_thd_cnt = std::min((uint64_t) atol(argv[3]), (uint64_t) MAX_THREADS);
+    if (argc > 4) write_ratio = atol(argv[4]);
+    g_total_thread_cnt = max_thd_cnt;
+    mem_allocator.init();
+    simulation = new SimManager;
+    stats._stats = (Stats_thd **) calloc(g_total_thread_cnt, sizeof(Stats_thd *));
+    for (uint64_t i = 0; i < g_total_thread_cnt; i++) {
+        stats._stats[i] = (Stats_thd *) calloc(1, sizeof(Stats_thd));
+        stats._stats[i]->mtx = (double *) calloc(40, sizeof(double));
+    }
+    // each lock on its own line, as row_t::init_manager() allocates them
+    locks = (Row_lock **) calloc(row_cnt, sizeof(Row_lock *));
+    writes = (uint64_t *) calloc(row_cnt, sizeof(uint64_t));
+    for (uint64_t i = 0; i < row_cnt; i++) {
+        locks[i] = (Row_lock *) mem_allocator.align_alloc(sizeof(Row_lock), 0);
+        new (locks[i]) Row_lock();
+        locks[i]->init((row_t *) calloc(1, sizeof(row_t)));
+    }
+
+    printf("row_lock_bench (%s, ROW_LOCK_WORD %s): %lu locks per thread on %lu rows, 1 in %lu "
+           "LOCK_EX\n", CC_ALG == WAIT_DIE ? "WAIT_DIE" : "NO_WAIT",
+           ROW_LOCK_WORD ? "true" : "false", op_cnt, row_cnt, write_ratio);
+    printf("  threads  Mlocks/s  aborts\n");
+    uint64_t errors = 0;
+    uint64_t writes_before = 0;
+    for (thd_cnt = 1; thd_cnt <= max_thd_cnt; thd_cnt *= 2) {
+        start = false;
+        ex_cnt = 0;
+        abort_cnt = 0;
+        pthread_t thds[MAX_THREADS];
+        for (uint64_t i = 0; i < thd_cnt; i++) {
+            pthread_create(&thds[i], NULL, run_worker, (void *) i);
+        }
+        const uint64_t starttime = get_sys_clock();
+        start = true;
+        for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+        const uint64_t ns = get_sys_clock() - starttime;
+
+        uint64_t writes_after = 0;
+        for (uint64_t i = 0; i < row_cnt; i++) writes_after += writes[i];
+        if (writes_after - writes_before != ex_cnt) {
+            printf("  %lu LOCK_EX grants, but %lu writes\n", ex_cnt, writes_after - writes_before);
+            errors++;
+        }
+        writes_before = writes_after;
+        printf("  %7lu  %8.2f  %6.2f%%\n", thd_cnt,
+               (double) (thd_cnt * op_cnt - abort_cnt) * 1000 / ns,
+               100.0 * abort_cnt / (thd_cnt * op_cnt));
+    }
+
+    if (errors) printf("row_lock_bench: LOCK_EX owners ran together, FAILED\n");
+    return errors ? 1 : 0;
+}
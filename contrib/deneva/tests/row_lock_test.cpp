@@ -0,0 +1,410 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Stress test of Row_lock under NO_WAIT and WAIT_DIE, with and without ROW_LOCK_WORD, and of
+   Row_lock and DlDetector under DL_DETECT. Threads run transactions that lock one to three of a
+   few rows, mostly LOCK_SH, and restart on Abort. Every grant is checked against a shadow count
+   of the owners of the row, so two LOCK_EX owners or a LOCK_EX owner next to LOCK_SH ones fail
+   the test. Afterwards every lock must be free: a new transaction gets LOCK_EX on each row at
+   once.
+
+   Under DL_DETECT half of the locks are LOCK_EX, so that the transactions often wait for each
+   other in cycles, while a detector thread runs DlDetector::detect(). A victim of the detector
+   restarts. The test fails if the transactions stop making progress, which is what a cycle the
+   detector misses or a waiter it loses look like, if the victims do not add up to the cycles and
+   timeouts the detector counted, or if it never broke a cycle. The workers keep a shadow of what
+   they wait for and own, and a victim that has not waited DL_DETECT_TIMEOUT must be on a cycle of
+   it when it is restarted. Before that, a transaction that restarts while another waits for it,
+   and then waits for that one, must not look like a cycle to the detector.
+
+       ./tests/row_lock_test [TXNS_PER_THREAD] [ROWS] [THREADS]
+*/
+
+#include "global.h"
+#include "dl_detect.h"
+#include "helper.h"
+#include "manager.h"
+#include "mem_alloc.h"
+#include "row.h"
+#include "row_lock.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "txn.h"
+#include "txn_table.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define MAX_THREADS 64
+#define MAX_ROWS 4096
+#define MAX_LOCKS_PER_TXN 3
+// seconds without a commit after which the test gives up
+#define STALL_TIMEOUT 20
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+Manager glob_manager;
+TxnTable txn_table;
+DlDetector dl_detector;
+UInt32 g_total_thread_cnt;
+bool g_central_man = false;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+
+static volatile bool done = false;
+bool SimManager::is_done() { return done; }
+// the detector counts cycles and timeouts in the statistics
+bool SimManager::is_warmup_done() { return true; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+void Manager::lock_row(row_t * row) { assert(false); }
+void Manager::release_row(row_t * row) { assert(false); }
+
+// Only the members Row_lock and DlDetector use are set up; the transaction managers are zeroed
+// memory.
+static thread_local uint64_t thd_id;
+uint64_t TxnManager::get_thd_id() { return thd_id; }
+txnid_t TxnManager::get_txn_id() const { return txn->txn_id; }
+ts_t TxnManager::get_timestamp() { return txn->timestamp; }
+uint64_t TxnManager::decr_lr() { return __sync_sub_and_fetch(&lock_ready_cnt, 1); }
+
+// the detector waits DL_DETECT_INTVL between passes, so DL_DETECT commits far less often
+static uint64_t txn_cnt = CC_ALG == DL_DETECT ? 5000 : 20000;
+static uint64_t row_cnt = 4;
+static uint64_t thd_cnt = 8;
+static Row_lock locks[MAX_ROWS];
+// the owners of each row: the number of LOCK_SH owners, or -1 for a LOCK_EX owner
+static volatile int64_t holders[MAX_ROWS];
+static volatile uint64_t next_ts = 1;
+static volatile uint64_t commit_cnt = 0;
+static volatile uint64_t abort_cnt = 0;
+static volatile uint64_t victim_cnt = 0;
+static volatile uint64_t errors = 0;
+
+// [DL_DETECT] The wait of each worker: its row + 1, or 0, its place in the queue of the row, and
+// its start. The place is taken under the latch of the row, so it is the order of the queue.
+static volatile uint64_t wait_row[MAX_THREADS];
+static volatile uint64_t wait_ticket[MAX_THREADS];
+static volatile uint64_t wait_start[MAX_THREADS];
+static volatile uint64_t tickets[MAX_ROWS];
+// the workers that own each row, a bit each
+static volatile uint64_t owner_bits[MAX_ROWS];
+static TxnManager * txn_mans[MAX_THREADS];
+// set once the victim of a worker is checked, the worker does not change its wait until then
+static volatile bool victim_checked[MAX_THREADS];
+
+static void error(const char * what, uint64_t row) {
+    if (__sync_fetch_and_add(&errors, 1) < 10) printf("%s on row %lu\n", what, row);
+}
+
+static void check_get(uint64_t row, lock_t type) {
+    if (type == LOCK_EX) {
+        if (!__sync_bool_compare_and_swap(&holders[row], 0, -1)) {
+            error("LOCK_EX granted next to another owner", row);
+        }
+        return;
+    }
+    int64_t cnt = holders[row];
+    while (true) {
+        if (cnt < 0) {
+            error("LOCK_SH granted next to a LOCK_EX owner", row);
+            return;
+        }
+        if (__sync_bool_compare_and_swap(&holders[row], cnt, cnt + 1)) return;
+        cnt = holders[row];
+    }
+}
+
+static void check_put(uint64_t row, lock_t type) {
+    if (type == LOCK_EX) __sync_bool_compare_and_swap(&holders[row], -1, 0);
+    else __sync_fetch_and_sub(&holders[row], 1);
+}
+
+// Right before Row_lock puts a wait into the queue, under the latch.
+uint64_t TxnManager::incr_lr() {
+    if (thd_id < MAX_THREADS && wait_row[thd_id] != 0)
+        wait_ticket[thd_id] = __sync_add_and_fetch(&tickets[wait_row[thd_id] - 1], 1);
+    return __sync_add_and_fetch(&lock_ready_cnt, 1);
+}
+
+// Whether the wait of the victim leads back to it. A waiter waits for the owners of its row and
+// for the waiters ahead of it. The waits and owners of a cycle do not change until it is broken,
+// the others may be read halfway through a change, which can only add edges.
+static bool on_cycle(uint64_t victim) {
+    uint64_t seen = 0;
+    uint64_t todo = 1UL << victim;
+    while (todo != 0) {
+        uint64_t t = __builtin_ctzl(todo);
+        todo &= todo - 1;
+        uint64_t row = wait_row[t];
+        uint64_t ticket = wait_ticket[t];
+        if (row == 0 || ticket == 0) continue;
+        uint64_t next = owner_bits[row - 1];
+        for (uint64_t u = 0; u < thd_cnt; u++) {
+            if (u != t && wait_row[u] == row && wait_ticket[u] != 0 && wait_ticket[u] < ticket)
+                next |= 1UL << u;
+        }
+        if (next & (1UL << victim)) return true;
+        next &= ~seen;
+        seen |= next;
+        todo |= next;
+    }
+    return false;
+}
+
+// Called by Row_lock when a waiter may go on, under the latch of its row. The victims of the
+// detector are checked here, while the workers they wait for still wait or own as the detector
+// saw them.
+void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) {
+    uint64_t victim = txn_id / txn_cnt;
+    if (CC_ALG != DL_DETECT || victim >= thd_cnt || !txn_mans[victim]->dl_victim) return;
+    if (!on_cycle(victim) && get_sys_clock() < wait_start[victim] + DL_DETECT_TIMEOUT)
+        error("victim not on a cycle", wait_row[victim] - 1);
+    victim_checked[victim] = true;
+}
+
+static TxnManager * new_txn_man() {
+    TxnManager * txn_man = (TxnManager *) calloc(1, sizeof(TxnManager));
+    txn_man->txn = (Transaction *) calloc(1, sizeof(Transaction));
+    return txn_man;
+}
+
+static void * run_worker(void * arg) {
+    thd_id = (uint64_t) arg;
+    unsigned seed = thd_id + 1;
+    TxnManager * txn_man = new_txn_man();
+    txn_mans[thd_id] = txn_man;
+    for (uint64_t i = 0; i < txn_cnt; i++) {
+        txn_man->txn->txn_id = thd_id * txn_cnt + i;
+        // WAIT_DIE keeps the timestamp across restarts
+        txn_man->txn->timestamp = __sync_fetch_and_add(&next_ts, 1);
+        txn_man->dl_wait_seq = 0;
+        uint64_t lock_cnt = 1 + rand_r(&seed) % std::min(row_cnt, (uint64_t) MAX_LOCKS_PER_TXN);
+        uint64_t rows[MAX_LOCKS_PER_TXN];
+        lock_t types[MAX_LOCKS_PER_TXN];
+        for (uint64_t j = 0; j < lock_cnt; j++) {
+            bool dup;
+            do {
+                rows[j] = rand_r(&seed) % row_cnt;
+                dup = false;
+                for (uint64_t k = 0; k < j; k++) dup |= rows[k] == rows[j];
+            } while (dup);
+            types[j] = rand_r(&seed) % (CC_ALG == DL_DETECT ? 2 : 4) == 0 ? LOCK_EX : LOCK_SH;
+        }
+        while (true) {
+            uint64_t got = 0;
+            RC rc = RCOK;
+            for (; got < lock_cnt; got++) {
+                txn_man->lock_ready = true;
+                wait_start[thd_id] = get_sys_clock();
+                wait_row[thd_id] = rows[got] + 1;
+                rc = locks[rows[got]].lock_get(types[got], txn_man);
+                if (rc == WAIT) {
+                    while (!txn_man->lock_ready) sched_yield();
+                    rc = RCOK;
+                    if (txn_man->dl_victim) {
+                        while (!victim_checked[thd_id]) sched_yield();
+                        victim_checked[thd_id] = false;
+                        txn_man->dl_victim = false;
+                        __sync_fetch_and_add(&victim_cnt, 1);
+                        rc = Abort;
+                    }
+                }
+                if (rc != Abort) {
+                    check_get(rows[got], types[got]);
+                    __sync_fetch_and_or(&owner_bits[rows[got]], 1UL << thd_id);
+                }
+                wait_ticket[thd_id] = 0;
+                wait_row[thd_id] = 0;
+                if (rc == Abort) break;
+            }
+            for (uint64_t j = 0; j < got; j++) {
+                check_put(rows[j], types[j]);
+                __sync_fetch_and_and(&owner_bits[rows[j]], ~(1UL << thd_id));
+                locks[rows[j]].lock_release(txn_man);
+            }
+            if (rc == RCOK) {
+                __sync_fetch_and_add(&commit_cnt, 1);
+                break;
+            }
+            __sync_fetch_and_add(&abort_cnt, 1);
+            // as TxnManager::reset() does
+            txn_man->dl_restart_cnt++;
+            // let the owner that made it abort, or that it waited for, go on
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void * run_detector(void * arg) {
+    thd_id = thd_cnt;
+    while (!done) dl_detector.detect(thd_cnt);
+    return NULL;
+}
+
+static uint64_t detect_cnt() {
+    return ((Stats_thd * volatile) stats._stats[thd_cnt])->dl_detect_cnt;
+}
+
+// runs a whole pass of the detector, it skips the calls that come too early
+static void detect_pass() {
+    uint64_t cnt = detect_cnt();
+    while (detect_cnt() == cnt) dl_detector.detect(thd_cnt);
+}
+
+// A waits for B and C, then B restarts and waits for A. The edge from A leads to the first run of
+// B, which is over, so this is no cycle; C keeps A waiting.
+static void check_restarted_owner() {
+    Row_lock * lock_a = new Row_lock;
+    Row_lock * lock_b = new Row_lock;
+    lock_a->init((row_t *) calloc(1, sizeof(row_t)));
+    lock_b->init((row_t *) calloc(1, sizeof(row_t)));
+    TxnManager * txns[3];
+    for (uint64_t i = 0; i < 3; i++) {
+        txns[i] = new_txn_man();
+        txns[i]->txn->txn_id = thd_cnt * txn_cnt + 1 + i;
+        txns[i]->txn->timestamp = i + 1;
+        txns[i]->lock_ready = true;
+    }
+    TxnManager * a = txns[0];
+    TxnManager * b = txns[1];
+    TxnManager * c = txns[2];
+    thd_id = 0;
+    RC rc_a = lock_a->lock_get(LOCK_EX, a);
+    thd_id = 1;
+    RC rc_b = lock_b->lock_get(LOCK_SH, b);
+    thd_id = 2;
+    RC rc_c = lock_b->lock_get(LOCK_SH, c);
+    if (rc_a != RCOK || rc_b != RCOK || rc_c != RCOK) error("free lock not granted", 0);
+    thd_id = 0;
+    if (lock_b->lock_get(LOCK_EX, a) != WAIT) error("conflicting lock granted", 0);
+    detect_pass();
+
+    thd_id = 1;
+    lock_b->lock_release(b);
+    b->dl_restart_cnt++;
+    b->lock_ready = true;
+    if (lock_a->lock_get(LOCK_SH, b) != WAIT) error("conflicting lock granted", 0);
+    uint64_t cycle_cnt = stats._stats[thd_cnt]->dl_cycle_cnt;
+    detect_pass();
+    if (a->dl_victim || b->dl_victim || stats._stats[thd_cnt]->dl_cycle_cnt != cycle_cnt) {
+        // the locks of the victim are not known to be in its queues any more, and stay taken
+        error("edge to a restarted transaction taken for a cycle", 0);
+        return;
+    }
+
+    thd_id = 2;
+    lock_b->lock_release(c);
+    thd_id = 0;
+    if (!a->lock_ready || a->dl_victim) error("waiter not granted", 0);
+    lock_a->lock_release(a);
+    lock_b->lock_release(a);
+    thd_id = 1;
+    if (!b->lock_ready || b->dl_victim) error("waiter not granted", 0);
+    lock_a->lock_release(b);
+    detect_pass();
+}
+
+// checks that the detector restarted a victim for each cycle and timeout it counted
+static void check_victims() {
+    uint64_t cycle_cnt = 0;
+    uint64_t timeout_cnt = 0;
+    for (uint64_t i = 0; i < g_total_thread_cnt; i++) {
+        cycle_cnt += stats._stats[i]->dl_cycle_cnt;
+        timeout_cnt += stats._stats[i]->dl_timeout_cnt;
+    }
+    if (victim_cnt != cycle_cnt + timeout_cnt) {
+        printf("%lu victims restarted, but %lu cycles and %lu timeouts aborted\n", victim_cnt,
+               cycle_cnt, timeout_cnt);
+        errors++;
+    }
+    if (cycle_cnt == 0) {
+        printf("no cycle was broken\n");
+        errors++;
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) txn_cnt = atol(argv[1]);
+    if (argc > 2) row_cnt = std::min((uint64_t) atol(argv[2]), (uint64_t) MAX_ROWS);
+    if (argc > 3) thd_cnt = std::min((uint64_t) atol(argv[3]), (uint64_t) MAX_THREADS);
+    g_total_thread_cnt = thd_cnt + 1;
+    mem_allocator.init();
+    simulation = new SimManager;
+    stats._stats = (Stats_thd **) calloc(g_total_thread_cnt, sizeof(Stats_thd *));
+    for (uint64_t i = 0; i < g_total_thread_cnt; i++) {
+        stats._stats[i] = (Stats_thd *) calloc(1, sizeof(Stats_thd));
+        // the waits for the latch of a lock, as Stats_thd::init() sizes them
+        stats._stats[i]->mtx = (double *) calloc(40, sizeof(double));
+    }
+    dl_detector.init();
+    row_t * rows = (row_t *) calloc(row_cnt, sizeof(row_t));
+    for (uint64_t i = 0; i < row_cnt; i++) locks[i].init(&rows[i]);
+
+    pthread_t thds[MAX_THREADS];
+    pthread_t detector;
+    if (CC_ALG == DL_DETECT) {
+        check_restarted_owner();
+        pthread_create(&detector, NULL, run_detector, NULL);
+    }
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_create(&thds[i], NULL, run_worker, (void *) i);
+    uint64_t last_cnt = 0;
+    uint64_t stall = 0;
+    while (commit_cnt < thd_cnt * txn_cnt) {
+        sleep(1);
+        stall = commit_cnt == last_cnt ? stall + 1 : 0;
+        last_cnt = commit_cnt;
+        if (stall == STALL_TIMEOUT) {
+            printf("row_lock_test: no commit for %d s after %lu commits, FAILED\n", STALL_TIMEOUT,
+                   last_cnt);
+            fflush(stdout);
+            _exit(1);
+        }
+    }
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+    done = true;
+    if (CC_ALG == DL_DETECT) pthread_join(detector, NULL);
+
+    thd_id = 0;
+    TxnManager * txn_man = new_txn_man();
+    txn_man->txn->txn_id = thd_cnt * txn_cnt;
+    txn_man->txn->timestamp = next_ts;
+    for (uint64_t i = 0; i < row_cnt; i++) {
+        if (holders[i] != 0) error("owners left", i);
+        txn_man->lock_ready = true;
+        if (locks[i].lock_get(LOCK_EX, txn_man) != RCOK) {
+            error("lock not free at the end", i);
+            continue;
+        }
+        locks[i].lock_release(txn_man);
+    }
+    if (CC_ALG == DL_DETECT) check_victims();
+
+    // DL_DETECT does not use the lock word, its runs differ in the timeout
+    char variant[64];
+    if (CC_ALG == DL_DETECT) {
+        snprintf(variant, sizeof(variant), "DL_DETECT, DL_DETECT_TIMEOUT %lu",
+                 (uint64_t) DL_DETECT_TIMEOUT);
+    } else {
+        snprintf(variant, sizeof(variant), "%s, ROW_LOCK_WORD %s",
+                 CC_ALG == WAIT_DIE ? "WAIT_DIE" : "NO_WAIT", ROW_LOCK_WORD ? "true" : "false");
+    }
+    printf("row_lock_test (%s): %lu commits, %lu aborts, %lu victims, %s\n", variant, commit_cnt,
+           abort_cnt, victim_cnt, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
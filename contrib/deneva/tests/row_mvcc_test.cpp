@@ -0,0 +1,187 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the version histories of Row_mvcc. Writers install versions out of timestamp order, so
+   that the write history grows past the MVCC_INLINE_VERS versions kept in the row, and every read
+   is checked to return the newest version not newer than its timestamp, also at each boundary.
+   Then the watermark moves: a garbage collection has to keep the newest version older than the
+   watermark, hand exactly the older ones back to the row pool, and leave the base row standing
+   for the newest version it dropped. Once few enough versions are left, the history moves back
+   into the row, and grows out of it again afterwards.
+
+       ./tests/row_mvcc_test
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "manager.h"
+#include "mem_alloc.h"
+#include "pool.h"
+#include "row.h"
+#include "row_mvcc.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "txn.h"
+#include "txn_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define VERSIONS 20
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+Manager glob_manager;
+TxnTable txn_table;
+RowPool row_pool;
+bool g_central_man = false;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt64 g_max_read_req = MAX_READ_REQ;
+UInt64 g_max_pre_req = MAX_PRE_REQ;
+
+// the statistics are not set up
+bool SimManager::is_warmup_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+static ts_t watermark = 0;
+ts_t Manager::get_min_ts(uint64_t tid) { return watermark; }
+void Manager::lock_row(row_t * row) { assert(false); }
+void Manager::release_row(row_t * row) { assert(false); }
+void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) { assert(false); }
+
+// Only the members Row_mvcc uses are set up; the transaction manager is zeroed memory. A row is
+// told apart by its data, which copy() takes over.
+uint64_t TxnManager::get_thd_id() { return 0; }
+txnid_t TxnManager::get_txn_id() const { return txn->txn_id; }
+ts_t TxnManager::get_timestamp() { return txn->timestamp; }
+void row_t::copy(row_t * src) { data = src->data; }
+char * row_t::get_data() { return data; }
+table_t * row_t::get_table() { return NULL; }
+Catalog * row_t::get_schema() { return NULL; }
+const char * row_t::get_table_name() { return "MAIN_TABLE"; }
+void row_t::free_row() {}
+
+static row_t * freed[VERSIONS];
+static uint64_t freed_cnt = 0;
+void RowPool::put(uint64_t thd_id, row_t * row) {
+    if (freed_cnt < VERSIONS) freed[freed_cnt] = row;
+    freed_cnt++;
+}
+
+static Row_mvcc mvcc;
+static row_t base;
+static row_t vers[VERSIONS];
+static char labels[VERSIONS + 1];
+static TxnManager * txn_man;
+static uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (errors++ < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// version i has timestamp 10 * (i + 1); the base row is version -1
+static ts_t ver_ts(uint64_t i) { return 10 * (i + 1); }
+
+static RC access(TsType type, ts_t ts, row_t * row = NULL) {
+    txn_man->txn->timestamp = ts;
+    txn_man->cur_row = NULL;
+    return mvcc.access(txn_man, type, row);
+}
+
+static void write(uint64_t i) {
+    RC rc = access(P_REQ, ver_ts(i));
+    CHECK(rc == RCOK, "prewrite at %lu: rc %d\n", ver_ts(i), rc);
+    rc = access(W_REQ, ver_ts(i), &vers[i]);
+    CHECK(rc == RCOK, "write at %lu: rc %d\n", ver_ts(i), rc);
+}
+
+// Reads at ts and checks it returns version expected, or for -1 the base row, which holds the
+// data of version base_ver.
+static void check_read(ts_t ts, int64_t expected, int64_t base_ver) {
+    RC rc = access(R_REQ, ts);
+    CHECK(rc == RCOK, "read at %lu: rc %d\n", ts, rc);
+    if (rc != RCOK) return;
+    row_t * want = expected < 0 ? &base : &vers[expected];
+    const char * data = expected < 0 ? &labels[base_ver + 1] : &labels[expected + 1];
+    CHECK(txn_man->cur_row == want && txn_man->cur_row->data == data,
+          "read at %lu returned version %ld, expected %ld\n", ts,
+          (long) (txn_man->cur_row->data - labels) - 1, (long) expected);
+}
+
+// Reads at every timestamp from that of version first - 1 on, after the versions below first were
+// dropped and the base row took over the data of version first - 1. Reads below the watermark
+// stand for a transaction that is still reading a version the watermark has passed.
+static void check_reads(uint64_t first, uint64_t last) {
+    for (ts_t ts = first == 0 ? 0 : ver_ts(first - 1); ts <= ver_ts(last) + 1; ts++) {
+        int64_t expected = -1;
+        for (uint64_t i = first; i <= last; i++) {
+            if (ver_ts(i) <= ts) expected = i;
+        }
+        check_read(ts, expected, (int64_t) first - 1);
+    }
+}
+
+// Moves the watermark to ts, which runs a garbage collection on the next access, and checks that
+// versions [first, keep) were handed back to the row pool.
+static void collect(ts_t ts, uint64_t first, uint64_t keep) {
+    watermark = ts;
+    freed_cnt = 0;
+    RC rc = access(R_REQ, ts);
+    CHECK(rc == RCOK, "read at %lu: rc %d\n", ts, rc);
+    CHECK(freed_cnt == keep - first, "watermark %lu freed %lu versions, expected %lu\n", ts,
+          freed_cnt, keep - first);
+    for (uint64_t i = 0; i < freed_cnt && i < VERSIONS; i++) {
+        uint64_t ver = freed[i] - vers;
+        CHECK(ver >= first && ver < keep, "watermark %lu freed version %lu\n", ts, ver);
+    }
+}
+
+int main() {
+    mem_allocator.init();
+    simulation = new SimManager;
+    txn_man = (TxnManager *) calloc(1, sizeof(TxnManager));
+    txn_man->txn = (Transaction *) calloc(1, sizeof(Transaction));
+    base.data = &labels[0];
+    for (uint64_t i = 0; i < VERSIONS; i++) vers[i].data = &labels[i + 1];
+    mvcc.init(&base);
+
+    // the first half of the versions, the odd ones before the even ones
+    uint64_t half = VERSIONS / 2;
+    for (uint64_t i = 1; i < half; i += 2) write(i);
+    for (uint64_t i = 0; i < half; i += 2) write(i);
+    check_reads(0, half - 1);
+
+    // a watermark at a version keeps the one before it, a watermark just above a version keeps
+    // that one
+    collect(ver_ts(2), 0, 1);
+    check_reads(1, half - 1);
+    collect(ver_ts(3) + 1, 1, 3);
+    check_reads(3, half - 1);
+
+    // down to two versions, which fit into the row again, then past MVCC_INLINE_VERS again
+    collect(ver_ts(half - 1), 3, half - 2);
+    check_reads(half - 2, half - 1);
+    for (uint64_t i = half; i < VERSIONS; i++) write(i);
+    check_reads(half - 2, VERSIONS - 1);
+    collect(ver_ts(VERSIONS - 1) + 1, half - 2, VERSIONS - 1);
+    check_reads(VERSIONS - 1, VERSIONS - 1);
+
+    printf("row_mvcc_test: %d versions, %lu errors, %s\n", VERSIONS, errors,
+           errors == 0 ? "passed" : "FAILED");
+    return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Builds and runs the tests in tests/, each one under the configuration it needs. Run from
+# contrib/deneva:
+#
+#     ./tests/run_tests.sh [TEST...]
+#
+# config.h is restored on exit, also when a build fails or the script is interrupted.
+
+orig=$(mktemp)
+cp config.h $orig
+trap 'cp $orig config.h; rm -f $orig' EXIT
+
+# the structures under test are never freed
+export ASAN_OPTIONS=detect_leaks=0
+failed=""
+
+# run_test NAME [SED_EXPR...] builds tests/NAME with the sed expressions applied to config.h
+run_test() {
+    name=$1
+    shift
+    if [ -n "$only" ] && [[ " $only " != *" $name "* ]]; then return; fi
+    cp $orig config.h
+    for expr in "$@"; do sed -i -e "$expr" config.h; done
+    if ! make tests/$name > /dev/null || ! ./tests/$name; then
+        failed="$failed $name"
+    fi
+}
+
+only="$@"
+run_test index_btree_test
+run_test index_btree_bench
+run_test index_hash_test
+run_test index_hash_bench
+run_test undo_log_test
+run_test logger_test "s/^#define LOGGING .*/#define LOGGING true/"
+for alg in NO_WAIT WAIT_DIE; do
+    for word in true false; do
+        run_test row_lock_test "s/^#define CC_ALG .*/#define CC_ALG ${alg}/" \
+                               "s/^#define ROW_LOCK_WORD .*/#define ROW_LOCK_WORD ${word}/"
+    done
+done
+# scaling of read-mostly locking, with and without the lock word
+for word in true false; do
+    run_test row_lock_bench "s/^#define CC_ALG .*/#define CC_ALG NO_WAIT/" \
+                            "s/^#define ROW_LOCK_WORD .*/#define ROW_LOCK_WORD ${word}/"
+done
+# a DL_DETECT_TIMEOUT just above DL_DETECT_INTVL makes timeouts race with grants
+for timeout in "100 * 1000000UL" "200000UL"; do
+    run_test row_lock_test "s/^#define CC_ALG .*/#define CC_ALG DL_DETECT/" \
+                           "s/^#define DL_DETECT_TIMEOUT .*/#define DL_DETECT_TIMEOUT ${timeout}/"
+done
+run_test txn_table_test
+# a few slots, so that the queues wrap and fill up
+run_test work_queue_test "s/^#define WORK_QUEUE_CAPACITY .*/#define WORK_QUEUE_CAPACITY 8/"
+run_test row_mvcc_test "s/^#define CC_ALG .*/#define CC_ALG MVCC/"
+run_test lts_client_test
+# the rows need a lock manager that links without the transactions, the index a hash index
+run_test snapshot_test "s/^#define CC_ALG .*/#define CC_ALG NO_WAIT/" \
+                       "s/^#define WORKLOAD .*/#define WORKLOAD YCSB/" \
+                       "s/^#define INDEX_STRUCT .*/#define INDEX_STRUCT IDX_HASH/"
+run_test recovery_test "s/^#define LOGGING .*/#define LOGGING true/" \
+                       "s/^#define CC_ALG .*/#define CC_ALG NO_WAIT/" \
+                       "s/^#define WORKLOAD .*/#define WORKLOAD YCSB/" \
+                       "s/^#define INDEX_STRUCT .*/#define INDEX_STRUCT IDX_HASH/"
+for adaptive in true false; do
+    run_test msg_batch_test "s/^#define MSG_BATCH_ADAPTIVE .*/#define MSG_BATCH_ADAPTIVE ${adaptive}/"
+done
+# the query messages carry the requests of YCSB
+run_test message_test "s/^#define CC_ALG .*/#define CC_ALG NO_WAIT/" \
+                      "s/^#define WORKLOAD .*/#define WORKLOAD YCSB/"
+run_test epoll_transport_test "s/^#define TPORT_TYPE .*/#define TPORT_TYPE EPOLL/"
+run_test shm_transport_test "s/^#define SHM_TPORT .*/#define SHM_TPORT true/"
+# a small region, so that the arenas run out
+for alloc in THREAD_ALLOC PART_ALLOC; do
+    run_test mem_alloc_test "s/^#define ${alloc} .*/#define ${alloc} true/" \
+                            "s/^#define MEM_SIZE .*/#define MEM_SIZE (1UL << 26)/"
+done
+
+if [ -n "$failed" ]; then
+    echo "failed:$failed"
+    exit 1
+fi
+echo "all tests passed"
@@ -0,0 +1,305 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the shared memory rings of shm_transport.cpp between two processes, nodes 0 and 1 of
+   an ifconfig.txt that has both on 127.0.0.1. It is built with a small ring and a long
+   SHM_WAIT_TIMEOUT, see the Makefile, and with SHM_TPORT true.
+
+   First node 0 is started and killed once it created its segment, which leaves a segment with a
+   dead creator behind. Node 1 is started next and must not send into that one, but wait for the
+   segment of the real node 0, which is started a moment later. Then each send thread of node 1
+   sends batches of random sizes, which wrap around the end of its ring many times, while the
+   input threads of node 0 only start to read once the rings have been full for a while. Every
+   batch has to come in order and byte for byte. At last node 1 sends pings that node 0 answers,
+   with random pauses, so that senders race with input threads going to sleep; a lost wake up
+   stalls the round trip until the futex times out. On a single CPU a sender only runs once the
+   input thread sleeps, so the race needs more than one to show.
+
+   nanomsg is not used between local nodes: its allocator is malloc() here, and the decoding of a
+   batch hands over a copy of it in place of its messages.
+
+       ./tests/shm_transport_test [BATCHES_PER_THREAD] [PINGS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "transport.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define THREADS 2
+// ms the input threads of node 0 leave the rings full
+#define FULL_PAUSE 300
+// ms a ping may take, far below SHM_WAIT_TIMEOUT
+#define PING_TIMEOUT 1000
+// seconds after which the run counts as hung
+#define RUN_TIMEOUT 60
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+UInt32 g_node_id;
+UInt32 g_node_cnt = 2;
+UInt32 g_client_node_cnt = 0;
+UInt32 g_repl_cnt = 0;
+UInt32 g_total_node_cnt = 2;
+UInt32 g_thread_cnt = 1;
+UInt32 g_rem_thread_cnt = THREADS;
+UInt32 g_send_thread_cnt = THREADS;
+UInt32 g_this_rem_thread_cnt = THREADS;
+UInt32 g_client_thread_cnt = 1;
+UInt32 g_client_rem_thread_cnt = THREADS;
+UInt32 g_client_send_thread_cnt = THREADS;
+UInt32 g_servers_per_client = 0;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+// the largest batch whose record fits in half a ring
+uint64_t g_msg_size = SHM_RING_SIZE / 2 - SHM_REC_HDR;
+
+bool SimManager::is_warmup_done() { return false; }
+bool SimManager::is_setup_done() { return false; }
+bool SimManager::is_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+// the sockets to remote nodes are never opened
+extern "C" {
+void * nn_allocmsg(size_t size, int type) { return malloc(size); }
+int nn_freemsg(void * msg) {
+    free(msg);
+    return 0;
+}
+void * nn_reallocmsg(void * msg, size_t size) { abort(); }
+int nn_socket(int domain, int protocol) { abort(); }
+int nn_close(int s) { abort(); }
+int nn_setsockopt(int s, int level, int option, const void * val, size_t len) { abort(); }
+int nn_getsockopt(int s, int level, int option, void * val, size_t * len) { abort(); }
+int nn_bind(int s, const char * addr) { abort(); }
+int nn_connect(int s, const char * addr) { abort(); }
+int nn_shutdown(int s, int how) { abort(); }
+int nn_send(int s, const void * buf, size_t len, int flags) { abort(); }
+int nn_recv(int s, void * buf, size_t len, int flags) { abort(); }
+int nn_errno() { return errno; }
+const char * nn_strerror(int errnum) { return strerror(errnum); }
+const char * nn_symbol(int i, int * value) { abort(); }
+void nn_term() { abort(); }
+}
+
+enum batch_kind { BULK, PING, PONG };
+
+struct batch_hdr {
+    uint32_t len;
+    uint32_t kind;
+    uint64_t thread;
+    uint64_t seq;
+};
+
+static uint64_t batch_cnt = 2000;
+static uint64_t ping_cnt = 20000;
+static Transport tport;
+static volatile uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (__sync_fetch_and_add(&errors, 1) < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+static uint8_t pattern(const batch_hdr * hdr, uint64_t i) {
+    return (hdr->seq * 31 + hdr->thread * 7 + i) & 0xff;
+}
+
+std::vector<Message*> * Message::create_messages(char * buf) {
+    uint32_t len = ((batch_hdr *) buf)->len;
+    char * copy = (char *) malloc(len);
+    memcpy(copy, buf, len);
+    return new std::vector<Message*>(1, (Message *) copy);
+}
+
+static void send_batch(uint64_t thread, uint64_t dest, batch_kind kind, uint64_t seq,
+                       uint32_t len) {
+    char * buf = (char *) nn_allocmsg(len, 0);
+    batch_hdr * hdr = (batch_hdr *) buf;
+    hdr->len = len;
+    hdr->kind = kind;
+    hdr->thread = thread;
+    hdr->seq = seq;
+    for (uint64_t i = sizeof(batch_hdr); i < len; i++) buf[i] = pattern(hdr, i);
+    tport.send_msg(g_thread_cnt + g_rem_thread_cnt + thread, dest, buf, len);
+}
+
+// Waits for the next batch of input thread thread, and checks it.
+static batch_hdr * recv_batch(uint64_t thread) {
+    std::vector<Message*> * msgs;
+    while ((msgs = tport.recv_msg(thread)) == NULL) {
+    }
+    CHECK(msgs->size() == 1, "%lu batches decoded at once\n", msgs->size());
+    batch_hdr * hdr = (batch_hdr *) msgs->front();
+    delete msgs;
+    CHECK(hdr->thread == thread, "batch of send thread %lu in ring of %lu\n", hdr->thread, thread);
+    for (uint64_t i = sizeof(batch_hdr); i < hdr->len; i++) {
+        if ((uint8_t) ((char *) hdr)[i] != pattern(hdr, i)) {
+            CHECK(false, "batch %lu of send thread %lu differs at byte %lu\n", hdr->seq,
+                  hdr->thread, i);
+            break;
+        }
+    }
+    return hdr;
+}
+
+// Node 1: sends the batches through ring thread, then the pings through ring 0.
+static void * run_sender(void * arg) {
+    uint64_t thread = (uint64_t) arg;
+    unsigned seed = thread + 1;
+    uint64_t starttime = get_sys_clock();
+    uint64_t sent = 0;
+    bool full = false;
+    for (uint64_t seq = 0; seq < batch_cnt; seq++) {
+        // mostly small batches, with now and then one of up to half a ring
+        uint64_t max = rand_r(&seed) % 4 == 0 ? g_msg_size : 256;
+        uint32_t len = sizeof(batch_hdr) + rand_r(&seed) % (max - sizeof(batch_hdr) + 1);
+        send_batch(thread, 0, BULK, seq, len);
+        sent += len;
+        if (!full && sent > 2 * SHM_RING_SIZE) {
+            full = true;
+            CHECK(get_sys_clock() - starttime > FULL_PAUSE / 3 * 1000000UL,
+                  "send thread %lu went past a full ring\n", thread);
+        }
+    }
+    CHECK(full, "send thread %lu sent less than two rings\n", thread);
+    if (thread != 0) return NULL;
+
+    uint64_t max_ping = 0;
+    for (uint64_t seq = 0; seq < ping_cnt; seq++) {
+        // no pause, a short one, or one long enough for the input thread to fall asleep
+        uint64_t pause = rand_r(&seed) % 3;
+        if (pause == 1) {
+            for (volatile uint64_t i = rand_r(&seed) % 2000; i > 0; i--) {
+            }
+        } else if (pause == 2) {
+            usleep(rand_r(&seed) % 200);
+        }
+        uint64_t pingtime = get_sys_clock();
+        send_batch(0, 0, PING, seq, sizeof(batch_hdr));
+        batch_hdr * hdr = recv_batch(0);
+        uint64_t rtt = get_sys_clock() - pingtime;
+        CHECK(hdr->kind == PONG && hdr->seq == seq, "ping %lu answered by %u %lu\n", seq,
+              hdr->kind, hdr->seq);
+        CHECK(rtt < PING_TIMEOUT * 1000000UL, "ping %lu took %lu ms\n", seq, rtt / 1000000);
+        max_ping = std::max(max_ping, rtt);
+        free(hdr);
+    }
+    printf("shm_transport_test: slowest of %lu pings %lu us\n", ping_cnt, max_ping / 1000);
+    return NULL;
+}
+
+// Node 0: receives the batches of ring thread, and answers the pings in ring 0.
+static void * run_receiver(void * arg) {
+    uint64_t thread = (uint64_t) arg;
+    usleep(FULL_PAUSE * 1000);
+    for (uint64_t seq = 0; seq < batch_cnt; seq++) {
+        batch_hdr * hdr = recv_batch(thread);
+        CHECK(hdr->kind == BULK && hdr->seq == seq, "batch %lu of send thread %lu came as %u %lu\n",
+              seq, thread, hdr->kind, hdr->seq);
+        free(hdr);
+    }
+    if (thread != 0) return NULL;
+    for (uint64_t seq = 0; seq < ping_cnt; seq++) {
+        batch_hdr * hdr = recv_batch(0);
+        CHECK(hdr->kind == PING && hdr->seq == seq, "ping %lu came as %u %lu\n", seq, hdr->kind,
+              hdr->seq);
+        send_batch(0, 1, PONG, seq, sizeof(batch_hdr));
+        free(hdr);
+    }
+    return NULL;
+}
+
+// Runs node node_id in a child process, until it is done or killed.
+static pid_t start_node(uint64_t node_id) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    g_node_id = node_id;
+    tport.init();
+    pthread_t thds[THREADS];
+    for (uint64_t i = 0; i < THREADS; i++) {
+        pthread_create(&thds[i], NULL, node_id == 0 ? run_receiver : run_sender, (void *) i);
+    }
+    for (uint64_t i = 0; i < THREADS; i++) pthread_join(thds[i], NULL);
+    tport.shutdown();
+    fflush(stdout);
+    _exit(errors ? 1 : 0);
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) batch_cnt = atol(argv[1]);
+    if (argc > 2) ping_cnt = atol(argv[2]);
+    mem_allocator.init();
+    simulation = new SimManager;
+    char dir[] = "/tmp/shm_transport_test.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    string ifconfig = string(dir) + "/ifconfig.txt";
+    FILE * f = fopen(ifconfig.c_str(), "w");
+    fprintf(f, "127.0.0.1\n127.0.0.1\n");
+    fclose(f);
+    setenv("SCHEMA_PATH", (string(dir) + "/").c_str(), 1);
+    fflush(stdout);
+
+    // node 0 waits for node 1 once its segment is there
+    string seg = "/dev/shm/deneva_" + std::to_string(TPORT_PORT) + "_0";
+    unlink(seg.c_str());
+    pid_t stale = start_node(0);
+    while (access(seg.c_str(), F_OK) != 0) usleep(1000);
+    usleep(100000);
+    kill(stale, SIGKILL);
+    waitpid(stale, NULL, 0);
+
+    pid_t node1 = start_node(1);
+    usleep(300000);
+    pid_t node0 = start_node(0);
+    // a node that fails leaves the other one waiting, so the first failure ends the run
+    uint64_t running = 2;
+    for (uint64_t i = 0; i < RUN_TIMEOUT * 100 && running > 0 && !errors; i++) {
+        int status;
+        if (waitpid(-1, &status, WNOHANG) <= 0) {
+            usleep(10000);
+            continue;
+        }
+        running--;
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) errors++;
+    }
+    if (running > 0) {
+        if (!errors) printf("shm_transport_test: not done after %d s\n", RUN_TIMEOUT);
+        kill(node0, SIGKILL);
+        kill(node1, SIGKILL);
+        errors++;
+    }
+    unlink(ifconfig.c_str());
+    rmdir(dir);
+    printf("shm_transport_test (SHM_RING_SIZE %lu): %lu batches per thread, %lu pings, %s\n",
+           (uint64_t) SHM_RING_SIZE, batch_cnt, ping_cnt, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of TableSnapshot. A workload of one table in two partitions, with a primary index, a
+   secondary index whose items are chained, two rows to a key, and a nonunique index, is
+   generated and saved. A second workload loads the snapshot in parallel, and every key of every
+   index must read back the rows of the first, field for field. Then copies of the file with an
+   entry pointing past the rows of its table, with an entry in a partition that does not exist,
+   and cut short must all be refused, leaving the indexes of the workload empty.
+
+       ./tests/snapshot_test [ROWS]
+*/
+
+#include "global.h"
+#include "catalog.h"
+#include "helper.h"
+#include "index_hash.h"
+#include "manager.h"
+#include "mem_alloc.h"
+#include "row.h"
+#include "sim_manager.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "table.h"
+#include "txn.h"
+#include "txn_table.h"
+#include "wl.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#define FIELD_CNT 4
+#define FIELD_SIZE 8
+// the nonunique index has this many keys
+#define GROUP_CNT 1000
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+Manager glob_manager;
+TxnTable txn_table;
+bool g_central_man = false;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 2;
+UInt32 g_node_cnt = 1;
+UInt32 g_node_id = 0;
+UInt32 g_init_parallelism = 4;
+UInt64 g_synth_table_size = 100000;
+UInt32 g_field_per_tuple = FIELD_CNT;
+UInt32 g_num_wh = 0;
+UInt32 g_dist_per_wh = 0;
+UInt32 g_cust_per_dist = 0;
+UInt32 g_max_items = 0;
+UInt32 g_max_part_key = 0;
+UInt32 g_max_product_key = 0;
+UInt32 g_max_supplier_key = 0;
+char * snapshot_dir = NULL;
+
+bool SimManager::is_warmup_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+void itemid_t::init() {
+    valid = false;
+    location = 0;
+    next = NULL;
+}
+// the rows are always inserted with their partition
+uint64_t get_part_id(void * addr) { assert(false); return 0; }
+
+// row_t links in Row_lock, which no transaction calls here
+void Manager::lock_row(row_t * row) { assert(false); }
+void Manager::release_row(row_t * row) { assert(false); }
+void TxnTable::restart_txn(uint64_t thd_id, uint64_t txn_id, uint64_t batch_id) {}
+uint64_t TxnManager::get_thd_id() { return 0; }
+txnid_t TxnManager::get_txn_id() const { return 0; }
+ts_t TxnManager::get_timestamp() { return 0; }
+uint64_t TxnManager::decr_lr() { return 0; }
+
+static uint64_t errors = 0;
+
+#define CHECK(cond) \
+    if (!(cond)) { \
+        if (errors++ < 10) printf("%s:%d: %s failed\n", __FILE__, __LINE__, #cond); \
+    }
+
+class TestWorkload : public Workload {
+public:
+    RC init() {
+        init_schema(schema_path);
+        table = tables["MAIN_TABLE"];
+        primary = indexes["PRIMARY"];
+        secondary = indexes["SECONDARY"];
+        groups = indexes["GROUPS"];
+        return RCOK;
+    }
+    // rows of random data, each in the partition of its key
+    RC init_table() {
+        unsigned seed = 1;
+        for (uint64_t key = 0; key < g_synth_table_size; key++) {
+            row_t * row;
+            uint64_t row_id;
+            table->get_new_row(row, key % g_part_cnt, row_id);
+            row->set_primary_key(key);
+            for (UInt32 fid = 0; fid < FIELD_CNT; fid++) {
+                uint64_t value = rand_r(&seed);
+                row->set_value(fid, &value);
+            }
+            index_insert(primary, key, row, key % g_part_cnt);
+            index_insert(secondary, key / 2, row, key / 2 % g_part_cnt);
+            index_insert_nonunique(groups, key % GROUP_CNT, row, key % GROUP_CNT % g_part_cnt);
+        }
+        return RCOK;
+    }
+    RC get_txn_man(TxnManager *& txn_manager) { return RCOK; }
+
+    static const char * schema_path;
+    table_t * table;
+    INDEX * primary;
+    INDEX * secondary;
+    INDEX * groups;
+};
+
+const char * TestWorkload::schema_path;
+
+// the primary keys of the rows of key, in order
+static std::vector<uint64_t> read_rows(INDEX * index, uint64_t key, bool nonunique) {
+    std::vector<uint64_t> keys;
+    if (!index->index_exist(key)) return keys;
+    itemid_t * item;
+    if (nonunique) {
+        for (int count = 0; ; count++) {
+            index->index_read(key, count, item, 0);
+            if (item == NULL) break;
+            keys.push_back(((row_t *) item->location)->get_primary_key());
+        }
+    } else {
+        index->index_read(key, item, 0, 0);
+        for (; item != NULL; item = item->next) {
+            keys.push_back(((row_t *) item->location)->get_primary_key());
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+static void check_rows(INDEX * saved, INDEX * loaded, uint64_t key_cnt, bool nonunique) {
+    for (uint64_t key = 0; key < key_cnt; key++) {
+        CHECK(read_rows(saved, key, nonunique) == read_rows(loaded, key, nonunique));
+    }
+}
+
+// the partition and data of each row, found through the primary indexes
+static void check_data(TestWorkload & saved, TestWorkload & loaded) {
+    for (uint64_t key = 0; key < g_synth_table_size; key++) {
+        itemid_t * saved_item;
+        itemid_t * loaded_item;
+        saved.primary->index_read(key, saved_item, 0, 0);
+        loaded.primary->index_read(key, loaded_item, 0, 0);
+        row_t * saved_row = (row_t *) saved_item->location;
+        row_t * loaded_row = (row_t *) loaded_item->location;
+        CHECK(loaded_row->get_part_id() == saved_row->get_part_id());
+        CHECK(!memcmp(loaded_row->get_data(), saved_row->get_data(),
+                      saved_row->get_tuple_size()));
+    }
+}
+
+static std::string read_file(const std::string & path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void write_file(const std::string & path, const std::string & data) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+}
+
+// offset of the first entry of the first index in a snapshot image
+static uint64_t first_entry(const std::string & image) {
+    const snapshot_header * header = (const snapshot_header *) image.data();
+    uint64_t pos = sizeof(snapshot_header);
+    for (uint64_t i = 0; i < header->table_cnt; i++) {
+        const snapshot_table * sec = (const snapshot_table *) (image.data() + pos);
+        pos += sizeof(snapshot_table) +
+               sec->row_cnt * (sizeof(snapshot_row) + (sec->tuple_size + 7) / 8 * 8);
+    }
+    return pos + sizeof(snapshot_index);
+}
+
+// loads a damaged copy of the snapshot, which must be refused
+static void check_refused(const char * what, const std::string & path,
+                          const std::string & image) {
+    write_file(path, image);
+    TestWorkload wl;
+    wl.init();
+    TableSnapshot::loaded = false;
+    if (TableSnapshot::load(&wl) || TableSnapshot::loaded) {
+        printf("snapshot with %s loaded\n", what);
+        errors++;
+    }
+    for (uint64_t key = 0; key < g_synth_table_size; key++) {
+        CHECK(!wl.primary->index_exist(key) && !wl.groups->index_exist(key % GROUP_CNT));
+    }
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) g_synth_table_size = atol(argv[1]);
+    char dir[] = "/tmp/snapshot_test_XXXXXX";
+    snapshot_dir = mkdtemp(dir);
+    const std::string schema_path = std::string(snapshot_dir) + "/schema.txt";
+    std::ofstream schema(schema_path);
+    schema << "TABLE=MAIN_TABLE\n";
+    for (UInt32 fid = 0; fid < FIELD_CNT; fid++) {
+        schema << "\t" << FIELD_SIZE << ",int64_t,F" << fid << "\n";
+    }
+    schema << "\nINDEX=PRIMARY\nMAIN_TABLE,0\n\nINDEX=SECONDARY\nMAIN_TABLE,0\n\n"
+           << "INDEX=GROUPS\nMAIN_TABLE,0\n\n";
+    schema.close();
+    TestWorkload::schema_path = schema_path.c_str();
+    mem_allocator.init();
+    simulation = new SimManager;
+
+    TestWorkload saved;
+    saved.init();
+    CHECK(!TableSnapshot::load(&saved));
+    saved.init_table();
+    TableSnapshot::save(&saved);
+
+    TestWorkload loaded;
+    loaded.init();
+    CHECK(TableSnapshot::load(&loaded) && TableSnapshot::loaded);
+    check_rows(saved.primary, loaded.primary, g_synth_table_size, false);
+    check_rows(saved.secondary, loaded.secondary, g_synth_table_size / 2, false);
+    check_rows(saved.groups, loaded.groups, GROUP_CNT, true);
+    check_data(saved, loaded);
+
+    // the only snapshot in the directory
+    std::string path;
+    DIR * entries = opendir(snapshot_dir);
+    for (dirent * entry = readdir(entries); entry != NULL; entry = readdir(entries)) {
+        const std::string name = entry->d_name;
+        if (name.size() > 5 && name.compare(name.size() - 5, 5, ".snap") == 0) {
+            path = std::string(snapshot_dir) + "/" + name;
+        }
+    }
+    closedir(entries);
+    if (path.empty()) {
+        printf("no snapshot saved\n");
+        errors++;
+    } else {
+        const std::string image = read_file(path);
+        std::string bad = image;
+        ((snapshot_entry *) &bad[first_entry(image)])->row_idx = g_synth_table_size;
+        check_refused("a row past the table", path, bad);
+        bad = image;
+        ((snapshot_entry *) &bad[first_entry(image)])->part_id = g_part_cnt;
+        check_refused("an entry in no partition", path, bad);
+        check_refused("the end cut off", path, image.substr(0, image.size() - 8));
+        unlink(path.c_str());
+    }
+    unlink(schema_path.c_str());
+    rmdir(snapshot_dir);
+
+    printf("snapshot_test: %lu rows, %s\n", (uint64_t) g_synth_table_size,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
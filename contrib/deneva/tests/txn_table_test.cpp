@@ -0,0 +1,188 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Concurrent test of TxnTable, built under ASan with TXN_TABLE_RETIRE_BATCH 1, so that a thread
+   reclaims its removed nodes on every removal. Threads start and release transactions of their
+   own in a table of a few buckets, register the timestamp of each with update_min_ts(), look up
+   the transactions of the other threads and call get_min_ts(). The pools free what is put back
+   to them, so a node or TxnManager that is read after it was reclaimed is a use after free.
+   get_min_ts() must never return more than the oldest transaction of the caller or less than the
+   oldest transaction any thread had when it was called. Afterwards the table must be empty.
+
+       ./tests/txn_table_test [OPS_PER_THREAD] [THREADS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "pool.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "txn.h"
+#include "txn_table.h"
+#include "work_queue.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <deque>
+
+#define MAX_THREADS 64
+// transactions a thread has in the table at most
+#define MAX_LIVE 4
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+TxnTable txn_table;
+TxnManPool txn_man_pool;
+TxnTablePool txn_table_pool;
+QWorkQueue work_queue;
+UInt32 g_total_thread_cnt;
+// a table of 8 buckets, each with a list of several transactions
+int32_t g_inflight_max = 7;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt32 g_node_id = 0;
+
+bool SimManager::is_warmup_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+static volatile uint64_t node_put_cnt = 0;
+
+// The pools hand out fresh memory and free what comes back. Only the members TxnTable uses are
+// set up; the transaction managers are zeroed memory.
+void TxnTablePool::get(uint64_t thd_id, txn_node *& item) { item = new txn_node; }
+void TxnTablePool::put(uint64_t thd_id, txn_node * item) {
+    __sync_fetch_and_add(&node_put_cnt, 1);
+    delete item;
+}
+void TxnManPool::get(uint64_t thd_id, TxnManager *& item) {
+    item = (TxnManager *) calloc(1, sizeof(TxnManager));
+    item->txn = (Transaction *) calloc(1, sizeof(Transaction));
+}
+void TxnManPool::put(uint64_t thd_id, TxnManager * item) {
+    free(item->txn);
+    free(item);
+}
+void TxnManager::set_txn_id(txnid_t txn_id) { txn->txn_id = txn_id; }
+
+// restart_txn() is not tested
+Message * Message::create_message(TxnManager * txn, RemReqType rtype) {
+    assert(false);
+    return NULL;
+}
+void QWorkQueue::enqueue(uint64_t thd_id, Message * msg, bool busy) { assert(false); }
+
+static uint64_t op_cnt = 50000;
+static uint64_t thd_cnt = 4;
+static volatile uint64_t next_txn_id = 1;
+static volatile uint64_t next_ts = 1;
+// the oldest timestamp each thread may have in the table, UINT64_MAX if none
+static volatile uint64_t oldest[MAX_THREADS];
+// recent transactions of each thread, some released already, for the other threads to look up
+static volatile uint64_t published[MAX_THREADS][MAX_LIVE];
+static volatile uint64_t errors = 0;
+
+static void error(const char * what, uint64_t thd_id) {
+    if (__sync_fetch_and_add(&errors, 1) < 10) printf("%s in thread %lu\n", what, thd_id);
+}
+
+struct live_txn {
+    uint64_t txn_id;
+    uint64_t ts;
+    TxnManager * txn_man;
+};
+
+static void start(uint64_t thd_id, std::deque<live_txn> & live) {
+    live_txn t;
+    t.txn_id = __sync_fetch_and_add(&next_txn_id, 1);
+    t.ts = __sync_fetch_and_add(&next_ts, 1);
+    // the newest transaction of the thread, so it is the oldest only if it is alone
+    if (live.empty()) oldest[thd_id] = t.ts;
+    __sync_synchronize();
+    t.txn_man = txn_table.get_transaction_manager(thd_id, t.txn_id, 0);
+    if (t.txn_man == NULL || t.txn_man->txn->txn_id != t.txn_id) {
+        error("wrong TxnManager for a new transaction", thd_id);
+    } else if (txn_table.get_transaction_manager(thd_id, t.txn_id, 0) != t.txn_man) {
+        error("second TxnManager for a transaction", thd_id);
+    }
+    txn_table.update_min_ts(thd_id, t.txn_id, 0, t.ts);
+    published[thd_id][t.txn_id % MAX_LIVE] = t.txn_id;
+    live.push_back(t);
+}
+
+static void release(uint64_t thd_id, std::deque<live_txn> & live) {
+    const live_txn t = live.front();
+    live.pop_front();
+    txn_table.release_transaction_manager(thd_id, t.txn_id, 0);
+    __sync_synchronize();
+    oldest[thd_id] = live.empty() ? UINT64_MAX : live.front().ts;
+}
+
+static void check_min_ts(uint64_t thd_id, const std::deque<live_txn> & live) {
+    uint64_t low = UINT64_MAX;
+    for (uint64_t i = 0; i < thd_cnt; i++) low = std::min(low, (uint64_t) oldest[i]);
+    __sync_synchronize();
+    const uint64_t min_ts = txn_table.get_min_ts(thd_id);
+    if (min_ts < low) error("get_min_ts below every transaction", thd_id);
+    if (!live.empty() && min_ts > live.front().ts) error("get_min_ts missed a transaction", thd_id);
+}
+
+static void * run_worker(void * arg) {
+    const uint64_t thd_id = (uint64_t) arg;
+    unsigned seed = thd_id + 1;
+    std::deque<live_txn> live;
+    for (uint64_t i = 0; i < op_cnt; i++) {
+        const uint32_t op = rand_r(&seed) % 8;
+        if (op < 3) {
+            if (live.size() < MAX_LIVE) start(thd_id, live);
+            else release(thd_id, live);
+        } else if (op < 6) {
+            if (!live.empty()) release(thd_id, live);
+        } else if (op == 6) {
+            // a timestamp above that of the transaction, which leaves its min_ts alone
+            const uint64_t other = rand_r(&seed) % thd_cnt;
+            const uint64_t txn_id = published[other][rand_r(&seed) % MAX_LIVE];
+            if (txn_id != 0) txn_table.update_min_ts(thd_id, txn_id, 0, next_ts);
+        } else {
+            check_min_ts(thd_id, live);
+        }
+    }
+    while (!live.empty()) release(thd_id, live);
+    return NULL;
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) op_cnt = atol(argv[1]);
+    if (argc > 2) thd_cnt = std::min((uint64_t) atol(argv[2]), (uint64_t) MAX_THREADS);
+    g_total_thread_cnt = thd_cnt + 1;
+    mem_allocator.init();
+    simulation = new SimManager;
+    txn_table.init();
+    for (uint64_t i = 0; i < thd_cnt; i++) oldest[i] = UINT64_MAX;
+
+    pthread_t thds[MAX_THREADS];
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_create(&thds[i], NULL, run_worker, (void *) i);
+    for (uint64_t i = 0; i < thd_cnt; i++) pthread_join(thds[i], NULL);
+
+    if (txn_table.get_min_ts(0) != UINT64_MAX) error("transactions left", 0);
+    if (node_put_cnt == 0) error("no node reclaimed", 0);
+
+    printf("txn_table_test: %lu transactions in %lu threads, %lu nodes reclaimed, %s\n",
+           next_txn_id - 1, thd_cnt, node_put_cnt, errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Randomized test of UndoLog. Each round makes overlapping random writes to a few rows and logs
+   them, enough to make the log grow, then either rolls back, after which every row must equal its
+   copy byte for byte, or commits by clearing the log and taking new copies.
+
+       ./tests/undo_log_test [ROUNDS]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <random>
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "row.h"
+#include "undo_log.h"
+
+#define ROW_CNT 16
+#define TUPLE_SIZE 1000
+// a round makes up to MAX_WRITES writes of up to MAX_WRITE_LEN bytes
+#define MAX_WRITES 400
+#define MAX_WRITE_LEN 64
+
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+UInt32 g_node_cnt = 1;
+UInt32 g_thread_cnt = 1;
+mem_alloc mem_allocator;
+
+int main(int argc, char ** argv) {
+    const uint64_t round_cnt = argc > 1 ? atol(argv[1]) : 2000;
+    std::mt19937_64 rand(1);
+    row_t rows[ROW_CNT];
+    char copies[ROW_CNT][TUPLE_SIZE];
+    for (uint64_t i = 0; i < ROW_CNT; i++) {
+        rows[i].tuple_size = TUPLE_SIZE;
+        rows[i].data = (char *) malloc(TUPLE_SIZE);
+        for (uint64_t j = 0; j < TUPLE_SIZE; j++) rows[i].data[j] = copies[i][j] = rand();
+    }
+
+    UndoLog log;
+    log.init();
+    uint64_t errors = 0;
+    uint64_t rollbacks = 0;
+    for (uint64_t round = 0; round < round_cnt; round++) {
+        uint64_t write_cnt = rand() % MAX_WRITES;
+        for (uint64_t w = 0; w < write_cnt; w++) {
+            row_t * row = &rows[rand() % ROW_CNT];
+            uint32_t offset = rand() % TUPLE_SIZE;
+            uint32_t len = 1 + rand() % MAX_WRITE_LEN;
+            if (offset + len > TUPLE_SIZE) len = TUPLE_SIZE - offset;
+            log.add(row, offset, len);
+            for (uint32_t j = 0; j < len; j++) row->data[offset + j] = rand();
+        }
+        if (rand() % 2) {
+            log.rollback();
+            rollbacks++;
+            for (uint64_t i = 0; i < ROW_CNT; i++) {
+                if (memcmp(rows[i].data, copies[i], TUPLE_SIZE) != 0) {
+                    if (errors++ < 10) printf("round %lu: row %lu not restored\n", round, i);
+                }
+            }
+        } else {
+            log.clear();
+            for (uint64_t i = 0; i < ROW_CNT; i++) memcpy(copies[i], rows[i].data, TUPLE_SIZE);
+        }
+        if (!log.empty()) {
+            if (errors++ < 10) printf("round %lu: log not empty\n", round);
+        }
+    }
+    log.release();
+    for (uint64_t i = 0; i < ROW_CNT; i++) free(rows[i].data);
+
+    printf("undo_log_test: %lu rounds, %lu rollbacks, %s\n", round_cnt, rollbacks,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
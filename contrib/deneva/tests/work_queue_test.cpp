@@ -0,0 +1,304 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   Test of the per-worker queues of QWorkQueue, built with a WORK_QUEUE_CAPACITY of a few slots so
+   that the rings wrap and fill up all the time.
+
+   First, from a single thread: a worker that steals the continuations of another one takes them
+   in the order they came, and all continuations before any new transaction; new transactions
+   that find the queue of their worker full spill over to the next one; and a continuation that
+   finds the queue of its worker full waits until there is room, as one put into another queue
+   could be taken after a later message of its transaction.
+
+   Then input threads enqueue continuations of transactions of their own and new transactions,
+   while workers dequeue and steal. Every message has to be dequeued once, and the continuations
+   of each transaction in the order they were enqueued. The workers take turns to dequeue, so that
+   the order of the dequeues is the order they see.
+
+       ./tests/work_queue_test [MSGS_PER_THREAD] [WORKERS]
+*/
+
+#include "global.h"
+#include "helper.h"
+#include "mem_alloc.h"
+#include "message.h"
+#include "sim_manager.h"
+#include "stats.h"
+#include "work_queue.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <vector>
+
+#define MAX_WORKERS 64
+#define INPUT_THREADS 2
+// transactions each input thread sends continuations of
+#define TXNS_PER_THREAD 16
+// ms a continuation has to wait for a full queue
+#define FULL_PAUSE 50
+
+mem_alloc mem_allocator;
+SimManager * simulation;
+Stats stats;
+QWorkQueue work_queue;
+UInt32 g_thread_cnt = 4;
+UInt32 g_node_cnt = 1;
+UInt32 g_node_id = 0;
+UInt32 g_client_node_cnt = 0;
+UInt32 g_repl_cnt = 0;
+bool g_part_alloc = false;
+UInt32 g_part_cnt = 1;
+
+// the statistics are counted, for the steals
+bool SimManager::is_warmup_done() { return true; }
+bool SimManager::is_done() { return false; }
+uint64_t get_sys_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+// the Calvin scheduler queue is not used
+uint64_t SimManager::get_worker_epoch() { abort(); }
+void SimManager::next_worker_epoch() { abort(); }
+void SimManager::inc_epoch_txn_cnt() { abort(); }
+void Message::release() { abort(); }
+
+static uint64_t msg_cnt = 20000;
+static volatile uint64_t errors = 0;
+
+#define CHECK(cond, ...) \
+    do { \
+        if (!(cond)) { \
+            if (__sync_fetch_and_add(&errors, 1) < 10) printf(__VA_ARGS__); \
+        } \
+    } while (0)
+
+// Only the members QWorkQueue uses are set up, the rest is zeroed memory. batch_id is the place
+// of a continuation in its transaction, return_node_id the index of the message in msgs.
+static std::vector<Message *> msgs;
+static volatile uint64_t * dequeued;
+static volatile uint64_t new_txn_id = 1UL << 32;
+
+static Message * new_msg(RemReqType rtype, uint64_t txn_id, uint64_t seq) {
+    Message * msg = (Message *) calloc(1, sizeof(Message));
+    msg->rtype = rtype;
+    msg->txn_id = txn_id;
+    msg->batch_id = seq;
+    return msg;
+}
+
+static void enqueue(uint64_t thd_id, Message * msg) { work_queue.enqueue(thd_id, msg, false); }
+
+// the next message of worker thd_id has to be msg, or none if msg is NULL
+static void expect(uint64_t thd_id, Message * msg) {
+    Message * got = work_queue.dequeue(thd_id);
+    if (msg == NULL) {
+        CHECK(got == NULL, "worker %lu dequeued message %lu %lu, expected none\n", thd_id,
+              got->txn_id, got->batch_id);
+        return;
+    }
+    CHECK(got == msg, "worker %lu dequeued %s, expected message %lu %lu\n", thd_id,
+          got ? "another message" : "none", msg->txn_id, msg->batch_id);
+}
+
+// Continuations of two transactions of worker 0 and new transactions: worker 1 steals them
+// in turn with worker 0, continuations first and in order, and the rings wrap.
+static void check_steal_order() {
+    const uint64_t txns[2] = {0, g_thread_cnt};
+    for (uint64_t round = 0; round < 4; round++) {
+        std::vector<Message *> conts;
+        std::vector<Message *> news;
+        // one less than fits, so that the rings wrap in the middle
+        for (uint64_t i = 0; i < WORK_QUEUE_CAPACITY - 1; i++) {
+            if (i % 3 == 0) {
+                news.push_back(new_msg(CL_QRY, new_txn_id++, 0));
+                enqueue(0, news.back());
+            }
+            conts.push_back(new_msg(RQRY, txns[i % 2], round * WORK_QUEUE_CAPACITY + i));
+            enqueue(0, conts.back());
+        }
+        // the new transactions went round robin, worker 1 finds the first in its own queue
+        for (uint64_t i = 0; i < conts.size(); i++) expect(i % 2 == 0 ? 1 : 0, conts[i]);
+        for (uint64_t i = 0; i < news.size(); i++) {
+            Message * got = work_queue.dequeue(1);
+            bool found = false;
+            for (Message * msg : news) found |= msg == got;
+            CHECK(found, "worker 1 dequeued something else than a new transaction\n");
+        }
+        expect(0, NULL);
+        expect(1, NULL);
+        for (Message * msg : conts) free(msg);
+        for (Message * msg : news) free(msg);
+    }
+    CHECK(stats._stats[1]->work_queue_steal_cnt > 0, "worker 1 never stole\n");
+}
+
+// New transactions fill all queues, then worker 1 empties its own and more come, each has to go
+// to worker 1 and none may get lost.
+static void check_spill() {
+    std::vector<Message *> news;
+    for (uint64_t i = 0; i < g_thread_cnt * WORK_QUEUE_CAPACITY; i++) {
+        news.push_back(new_msg(CL_QRY, new_txn_id++, 0));
+        enqueue(0, news.back());
+    }
+    std::vector<Message *> got;
+    // the queue of worker 1 comes first for worker 1
+    for (uint64_t i = 0; i < WORK_QUEUE_CAPACITY; i++) got.push_back(work_queue.dequeue(1));
+    for (uint64_t i = 0; i < WORK_QUEUE_CAPACITY; i++) {
+        news.push_back(new_msg(CL_QRY, new_txn_id++, 0));
+        enqueue(0, news.back());
+    }
+    for (Message * msg = work_queue.dequeue(0); msg; msg = work_queue.dequeue(0)) {
+        got.push_back(msg);
+    }
+    CHECK(got.size() == news.size(), "%lu new transactions enqueued, %lu dequeued\n",
+          news.size(), got.size());
+    for (Message * msg : news) {
+        uint64_t cnt = 0;
+        for (Message * m : got) cnt += m == msg;
+        CHECK(cnt == 1, "new transaction %lu dequeued %lu times\n", msg->txn_id, cnt);
+        free(msg);
+    }
+}
+
+static volatile bool pushed = false;
+
+static void * push_one(void * arg) {
+    enqueue(0, (Message *) arg);
+    pushed = true;
+    return NULL;
+}
+
+// A continuation of worker 0 waits while its queue is full, and then comes after the others.
+static void check_full_wait() {
+    std::vector<Message *> conts;
+    for (uint64_t i = 0; i <= WORK_QUEUE_CAPACITY; i++) conts.push_back(new_msg(RQRY, 0, i));
+    for (uint64_t i = 0; i < WORK_QUEUE_CAPACITY; i++) enqueue(0, conts[i]);
+    pthread_t thd;
+    pthread_create(&thd, NULL, push_one, conts.back());
+    usleep(FULL_PAUSE * 1000);
+    CHECK(!pushed, "continuation did not wait for a full queue\n");
+    expect(1, conts[0]);
+    pthread_join(thd, NULL);
+    for (uint64_t i = 1; i < conts.size(); i++) expect(1, conts[i]);
+    expect(1, NULL);
+    for (Message * msg : conts) free(msg);
+}
+
+static volatile bool input_done = false;
+static volatile uint64_t dequeue_cnt = 0;
+static volatile uint64_t new_cnt = 0;
+// the place of the next continuation of each transaction
+static volatile uint64_t next_seq[INPUT_THREADS * TXNS_PER_THREAD];
+static pthread_mutex_t turn = PTHREAD_MUTEX_INITIALIZER;
+
+static void * run_input(void * arg) {
+    uint64_t thread = (uint64_t) arg;
+    unsigned seed = thread + 1;
+    uint64_t seqs[TXNS_PER_THREAD] = {};
+    for (uint64_t i = 0; i < msg_cnt; i++) {
+        Message * msg = msgs[thread * msg_cnt + i];
+        if (rand_r(&seed) % 4 == 0) {
+            msg->rtype = CL_QRY;
+            msg->txn_id = __sync_fetch_and_add(&new_txn_id, 1);
+        } else {
+            uint64_t txn = rand_r(&seed) % TXNS_PER_THREAD;
+            msg->rtype = RQRY;
+            msg->txn_id = thread * TXNS_PER_THREAD + txn;
+            msg->batch_id = seqs[txn]++;
+        }
+        enqueue(g_thread_cnt + thread, msg);
+    }
+    return NULL;
+}
+
+static void * run_worker(void * arg) {
+    uint64_t thd_id = (uint64_t) arg;
+    while (true) {
+        bool done = input_done;
+        pthread_mutex_lock(&turn);
+        Message * msg = work_queue.dequeue(thd_id);
+        if (msg) {
+            __sync_fetch_and_add(&dequeued[msg->return_node_id], 1);
+            dequeue_cnt++;
+            if (msg->rtype == CL_QRY) {
+                new_cnt++;
+            } else {
+                uint64_t & next = (uint64_t &) next_seq[msg->txn_id];
+                CHECK(msg->batch_id == next, "continuation %lu of transaction %lu dequeued "
+                      "where %lu was next\n", msg->batch_id, msg->txn_id, next);
+                next = msg->batch_id + 1;
+            }
+        }
+        pthread_mutex_unlock(&turn);
+        if (!msg) {
+            if (done) break;
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+int main(int argc, char ** argv) {
+    if (argc > 1) msg_cnt = atol(argv[1]);
+    if (argc > 2) g_thread_cnt = std::min((uint64_t) atol(argv[2]), (uint64_t) MAX_WORKERS);
+    // a thread that stays blocked shows up as a hung test
+    alarm(60);
+    mem_allocator.init();
+    simulation = new SimManager;
+    stats._stats = (Stats_thd **) calloc(g_thread_cnt + INPUT_THREADS, sizeof(Stats_thd *));
+    for (uint64_t i = 0; i < g_thread_cnt + INPUT_THREADS; i++) {
+        stats._stats[i] = (Stats_thd *) calloc(1, sizeof(Stats_thd));
+        // the waits for the latches, as Stats_thd::init() sizes them
+        stats._stats[i]->mtx = (double *) calloc(40, sizeof(double));
+    }
+    work_queue.init();
+
+    check_steal_order();
+    check_spill();
+    check_full_wait();
+
+    const uint64_t total = INPUT_THREADS * msg_cnt;
+    dequeued = (volatile uint64_t *) calloc(total, sizeof(uint64_t));
+    for (uint64_t i = 0; i < total; i++) {
+        msgs.push_back(new_msg(RQRY, 0, 0));
+        msgs.back()->return_node_id = i;
+    }
+    uint64_t steal_cnt = 0;
+    for (uint64_t i = 0; i < g_thread_cnt; i++) steal_cnt -= stats._stats[i]->work_queue_steal_cnt;
+    pthread_t inputs[INPUT_THREADS];
+    pthread_t workers[MAX_WORKERS];
+    for (uint64_t i = 0; i < g_thread_cnt; i++) {
+        pthread_create(&workers[i], NULL, run_worker, (void *) i);
+    }
+    for (uint64_t i = 0; i < INPUT_THREADS; i++) {
+        pthread_create(&inputs[i], NULL, run_input, (void *) i);
+    }
+    for (uint64_t i = 0; i < INPUT_THREADS; i++) pthread_join(inputs[i], NULL);
+    input_done = true;
+    for (uint64_t i = 0; i < g_thread_cnt; i++) pthread_join(workers[i], NULL);
+    for (uint64_t i = 0; i < g_thread_cnt; i++) steal_cnt += stats._stats[i]->work_queue_steal_cnt;
+
+    CHECK(dequeue_cnt == total, "%lu messages enqueued, %lu dequeued\n", total, dequeue_cnt);
+    for (uint64_t i = 0; i < total; i++) {
+        CHECK(dequeued[i] == 1, "message %lu dequeued %lu times\n", i, dequeued[i]);
+        free(msgs[i]);
+    }
+    CHECK(work_queue.get_wq_cnt() == 0 && work_queue.get_txn_cnt() == 0,
+          "%lu continuations and %lu new transactions counted as queued\n",
+          work_queue.get_wq_cnt(), work_queue.get_txn_cnt());
+    printf("work_queue_test (WORK_QUEUE_CAPACITY %lu): %lu messages, %lu new transactions, "
+           "%lu steals, %s\n", (uint64_t) WORK_QUEUE_CAPACITY, total, new_cnt, steal_cnt,
+           errors ? "FAILED" : "passed");
+    return errors ? 1 : 0;
+}
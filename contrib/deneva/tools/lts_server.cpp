@@ -0,0 +1,179 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+/*
+   A stand-in for the LTS, to run LTS_TCP_CLOCK on one machine. It speaks the TCP protocol of
+   lts_wire.h, both the single timestamp requests of TcpLtsSocket and the batched ones of
+   LtsClient, and hands out consecutive timestamps from one counter. Build it with make lts_server.
+
+       ./lts_server [-p PORT] [-d DELAY_US] [-s FIRST_TS] [-m MAX_COUNT]
+
+   -d holds back every response for DELAY_US microseconds without holding up the requests behind
+   it, like a network round trip does. -m grants at most MAX_COUNT timestamps per request; with
+   -m 0 the server ignores the count field, like an LTS that predates it.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include <algorithm>
+#include <deque>
+
+#include "config.h"
+#include "lts_wire.h"
+
+struct lts_resp {
+    uint64_t deadline;
+    char frame[LTS_RESP_LEN];
+};
+
+struct lts_conn {
+    int fd;
+    pthread_mutex_t mtx;
+    pthread_cond_t cond;
+    std::deque<lts_resp> resps;
+    bool closed;
+};
+
+static uint64_t next_ts = 1;
+static uint64_t delay_ns = 0;
+static uint64_t max_count = UINT64_MAX;
+
+static uint64_t get_clock() {
+    timespec tp;
+    clock_gettime(CLOCK_MONOTONIC, &tp);
+    return tp.tv_sec * 1000000000UL + tp.tv_nsec;
+}
+
+static void * write_resps(void * arg) {
+    lts_conn * conn = (lts_conn *) arg;
+    pthread_mutex_lock(&conn->mtx);
+    while (true) {
+        while (conn->resps.empty() && !conn->closed) pthread_cond_wait(&conn->cond, &conn->mtx);
+        if (conn->resps.empty()) break;
+        lts_resp resp = conn->resps.front();
+        conn->resps.pop_front();
+        pthread_mutex_unlock(&conn->mtx);
+        uint64_t now = get_clock();
+        if (resp.deadline > now) {
+            timespec ts = {(time_t) ((resp.deadline - now) / 1000000000UL),
+                           (long) ((resp.deadline - now) % 1000000000UL)};
+            nanosleep(&ts, NULL);
+        }
+        for (uint64_t sent = 0; sent < LTS_RESP_LEN;) {
+            ssize_t bytes = send(conn->fd, resp.frame + sent, LTS_RESP_LEN - sent, MSG_NOSIGNAL);
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes <= 0) break;
+            sent += bytes;
+        }
+        pthread_mutex_lock(&conn->mtx);
+    }
+    pthread_mutex_unlock(&conn->mtx);
+    return NULL;
+}
+
+static void * read_reqs(void * arg) {
+    lts_conn * conn = (lts_conn *) arg;
+    pthread_t writer;
+    pthread_create(&writer, NULL, write_resps, conn);
+    char frame[LTS_REQ_LEN];
+    while (true) {
+        uint64_t recvd = 0;
+        while (recvd < LTS_REQ_LEN) {
+            ssize_t bytes = recv(conn->fd, frame + recvd, LTS_REQ_LEN - recvd, 0);
+            if (bytes < 0 && errno == EINTR) continue;
+            if (bytes <= 0) break;
+            recvd += bytes;
+        }
+        if (recvd < LTS_REQ_LEN) break;
+
+        uint64_t txn_id, txn_ts, count;
+        if (!lts_decode(frame, LTS_REQ_LEN, txn_id, txn_ts, count)) {
+            printf("Bad request, closing connection %d\n", conn->fd);
+            break;
+        }
+        lts_resp resp;
+        resp.deadline = get_clock() + delay_ns;
+        count = std::min(count, max_count);
+        txn_ts = __sync_fetch_and_add(&next_ts, count ? count : 1);
+        if (!lts_encode(resp.frame, LTS_RESP_LEN, txn_id, txn_ts, count)) {
+            printf("Response does not fit, closing connection %d\n", conn->fd);
+            break;
+        }
+        pthread_mutex_lock(&conn->mtx);
+        conn->resps.push_back(resp);
+        pthread_cond_signal(&conn->cond);
+        pthread_mutex_unlock(&conn->mtx);
+    }
+
+    pthread_mutex_lock(&conn->mtx);
+    conn->closed = true;
+    pthread_cond_signal(&conn->cond);
+    pthread_mutex_unlock(&conn->mtx);
+    pthread_join(writer, NULL);
+    close(conn->fd);
+    delete conn;
+    return NULL;
+}
+
+int main(int argc, char * argv[]) {
+    int port = LTS_TCP_PORT;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:d:s:m:")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 'd': delay_ns = strtoull(optarg, NULL, 10) * 1000; break;
+        case 's': next_ts = strtoull(optarg, NULL, 10); break;
+        case 'm': max_count = strtoull(optarg, NULL, 10); break;
+        default:
+            printf("usage: %s [-p PORT] [-d DELAY_US] [-s FIRST_TS] [-m MAX_COUNT]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port);
+    sa.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(listen_fd, (sockaddr *) &sa, sizeof(sa)) < 0 || listen(listen_fd, 128) < 0) {
+        printf("Bind Error: %d %s\n", errno, strerror(errno));
+        return 1;
+    }
+    printf("LTS listening on port %d\n", port);
+    fflush(stdout);
+
+    while (true) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            printf("Accept Error: %d %s\n", errno, strerror(errno));
+            return 1;
+        }
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        lts_conn * conn = new lts_conn;
+        conn->fd = fd;
+        pthread_mutex_init(&conn->mtx, NULL);
+        pthread_cond_init(&conn->cond, NULL);
+        conn->closed = false;
+        pthread_t reader;
+        pthread_create(&reader, NULL, read_reqs, conn);
+        pthread_detach(reader);
+    }
+    return 0;
+}
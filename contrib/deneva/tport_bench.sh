@@ -0,0 +1,71 @@
+#!/bin/bash
+
+# Compare the nanomsg (TCP), epoll (EPOLL) and shared memory (SHM) transports with several server
+# and client nodes on this machine. Run from contrib/deneva:
+#
+#     ./tport_bench.sh [SERVER_NODES] [CLIENT_NODES]
+#
+# config.h and ifconfig.txt are restored on exit, also when a build fails or the script is
+# interrupted. Results go to tport_bench/.
+
+nodes=${1:-4}
+clients=${2:-$nodes}
+out=tport_bench
+mkdir -p $out
+cp config.h $out/config.h.orig
+rm -f $out/ifconfig.txt.orig
+[ -f ifconfig.txt ] && cp ifconfig.txt $out/ifconfig.txt.orig
+
+restore() {
+    cp $out/config.h.orig config.h
+    if [ -f $out/ifconfig.txt.orig ]; then
+        cp $out/ifconfig.txt.orig ifconfig.txt
+    else
+        rm -f ifconfig.txt
+    fi
+    rm -f /dev/shm/deneva_*
+}
+trap restore EXIT
+
+rm -f ifconfig.txt
+for ((i = 0; i < nodes + clients; i++)); do
+    echo 127.0.0.1 >> ifconfig.txt
+done
+
+for tport in TCP EPOLL SHM
+do
+    cp $out/config.h.orig config.h
+    if [ $tport = SHM ]; then
+        sed -i -e "s/^#define TPORT_TYPE .*/#define TPORT_TYPE TCP/" \
+               -e "s/^#define SHM_TPORT .*/#define SHM_TPORT true/" config.h
+    else
+        sed -i -e "s/^#define TPORT_TYPE .*/#define TPORT_TYPE ${tport}/" \
+               -e "s/^#define SHM_TPORT .*/#define SHM_TPORT false/" config.h
+    fi
+    sed -i \
+           -e "s/^#define NODE_CNT .*/#define NODE_CNT ${nodes}/" \
+           -e "s/^#define CLIENT_NODE_CNT .*/#define CLIENT_NODE_CNT ${clients}/" config.h
+    make clean > /dev/null
+    make -j > /dev/null || exit 1
+
+    pids=""
+    for ((i = 0; i < nodes; i++)); do
+        /usr/bin/time -f "%U %S" -o $out/${tport}_time_$i ./rundb -nid$i > $out/${tport}_server_$i.txt &
+        pids="$pids $!"
+    done
+    for ((i = nodes; i < nodes + clients; i++)); do
+        ./runcl -nid$i > $out/${tport}_client_$i.txt &
+        pids="$pids $!"
+    done
+    wait $pids
+
+    # throughput summed over the servers, cpu seconds and input thread idle time per server
+    cat $out/${tport}_server_*.txt | grep "\[summary\]" | tr ',' '\n' | awk -F= -v tport=$tport '
+        $1 == "tput" { tput += $2 }
+        $1 == "msg_recv_idle_time" { idle += $2 }
+        $1 == "msg_send_time" { send += $2 }
+        $1 == "msg_unpack_time" { unpack += $2 }
+        END { printf "%s: tput=%f msg_recv_idle_time=%f msg_send_time=%f msg_unpack_time=%f\n",
+                     tport, tput, idle, send, unpack }'
+    cat $out/${tport}_time_* | awk -v tport=$tport '{ cpu += $1 + $2 } END { printf "%s: cpu=%fs\n", tport, cpu }'
+done
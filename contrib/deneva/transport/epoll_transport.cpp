@@ -0,0 +1,265 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "global.h"
+#include "helper.h"
+#include "transport.h"
+#include "message.h"
+#include "mem_alloc.h"
+
+#if TPORT_TYPE == EPOLL
+
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+/*
+   Every send thread of a node has one TCP connection to every other node, like the nanomsg
+   transport has one socket pair. A node listens on a single port, and the connections it accepts
+   are spread over the epoll instances of its input threads. After connecting, the sender writes
+   its node id.
+*/
+
+static sockaddr_in get_sockaddr(const char * addr, uint64_t port_id) {
+    sockaddr_in sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sin_family = AF_INET;
+    sa.sin_port = htons(port_id);
+    int rc = inet_pton(AF_INET, addr, &sa.sin_addr);
+    M_ASSERT_V(rc == 1, "Bad address in ifconfig.txt: %s\n", addr);
+    return sa;
+}
+
+int Transport::epoll_connect(uint64_t dest_id, uint64_t port_id) {
+    sockaddr_in sa = get_sockaddr(ifaddr[dest_id], port_id);
+    int fd = -1;
+    // the peer may not listen yet
+    while (true) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        assert(fd >= 0);
+        if (::connect(fd, (sockaddr *) &sa, sizeof(sa)) == 0) break;
+        close(fd);
+        usleep(100000);
+    }
+    int opt = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+    // same timeout as the nanomsg sockets, so a send can notice the end of the run
+    timeval timeo = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeo, sizeof(timeo));
+    uint32_t node_id = g_node_id;
+    ssize_t rc = write(fd, &node_id, sizeof(node_id));
+    assert(rc == sizeof(node_id));
+    printf("Sock Connected to %s:%ld %d -> %ld\n", ifaddr[dest_id], port_id, g_node_id, dest_id);
+    return fd;
+}
+
+void Transport::epoll_init() {
+    uint64_t port_id = get_port_id(g_node_id, g_node_id);
+    uint64_t conn_cnt = 0;
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        if (node_id == g_node_id || use_shm(node_id)) continue;
+        conn_cnt += ISCLIENTN(node_id) ? g_client_send_thread_cnt : g_send_thread_cnt;
+    }
+
+    listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    assert(listen_fd >= 0);
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    sockaddr_in sa = get_sockaddr(ifaddr[g_node_id], port_id);
+    if (::bind(listen_fd, (sockaddr *) &sa, sizeof(sa)) < 0 || listen(listen_fd, conn_cnt + 1) < 0) {
+        printf("Bind Error: %d %s\n", errno, strerror(errno));
+        assert(false);
+    }
+    printf("Sock Listening on %s:%ld %d\n", ifaddr[g_node_id], port_id, g_node_id);
+
+    // Sending connections, the peers queue them in their backlog until they accept
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        if (node_id == g_node_id || use_shm(node_id)) continue;
+        uint64_t dest_port_id = get_port_id(node_id, node_id);
+        uint64_t thd_start = ISCLIENTN(g_node_id) ? g_client_thread_cnt + g_client_rem_thread_cnt
+                                                  : g_thread_cnt + g_rem_thread_cnt;
+        uint64_t thd_cnt = ISCLIENTN(g_node_id) ? g_client_send_thread_cnt : g_send_thread_cnt;
+        for (uint64_t thd_id = thd_start; thd_id < thd_start + thd_cnt; thd_id++) {
+            int fd = epoll_connect(node_id, dest_port_id);
+            send_fds.insert(std::make_pair(std::make_pair(node_id, thd_id), fd));
+        }
+    }
+
+    // Receiving connections
+    epoll_fds = new int[g_this_rem_thread_cnt];
+    recv_conns = new std::vector<tcp_conn*>[g_this_rem_thread_cnt];
+    for (uint64_t i = 0; i < g_this_rem_thread_cnt; i++) {
+        epoll_fds[i] = epoll_create1(0);
+        assert(epoll_fds[i] >= 0);
+#if SHM_TPORT
+        // told apart from the connections by its NULL ptr
+        if (shm_wake_fds[i] >= 0) {
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.ptr = NULL;
+            int rc = epoll_ctl(epoll_fds[i], EPOLL_CTL_ADD, shm_wake_fds[i], &ev);
+            assert(rc == 0);
+        }
+#endif
+    }
+    for (uint64_t i = 0; i < conn_cnt; i++) {
+        int fd = accept(listen_fd, NULL, NULL);
+        assert(fd >= 0);
+        uint32_t node_id;
+        ssize_t rc = read(fd, &node_id, sizeof(node_id));
+        assert(rc == sizeof(node_id));
+        assert(node_id < g_total_node_cnt && node_id != g_node_id);
+        // the input thread only reads what epoll reported, so it must never block
+        int flags = 1;
+        ioctl(fd, FIONBIO, &flags);
+
+        tcp_conn * conn = new tcp_conn;
+        conn->fd = fd;
+        conn->node_id = node_id;
+        conn->capacity = 2 * (g_msg_size + sizeof(uint32_t));
+        conn->buf = (char *) mem_allocator.alloc(conn->capacity);
+        conn->start = 0;
+        conn->end = 0;
+
+        uint64_t idx = i % g_this_rem_thread_cnt;
+        epoll_event ev;
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        rc = epoll_ctl(epoll_fds[idx], EPOLL_CTL_ADD, fd, &ev);
+        assert(rc == 0);
+        recv_conns[idx].push_back(conn);
+        printf("Sock Accepted from %d on input thread %ld\n", node_id, idx);
+    }
+    fflush(stdout);
+}
+
+void Transport::epoll_send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,
+                               int size) {
+    uint64_t starttime = get_sys_clock();
+    int fd = send_fds.find(std::make_pair(dest_node_id, send_thread_id))->second;
+
+    uint32_t len = size;
+    iovec iov[2];
+    iov[0].iov_base = &len;
+    iov[0].iov_len = sizeof(len);
+    iov[1].iov_base = sbuf;
+    iov[1].iov_len = size;
+    msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = iov;
+    mh.msg_iovlen = 2;
+    // a blocking send, but it times out so that a full peer at the end of the run can't hang us
+    while (mh.msg_iovlen > 0 && (!simulation->is_setup_done() || !simulation->is_done())) {
+        ssize_t rc = sendmsg(fd, &mh, MSG_NOSIGNAL);
+        if (rc < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            printf("Send Error %d %s\n", errno, strerror(errno));
+            break;
+        }
+        while (mh.msg_iovlen > 0 && (size_t) rc >= mh.msg_iov[0].iov_len) {
+            rc -= mh.msg_iov[0].iov_len;
+            mh.msg_iov++;
+            mh.msg_iovlen--;
+        }
+        if (mh.msg_iovlen > 0) {
+            mh.msg_iov[0].iov_base = (char *) mh.msg_iov[0].iov_base + rc;
+            mh.msg_iov[0].iov_len -= rc;
+        }
+    }
+    nn::freemsg(sbuf);
+    DEBUG("%ld Batch of %d bytes sent to node %ld\n", send_thread_id, size, dest_node_id);
+
+    INC_STATS(send_thread_id, msg_send_time, get_sys_clock() - starttime);
+    INC_STATS(send_thread_id, msg_send_cnt, 1);
+}
+
+// Decode the batch at the front of conn, if it has arrived completely.
+std::vector<Message*> * Transport::epoll_unpack(uint64_t thd_id, tcp_conn * conn) {
+    if (conn->end - conn->start < sizeof(uint32_t)) return NULL;
+    // batches follow each other unpadded, so the length is not aligned
+    uint32_t len;
+    memcpy(&len, &conn->buf[conn->start], sizeof(len));
+    assert(len <= g_msg_size);
+    if (conn->end - conn->start < sizeof(uint32_t) + len) return NULL;
+
+    uint64_t starttime = get_sys_clock();
+    std::vector<Message*> * msgs = Message::create_messages(&conn->buf[conn->start + sizeof(len)]);
+    conn->start += sizeof(len) + len;
+    DEBUG("Batch of %d bytes recv from node %ld\n", len, conn->node_id);
+    INC_STATS(thd_id,msg_recv_cnt,1);
+    INC_STATS(thd_id,msg_recv_msg_cnt,msgs->size());
+    INC_STATS(thd_id,msg_recv_alloc_cnt,1);
+    INC_STATS(thd_id,msg_recv_copy_bytes,len - sizeof(uint32_t) * 3);
+    INC_STATS(thd_id,msg_unpack_time,get_sys_clock()-starttime);
+    return msgs;
+}
+
+std::vector<Message*> * Transport::epoll_recv_msg(uint64_t thd_id) {
+    uint64_t starttime = get_sys_clock();
+    uint64_t idx = thd_id % g_this_rem_thread_cnt;
+    std::vector<tcp_conn*> & conns = recv_conns[idx];
+    bool shm_rings = false;
+#if SHM_TPORT
+    shm_rings = !shm_recv_rings[idx].empty();
+#endif
+    if (conns.empty() && !shm_rings) return NULL;
+    std::vector<Message*> * msgs = NULL;
+
+    // A batch that is already buffered does not make its socket readable again. Start at a
+    // different connection every time so that none of them starves.
+    for (uint64_t i = 0; i < conns.size() && !msgs; i++) {
+        msgs = epoll_unpack(thd_id, conns[(starttime + i) % conns.size()]);
+    }
+    if (msgs) return msgs;
+
+#if SHM_TPORT
+    // local peers write to rings, and write to the wake FIFO of the thread while it sleeps
+    if (shm_rings && (msgs = shm_sleep(thd_id))) return msgs;
+#endif
+    epoll_event events[EPOLL_MAX_EVENTS];
+    int cnt = epoll_wait(epoll_fds[idx], events, EPOLL_MAX_EVENTS, EPOLL_WAIT_TIMEOUT);
+#if SHM_TPORT
+    if (shm_rings) shm_awake(thd_id);
+#endif
+    uint64_t recv_starttime = get_sys_clock();
+    if (cnt <= 0) {
+        INC_STATS(thd_id,msg_recv_idle_time, recv_starttime - starttime);
+        return NULL;
+    }
+    for (int i = 0; i < cnt; i++) {
+        tcp_conn * conn = (tcp_conn *) events[i].data.ptr;
+#if SHM_TPORT
+        if (conn == NULL) {
+            // the rings are read on the next call
+            char wakes[64];
+            while (read(shm_wake_fds[idx], wakes, sizeof(wakes)) > 0) {}
+            continue;
+        }
+#endif
+        if (conn->start > 0) {
+            memmove(conn->buf, &conn->buf[conn->start], conn->end - conn->start);
+            conn->end -= conn->start;
+            conn->start = 0;
+        }
+        ssize_t bytes = read(conn->fd, &conn->buf[conn->end], conn->capacity - conn->end);
+        if (bytes > 0) {
+            conn->end += bytes;
+        } else if (bytes == 0 || (errno != EAGAIN && errno != EINTR)) {
+            // the peer is gone, which happens when the run is over
+            epoll_ctl(epoll_fds[idx], EPOLL_CTL_DEL, conn->fd, NULL);
+        }
+        if (!msgs) msgs = epoll_unpack(thd_id, conn);
+    }
+    INC_STATS(thd_id,msg_recv_time, get_sys_clock() - recv_starttime);
+    return msgs;
+}
+
+#endif
@@ -30,6 +30,36 @@
 #include "da_query.h"
 #include "sundial.h"
 
+// Room a batch reserves for each message, the largest message class.
+static const uint64_t max_msg_size = std::max({
+    sizeof(InitDoneMessage), sizeof(FinishMessage), sizeof(LogMessage), sizeof(LogRspMessage),
+    sizeof(LogFlushedMessage), sizeof(QueryResponseMessage), sizeof(AckMessage),
+    sizeof(PrepareMessage), sizeof(ForwardMessage), sizeof(DoneMessage),
+    sizeof(ClientResponseMessage), sizeof(YCSBClientQueryMessage), sizeof(TPCCClientQueryMessage),
+    sizeof(PPSClientQueryMessage), sizeof(DAClientQueryMessage), sizeof(YCSBQueryMessage),
+    sizeof(TPCCQueryMessage), sizeof(PPSQueryMessage), sizeof(DAQueryMessage)});
+
+msg_batch * msg_batch::create(uint64_t msg_cnt) {
+    uint64_t capacity = msg_cnt * ((max_msg_size + 7) / 8 * 8);
+    msg_batch * batch = (msg_batch *) mem_allocator.alloc(sizeof(msg_batch) + capacity);
+    batch->capacity = capacity;
+    batch->ptr = 0;
+    batch->refcnt = msg_cnt;
+    return batch;
+}
+
+void * msg_batch::alloc(uint64_t size) {
+    assert(size <= max_msg_size);
+    void * p = (char *) (this + 1) + ptr;
+    ptr += (size + 7) / 8 * 8;
+    assert(ptr <= capacity);
+    return p;
+}
+
+void msg_batch::release() {
+    if (ATOM_SUB_FETCH(refcnt, 1) == 0) mem_allocator.free(this, sizeof(msg_batch) + capacity);
+}
+
 std::vector<Message*> * Message::create_messages(char * buf) {
     std::vector<Message*> * all_msgs = new std::vector<Message*>;
     char * data = buf;
@@ -43,8 +73,11 @@ std::vector<Message*> * Message::create_messages(char * buf) {
     assert(dest_id == g_node_id);
     assert(return_id != g_node_id);
     assert(ISCLIENTN(return_id) || ISSERVERN(return_id) || ISREPLICAN(return_id));
+    assert(txn_cnt > 0);
+    msg_batch * batch = msg_batch::create(txn_cnt);
+    all_msgs->reserve(txn_cnt);
     while(txn_cnt > 0) {
-        Message * msg = create_message(&data[ptr]);
+        Message * msg = create_message(&data[ptr], batch);
         msg->return_node_id = return_id;
         ptr += msg->get_size();
         all_msgs->push_back(msg);
@@ -53,11 +86,11 @@ std::vector<Message*> * Message::create_messages(char * buf) {
     return all_msgs;
 }
 
-Message * Message::create_message(char * buf) {
+Message * Message::create_message(char * buf, msg_batch * batch) {
  RemReqType rtype = NO_MSG;
     uint64_t ptr = 0;
     COPY_VAL(rtype,buf,ptr);
-    Message * msg = create_message(rtype);
+    Message * msg = create_message(rtype, batch);
     fflush(stdout);
     msg->copy_from_buf(buf);
     return msg;
@@ -116,70 +149,70 @@ Message * Message::create_message(uint64_t txn_id, uint64_t batch_id, RemReqType
     return msg;
 }
 
-Message * Message::create_message(RemReqType rtype) {
+Message * Message::create_message(RemReqType rtype, msg_batch * batch) {
     Message * msg;
     switch(rtype) {
         case INIT_DONE:
-            msg = new InitDoneMessage;
+            msg = new (batch) InitDoneMessage;
             break;
         case RQRY:
         case RQRY_CONT:
     #if WORKLOAD == YCSB
-        msg = new YCSBQueryMessage;
+        msg = new (batch) YCSBQueryMessage;
     #elif WORKLOAD == TPCC
-        msg = new TPCCQueryMessage;
+        msg = new (batch) TPCCQueryMessage;
     #elif WORKLOAD == PPS
-        msg = new PPSQueryMessage;
+        msg = new (batch) PPSQueryMessage;
     #elif WORKLOAD == DA
-        msg = new DAQueryMessage;
+        msg = new (batch) DAQueryMessage;
     #endif
         msg->init();
         break;
         case RFIN:
-        msg = new FinishMessage;
+        msg = new (batch) FinishMessage;
         break;
         case RQRY_RSP:
-        msg = new QueryResponseMessage;
+        msg = new (batch) QueryResponseMessage;
         break;
         case LOG_MSG:
-        msg = new LogMessage;
+        msg = new (batch) LogMessage;
         break;
         case LOG_MSG_RSP:
-        msg = new LogRspMessage;
+        msg = new (batch) LogRspMessage;
         break;
         case LOG_FLUSHED:
-        msg = new LogFlushedMessage;
+        msg = new (batch) LogFlushedMessage;
         break;
         case CALVIN_ACK:
         case RACK_PREP:
         case RACK_FIN:
-        msg = new AckMessage;
+        msg = new (batch) AckMessage;
         break;
         case CL_QRY:
         case RTXN:
         case RTXN_CONT:
     #if WORKLOAD == YCSB
-        msg = new YCSBClientQueryMessage;
+        msg = new (batch) YCSBClientQueryMessage;
     #elif WORKLOAD == TPCC
-        msg = new TPCCClientQueryMessage;
+        msg = new (batch) TPCCClientQueryMessage;
     #elif WORKLOAD == PPS
-        msg = new PPSClientQueryMessage;
+        msg = new (batch) PPSClientQueryMessage;
     #elif WORKLOAD == DA
-        msg = new DAClientQueryMessage;
+        msg = new (batch) DAClientQueryMessage;
     #endif
         msg->init();
         break;
         case RPREPARE:
-        msg = new PrepareMessage;
+        msg = new (batch) PrepareMessage;
         break;
         case RFWD:
-        msg = new ForwardMessage;
+        msg = new (batch) ForwardMessage;
         break;
         case RDONE:
-        msg = new DoneMessage;
+        msg = new (batch) DoneMessage;
         break;
         case CL_RSP:
-        msg = new ClientResponseMessage;
+        msg = new (batch) ClientResponseMessage;
         break;
         default:
         assert(false);
@@ -189,6 +222,7 @@ Message * Message::create_message(RemReqType rtype) {
     msg->txn_id = UINT64_MAX;
     msg->batch_id = UINT64_MAX;
     msg->return_node_id = g_node_id;
+    msg->batch = batch;
     msg->wq_time = 0;
     msg->mq_time = 0;
     msg->ntwk_time = 0;
@@ -279,116 +313,20 @@ void Message::mcopy_to_buf(char * buf) {
 }
 
 void Message::release_message(Message * msg) {
-    switch(msg->rtype) {
-        case INIT_DONE: {
-            InitDoneMessage * m_msg = (InitDoneMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RQRY:
-        case RQRY_CONT: {
-    #if WORKLOAD == YCSB
-            YCSBQueryMessage * m_msg = (YCSBQueryMessage*)msg;
-    #elif WORKLOAD == TPCC
-            TPCCQueryMessage * m_msg = (TPCCQueryMessage*)msg;
-    #elif WORKLOAD == PPS
-            PPSQueryMessage * m_msg = (PPSQueryMessage*)msg;
-    #elif WORKLOAD == DA
-            DAQueryMessage* m_msg = (DAQueryMessage*)msg;
-    #endif
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RFIN: {
-            FinishMessage * m_msg = (FinishMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RQRY_RSP: {
-            QueryResponseMessage * m_msg = (QueryResponseMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case LOG_MSG: {
-            LogMessage * m_msg = (LogMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case LOG_MSG_RSP: {
-            LogRspMessage * m_msg = (LogRspMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case LOG_FLUSHED: {
-            LogFlushedMessage * m_msg = (LogFlushedMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case CALVIN_ACK:
-        case RACK_PREP:
-        case RACK_FIN: {
-            AckMessage * m_msg = (AckMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case CL_QRY:
-        case RTXN:
-        case RTXN_CONT: {
-    #if WORKLOAD == YCSB
-            YCSBClientQueryMessage * m_msg = (YCSBClientQueryMessage*)msg;
-    #elif WORKLOAD == TPCC
-            TPCCClientQueryMessage * m_msg = (TPCCClientQueryMessage*)msg;
-    #elif WORKLOAD == PPS
-            PPSClientQueryMessage * m_msg = (PPSClientQueryMessage*)msg;
-    #elif WORKLOAD == DA
-            DAClientQueryMessage* m_msg = (DAClientQueryMessage*)msg;
-    #endif
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RPREPARE: {
-            PrepareMessage * m_msg = (PrepareMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RFWD: {
-            ForwardMessage * m_msg = (ForwardMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case RDONE: {
-            DoneMessage * m_msg = (DoneMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        case CL_RSP: {
-            ClientResponseMessage * m_msg = (ClientResponseMessage*)msg;
-            m_msg->release();
-            delete m_msg;
-            break;
-        }
-        default: {
-            assert(false);
-        }
+    msg_batch * batch = msg->batch;
+    msg->release();
+    if (batch) {
+        msg->~Message();
+        batch->release();
+    } else {
+        delete msg;
     }
 }
 /************************/
 
 uint64_t QueryMessage::get_size() {
     uint64_t size = Message::mget_size();
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     size += sizeof(ts);
 #endif
 #if CC_ALG == OCC || CC_ALG == FOCC || CC_ALG == BOCC || CC_ALG == SSI || CC_ALG == WSI
@@ -399,7 +337,7 @@ uint64_t QueryMessage::get_size() {
 
 void QueryMessage::copy_from_txn(TxnManager * txn) {
     Message::mcopy_from_txn(txn);
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     ts = txn->get_timestamp();
     assert(ts != 0);
 #endif
@@ -410,7 +348,7 @@ void QueryMessage::copy_from_txn(TxnManager * txn) {
 
 void QueryMessage::copy_to_txn(TxnManager * txn) {
     Message::mcopy_to_txn(txn);
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     assert(ts != 0);
     txn->set_timestamp(ts);
 #endif
@@ -423,7 +361,7 @@ void QueryMessage::copy_from_buf(char * buf) {
     Message::mcopy_from_buf(buf);
     uint64_t ptr __attribute__ ((unused));
     ptr = Message::mget_size();
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     COPY_VAL(ts,buf,ptr);
     assert(ts != 0);
 #endif
@@ -436,7 +374,7 @@ void QueryMessage::copy_to_buf(char * buf) {
     Message::mcopy_to_buf(buf);
     uint64_t ptr __attribute__ ((unused));
     ptr = Message::mget_size();
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     COPY_BUF(buf,ts,ptr);
     assert(ts != 0);
 #endif
@@ -493,7 +431,8 @@ void YCSBClientQueryMessage::copy_from_buf(char * buf) {
     for(uint64_t i = 0 ; i < size;i++) {
         DEBUG_M("YCSBClientQueryMessage::copy ycsb_request alloc\n");
         ycsb_request * req = (ycsb_request*)mem_allocator.alloc(sizeof(ycsb_request));
-        *req = *reinterpret_cast<ycsb_request*>(buf + ptr);
+        // the messages of a batch are not padded, so the request is not aligned
+        memcpy((void *) req, buf + ptr, sizeof(ycsb_request));
         ptr += sizeof(ycsb_request);
         assert(req->key < g_synth_table_size);
         requests.add(req);
@@ -1411,7 +1350,8 @@ void YCSBQueryMessage::copy_from_buf(char * buf) {
     for(uint64_t i = 0 ; i < size;i++) {
         DEBUG_M("YCSBQueryMessage::copy ycsb_request alloc\n");
         ycsb_request * req = (ycsb_request*)mem_allocator.alloc(sizeof(ycsb_request));
-        *req = *reinterpret_cast<ycsb_request*>(buf + ptr);
+        // the messages of a batch are not padded, so the request is not aligned
+        memcpy((void *) req, buf + ptr, sizeof(ycsb_request));
         ptr += sizeof(ycsb_request);
         ASSERT(req->key < g_synth_table_size);
         requests.add(req);
@@ -20,32 +20,56 @@
 #include "global.h"
 #include "helper.h"
 #include "logger.h"
+#include "mem_alloc.h"
 #include "array.h"
+#include "work_queue.h"
 
 class ycsb_request;
 class LogRecord;
 struct Item_no;
 
+// The messages of a received batch are decoded into one block, which is freed when the last of
+// them is released. The block starts with this header.
+struct msg_batch {
+    static msg_batch * create(uint64_t msg_cnt);
+    void * alloc(uint64_t size);
+    void release();
+
+    uint64_t capacity;
+    uint64_t ptr;
+    volatile uint64_t refcnt;
+};
+
 class Message {
 public:
     virtual ~Message(){}
-    static Message * create_message(char * buf);
+    // messages come from the slab allocator when THREAD_ALLOC or PART_ALLOC is on
+    static void * operator new(size_t size) { return mem_allocator.alloc(size); }
+    static void operator delete(void * ptr, size_t size) { mem_allocator.free(ptr, size); }
+    // decoded messages of a received batch, or a heap message if batch is NULL
+    static void * operator new(size_t size, msg_batch * batch) {
+        return batch ? batch->alloc(size) : mem_allocator.alloc(size);
+    }
+    static void operator delete(void * ptr, msg_batch * batch) {}
+    static Message * create_message(char * buf, msg_batch * batch = NULL);
     static Message * create_message(BaseQuery * query, RemReqType rtype);
     static Message * create_message(TxnManager * txn, RemReqType rtype);
     static Message * create_message(uint64_t txn_id, RemReqType rtype);
     static Message * create_message(uint64_t txn_id,uint64_t batch_id, RemReqType rtype);
     static Message * create_message(LogRecord * record, RemReqType rtype);
-    static Message * create_message(RemReqType rtype);
+    static Message * create_message(RemReqType rtype, msg_batch * batch = NULL);
     static std::vector<Message*> * create_messages(char * buf);
     static void release_message(Message * msg);
     RemReqType rtype;
     uint64_t txn_id;
     uint64_t batch_id;
     uint64_t return_node_id;
+    msg_batch * batch;
 
     uint64_t wq_time;
     uint64_t mq_time;
     uint64_t ntwk_time;
+    work_queue_entry wq_entry;
 
     // Collect other stats
     double lat_work_queue_time;
@@ -374,7 +398,7 @@ public:
     void release() {}
 
     uint64_t pid;
-#if CC_ALG == WAIT_DIE || CC_ALG == TIMESTAMP || CC_ALG == MVCC
+#if CC_ALG == WAIT_DIE || CC_ALG == DL_DETECT || CC_ALG == TIMESTAMP || CC_ALG == MVCC
     uint64_t ts;
 #endif
 #if CC_ALG == MVCC
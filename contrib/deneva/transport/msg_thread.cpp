@@ -25,6 +25,12 @@
 #include "pool.h"
 #include "global.h"
 
+// log2 bucket of the batch histograms in Stats
+static uint64_t hist_bucket(uint64_t value) {
+    uint64_t bucket = 63 - __builtin_clzll(value | 1);
+    return std::min(bucket, (uint64_t) MSG_BATCH_HIST_SIZE - 1);
+}
+
 void MessageThread::init(uint64_t thd_id) {
     buffer_cnt = g_total_node_cnt;
 #if CC_ALG == CALVIN
@@ -37,6 +43,9 @@ void MessageThread::init(uint64_t thd_id) {
         buffer[n] = (mbuf *)mem_allocator.align_alloc(sizeof(mbuf));
         buffer[n]->init(n);
         buffer[n]->reset(n);
+        // until the rate is known, send right away
+        buffer[n]->last_time = 0;
+        buffer[n]->arrival_intv = g_msg_batch_max_delay;
     }
     _thd_id = thd_id;
 }
@@ -44,7 +53,8 @@ void MessageThread::init(uint64_t thd_id) {
 void MessageThread::check_and_send_batches() {
     uint64_t starttime = get_sys_clock();
     for(uint64_t dest_node_id = 0; dest_node_id < buffer_cnt; dest_node_id++) {
-        if(buffer[dest_node_id]->ready()) {
+        if(buffer[dest_node_id]->cnt > 0 &&
+           buffer[dest_node_id]->ready(msg_queue.get_pending(_thd_id, dest_node_id))) {
             send_batch(dest_node_id);
         }
     }
@@ -56,7 +66,10 @@ void MessageThread::send_batch(uint64_t dest_node_id) {
     mbuf * sbuf = buffer[dest_node_id];
     assert(sbuf->cnt > 0);
     ((uint32_t*)sbuf->buffer)[2] = sbuf->cnt;
-    INC_STATS(_thd_id,mbuf_send_intv_time,get_sys_clock() - sbuf->starttime);
+    uint64_t delay = get_sys_clock() - sbuf->starttime;
+    INC_STATS(_thd_id,mbuf_send_intv_time,delay);
+    INC_STATS(_thd_id,msg_batch_size_hist[hist_bucket(sbuf->cnt)],1);
+    INC_STATS(_thd_id,msg_batch_delay_hist[hist_bucket(delay / 1000)],1);
 
     DEBUG("Send batch of %ld msgs to %ld\n",sbuf->cnt,dest_node_id);
     fflush(stdout);
@@ -69,6 +82,8 @@ void MessageThread::send_batch(uint64_t dest_node_id) {
         INC_STATS(_thd_id,msg_batch_size_bytes_to_client,sbuf->ptr);
     }
     INC_STATS(_thd_id,msg_batch_cnt,1);
+    // the transport took over the buffer
+    sbuf->init(dest_node_id);
     sbuf->reset(dest_node_id);
     INC_STATS(_thd_id,mtx[12],get_sys_clock() - starttime);
 }
@@ -141,6 +156,7 @@ void MessageThread::run() {
         Message::release_message(msg);
     }
     if (sbuf->starttime == 0) sbuf->starttime = get_sys_clock();
+    sbuf->arrive(get_sys_clock());
 
     check_and_send_batches();
     INC_STATS(_thd_id,mtx[10],get_sys_clock() - starttime);
@@ -21,12 +21,21 @@
 #include "helper.h"
 #include "nn.hpp"
 
+// Weight of the newest gap in the smoothed gap between messages to a destination
+#define MSG_BATCH_EWMA 0.125
+
+// Messages are encoded straight into a nanomsg buffer of g_msg_size, which is handed to the
+// transport. The nanomsg path shrinks it to the encoded bytes before sending.
 struct mbuf {
     char * buffer;
     uint64_t starttime;
     uint64_t ptr;
     uint64_t cnt;
     bool wait;
+    // arrival of the last message for this destination and the smoothed gap between them, kept
+    // across batches
+    uint64_t last_time;
+    double arrival_intv;
 
     void init(uint64_t dest_id) { buffer = (char *)nn_allocmsg(g_msg_size, 0); }
     void reset(uint64_t dest_id) {
@@ -44,10 +53,32 @@ struct mbuf {
         COPY_BUF_SIZE(buffer,p,ptr,s);
     }
     bool fits(uint64_t s) { return (ptr + s) <= g_msg_size; }
-    bool ready() {
+    void arrive(uint64_t now) {
+        if (last_time > 0) {
+            // A long pause says nothing about the rate once traffic is back, so the rate is
+            // unknown again, as before the first message. Averaging the pauses in instead would
+            // keep the gap just below the deadline, and make every message wait for it.
+            uint64_t gap = now - last_time;
+            if (gap >= g_msg_batch_max_delay) arrival_intv = g_msg_batch_max_delay;
+            else arrival_intv += (gap - arrival_intv) * MSG_BATCH_EWMA;
+        }
+        last_time = now;
+    }
+    // pending: messages for this destination still in the message queue
+    bool ready(uint64_t pending) {
         if (cnt == 0) return false;
-        if ((get_sys_clock() - starttime) >= g_msg_time_limit) return true;
-        return false;
+        uint64_t now = get_sys_clock();
+#if MSG_BATCH_ADAPTIVE
+        if (now - starttime >= g_msg_batch_max_delay) return true;
+        if (pending > 0) return false;
+        // Wait for the next message only if it is expected before the deadline, and stop
+        // waiting once it is clearly late.
+        uint64_t next_time = last_time + (uint64_t) arrival_intv;
+        if (next_time >= starttime + g_msg_batch_max_delay) return true;
+        return now > next_time + (uint64_t) arrival_intv;
+#else
+        return now - starttime >= g_msg_time_limit;
+#endif
     }
 };
 
@@ -0,0 +1,372 @@
+/* Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+
+#include "global.h"
+#include "helper.h"
+#include "transport.h"
+#include "message.h"
+
+#if SHM_TPORT
+
+#include <ifaddrs.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+// after global.h, its LOCK_EX would clash with the flock() one
+#include <fcntl.h>
+
+/*
+   Every node whose address in ifconfig.txt belongs to this machine gets its messages through a
+   segment in /dev/shm instead of a socket. The receiving node creates the segment: a header, one
+   wake word per input thread, and one single producer, single consumer ring for every send
+   thread of every local peer. Each ring is read by one input thread, the rings are spread over
+   them like the epoll connections.
+
+   A batch is copied into the ring behind its size, and decoded by the input thread straight from
+   there. A batch that does not fit before the end of the ring leaves a wrap mark. An input thread
+   that has nothing but rings to listen to sleeps on its wake word once they are all empty, and
+   the sender that finds it sleeping bumps the word and wakes it. One that also listens to sockets
+   sleeps in epoll_wait, which can't wait on a futex, so it gets a FIFO next to the segment, which
+   its epoll instance watches and the sender writes a byte to instead.
+*/
+
+#define SHM_MAGIC 0x64656e657661736dUL
+#define SHM_WRAP UINT32_MAX
+
+struct Transport::shm_header {
+    volatile uint64_t magic;
+    // creator of the segment, a segment left over from an earlier run has a dead one
+    volatile int64_t pid;
+    uint64_t wake_cnt;
+    uint64_t ring_cnt;
+    // the input threads are woken through their FIFOs instead of their wake words
+    uint64_t wake_fifos;
+    // index of the first ring of every node, UINT64_MAX for nodes that are not local
+    uint64_t ring_base[];
+};
+
+struct Transport::shm_wake {
+    volatile uint32_t seq;
+    volatile uint32_t sleeping;
+    char _pad[CL_SIZE - sizeof(uint32_t) * 2];
+};
+
+struct Transport::shm_ring {
+    volatile uint64_t head;  // written by the input thread
+    char _pad1[CL_SIZE - sizeof(uint64_t)];
+    volatile uint64_t tail;  // written by the send thread
+    char _pad2[CL_SIZE - sizeof(uint64_t)];
+    uint64_t wake_id;
+    char _pad3[CL_SIZE - sizeof(uint64_t)];
+    char data[SHM_RING_SIZE];
+};
+
+uint64_t Transport::shm_header_size() {
+    uint64_t size = sizeof(shm_header) + sizeof(uint64_t) * g_total_node_cnt;
+    return (size + CL_SIZE - 1) / CL_SIZE * CL_SIZE;
+}
+
+static uint64_t shm_rec_size(uint64_t size) { return (SHM_REC_HDR + size + 7) / 8 * 8; }
+
+static string shm_name(uint64_t node_id) {
+    return "/deneva_" + std::to_string(TPORT_PORT) + "_" + std::to_string(node_id);
+}
+
+static string shm_wake_path(uint64_t node_id, uint64_t wake_id) {
+    return "/dev/shm" + shm_name(node_id) + "_wake_" + std::to_string(wake_id);
+}
+
+static long futex(volatile uint32_t * addr, int op, uint32_t val, const timespec * timeout) {
+    // not FUTEX_PRIVATE_FLAG, the word is shared with other processes
+    return syscall(SYS_futex, addr, op, val, timeout, NULL, 0);
+}
+
+static bool is_local_addr(ifaddrs * addrs, const char * addr) {
+#if TPORT_TYPE == IPC
+    return true;
+#endif
+    in_addr a;
+    if (inet_pton(AF_INET, addr, &a) != 1) return false;
+    if ((ntohl(a.s_addr) >> 24) == 127) return true;
+    for (ifaddrs * i = addrs; i != NULL; i = i->ifa_next) {
+        if (i->ifa_addr == NULL || i->ifa_addr->sa_family != AF_INET) continue;
+        if (((sockaddr_in *) i->ifa_addr)->sin_addr.s_addr == a.s_addr) return true;
+    }
+    return false;
+}
+
+static bool is_alive(int64_t pid) { return kill(pid, 0) == 0 || errno == EPERM; }
+
+// Maps the segment of a local peer, once it has created it.
+char * Transport::shm_attach(uint64_t node_id) {
+    string name = shm_name(node_id);
+    while (true) {
+        int fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd >= 0) {
+            struct stat st;
+            char * seg = NULL;
+            if (fstat(fd, &st) == 0 && (uint64_t) st.st_size >= shm_header_size()) {
+                seg = (char *) mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                assert(seg != MAP_FAILED);
+            }
+            close(fd);
+            if (seg) {
+                shm_header * hdr = (shm_header *) seg;
+                if (__atomic_load_n(&hdr->magic, __ATOMIC_ACQUIRE) == SHM_MAGIC &&
+                    is_alive(hdr->pid)) {
+                    printf("Shm Attached to %s %d -> %ld\n", name.c_str(), g_node_id, node_id);
+                    return seg;
+                }
+                munmap(seg, st.st_size);
+            }
+        }
+        usleep(100000);
+    }
+}
+
+void Transport::shm_init() {
+    local_nodes = new bool[g_total_node_cnt];
+    ifaddrs * addrs = NULL;
+    if (getifaddrs(&addrs) != 0) addrs = NULL;
+    uint64_t local_cnt = 0;
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        local_nodes[node_id] = node_id != g_node_id && is_local_addr(addrs, ifaddr[node_id]);
+        if (local_nodes[node_id]) local_cnt++;
+    }
+    if (addrs) freeifaddrs(addrs);
+    shm_only = local_cnt == g_total_node_cnt - 1;
+    shm_recv_rings = new std::vector<shm_ring*>[g_this_rem_thread_cnt];
+    peer_wakes = new shm_wake*[g_total_node_cnt];
+    peer_wake_fds = new int*[g_total_node_cnt]();
+    shm_wakes = NULL;
+    shm_wake_fds = new int[g_this_rem_thread_cnt];
+    for (uint64_t i = 0; i < g_this_rem_thread_cnt; i++) shm_wake_fds[i] = -1;
+    printf("Shm %ld of %d nodes are local\n", local_cnt, g_total_node_cnt - 1);
+    if (local_cnt == 0) return;
+
+    // Receiving rings
+    uint64_t header_size = shm_header_size();
+    uint64_t ring_cnt = 0;
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        if (!local_nodes[node_id]) continue;
+        ring_cnt += ISCLIENTN(node_id) ? g_client_send_thread_cnt : g_send_thread_cnt;
+    }
+    uint64_t seg_size = header_size + sizeof(shm_wake) * g_this_rem_thread_cnt +
+                        sizeof(shm_ring) * ring_cnt;
+    string name = shm_name(g_node_id);
+    // left over from an earlier run
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    M_ASSERT_V(fd >= 0, "Shm Error %s: %d %s\n", name.c_str(), errno, strerror(errno));
+    if (ftruncate(fd, seg_size) != 0) {
+        printf("Shm Error %s: %d %s\n", name.c_str(), errno, strerror(errno));
+        assert(false);
+    }
+    char * seg = (char *) mmap(NULL, seg_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    assert(seg != MAP_FAILED);
+    close(fd);
+
+    // a new segment is zero filled
+    shm_header * hdr = (shm_header *) seg;
+    hdr->wake_cnt = g_this_rem_thread_cnt;
+    hdr->ring_cnt = ring_cnt;
+    shm_wakes = (shm_wake *) (seg + header_size);
+    shm_ring * rings = (shm_ring *) (shm_wakes + g_this_rem_thread_cnt);
+    uint64_t ring_id = 0;
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        hdr->ring_base[node_id] = local_nodes[node_id] ? ring_id : UINT64_MAX;
+        if (!local_nodes[node_id]) continue;
+        uint64_t thd_cnt = ISCLIENTN(node_id) ? g_client_send_thread_cnt : g_send_thread_cnt;
+        for (uint64_t i = 0; i < thd_cnt; i++, ring_id++) {
+            rings[ring_id].wake_id = ring_id % g_this_rem_thread_cnt;
+            shm_recv_rings[ring_id % g_this_rem_thread_cnt].push_back(&rings[ring_id]);
+        }
+    }
+#if TPORT_TYPE == EPOLL
+    // opened for writing as well, so that the FIFO never reports a hang up once a sender is gone
+    hdr->wake_fifos = !shm_only;
+    for (uint64_t i = 0; i < g_this_rem_thread_cnt && !shm_only; i++) {
+        string path = shm_wake_path(g_node_id, i);
+        unlink(path.c_str());
+        M_ASSERT_V(mkfifo(path.c_str(), 0600) == 0, "Shm Error %s: %d %s\n", path.c_str(), errno,
+                   strerror(errno));
+        shm_wake_fds[i] = open(path.c_str(), O_RDWR | O_NONBLOCK);
+        assert(shm_wake_fds[i] >= 0);
+    }
+#endif
+    hdr->pid = getpid();
+    __atomic_store_n(&hdr->magic, SHM_MAGIC, __ATOMIC_RELEASE);
+    printf("Shm Created %s with %ld rings\n", name.c_str(), ring_cnt);
+
+    // Sending rings
+    uint64_t thd_start = ISCLIENTN(g_node_id) ? g_client_thread_cnt + g_client_rem_thread_cnt
+                                              : g_thread_cnt + g_rem_thread_cnt;
+    uint64_t thd_cnt = ISCLIENTN(g_node_id) ? g_client_send_thread_cnt : g_send_thread_cnt;
+    for (uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
+        if (!local_nodes[node_id]) continue;
+        char * peer_seg = shm_attach(node_id);
+        shm_header * peer_hdr = (shm_header *) peer_seg;
+        M_ASSERT_V(peer_hdr->ring_base[g_node_id] != UINT64_MAX,
+                   "Node %ld does not take node %d for local\n", node_id, g_node_id);
+        peer_wakes[node_id] = (shm_wake *) (peer_seg + header_size);
+        shm_ring * peer_rings = (shm_ring *) (peer_wakes[node_id] + peer_hdr->wake_cnt);
+        if (peer_hdr->wake_fifos) {
+            // the peer opened them before it published the segment
+            peer_wake_fds[node_id] = new int[peer_hdr->wake_cnt];
+            for (uint64_t i = 0; i < peer_hdr->wake_cnt; i++) {
+                string path = shm_wake_path(node_id, i);
+                peer_wake_fds[node_id][i] = open(path.c_str(), O_WRONLY | O_NONBLOCK);
+                M_ASSERT_V(peer_wake_fds[node_id][i] >= 0, "Shm Error %s: %d %s\n", path.c_str(),
+                           errno, strerror(errno));
+            }
+        }
+        for (uint64_t i = 0; i < thd_cnt; i++) {
+            shm_ring * ring = &peer_rings[peer_hdr->ring_base[g_node_id] + i];
+            shm_send_rings.insert(std::make_pair(std::make_pair(node_id, thd_start + i), ring));
+        }
+    }
+    fflush(stdout);
+}
+
+// Removes the name of the segment of this node, the peers keep their mappings until they exit.
+void Transport::shm_shutdown() {
+    if (shm_wakes == NULL) return;
+    string name = shm_name(g_node_id);
+    shm_unlink(name.c_str());
+    for (uint64_t i = 0; i < g_this_rem_thread_cnt; i++) {
+        if (shm_wake_fds[i] >= 0) unlink(shm_wake_path(g_node_id, i).c_str());
+    }
+    printf("Shm Unlinked %s\n", name.c_str());
+}
+
+void Transport::shm_send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,
+                             int size) {
+    uint64_t starttime = get_sys_clock();
+    shm_ring * ring = shm_send_rings.find(std::make_pair(dest_node_id, send_thread_id))->second;
+    assert(shm_rec_size(size) <= SHM_RING_SIZE / 2);
+
+    uint64_t need = shm_rec_size(size);
+    uint64_t tail = ring->tail;
+    uint64_t off = tail % SHM_RING_SIZE;
+    uint64_t wrap = off + need > SHM_RING_SIZE ? SHM_RING_SIZE - off : 0;
+    // wait for the input thread to make room, unless the run is over
+    bool full = true;
+    while ((full = tail + wrap + need - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) >
+                   SHM_RING_SIZE) &&
+           (!simulation->is_setup_done() || !simulation->is_done())) {
+        sched_yield();
+    }
+    if (!full) {
+        if (wrap > 0) {
+            *(uint32_t *) &ring->data[off] = SHM_WRAP;
+            tail += wrap;
+            off = 0;
+        }
+        *(uint32_t *) &ring->data[off] = size;
+        memcpy(&ring->data[off + SHM_REC_HDR], sbuf, size);
+        __atomic_store_n(&ring->tail, tail + need, __ATOMIC_RELEASE);
+
+        // pairs with the fence of an input thread going to sleep
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        shm_wake * wake = &peer_wakes[dest_node_id][ring->wake_id];
+        if (wake->sleeping && peer_wake_fds[dest_node_id]) {
+            // any byte wakes the thread, and a full FIFO already does
+            char c = 0;
+            if (write(peer_wake_fds[dest_node_id][ring->wake_id], &c, 1) < 0 && errno != EAGAIN) {
+                printf("Shm Wake Error %d %s\n", errno, strerror(errno));
+            }
+        } else if (wake->sleeping) {
+            __atomic_add_fetch(&wake->seq, 1, __ATOMIC_SEQ_CST);
+            futex(&wake->seq, FUTEX_WAKE, INT_MAX, NULL);
+        }
+    }
+    nn::freemsg(sbuf);
+    DEBUG("%ld Batch of %d bytes sent to node %ld\n", send_thread_id, size, dest_node_id);
+
+    INC_STATS(send_thread_id, msg_send_time, get_sys_clock() - starttime);
+    INC_STATS(send_thread_id, msg_send_cnt, 1);
+}
+
+// Decode the batch at the head of ring, if there is one.
+std::vector<Message*> * Transport::shm_unpack(uint64_t thd_id, shm_ring * ring) {
+    uint64_t head = ring->head;
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) return NULL;
+    uint64_t off = head % SHM_RING_SIZE;
+    uint32_t len = *(uint32_t *) &ring->data[off];
+    if (len == SHM_WRAP) {
+        // the sender publishes the wrap mark together with the batch behind it
+        head += SHM_RING_SIZE - off;
+        off = 0;
+        len = *(uint32_t *) &ring->data[off];
+    }
+    assert(len <= g_msg_size);
+
+    uint64_t starttime = get_sys_clock();
+    std::vector<Message*> * msgs = Message::create_messages(&ring->data[off + SHM_REC_HDR]);
+    __atomic_store_n(&ring->head, head + shm_rec_size(len), __ATOMIC_RELEASE);
+    DEBUG("Batch of %d bytes recv from shm\n", len);
+    INC_STATS(thd_id,msg_recv_cnt,1);
+    INC_STATS(thd_id,msg_recv_msg_cnt,msgs->size());
+    INC_STATS(thd_id,msg_recv_alloc_cnt,1);
+    INC_STATS(thd_id,msg_recv_copy_bytes,len - sizeof(uint32_t) * 3);
+    INC_STATS(thd_id,msg_unpack_time,get_sys_clock()-starttime);
+    return msgs;
+}
+
+std::vector<Message*> * Transport::shm_recv_msg(uint64_t thd_id) {
+    uint64_t starttime = get_sys_clock();
+    uint64_t idx = thd_id % g_this_rem_thread_cnt;
+    std::vector<shm_ring*> & rings = shm_recv_rings[idx];
+    if (rings.empty()) return NULL;
+    std::vector<Message*> * msgs = NULL;
+
+    // start at a different ring every time so that none of them starves
+    uint64_t first = starttime % rings.size();
+    for (uint64_t i = 0; i < rings.size() && !msgs; i++) {
+        msgs = shm_unpack(thd_id, rings[(first + i) % rings.size()]);
+    }
+    if (msgs || !shm_only) return msgs;
+
+    // Nothing else to listen to, so sleep until a sender wakes us up. The timeout lets the
+    // thread notice the end of the run.
+    shm_wake * wake = &shm_wakes[idx];
+    uint32_t seq = wake->seq;
+    msgs = shm_sleep(thd_id);
+    if (!msgs) {
+        timespec timeout = {SHM_WAIT_TIMEOUT / 1000, SHM_WAIT_TIMEOUT % 1000 * 1000000L};
+        futex(&wake->seq, FUTEX_WAIT, seq, &timeout);
+        shm_awake(thd_id);
+        INC_STATS(thd_id,msg_recv_idle_time, get_sys_clock() - starttime);
+    }
+    return msgs;
+}
+
+// Marks input thread thd_id sleeping, so that the senders wake it, unless a batch came in before
+// they can have seen the mark. The thread clears the mark with shm_awake() once it wakes up.
+std::vector<Message*> * Transport::shm_sleep(uint64_t thd_id) {
+    uint64_t idx = thd_id % g_this_rem_thread_cnt;
+    std::vector<shm_ring*> & rings = shm_recv_rings[idx];
+    std::vector<Message*> * msgs = NULL;
+    shm_wakes[idx].sleeping = 1;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (uint64_t i = 0; i < rings.size() && !msgs; i++) {
+        msgs = shm_unpack(thd_id, rings[i]);
+    }
+    if (msgs) shm_awake(thd_id);
+    return msgs;
+}
+
+void Transport::shm_awake(uint64_t thd_id) {
+    shm_wakes[thd_id % g_this_rem_thread_cnt].sleeping = 0;
+}
+
+#endif
@@ -185,9 +185,16 @@ void Transport::init() {
 
     string path = get_path();
     read_ifconfig(path.c_str());
+#if SHM_TPORT
+    shm_init();
+#endif
+#if TPORT_TYPE == EPOLL
+    epoll_init();
+    return;
+#endif
 
     for(uint64_t node_id = 0; node_id < g_total_node_cnt; node_id++) {
-        if (node_id == g_node_id) continue;
+        if (node_id == g_node_id || use_shm(node_id)) continue;
         // Listening ports
         if(ISCLIENTN(node_id)) {
             for (uint64_t client_thread_id = g_client_thread_cnt + g_client_rem_thread_cnt;
@@ -240,14 +247,39 @@ void Transport::init() {
     fflush(stdout);
 }
 
+bool Transport::use_shm(uint64_t node_id) {
+#if SHM_TPORT
+    return local_nodes[node_id];
+#else
+    return false;
+#endif
+}
+
+void Transport::shutdown() {
+#if SHM_TPORT
+    shm_shutdown();
+#endif
+}
+
 // rename sid to send thread id
 void Transport::send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,int size) {
+    if (use_shm(dest_node_id)) {
+#if SHM_TPORT
+        shm_send_msg(send_thread_id, dest_node_id, sbuf, size);
+#endif
+        return;
+    }
+#if TPORT_TYPE == EPOLL
+    epoll_send_msg(send_thread_id, dest_node_id, sbuf, size);
+    return;
+#endif
     uint64_t starttime = get_sys_clock();
 
     Socket * socket = send_sockets.find(std::make_pair(dest_node_id,send_thread_id))->second;
-    // Copy messages to nanomsg buffer
-    void * buf = nn_allocmsg(size,0);
-    memcpy(buf,sbuf,size);
+    // sbuf is a nanomsg buffer of g_msg_size the messages were encoded into. The socket takes it
+    // over and sends all of it, so cut it down to the encoded batch first.
+    void * buf = nn_reallocmsg(sbuf, size);
+    if (!buf) buf = sbuf;
     DEBUG("%ld Sending batch of %d bytes to node %ld on socket %ld\n", send_thread_id, size,
             dest_node_id, (uint64_t)socket);
 
@@ -267,7 +299,7 @@ void Transport::send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void *
         }
 #endif
     }
-    //nn_freemsg(sbuf);
+    if (rc < 0) nn::freemsg(buf);
     DEBUG("%ld Batch of %d bytes sent to node %ld\n",send_thread_id,size,dest_node_id);
 
     INC_STATS(send_thread_id,msg_send_time,get_sys_clock() - starttime);
@@ -276,10 +308,18 @@ void Transport::send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void *
 
 // Listens to sockets for messages from other nodes
 std::vector<Message*> * Transport::recv_msg(uint64_t thd_id) {
+#if SHM_TPORT
+    std::vector<Message*> * shm_msgs = shm_recv_msg(thd_id);
+    if (shm_msgs || shm_only) return shm_msgs;
+#endif
+#if TPORT_TYPE == EPOLL
+    return epoll_recv_msg(thd_id);
+#endif
     int bytes = 0;
     void * buf;
     uint64_t starttime = get_sys_clock();
     std::vector<Message*> * msgs = NULL;
+    if (recv_sockets.empty()) return msgs;
     //uint64_t ctr = starttime % recv_sockets.size();
     uint64_t rand = (starttime % recv_sockets.size()) / g_this_rem_thread_cnt;
     // uint64_t ctr = ((thd_id % g_this_rem_thread_cnt) % recv_sockets.size()) + rand *
@@ -333,6 +373,9 @@ std::vector<Message*> * Transport::recv_msg(uint64_t thd_id) {
     msgs = Message::create_messages((char*)buf);
     DEBUG("Batch of %d bytes recv from node %ld; Time: %f\n", bytes, msgs->front()->return_node_id,
             simulation->seconds_from_start(get_sys_clock()));
+    INC_STATS(thd_id,msg_recv_msg_cnt,msgs->size());
+    INC_STATS(thd_id,msg_recv_alloc_cnt,1);
+    INC_STATS(thd_id,msg_recv_copy_bytes,bytes - sizeof(uint32_t) * 3);
 
     nn::freemsg(buf);
 
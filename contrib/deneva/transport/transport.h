@@ -35,6 +35,21 @@ Data:    MSG_SIZE - HDR_SIZE bytes
 
 #define GET_RCV_NODE_ID(b)  ((uint32_t*)b)[0]
 
+// With TPORT_TYPE EPOLL a batch goes over a plain TCP connection behind its size in bytes
+// (uint32_t), and input threads sleep in epoll_wait for at most this many ms.
+#define EPOLL_WAIT_TIMEOUT 1
+#define EPOLL_MAX_EVENTS 16
+
+// With SHM_TPORT a batch goes through a ring of this many bytes, behind its size in bytes
+// (uint32_t, padded to 8 bytes). Idle input threads sleep on a futex for at most this many ms.
+#ifndef SHM_RING_SIZE
+#define SHM_RING_SIZE (1UL << 20)
+#endif
+#define SHM_REC_HDR 8
+#ifndef SHM_WAIT_TIMEOUT
+#define SHM_WAIT_TIMEOUT 1
+#endif
+
 class Socket {
 public:
     Socket () : sock(AF_SP,NN_PAIR) {}
@@ -56,12 +71,64 @@ public:
     uint64_t get_port_id(uint64_t src_node_id, uint64_t dest_node_id, uint64_t send_thread_id);
     Socket * bind(uint64_t port_id);
     Socket * connect(uint64_t dest_id,uint64_t port_id);
+    // sbuf must come from nn_allocmsg, it belongs to the transport afterwards
     void send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,int size);
     std::vector<Message*> * recv_msg(uint64_t thd_id);
     void simple_send_msg(int size);
     uint64_t simple_recv_msg();
 
 private:
+    // whether messages to node_id go through shared memory
+    bool use_shm(uint64_t node_id);
+#if SHM_TPORT
+    // laid out in shm_transport.cpp
+    struct shm_header;
+    struct shm_wake;
+    struct shm_ring;
+    uint64_t shm_header_size();
+    void shm_init();
+    void shm_shutdown();
+    char * shm_attach(uint64_t node_id);
+    void shm_send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,int size);
+    std::vector<Message*> * shm_recv_msg(uint64_t thd_id);
+    std::vector<Message*> * shm_unpack(uint64_t thd_id, shm_ring * ring);
+    std::vector<Message*> * shm_sleep(uint64_t thd_id);
+    void shm_awake(uint64_t thd_id);
+
+    bool * local_nodes;
+    // no peer to listen to besides the rings, so idle input threads may sleep
+    bool shm_only;
+    std::map<std::pair<uint64_t, uint64_t>, shm_ring*> shm_send_rings;  // dest_node_id,send_thread_id
+    shm_wake ** peer_wakes;  // per local node, the wake words of its input threads
+    int ** peer_wake_fds;  // per local node, the wake FIFOs of its input threads, or NULL
+    // per input thread
+    shm_wake * shm_wakes;
+    int * shm_wake_fds;  // read end of the wake FIFO, -1 without one
+    std::vector<shm_ring*> * shm_recv_rings;
+#endif
+#if TPORT_TYPE == EPOLL
+    // incoming connection of the TPORT_TYPE EPOLL transport
+    struct tcp_conn {
+        int fd;
+        uint64_t node_id;
+        // received bytes, the batch being assembled starts at start
+        char * buf;
+        uint64_t start;
+        uint64_t end;
+        uint64_t capacity;
+    };
+    void epoll_init();
+    void epoll_send_msg(uint64_t send_thread_id, uint64_t dest_node_id, void * sbuf,int size);
+    std::vector<Message*> * epoll_recv_msg(uint64_t thd_id);
+    std::vector<Message*> * epoll_unpack(uint64_t thd_id, tcp_conn * conn);
+    int epoll_connect(uint64_t dest_id, uint64_t port_id);
+
+    int listen_fd;
+    std::map<std::pair<uint64_t, uint64_t>, int> send_fds;  // dest_node_id,send_thread_id : fd
+    // per input thread
+    int * epoll_fds;
+    std::vector<tcp_conn*> * recv_conns;
+#endif
     uint64_t rr;
     std::map<std::pair<uint64_t, uint64_t>, Socket*> send_sockets;  // dest_node_id,send_thread_id :
                                                                   // socket
@@ -20,6 +20,7 @@
 #include "algorithm.h"
 #include "anomaly_type.h"
 #include "prece_type.h"
+#include "../util/sharded_counter.h"
 
 namespace ttts {
 
@@ -254,10 +255,148 @@ class ConflictGraph {
   std::vector<ConflictGraphNode> nodes_;
 };
 
+// A compact signature of a conflict cycle, which is all we need to identify its anomaly type.
+// - For cycle of two transactions, it is made up of the precedence types ordered by happening time and
+//   whether the two precedences are on the same item.
+// - For cycle of more transactions, it is the set of precedence types in the cycle.
+class DACycleSignature {
+ public:
+  static constexpr uint32_t DOUBLE_TRANS_NUM = Count<PreceType>() * Count<PreceType>() * 2;
+  static constexpr uint32_t MULTI_TRANS_NUM = 1 << Count<PreceType>();
+  static constexpr uint32_t NUM = DOUBLE_TRANS_NUM + MULTI_TRANS_NUM;
+
+  static constexpr uint32_t TypeBit(const PreceType type) { return 1 << static_cast<uint32_t>(type); }
+
+  static constexpr uint32_t DoubleTrans(const PreceType early_type, const PreceType later_type, const bool same_item) {
+    return (static_cast<uint32_t>(early_type) * Count<PreceType>() + static_cast<uint32_t>(later_type)) * 2 + same_item;
+  }
+
+  static constexpr uint32_t MultiTrans(const uint32_t type_mask) { return DOUBLE_TRANS_NUM + type_mask; }
+
+  static uint32_t Of(const std::vector<DAPreceInfo>& preces) {
+    assert(preces.size() >= 2);
+    if (preces.size() >= 3) {
+      uint32_t type_mask = 0;
+      for (const DAPreceInfo& prece : preces) {
+        type_mask |= TypeBit(prece.type());
+      }
+      return MultiTrans(type_mask);
+    }
+    // when build path, later happened precedence is sorted to front
+    return DoubleTrans(preces.back().type(), preces.front().type(), preces.back().item_id() == preces.front().item_id());
+  }
+};
+
+// Rules to identify anomaly type by cycle signature. They are only evaluated at compile time to fill
+// DA_ANOMALY_TABLE.
+class DAAnomalyRules {
+ public:
+  static constexpr std::array<AnomalyType, DACycleSignature::NUM> Table() {
+    std::array<AnomalyType, DACycleSignature::NUM> table{};
+    for (uint32_t early = 0; early < Count<PreceType>(); ++early) {
+      for (uint32_t later = 0; later < Count<PreceType>(); ++later) {
+        const PreceType early_type = static_cast<PreceType>(early);
+        const PreceType later_type = static_cast<PreceType>(later);
+        const uint32_t type_mask = DACycleSignature::TypeBit(early_type) | DACycleSignature::TypeBit(later_type);
+        for (const bool same_item : {false, true}) {
+          table[DACycleSignature::DoubleTrans(early_type, later_type, same_item)] =
+              IdentifyAnomalyDirty(type_mask).value_or(same_item ? IdentifyAnomalySingle(early_type, later_type)
+                                                                 : IdentifyAnomalyDouble(early_type, later_type));
+        }
+      }
+    }
+    for (uint32_t type_mask = 0; type_mask < DACycleSignature::MULTI_TRANS_NUM; ++type_mask) {
+      table[DACycleSignature::MultiTrans(type_mask)] =
+          IdentifyAnomalyDirty(type_mask).value_or(IdentifyAnomalyMultiple(type_mask));
+    }
+    return table;
+  }
+
+  static constexpr std::optional<AnomalyType> IdentifyAnomalyDirty(const uint32_t type_mask) {
+    if (type_mask & (DACycleSignature::TypeBit(PreceType::WA) | DACycleSignature::TypeBit(PreceType::WC))) {
+      // WA and WC precedence han only appear
+      return AnomalyType::WAT_1_DIRTY_WRITE;
+    } else if (type_mask & DACycleSignature::TypeBit(PreceType::RA)) {
+      return AnomalyType::RAT_1_DIRTY_READ;
+    } else {
+      return {};
+    }
+  }
+
+  // require type1 precedence happens before type2 precedence
+  static constexpr AnomalyType IdentifyAnomalySingle(const PreceType early_type, const PreceType later_type) {
+    if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
+      return AnomalyType::WAT_1_FULL_WRITE; // WW-WW | WR-WW = WWW
+    } else if (early_type == PreceType::WR && early_type == PreceType::WW) {
+      return AnomalyType::WAT_1_FULL_WRITE; // WR-WW = WWW
+    } else if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::WAT_1_LOST_SELF_UPDATE; // WW-WR = WWR
+    } else if (early_type == PreceType::RW && later_type == PreceType::WW) {
+      return AnomalyType::WAT_1_LOST_UPDATE; // RW-WW | RW-RW = RWW
+    } else if (early_type == PreceType::WR && later_type == PreceType::RW) {
+      return AnomalyType::RAT_1_INTERMEDIATE_READ; // WR-RW = WRW
+    } else if (early_type == PreceType::RW && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::RAT_1_NON_REPEATABLE_READ; // RW-WR = RWR
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
+      return AnomalyType::IAT_1_LOST_UPDATE_COMMITTED; // RW-WW(WCW) = RWW
+    } else {
+      return AnomalyType::UNKNOWN_1;
+    }
+  }
+
+  static constexpr AnomalyType IdentifyAnomalyDouble(const PreceType early_type, const PreceType later_type) {
+    const auto any_order = [early_type, later_type](const PreceType type1, const PreceType type2) -> std::optional<bool> {
+      if (early_type == type1 && later_type == type2) {
+        return true;
+      } else if (early_type == type2 && later_type == type1) {
+        return false;
+      } else {
+        return {};
+      }
+    };
+    if (const auto order = any_order(PreceType::WR, PreceType::WW); order.has_value()) {
+      return *order ? AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_1 : AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
+    } else if (early_type == PreceType::WW && later_type == PreceType::WCR) {
+      return AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
+    } else if (const auto order = any_order(PreceType::RW, PreceType::WW); order.has_value()) {
+      return *order ? AnomalyType::WAT_2_READ_WRITE_SKEW_1 : AnomalyType::WAT_2_READ_WRITE_SKEW_2;
+    } else if (early_type == PreceType::WW && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
+      return AnomalyType::WAT_2_FULL_WRITE_SKEW;
+    } else if (early_type == PreceType::WR && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::RAT_2_WRITE_READ_SKEW;
+    } else if (early_type == PreceType::WR && later_type == PreceType::WCW) {
+      return AnomalyType::RAT_2_DOUBLE_WRITE_SKEW_COMMITTED;
+    } else if (const auto order = any_order(PreceType::RW, PreceType::WR); order.has_value()) {
+      return *order ? AnomalyType::RAT_2_READ_SKEW : AnomalyType::RAT_2_READ_SKEW_2;
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCR) {
+      return AnomalyType::RAT_2_READ_SKEW;
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
+      return AnomalyType::IAT_2_READ_WRITE_SKEW_COMMITTED;
+    } else if (early_type == PreceType::RW && later_type == PreceType::RW) {
+      return AnomalyType::IAT_2_WRITE_SKEW;
+    } else {
+      return AnomalyType::UNKNOWN_2;
+    }
+  }
+
+  static constexpr AnomalyType IdentifyAnomalyMultiple(const uint32_t type_mask) {
+    if (type_mask & DACycleSignature::TypeBit(PreceType::WW)) {
+      return AnomalyType::WAT_STEP;
+    }
+    if (type_mask & (DACycleSignature::TypeBit(PreceType::WR) | DACycleSignature::TypeBit(PreceType::WCR))) {
+      return AnomalyType::RAT_STEP;
+    }
+    return AnomalyType::IAT_STEP;
+  }
+};
+
+// Anomaly type of each cycle signature.
+inline constexpr std::array<AnomalyType, DACycleSignature::NUM> DA_ANOMALY_TABLE = DAAnomalyRules::Table();
+
 template <bool IDENTIFY_ANOMALY>
 class ConflictSerializableAlgorithm : public HistoryAlgorithm {
  public:
-  ConflictSerializableAlgorithm() : HistoryAlgorithm(IDENTIFY_ANOMALY ? "DLI_IDENTIFY OK" : "Conflict Serializable"), anomaly_counts_{0}, no_anomaly_count_(0) {}
+  ConflictSerializableAlgorithm() : HistoryAlgorithm(IDENTIFY_ANOMALY ? "DLI_IDENTIFY OK" : "Conflict Serializable") {}
   virtual ~ConflictSerializableAlgorithm() {}
 
   void Statistics() const override {
@@ -269,16 +408,18 @@ class ConflictSerializableAlgorithm : public HistoryAlgorithm {
       std::cout << std::setw(10) << static_cast<double>(value) / total * 100 << "% = " << std::setw(5) << value << " / " << std::setw(5) << total;
     };
 
-    const auto anomaly_count = std::accumulate(anomaly_counts_.begin(), anomaly_counts_.end(), 0);
+    const auto anomaly_counts = anomaly_counts_.Merge();
+    const auto anomaly_count = std::accumulate(anomaly_counts.begin(), anomaly_counts.end(), uint64_t(0));
+    const auto no_anomaly_count = no_anomaly_count_.Sum(0);
     std::cout << "=== DLI_IDENTIFY ===" << std::endl;
 
     std::cout << std::setw(40) << "True Rollback: ";
-    print_percent(anomaly_count, anomaly_count + no_anomaly_count_);
+    print_percent(anomaly_count, anomaly_count + no_anomaly_count);
     std::cout << std::endl;
 
     std::vector<std::pair<AnomalyType, uint32_t>> sorted_anomaly_counts_;
     for (const auto anomaly : Members<AnomalyType>()) {
-      sorted_anomaly_counts_.emplace_back(anomaly, anomaly_counts_.at(static_cast<uint32_t>(anomaly)));
+      sorted_anomaly_counts_.emplace_back(anomaly, anomaly_counts.at(static_cast<uint32_t>(anomaly)));
     }
     std::sort(sorted_anomaly_counts_.begin(), sorted_anomaly_counts_.end(), [](auto&& _1, auto&& _2) { return _1.second > _2.second; });
     for (const auto& [anomaly, count] : sorted_anomaly_counts_) {
@@ -331,12 +472,12 @@ class ConflictSerializableAlgorithm : public HistoryAlgorithm {
     const bool has_cycle = graph.HasCycle();
     if (IDENTIFY_ANOMALY && has_cycle) {
       const auto cycle = graph.MinCycleByFloyd();
-      const auto anomaly = IdentifyAnomaly_(cycle.preces());
+      const auto anomaly = IdentifyAnomaly(cycle.preces());
       TRY_LOG(os) << "[" << anomaly << "] " << cycle;
-      ++(anomaly_counts_.at(static_cast<uint32_t>(anomaly)));
+      anomaly_counts_.Add(static_cast<uint32_t>(anomaly));
       return anomaly;
     } else {
-      ++no_anomaly_count_;
+      no_anomaly_count_.Add(0);
       return {};
     }
   }
@@ -345,100 +486,14 @@ class ConflictSerializableAlgorithm : public HistoryAlgorithm {
       return !(GetAnomaly(history, os).has_value());
   }
 
- private:
-  static uint64_t ItemCount_(const std::vector<DAPreceInfo>& preces) {
-    std::set<uint64_t> item_ids;
-    for (const auto prece : preces) {
-      item_ids.emplace(prece.item_id());
-    }
-    return item_ids.size();
-  }
-
-  static AnomalyType IdentifyAnomaly_(const std::vector<DAPreceInfo>& preces) {
-    assert(preces.size() >= 2);
-    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WA || prece.type() == PreceType::WC; })) {
-      // WA and WC precedence han only appear
-      return AnomalyType::WAT_1_DIRTY_WRITE;
-    } else if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::RA; })) {
-      return AnomalyType::RAT_1_DIRTY_READ;
-    } else if (preces.size() >= 3) {
-      return IdentifyAnomalyMultiple_(preces);
-    // when build path, later happened precedence is sorted to front
-    } else if (preces.back().item_id() != preces.front().item_id()) {
-      return IdentifyAnomalyDouble_(preces.back().type(), preces.front().type());
-    } else {
-      return IdentifyAnomalySingle_(preces.back().type(), preces.front().type());
-    }
-  }
-
-  // require type1 precedence happens before type2 precedence
-  static AnomalyType IdentifyAnomalySingle_(const PreceType early_type, const PreceType later_type) {
-    if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
-      return AnomalyType::WAT_1_FULL_WRITE; // WW-WW | WR-WW = WWW
-    } else if (early_type == PreceType::WR && early_type == PreceType::WW) {
-      return AnomalyType::WAT_1_FULL_WRITE; // WR-WW = WWW
-    } else if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
-      return AnomalyType::WAT_1_LOST_SELF_UPDATE; // WW-WR = WWR
-    } else if (early_type == PreceType::RW && later_type == PreceType::WW) {
-      return AnomalyType::WAT_1_LOST_UPDATE; // RW-WW | RW-RW = RWW
-    } else if (early_type == PreceType::WR && later_type == PreceType::RW) {
-      return AnomalyType::RAT_1_INTERMEDIATE_READ; // WR-RW = WRW
-    } else if (early_type == PreceType::RW && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
-      return AnomalyType::RAT_1_NON_REPEATABLE_READ; // RW-WR = RWR
-    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
-      return AnomalyType::IAT_1_LOST_UPDATE_COMMITTED; // RW-WW(WCW) = RWW
-    } else {
-      return AnomalyType::UNKNOWN_1;
-    }
-  }
-
-  static AnomalyType IdentifyAnomalyDouble_(const PreceType early_type, const PreceType later_type) {
-    const auto any_order = [early_type, later_type](const PreceType type1, const PreceType type2) -> std::optional<bool> {
-      if (early_type == type1 && later_type == type2) {
-        return true;
-      } else if (early_type == type2 && later_type == type1) {
-        return false;
-      } else {
-        return {};
-      }
-    };
-    if (const auto order = any_order(PreceType::WR, PreceType::WW); order.has_value()) {
-      return *order ? AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_1 : AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
-    } else if (early_type == PreceType::WW && later_type == PreceType::WCR) {
-      return AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
-    } else if (const auto order = any_order(PreceType::RW, PreceType::WW); order.has_value()) {
-      return *order ? AnomalyType::WAT_2_READ_WRITE_SKEW_1 : AnomalyType::WAT_2_READ_WRITE_SKEW_2;
-    } else if (early_type == PreceType::WW && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
-      return AnomalyType::WAT_2_FULL_WRITE_SKEW;
-    } else if (early_type == PreceType::WR && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
-      return AnomalyType::RAT_2_WRITE_READ_SKEW;
-    } else if (early_type == PreceType::WR && later_type == PreceType::WCW) {
-      return AnomalyType::RAT_2_DOUBLE_WRITE_SKEW_COMMITTED;
-    } else if (const auto order = any_order(PreceType::RW, PreceType::WR); order.has_value()) {
-      return *order ? AnomalyType::RAT_2_READ_SKEW : AnomalyType::RAT_2_READ_SKEW_2;
-    } else if (early_type == PreceType::RW && later_type == PreceType::WCR) {
-      return AnomalyType::RAT_2_READ_SKEW;
-    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
-      return AnomalyType::IAT_2_READ_WRITE_SKEW_COMMITTED;
-    } else if (early_type == PreceType::RW && later_type == PreceType::RW) {
-      return AnomalyType::IAT_2_WRITE_SKEW;
-    } else {
-      return AnomalyType::UNKNOWN_2;
-    }
-  }
-
-  static AnomalyType IdentifyAnomalyMultiple_(const std::vector<DAPreceInfo>& preces) {
-    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WW; })) {
-      return AnomalyType::WAT_STEP;
-    }
-    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WR || prece.type() == PreceType::WCR; })) {
-      return AnomalyType::RAT_STEP;
-    }
-    return AnomalyType::IAT_STEP;
+  static AnomalyType IdentifyAnomaly(const std::vector<DAPreceInfo>& preces) {
+    return DA_ANOMALY_TABLE[DACycleSignature::Of(preces)];
   }
 
-  mutable std::array<std::atomic<uint64_t>, Count<AnomalyType>()> anomaly_counts_;
-  mutable std::atomic<uint64_t> no_anomaly_count_;
+ private:
+  // sharded by checker thread to avoid false sharing when FilterRun checks with many threads
+  mutable ShardedCounters<Count<AnomalyType>()> anomaly_counts_;
+  mutable ShardedCounters<1> no_anomaly_count_;
 };
 
 }  // namespace ttts
@@ -9,6 +9,7 @@
  *
  */
 #pragma once
+#include <cstring>
 #include "algorithm.h"
 
 namespace ttts {
@@ -56,29 +57,38 @@ std::string ToString<SerializeReadPolicy::SI_READ>() {
 // The executing result of one history. The history is serializable if the two results of original
 // history and serialized history are same.
 // The history result contains each transaction's read result and each item's final version.
+// Read results are appended as fixed-width records in executing order. Once the history is over,
+// they are regrouped by transaction into one contiguous array, so comparing results is hashing
+// plus memcmp instead of walking nested vectors.
 class HistoryResult {
  public:
-  HistoryResult(const uint64_t trans_num) : trans_results_(trans_num) {}
+  HistoryResult(const uint64_t trans_num)
+      : trans_committed_(trans_num, false),
+        trans_offsets_(trans_num + 1, 0),
+        trans_hashes_(trans_num, 0) {}
   HistoryResult(HistoryResult&&) = default;
   ~HistoryResult() {}
   HistoryResult& operator=(HistoryResult&&) = default;
 
   // Check if all transactions read the same versions
   bool ReadEqual(const HistoryResult& result) const {
-    return trans_results_ == result.trans_results_;
+    return trans_committed_ == result.trans_committed_ && trans_hashes_ == result.trans_hashes_ &&
+           RecordsEqual_(records_.data(), records_.size(), result.records_.data(),
+                         result.records_.size());
   }
 
   // Check if all committed transaction read the same versions, ignore aborted transactions
   bool CommitReadEqual(const HistoryResult& result) const {
-    if (trans_results_.size() != result.trans_results_.size()) {
+    if (trans_committed_.size() != result.trans_committed_.size()) {
       return false;
     }
-    for (uint64_t trans_id = 0; trans_id < trans_results_.size(); ++trans_id) {
-      if ((trans_results_[trans_id].committed_ !=
-           result.trans_results_[trans_id].committed_) ||  // different transaction status
-          (trans_results_[trans_id].committed_ &&
-           trans_results_[trans_id].read_results_ !=
-               result.trans_results_[trans_id].read_results_)) {
+    for (uint64_t trans_id = 0; trans_id < trans_committed_.size(); ++trans_id) {
+      if ((trans_committed_[trans_id] !=
+           result.trans_committed_[trans_id]) ||  // different transaction status
+          (trans_committed_[trans_id] &&
+           (trans_hashes_[trans_id] != result.trans_hashes_[trans_id] ||
+            !RecordsEqual_(TransRecords_(trans_id), TransRecordNum_(trans_id),
+                           result.TransRecords_(trans_id), result.TransRecordNum_(trans_id))))) {
         return false;
       }  // different read results
     }
@@ -93,41 +103,95 @@ class HistoryResult {
   // Add version to read result to compare with other history results.
   void PushTransReadResult(const uint64_t trans_id, const uint64_t item_id,
                            const uint64_t version) {
-    assert(trans_id < trans_results_.size());
-    trans_results_[trans_id].read_results_.emplace_back(
-        std::vector<std::pair<uint64_t, uint64_t>>{{item_id, version}});
+    assert(trans_id < trans_committed_.size());
+    records_.push_back({trans_id, item_id, version});
   }
 
-  // Add versions to read result to compare with other history results.
-  void PushTransReadResult(const uint64_t trans_id,
-                           std::vector<std::pair<uint64_t, uint64_t>>&& item_vers) {
-    assert(trans_id < trans_results_.size());
-    trans_results_[trans_id].read_results_.emplace_back(std::move(item_vers));
+  // Add versions read by a scan to read result. read_version is called for each item and returns
+  // the version to read, or an empty optional if the item is not in the scan result.
+  template <typename ReadVersion>
+  void PushTransScanResult(const uint64_t trans_id, const uint64_t item_num,
+                           ReadVersion&& read_version) {
+    assert(trans_id < trans_committed_.size());
+    // the scan head record keeps the scan boundary and its version is the number of read items
+    const size_t scan_head = records_.size();
+    records_.push_back({trans_id, SCAN_ITEM_ID, 0});
+    for (uint64_t item_id = 0; item_id < item_num; ++item_id) {
+      if (const std::optional<uint64_t> version = read_version(item_id); version.has_value()) {
+        records_.push_back({trans_id, item_id, version.value()});
+      }
+    }
+    records_[scan_head].version_ = records_.size() - scan_head - 1;
   }
 
   // Mark transaction as committed transaction.
   void SetTransCommitted(const uint64_t trans_id, const bool committed) {
-    assert(trans_id < trans_results_.size());
-    trans_results_[trans_id].committed_ = committed;
+    assert(trans_id < trans_committed_.size());
+    trans_committed_[trans_id] = committed;
   }
 
-  // Record the final version of each variables to compare with other history results.
+  // Record the final version of each variables to compare with other history results. It must be
+  // called after all reads are pushed, when the read records are grouped by transaction.
   void SetItemFinalVersions(std::vector<uint64_t>&& versions) {
     item_final_versions_ = std::move(versions);
+    GroupRecordsByTrans_();
   }
 
  private:
-  // Record each version the transaction has been read and whether the transaction is committed or
-  // aborted.
-  struct TransResult {
-    bool operator==(const TransResult& result) const {
-      return read_results_ == result.read_results_ && committed_ == result.committed_;
-    }
-    std::vector<std::vector<std::pair<uint64_t, uint64_t>>> read_results_;
-    bool committed_;
+  struct ReadRecord {
+    uint64_t trans_id_;
+    uint64_t item_id_;
+    uint64_t version_;
   };
+  static_assert(sizeof(ReadRecord) == 3 * sizeof(uint64_t),
+                "read records must be packed to be compared by memcmp");
+
+  static constexpr uint64_t SCAN_ITEM_ID = -1;
+
+  static bool RecordsEqual_(const ReadRecord* const records_1, const size_t size_1,
+                            const ReadRecord* const records_2, const size_t size_2) {
+    return size_1 == size_2 &&
+           (size_1 == 0 || std::memcmp(records_1, records_2, size_1 * sizeof(ReadRecord)) == 0);
+  }
+
+  const ReadRecord* TransRecords_(const uint64_t trans_id) const {
+    return records_.data() + trans_offsets_[trans_id];
+  }
+  size_t TransRecordNum_(const uint64_t trans_id) const {
+    return trans_offsets_[trans_id + 1] - trans_offsets_[trans_id];
+  }
+
+  // Stable counting sort of the records by transaction, so each transaction's reads keep their
+  // executing order, then hash each transaction's records.
+  void GroupRecordsByTrans_() {
+    const uint64_t trans_num = trans_committed_.size();
+    for (const ReadRecord& record : records_) {
+      ++trans_offsets_[record.trans_id_ + 1];
+    }
+    for (uint64_t trans_id = 0; trans_id < trans_num; ++trans_id) {
+      trans_offsets_[trans_id + 1] += trans_offsets_[trans_id];
+    }
+    std::vector<ReadRecord> grouped_records(records_.size());
+    std::vector<uint64_t> next_pos(trans_offsets_.begin(), trans_offsets_.end() - 1);
+    for (const ReadRecord& record : records_) {
+      grouped_records[next_pos[record.trans_id_]++] = record;
+    }
+    records_ = std::move(grouped_records);
+    for (uint64_t trans_id = 0; trans_id < trans_num; ++trans_id) {
+      uint64_t hash = 14695981039346656037ULL;  // FNV-1a over the record words
+      for (size_t i = trans_offsets_[trans_id]; i < trans_offsets_[trans_id + 1]; ++i) {
+        for (const uint64_t word : {records_[i].item_id_, records_[i].version_}) {
+          hash = (hash ^ word) * 1099511628211ULL;
+        }
+      }
+      trans_hashes_[trans_id] = hash;
+    }
+  }
 
-  std::vector<TransResult> trans_results_;     // size = trans_num
+  std::vector<ReadRecord> records_;            // grouped by transaction after the history is over
+  std::vector<bool> trans_committed_;          // size = trans_num
+  std::vector<uint64_t> trans_offsets_;        // size = trans_num + 1, records_ range of each trans
+  std::vector<uint64_t> trans_hashes_;         // size = trans_num
   std::vector<uint64_t> item_final_versions_;  // size = item_num
 };
 
@@ -172,9 +236,10 @@ class HistorySerializableAlgorithm : public HistoryAlgorithm {
   virtual bool Check(const History& history, std::ostream* const os) const override {
     History history_with_write_version = history;
     history_with_write_version.UpdateWriteVersions();
-    const auto check_serial = [this, &history_with_write_version, &os](History&& serial_history) {
+    const HistoryResult origin_result = Result<R>(history_with_write_version);
+    const auto check_serial = [this, &origin_result, &os](History&& serial_history) {
       // Check if the result of original history is same as serialized history.
-      if (ResultsEqual<L>(Result<R>(history_with_write_version), Result<R>(serial_history))) {
+      if (ResultsEqual<L>(origin_result, Result<R>(serial_history))) {
         TRY_LOG(os) << serial_history;
         return true;  // break
       }
@@ -202,16 +267,17 @@ bool ResultsEqual<SerializeLevel::FINAL_SAME>(const HistoryResult& _1, const His
 }
 
 // Call read_version for each item to determine which version to read and check whether is odd.
-std::vector<std::pair<uint64_t, uint64_t>> ScanOdd(
-    const uint64_t item_num, const std::function<uint64_t(const uint64_t)>& read_version) {
-  std::vector<std::pair<uint64_t, uint64_t>> scan_item_vers;
-  for (uint64_t item_id = 0; item_id < item_num; ++item_id) {
-    const uint64_t version = read_version(item_id);
-    if (version % 2 == 0) {
-      scan_item_vers.emplace_back(item_id, version);
-    }
-  }
-  return scan_item_vers;
+template <typename ReadVersion>
+void ScanOdd(HistoryResult& result, const uint64_t trans_id, const uint64_t item_num,
+             ReadVersion&& read_version) {
+  result.PushTransScanResult(trans_id, item_num,
+                             [&read_version](const uint64_t item_id) -> std::optional<uint64_t> {
+                               const uint64_t version = read_version(item_id);
+                               if (version % 2 == 0) {
+                                 return version;
+                               }
+                               return {};
+                             });
 }
 
 // Get result of the history with uncomitted read strategy.
@@ -251,10 +317,8 @@ HistoryResult Result<SerializeReadPolicy::UNCOMMITTED_READ>(const History& histo
       result.PushTransReadResult(operation.trans_id(), operation.item_id(),
                                  latest_version(operation.item_id()));
     } else if (operation.type() == Operation::Type::SCAN_ODD) {
-      result.PushTransReadResult(
-          operation.trans_id(),
-          ScanOdd(history.item_num(),
-                  [&latest_version](const uint64_t item_id) { return latest_version(item_id); }));
+      ScanOdd(result, operation.trans_id(), history.item_num(),
+              [&latest_version](const uint64_t item_id) { return latest_version(item_id); });
     } else if (operation.type() == Operation::Type::WRITE) {
       item_version_link[operation.item_id()].push_back(operation.version());
       std::optional<uint64_t>& my_last_write_version =
@@ -304,11 +368,11 @@ HistoryResult ResultAtLeastCommittedRead(const History& history, ReadVersion&& r
                                  read_version(operation.trans_id(), operation.item_id(),
                                               trans_write_item_versions, latest_versions));
     } else if (operation.type() == Operation::Type::SCAN_ODD) {
-      result.PushTransReadResult(
-          operation.trans_id(),
-          ScanOdd(history.item_num(),
-                  std::bind(read_version, operation.trans_id(), std::placeholders::_1,
-                            trans_write_item_versions, latest_versions)));
+      ScanOdd(result, operation.trans_id(), history.item_num(),
+              [&read_version, &trans_write_item_versions, &latest_versions,
+               trans_id = operation.trans_id()](const uint64_t item_id) {
+                return read_version(trans_id, item_id, trans_write_item_versions, latest_versions);
+              });
     } else if (operation.type() == Operation::Type::WRITE) {
       trans_write_item_versions[operation.trans_id()][operation.item_id()] = operation.version();
     } else if (operation.type() == Operation::Type::ABORT) {
@@ -365,7 +429,7 @@ HistoryResult Result<SerializeReadPolicy::REPEATABLE_READ>(const History& histor
           return write_version.value();
         } else {
           std::optional<uint64_t>& read_version = trans_read_item_versions[trans_id][item_id];
-          if (read_version.has_value()) {  // item has read
+          if (!read_version.has_value()) {  // item has not been read
             read_version = latest_versions[item_id];
           }
           return read_version.value();
@@ -389,12 +453,11 @@ HistoryResult Result<SerializeReadPolicy::SI_READ>(const History& history) {
           trans_item_versions_snapshot[operation.trans_id()][operation.item_id()];
       result.PushTransReadResult(operation.trans_id(), operation.item_id(), read_version);
     } else if (operation.type() == Operation::Type::SCAN_ODD) {
-      result.PushTransReadResult(
-          operation.trans_id(),
-          ScanOdd(history.item_num(), [&trans_item_versions_snapshot,
-                                       trans_id = operation.trans_id()](const uint64_t item_id) {
-            return trans_item_versions_snapshot[trans_id][item_id];
-          }));
+      ScanOdd(result, operation.trans_id(), history.item_num(),
+              [&trans_item_versions_snapshot,
+               trans_id = operation.trans_id()](const uint64_t item_id) {
+                return trans_item_versions_snapshot[trans_id][item_id];
+              });
     } else if (operation.type() == Operation::Type::WRITE) {
       trans_item_versions_snapshot[operation.trans_id()][operation.item_id()] = operation.version();
     } else if (operation.type() == Operation::Type::ABORT) {
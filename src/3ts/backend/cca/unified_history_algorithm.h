@@ -3,6 +3,7 @@
 #include "anomaly_type.h"
 #include "prece_type.h"
 #include "algorithm.h"
+#include "../util/sharded_counter.h"
 #include "../../../../contrib/deneva/unified_concurrency_control/dli_identify_util.h"
 #include "../../../../contrib/deneva/unified_concurrency_control/txn_dli_identify.h"
 #include "../../../../contrib/deneva/unified_concurrency_control/row_prece.h"
@@ -15,7 +16,7 @@ namespace ttts {
 template<UniAlgs ALG, typename Data>
 class UnifiedHistoryAlgorithm : public HistoryAlgorithm {
 public:
-  UnifiedHistoryAlgorithm() : HistoryAlgorithm(ToString(ALG)), anomaly_counts_{0} {}
+  UnifiedHistoryAlgorithm() : HistoryAlgorithm(ToString(ALG)) {}
 
   virtual bool Check(const History& history, std::ostream* const os) const override {
     return !(GetAnomaly(history, os).has_value());
@@ -68,7 +69,7 @@ public:
         if (txn_map[trans_id]->cycle_ != nullptr) {
           //std::cout << "abort::preces_size:" << txn_map[trans_id]->cycle_->Preces().size() << std::endl;
           const auto anomaly = AlgManager<ALG, Data>::IdentifyAnomaly(txn_map[trans_id]->cycle_->Preces());
-          ++(anomaly_counts_.at(static_cast<uint32_t>(anomaly)));
+          anomaly_counts_.Add(static_cast<uint32_t>(anomaly));
           return anomaly;
         }
       } else if (Operation::Type::COMMIT == operation.type()) {
@@ -90,7 +91,7 @@ public:
         if (txn_map[trans_id]->cycle_ != nullptr) {
           //std::cout << "commit::preces_size" << txn_map[trans_id]->cycle_->Preces().size() << std::endl;
           const auto anomaly = AlgManager<ALG, Data>::IdentifyAnomaly(txn_map[trans_id]->cycle_->Preces());
-          ++(anomaly_counts_.at(static_cast<uint32_t>(anomaly)));
+          anomaly_counts_.Add(static_cast<uint32_t>(anomaly));
           return anomaly;
         }
       }
@@ -99,7 +100,7 @@ public:
   }
 
 private:
-  mutable std::array<std::atomic<uint64_t>, Count<AnomalyType>()> anomaly_counts_;
+  mutable ShardedCounters<Count<AnomalyType>()> anomaly_counts_;
 };
 
 }
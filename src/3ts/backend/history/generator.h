@@ -10,8 +10,10 @@
  */
 #pragma once
 #include <random>
+#include <thread>
 
 #include "../util/generic.h"
+#include "text_parser.h"
 
 namespace ttts {
 
@@ -24,21 +26,74 @@ class HistoryGenerator {
 
 class InputHistoryGenerator : public HistoryGenerator {
  public:
-  InputHistoryGenerator(const std::string &path) : path_(path) {}
+  InputHistoryGenerator(const std::string &path, const uint64_t parse_thread_num = 1)
+      : path_(path), parse_thread_num_(std::max<uint64_t>(parse_thread_num, 1)) {}
   ~InputHistoryGenerator() {}
   virtual void DeliverHistories(const std::function<void(History &&)> &handle) const override {
-    std::ifstream fs(path_);
-    if (!fs) {
+    std::string buffer;
+    if (!ReadFile_(buffer)) {
       std::cerr << "Open Operation Sequences File Failed" << std::endl;
       return;
     }
-    for (History history; fs >> history;) {
-      handle(std::move(history));
+    const auto report_error = [this](const HistoryParseError &error) {
+      std::cerr << path_ << ":" << error.line << ":" << error.column << ": " << error.message
+                << std::endl;
+    };
+    const char *const begin = buffer.data();
+    const char *const end = begin + buffer.size();
+    if (parse_thread_num_ == 1) {
+      TextHistoryParser().Parse(begin, end, 1, handle, report_error);
+      return;
+    }
+
+    // Each chunk is parsed by its own thread. Chunks are delivered in file order, so the histories
+    // keep the same order as parsing with one thread.
+    struct ChunkResult {
+      std::vector<History> histories;
+      std::vector<HistoryParseError> errors;  // line numbers start from 1 in each chunk
+      uint64_t line_num;
+    };
+    const std::vector<const char *> bounds =
+        TextHistoryParser::SplitAtLines(begin, end, parse_thread_num_);
+    std::vector<ChunkResult> results(bounds.size() - 1);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < results.size(); ++i) {
+      threads.emplace_back([&result = results[i], chunk_begin = bounds[i],
+                            chunk_end = bounds[i + 1]]() {
+        result.line_num = TextHistoryParser().Parse(
+            chunk_begin, chunk_end, 1,
+            [&result](History &&history) { result.histories.emplace_back(std::move(history)); },
+            [&result](const HistoryParseError &error) { result.errors.push_back(error); });
+      });
+    }
+    uint64_t first_line = 1;
+    for (size_t i = 0; i < results.size(); ++i) {
+      threads[i].join();
+      for (HistoryParseError &error : results[i].errors) {
+        error.line += first_line - 1;
+        report_error(error);
+      }
+      for (History &history : results[i].histories) {
+        handle(std::move(history));
+      }
+      std::vector<History>().swap(results[i].histories);  // release delivered histories
+      first_line += results[i].line_num;
     }
   }
 
  private:
+  bool ReadFile_(std::string &buffer) const {
+    std::ifstream fs(path_, std::ios::binary | std::ios::ate);
+    if (!fs) {
+      return false;
+    }
+    buffer.resize(fs.tellg());
+    fs.seekg(0);
+    return static_cast<bool>(fs.read(buffer.data(), buffer.size()));
+  }
+
   const std::string path_;
+  const uint64_t parse_thread_num_;
 };
 
 class RandomHistoryGenerator : public HistoryGenerator {
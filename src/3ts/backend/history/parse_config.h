@@ -43,7 +43,9 @@ std::shared_ptr<ttts::HistoryGenerator> GeneratorParse(const libconfig::Config &
     std::shared_ptr<ttts::HistoryGenerator> res;
     if (name == "InputGenerator") {
       const std::string &file = s.lookup("file");
-      res = std::make_shared<ttts::InputHistoryGenerator>(file);
+      unsigned int parse_thread_num = 1;
+      s.lookupValue("parse_thread_num", parse_thread_num);  // optional
+      res = std::make_shared<ttts::InputHistoryGenerator>(file, parse_thread_num);
     } else {
       ttts::Options opt;
       opt.trans_num = s.lookup("trans_num");
@@ -71,72 +73,79 @@ std::shared_ptr<ttts::HistoryGenerator> GeneratorParse(const libconfig::Config &
   }
 }
 
+// Every algorithm AlgorithmParseInternal_ can create, as X(name, type). Only the algorithms of
+// ROLLBACK_RATE_ALGORITHMS support rollback rate statistics.
+#define ROLLBACK_RATE_ALGORITHMS(X)                                                              \
+  X("SSI", ttts::OCCAlgorithm<ttts::occ_algorithm::SSITransactionDesc>)                          \
+  X("WSI", ttts::OCCAlgorithm<ttts::occ_algorithm::WSITransactionDesc>)                          \
+  X("BOCC", ttts::OCCAlgorithm<occ_algorithm::BoccTransactionDesc>)                              \
+  X("FOCC", ttts::OCCAlgorithm<occ_algorithm::FoccTransactionDesc>)                              \
+  X("DLI", ttts::OCCAlgorithm<occ_algorithm::DLITransactionDesc>)
+#define HISTORY_ALGORITHMS(X)                                                                    \
+  X("SerializableAlgorithm_ALL_SAME_RR",                                                         \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::ALL_SAME,                                 \
+                                       SerializeReadPolicy::REPEATABLE_READ>)                    \
+  X("SerializableAlgorithm_ALL_SAME_RC",                                                         \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::ALL_SAME,                                 \
+                                       SerializeReadPolicy::COMMITTED_READ>)                     \
+  X("SerializableAlgorithm_ALL_SAME_RU",                                                         \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::ALL_SAME,                                 \
+                                       SerializeReadPolicy::UNCOMMITTED_READ>)                   \
+  X("SerializableAlgorithm_ALL_SAME_SI",                                                         \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::ALL_SAME, SerializeReadPolicy::SI_READ>)  \
+  X("SerializableAlgorithm_COMMIT_SAME_RR",                                                      \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::COMMIT_SAME,                              \
+                                       SerializeReadPolicy::REPEATABLE_READ>)                    \
+  X("SerializableAlgorithm_COMMIT_SAME_RC",                                                      \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::COMMIT_SAME,                              \
+                                       SerializeReadPolicy::COMMITTED_READ>)                     \
+  X("SerializableAlgorithm_COMMIT_SAME_RU",                                                      \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::COMMIT_SAME,                              \
+                                       SerializeReadPolicy::UNCOMMITTED_READ>)                   \
+  X("SerializableAlgorithm_COMMIT_SAME_SI",                                                      \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::COMMIT_SAME,                              \
+                                       SerializeReadPolicy::SI_READ>)                            \
+  X("SerializableAlgorithm_FINAL_SAME_RR",                                                       \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::FINAL_SAME,                               \
+                                       SerializeReadPolicy::REPEATABLE_READ>)                    \
+  X("SerializableAlgorithm_FINAL_SAME_RC",                                                       \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::FINAL_SAME,                               \
+                                       SerializeReadPolicy::COMMITTED_READ>)                     \
+  X("SerializableAlgorithm_FINAL_SAME_RU",                                                       \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::FINAL_SAME,                               \
+                                       SerializeReadPolicy::UNCOMMITTED_READ>)                   \
+  X("SerializableAlgorithm_FINAL_SAME_SI",                                                       \
+    ttts::HistorySerializableAlgorithm<SerializeLevel::FINAL_SAME,                               \
+                                       SerializeReadPolicy::SI_READ>)                            \
+  X("ConflictSerializableAlgorithm", ttts::ConflictSerializableAlgorithm<false>)                 \
+  X("DLI_IDENTIFY", ttts::ConflictSerializableAlgorithm<true>)                                   \
+  X("DLI_IDENTIFY_CYCLE",                                                                        \
+    ttts::UnifiedHistoryAlgorithm<ttts::UniAlgs::UNI_DLI_IDENTIFY_CYCLE, uint64_t>)              \
+  X("DLI_IDENTIFY_CHAIN",                                                                        \
+    ttts::UnifiedHistoryAlgorithm<ttts::UniAlgs::UNI_DLI_IDENTIFY_CHAIN, uint64_t>)
+
+#define ALGORITHM_NAME_(name, ...) name,
+const std::vector<std::string> ALGORITHM_NAMES = {
+    ROLLBACK_RATE_ALGORITHMS(ALGORITHM_NAME_) HISTORY_ALGORITHMS(ALGORITHM_NAME_)};
+#undef ALGORITHM_NAME_
+
 template <bool only_rollback_rate, typename AddAlgorithm>
 void AlgorithmParseInternal_(const libconfig::Config &cfg, const std::string &algorithm_name,
                              AddAlgorithm &&add_algorithm) {
-  if (algorithm_name == "SSI") {
-    add_algorithm(std::make_shared<ttts::OCCAlgorithm<ttts::occ_algorithm::SSITransactionDesc>>());
-  } else if (algorithm_name == "WSI") {
-    add_algorithm(std::make_shared<ttts::OCCAlgorithm<ttts::occ_algorithm::WSITransactionDesc>>());
-  } else if (algorithm_name == "BOCC") {
-    add_algorithm(std::make_shared<ttts::OCCAlgorithm<occ_algorithm::BoccTransactionDesc>>());
-  } else if (algorithm_name == "FOCC") {
-    add_algorithm(std::make_shared<ttts::OCCAlgorithm<occ_algorithm::FoccTransactionDesc>>());
-  } else if (algorithm_name == "DLI") {
-    add_algorithm(std::make_shared<ttts::OCCAlgorithm<occ_algorithm::DLITransactionDesc>>());
-  } else if constexpr (only_rollback_rate) {
+#define ADD_ALGORITHM_NAMED_(name, ...)                                                          \
+  if (algorithm_name == name) {                                                                  \
+    add_algorithm(std::make_shared<__VA_ARGS__>());                                              \
+    return;                                                                                      \
+  }
+  ROLLBACK_RATE_ALGORITHMS(ADD_ALGORITHM_NAMED_)
+  if constexpr (only_rollback_rate) {
     throw "Unknown algorithm name " + algorithm_name +
         " in algorithms supporting rollback rate statistics";
-  } else if (algorithm_name == "SerializableAlgorithm_ALL_SAME_RR") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_ALL_SAME_RC") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_ALL_SAME_RU") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::ALL_SAME, SerializeReadPolicy::UNCOMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_ALL_SAME_SI") {
-    add_algorithm(
-        std::make_shared<ttts::HistorySerializableAlgorithm<SerializeLevel::ALL_SAME,
-                                                            SerializeReadPolicy::SI_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_COMMIT_SAME_RR") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::COMMIT_SAME, SerializeReadPolicy::REPEATABLE_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_COMMIT_SAME_RC") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::COMMIT_SAME, SerializeReadPolicy::COMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_COMMIT_SAME_RU") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::COMMIT_SAME, SerializeReadPolicy::UNCOMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_COMMIT_SAME_SI") {
-    add_algorithm(
-        std::make_shared<ttts::HistorySerializableAlgorithm<SerializeLevel::COMMIT_SAME,
-                                                            SerializeReadPolicy::SI_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_FINAL_SAME_RR") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::FINAL_SAME, SerializeReadPolicy::REPEATABLE_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_FINAL_SAME_RC") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::FINAL_SAME, SerializeReadPolicy::COMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_FINAL_SAME_RU") {
-    add_algorithm(std::make_shared<ttts::HistorySerializableAlgorithm<
-                      SerializeLevel::FINAL_SAME, SerializeReadPolicy::UNCOMMITTED_READ>>());
-  } else if (algorithm_name == "SerializableAlgorithm_FINAL_SAME_SI") {
-    add_algorithm(
-        std::make_shared<ttts::HistorySerializableAlgorithm<SerializeLevel::FINAL_SAME,
-                                                            SerializeReadPolicy::SI_READ>>());
-  } else if (algorithm_name == "ConflictSerializableAlgorithm") {
-    add_algorithm(std::make_shared<ttts::ConflictSerializableAlgorithm<false>>());
-  } else if (algorithm_name == "DLI_IDENTIFY") {
-    add_algorithm(std::make_shared<ttts::ConflictSerializableAlgorithm<true>>());
-  } else if (algorithm_name == "DLI_IDENTIFY_CYCLE") {
-    add_algorithm(std::make_shared<ttts::UnifiedHistoryAlgorithm<ttts::UniAlgs::UNI_DLI_IDENTIFY_CYCLE, uint64_t>>());
-  } else if (algorithm_name == "DLI_IDENTIFY_CHAIN") {
-    add_algorithm(std::make_shared<ttts::UnifiedHistoryAlgorithm<ttts::UniAlgs::UNI_DLI_IDENTIFY_CHAIN, uint64_t>>());
   } else {
-    throw "Unknown algorithm name " + algorithm_name;
+    HISTORY_ALGORITHMS(ADD_ALGORITHM_NAMED_)
   }
+#undef ADD_ALGORITHM_NAMED_
+  throw "Unknown algorithm name " + algorithm_name;
 }
 
 #define CONSTEXPR_CONDITIONAL(cond, v1, v2) \
@@ -0,0 +1,161 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#pragma once
+#include <cstring>
+#include <string_view>
+
+#include "../util/generic.h"
+
+namespace ttts {
+
+// An invalid line found by TextHistoryParser. message is a string literal so that reporting an
+// error does not allocate.
+struct HistoryParseError {
+  uint64_t line;    // 1-based
+  uint64_t column;  // 1-based
+  const char* message;
+};
+
+// Parse histories in text format, one history per line, e.g. "R12ab W3c C12 A3". An operation is
+// a type character, a transaction id of any number of digits and, for reads and writes, a data item
+// name of any number of lowercase letters. Transaction ids and item names are renumbered from 0 in
+// order of appearance.
+//
+// The parser makes one pass over the buffer without copying it. The only allocation per line is the
+// operation vector moved into the History, the id tables are reused across lines.
+class TextHistoryParser {
+ public:
+  // Parse the lines in [begin, end), where begin must be the start of a line and first_line is its
+  // line number. handle_history is called for each non-blank valid line and handle_error for each
+  // invalid line, which is skipped. Returns the number of lines in the buffer.
+  template <typename HandleHistory, typename HandleError>
+  uint64_t Parse(const char* begin, const char* const end, const uint64_t first_line,
+                 HandleHistory&& handle_history, HandleError&& handle_error) {
+    uint64_t line = first_line;
+    while (begin != end) {
+      const char* line_end = static_cast<const char*>(std::memchr(begin, '\n', end - begin));
+      if (line_end == nullptr) {
+        line_end = end;
+      }
+      ParseLine_(begin, line_end, line++, handle_history, handle_error);
+      begin = (line_end == end) ? end : line_end + 1;
+    }
+    return line - first_line;
+  }
+
+  // Split [begin, end) into at most chunk_num chunks of similar size ending at line boundaries, so
+  // the chunks can be parsed in parallel. Returns the chunk boundaries, including begin and end.
+  static std::vector<const char*> SplitAtLines(const char* const begin, const char* const end,
+                                               const uint64_t chunk_num) {
+    std::vector<const char*> bounds{begin};
+    for (uint64_t i = 1; i < chunk_num && bounds.back() != end; ++i) {
+      const char* const pos = std::max(bounds.back(), begin + (end - begin) * i / chunk_num);
+      const char* const line_end = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+      bounds.push_back(line_end == nullptr ? end : line_end + 1);
+    }
+    if (bounds.back() != end) {
+      bounds.push_back(end);
+    }
+    return bounds;
+  }
+
+ private:
+  static bool IsSpace_(const char c) { return c == ' ' || c == '\t' || c == '\r'; }
+  static bool IsDigit_(const char c) { return c >= '0' && c <= '9'; }
+  static bool IsLower_(const char c) { return c >= 'a' && c <= 'z'; }
+
+  // Histories only have a few transactions and items, so a linear search beats hashing.
+  template <typename T>
+  static uint64_t DenseId_(std::vector<T>& ids, const T& id) {
+    for (uint64_t dense_id = 0; dense_id < ids.size(); ++dense_id) {
+      if (ids[dense_id] == id) {
+        return dense_id;
+      }
+    }
+    ids.push_back(id);
+    return ids.size() - 1;
+  }
+
+  template <typename HandleHistory, typename HandleError>
+  void ParseLine_(const char* p, const char* const end, const uint64_t line,
+                  HandleHistory& handle_history, HandleError& handle_error) {
+    const char* const line_begin = p;
+    const auto fail = [&handle_error, line, line_begin](const char* const pos,
+                                                        const char* const message) {
+      handle_error(HistoryParseError{line, static_cast<uint64_t>(pos - line_begin) + 1, message});
+    };
+    trans_ids_.clear();
+    item_names_.clear();
+    std::vector<Operation> operations;
+    while (true) {
+      while (p != end && IsSpace_(*p)) {
+        ++p;
+      }
+      if (p == end) {
+        break;
+      }
+      if (operations.empty()) {
+        operations.reserve((end - p) / 3 + 1);  // an operation takes at least 3 characters
+      }
+
+      const char* const type_pos = p;
+      const char type_c = *p++;
+      if (type_c != 'R' && type_c != 'W' && type_c != 'C' && type_c != 'A' && type_c != 'S') {
+        return fail(type_pos, "unknown operation type, supported operations: R W C A S");
+      }
+
+      if (p == end || !IsDigit_(*p)) {
+        return fail(p, "transaction id must be a number");
+      }
+      uint64_t trans_id = 0;
+      for (; p != end && IsDigit_(*p); ++p) {
+        if (trans_id > (UINT64_MAX - 9) / 10) {
+          return fail(p, "transaction id is too large");
+        }
+        trans_id = trans_id * 10 + (*p - '0');
+      }
+      trans_id = DenseId_(trans_ids_, trans_id);
+
+      if (type_c == 'R' || type_c == 'W') {
+        const char* const name_begin = p;
+        while (p != end && IsLower_(*p)) {
+          ++p;
+        }
+        if (p == name_begin) {
+          return fail(p, "data item name must be lowercase letters");
+        }
+        const uint64_t item_id =
+            DenseId_(item_names_, std::string_view(name_begin, p - name_begin));
+        if (type_c == 'R') {
+          operations.emplace_back(Operation::ReadTypeConstant(), trans_id, item_id);
+        } else {
+          operations.emplace_back(Operation::WriteTypeConstant(), trans_id, item_id);
+        }
+      } else if (type_c == 'C') {
+        operations.emplace_back(Operation::CommitTypeConstant(), trans_id);
+      } else if (type_c == 'A') {
+        operations.emplace_back(Operation::AbortTypeConstant(), trans_id);
+      } else {
+        operations.emplace_back(Operation::ScanOddTypeConstant(), trans_id);
+      }
+
+      if (p != end && !IsSpace_(*p)) {
+        return fail(p, "operations must be separated by spaces");
+      }
+    }
+    if (!operations.empty()) {
+      handle_history(History(trans_ids_.size(), item_names_.size(), std::move(operations)));
+    }
+  }
+
+  std::vector<uint64_t> trans_ids_;
+  std::vector<std::string_view> item_names_;
+};
+
+}  // namespace ttts
@@ -277,7 +277,7 @@ class History {
   History(const uint64_t trans_num, const uint64_t item_num, std::vector<Operation>&& operations)
       : trans_num_(trans_num),
         item_num_(item_num),
-        operations_(operations),
+        operations_(std::move(operations)),
         abort_trans_num_(0),
         anomaly_name_("") {}
   History(const uint64_t trans_num, const uint64_t item_num,
@@ -324,21 +324,19 @@ class History {
       uint64_t item_num = 0;
       std::unordered_map<uint64_t, uint64_t> trans_num_map;
       std::unordered_map<uint64_t, uint64_t> item_num_map;
-      for (std::stringstream ss(s); !ss.eof() && !ss.fail();) {
-        Operation operation;
-        if (Operation operation; ss >> operation) {
-          if (trans_num_map.count(operation.trans_id()) == 0) {
-            trans_num_map[operation.trans_id()] = trans_num_map.size();
-          }
-          operation.SetTransId(trans_num_map[operation.trans_id()]);
-          if (operation.IsPointDML()) {
-            if (item_num_map.count(operation.item_id()) == 0) {
-              item_num_map[operation.item_id()] = item_num_map.size();
-            }
-            operation.SetItemId(item_num_map[operation.item_id()]);
+      // an operation that ends the line leaves eof set, and skipping whitespace then would fail
+      for (Operation operation; !ss.eof() && !(ss >> std::ws).eof() && ss >> operation;) {
+        if (trans_num_map.count(operation.trans_id()) == 0) {
+          trans_num_map[operation.trans_id()] = trans_num_map.size();
+        }
+        operation.SetTransId(trans_num_map[operation.trans_id()]);
+        if (operation.IsPointDML()) {
+          if (item_num_map.count(operation.item_id()) == 0) {
+            item_num_map[operation.item_id()] = item_num_map.size();
           }
-          operations.emplace_back(operation);
+          operation.SetItemId(item_num_map[operation.item_id()]);
         }
+        operations.emplace_back(operation);
       }
       trans_num = trans_num_map.size();
       item_num = item_num_map.size();
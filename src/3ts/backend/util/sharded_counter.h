@@ -0,0 +1,74 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ttts {
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Each thread gets a stable id the first time it touches a sharded counter, so that threads of the
+// same ThreadPool fall into different shards.
+inline uint64_t ThreadShardId() {
+  static std::atomic<uint64_t> next_shard_id{0};
+  thread_local const uint64_t shard_id = next_shard_id.fetch_add(1, std::memory_order_relaxed);
+  return shard_id;
+}
+
+// A group of N counters split into cache-line-aligned per-thread shards. Add() only touches the
+// shard of the calling thread, so checker threads do not bounce the same cache lines. Reading is
+// done by merging all shards, which is expected to be rare (e.g. in Statistics()).
+template <size_t N, size_t SHARD_NUM = 64>
+class ShardedCounters {
+ public:
+  ShardedCounters() {
+    for (Shard& shard : shards_) {
+      for (std::atomic<uint64_t>& count : shard.counts_) {
+        count.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+  ShardedCounters(const ShardedCounters&) = delete;
+  ShardedCounters& operator=(const ShardedCounters&) = delete;
+
+  void Add(const size_t index, const uint64_t value = 1) {
+    // Threads sharing a shard after wrap around still count correctly, they only lose the padding.
+    shards_[ThreadShardId() % SHARD_NUM].counts_[index].fetch_add(value, std::memory_order_relaxed);
+  }
+
+  uint64_t Sum(const size_t index) const {
+    uint64_t sum = 0;
+    for (const Shard& shard : shards_) {
+      sum += shard.counts_[index].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  std::array<uint64_t, N> Merge() const {
+    std::array<uint64_t, N> sums{};
+    for (const Shard& shard : shards_) {
+      for (size_t index = 0; index < N; ++index) {
+        sums[index] += shard.counts_[index].load(std::memory_order_relaxed);
+      }
+    }
+    return sums;
+  }
+
+ private:
+  struct alignas(CACHE_LINE_SIZE) Shard {
+    std::array<std::atomic<uint64_t>, N> counts_;
+  };
+
+  std::array<Shard, SHARD_NUM> shards_;
+};
+
+}  // namespace ttts
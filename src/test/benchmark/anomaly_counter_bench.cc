@@ -0,0 +1,43 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include <array>
+#include <atomic>
+#include <string>
+#include <type_traits>
+
+#include "../../3ts/backend/cca/anomaly_type.h"
+#include "../../3ts/backend/util/sharded_counter.h"
+#include "benchmark/benchmark.h"
+
+// Same shape as the anomaly counters of ConflictSerializableAlgorithm: one counter per anomaly type,
+// incremented once per checked history.
+constexpr size_t ANOMALY_TYPE_NUM = ttts::Count<ttts::AnomalyType>();
+
+std::array<std::atomic<uint64_t>, ANOMALY_TYPE_NUM> shared_counts{};
+ttts::ShardedCounters<ANOMALY_TYPE_NUM> sharded_counts;
+
+static void BM_SharedAtomicCounters(benchmark::State& state) {
+  uint64_t i = state.thread_index();
+  for (auto _ : state) {
+    shared_counts[i++ % ANOMALY_TYPE_NUM].fetch_add(1, std::memory_order_relaxed);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_SharedAtomicCounters)->ThreadRange(1, 64)->UseRealTime();
+
+static void BM_ShardedCounters(benchmark::State& state) {
+  uint64_t i = state.thread_index();
+  for (auto _ : state) {
+    sharded_counts.Add(i++ % ANOMALY_TYPE_NUM);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ShardedCounters)->ThreadRange(1, 64)->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,3 @@
+g++ $1 -O2 -std=c++17 -lbenchmark -lpthread -lconfig++
+./a.out ${@:2}
+rm ./a.out
@@ -0,0 +1,119 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/history/parse_config.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#include "benchmark/benchmark.h"
+
+// Measure every algorithm registered in AlgorithmParseInternal_ on the same fixed corpus, reporting
+// ns/history and allocations/history. Run from this directory:
+//   bash bench.sh cca_bench.cc --benchmark_out=result.json
+//   python3 compare.py result.json
+// compare.py checks allocs/history against baseline/cca_bench_allocs_<CORPUS_VERSION>.json. To also
+// compare ns/history, record baseline.json the same way on the revision to compare against, on the
+// same machine, and pass --baseline baseline.json.
+
+#define CORPUS_VERSION "v1"
+#define CORPUS_DIR "../history/corpus/" CORPUS_VERSION "/"
+
+std::atomic<uint64_t> alloc_count{0};
+
+void* operator new(std::size_t size) {
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  if (void* const p = std::malloc(size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+const std::vector<std::string> CORPUS_FILES = {
+    CORPUS_DIR "traversal_t2_i2_d4_tail",
+    CORPUS_DIR "traversal_t2_i2_d4_anywhere",
+    CORPUS_DIR "traversal_t3_i3_d5_tail",
+    CORPUS_DIR "random_t3_i3_d6_tail_abort",
+    CORPUS_DIR "random_t4_i4_d8_tail",
+    CORPUS_DIR "random_t5_i8_d12_tail_abort",
+    CORPUS_DIR "random_t6_i10_d18_tail",
+    "../history/special/all_same_not_serial",
+};
+
+std::vector<History> LoadCorpus(const std::string& path) {
+  std::vector<History> histories;
+  InputHistoryGenerator(path).DeliverHistories(
+      [&histories](History&& history) { histories.emplace_back(std::move(history)); });
+  if (histories.empty()) {
+    throw "Empty corpus file " + path;
+  }
+  return histories;
+}
+
+template <typename Algorithm>
+void CheckOnce(const Algorithm& algorithm, const History& history) {
+  if constexpr (std::is_base_of_v<RollbackRateAlgorithm, Algorithm>) {
+    benchmark::DoNotOptimize(algorithm.RollbackNum(history, nullptr));
+  } else {
+    benchmark::DoNotOptimize(algorithm.Check(history, nullptr));
+  }
+}
+
+template <typename Algorithm>
+void BM_Algorithm(benchmark::State& state, std::shared_ptr<Algorithm> algorithm,
+                  const std::vector<History>* histories) {
+  std::chrono::nanoseconds elapsed(0);
+  // only those of the checks, so that allocs/history does not depend on the iteration count
+  uint64_t allocs = 0;
+  for (auto _ : state) {
+    const auto start_time = std::chrono::steady_clock::now();
+    const uint64_t alloc_count_begin = alloc_count.load(std::memory_order_relaxed);
+    for (const History& history : *histories) {
+      CheckOnce(*algorithm, history);
+    }
+    allocs += alloc_count.load(std::memory_order_relaxed) - alloc_count_begin;
+    elapsed += std::chrono::steady_clock::now() - start_time;
+  }
+  const double checked_num = static_cast<double>(state.iterations()) * histories->size();
+  state.counters["histories"] = histories->size();
+  state.counters["ns/history"] = elapsed.count() / checked_num;
+  state.counters["allocs/history"] = allocs / checked_num;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::pair<std::string, std::vector<History>>> corpus;
+  try {
+    for (const std::string& path : CORPUS_FILES) {
+      corpus.emplace_back(path.substr(path.find_last_of('/') + 1), LoadCorpus(path));
+    }
+  } catch (const std::string& str) {
+    std::cerr << str << std::endl;
+    return 1;
+  }
+
+  const libconfig::Config cfg;
+  for (const std::string& algorithm_name : ALGORITHM_NAMES) {
+    AlgorithmParseInternal_<false /* only_rollback_rate */>(
+        cfg, algorithm_name, [&corpus, &algorithm_name](auto&& algorithm) {
+          using Algorithm = std::decay_t<decltype(*algorithm)>;
+          for (const auto& [corpus_name, histories] : corpus) {
+            benchmark::RegisterBenchmark((algorithm_name + "/" + corpus_name).c_str(),
+                                         BM_Algorithm<Algorithm>, algorithm, &histories);
+          }
+        });
+  }
+  benchmark::AddCustomContext("corpus_version", CORPUS_VERSION);
+
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
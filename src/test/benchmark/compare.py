@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+#
+# Tencent is pleased to support the open source community by making 3TS available.
+#
+# Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+# in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+# Tencent Modifications are Copyright (C) THL A29 Limited.
+#
+# Compare a cca_bench result with the baselines and flag regressions.
+# Usage: python3 compare.py result.json [--baseline baseline.json] [--time-threshold 0.10]
+#                                       [--alloc-threshold 0.01] [--update-allocs]
+# Exit code is 1 if any algorithm regresses.
+#
+# allocs/history is counted exactly and does not depend on the machine or the build, so its
+# baseline is kept in the tree, in baseline/cca_bench_allocs_<corpus version>.json, and always
+# checked. ns/history does, so it is only compared with --baseline, a result recorded from the
+# revision to compare against, on the same machine and with the same build. --update-allocs
+# rewrites the allocs/history baseline from the result, for a change that is meant to allocate
+# differently.
+
+import argparse
+import json
+import os
+import sys
+
+BASELINE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "baseline")
+
+
+def load(path):
+    with open(path) as f:
+        result = json.load(f)
+    benchmarks = {}
+    for benchmark in result["benchmarks"]:
+        if benchmark.get("run_type", "iteration") != "iteration":
+            continue
+        benchmarks[benchmark["name"]] = benchmark
+    return result["context"].get("corpus_version"), benchmarks
+
+
+def allocs_path(corpus_version):
+    return os.path.join(BASELINE_DIR, "cca_bench_allocs_%s.json" % corpus_version)
+
+
+def load_allocs(corpus_version):
+    with open(allocs_path(corpus_version)) as f:
+        allocs = json.load(f)
+    assert allocs["corpus_version"] == corpus_version
+    return allocs["allocs/history"]
+
+
+def write_allocs(corpus_version, current):
+    allocs = {"corpus_version": corpus_version,
+              "allocs/history": {name: current[name]["allocs/history"] for name in sorted(current)}}
+    with open(allocs_path(corpus_version), "w") as f:
+        json.dump(allocs, f, indent=2)
+        f.write("\n")
+
+
+def relative_diff(base, cur):
+    return cur / base - 1 if base else (1.0 if cur else 0.0)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("current")
+    parser.add_argument("--baseline", help="result of the revision to compare ns/history with")
+    parser.add_argument("--time-threshold", type=float, default=0.10,
+                        help="relative ns/history increase regarded as regression")
+    parser.add_argument("--alloc-threshold", type=float, default=0.01,
+                        help="relative allocs/history increase regarded as regression")
+    parser.add_argument("--update-allocs", action="store_true",
+                        help="write the allocs/history baseline from the current result")
+    args = parser.parse_args()
+
+    current_version, current = load(args.current)
+    if args.update_allocs:
+        write_allocs(current_version, current)
+        print("wrote %s" % allocs_path(current_version))
+        return 0
+    base_allocs = load_allocs(current_version)
+    baseline = None
+    if args.baseline:
+        baseline_version, baseline = load(args.baseline)
+        if baseline_version != current_version:
+            print("corpus version mismatch: baseline %s, current %s" % (baseline_version,
+                                                                        current_version))
+            return 1
+
+    regressions = 0
+    print("%-70s %14s %14s %8s %12s %12s %8s" % ("benchmark", "base ns/his", "cur ns/his", "diff",
+                                                 "base alloc", "cur alloc", "diff"))
+    for name in sorted(set(base_allocs) | set(current)):
+        if name not in base_allocs or name not in current:
+            print("%-70s only in %s" % (name, "baseline" if name in base_allocs else "current"))
+            continue
+        cur = current[name]
+        alloc_diff = relative_diff(base_allocs[name], cur["allocs/history"])
+        regressed = alloc_diff > args.alloc_threshold + 1e-9
+        time_columns = "%14s %14s %8s" % ("-", "%.1f" % cur["ns/history"], "-")
+        if baseline is not None and name in baseline:
+            time_diff = relative_diff(baseline[name]["ns/history"], cur["ns/history"])
+            regressed = regressed or time_diff > args.time_threshold
+            time_columns = "%14.1f %14.1f %+7.1f%%" % (baseline[name]["ns/history"],
+                                                       cur["ns/history"], time_diff * 100)
+        regressions += regressed
+        print("%-70s %s %12.2f %12.2f %+7.1f%%%s" % (
+            name, time_columns, base_allocs[name], cur["allocs/history"], alloc_diff * 100,
+            "  REGRESSION" if regressed else ""))
+
+    print("%d regression(s)" % regressions)
+    return 1 if regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,78 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/history/generator.h"
+
+// Generate the benchmark corpus under the given directory. The corpus is committed, so it only needs
+// to be regenerated when a new corpus version is created. Usage: ./a.out ../history/corpus/v1
+using namespace ttts;
+
+struct CorpusFile {
+  std::string name;
+  bool traversal;
+  Options opt;
+  uint64_t history_num;  // random: histories to generate, traversal: max histories to keep
+};
+
+Options MakeOptions(const uint64_t trans_num, const uint64_t item_num, const uint64_t max_dml,
+                    const bool with_abort, const TclPosition tcl_position,
+                    const uint64_t subtask_num = 1) {
+  Options opt;
+  opt.trans_num = trans_num;
+  opt.item_num = item_num;
+  opt.max_dml = max_dml;
+  opt.subtask_num = subtask_num;
+  opt.subtask_id = 0;
+  opt.with_abort = with_abort;
+  opt.tcl_position = tcl_position;
+  opt.allow_empty_trans = false;
+  opt.dynamic_history_len = false;
+  opt.with_scan = Intensity::NONE_HAVE;
+  opt.with_write = Intensity::ALL_HAVE;
+  return opt;
+}
+
+const std::vector<CorpusFile> CORPUS_FILES = {
+    {"traversal_t2_i2_d4_tail", true, MakeOptions(2, 2, 4, true, TclPosition::TAIL, 7), 2000},
+    {"traversal_t2_i2_d4_anywhere", true, MakeOptions(2, 2, 4, false, TclPosition::ANYWHERE, 3),
+     2000},
+    {"traversal_t3_i3_d5_tail", true, MakeOptions(3, 3, 5, false, TclPosition::TAIL, 97), 2000},
+    {"random_t3_i3_d6_tail_abort", false, MakeOptions(3, 3, 6, true, TclPosition::TAIL), 1000},
+    {"random_t4_i4_d8_tail", false, MakeOptions(4, 4, 8, false, TclPosition::TAIL), 1000},
+    {"random_t5_i8_d12_tail_abort", false, MakeOptions(5, 8, 12, true, TclPosition::TAIL), 500},
+    {"random_t6_i10_d18_tail", false, MakeOptions(6, 10, 18, false, TclPosition::TAIL), 200},
+};
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <corpus_dir>" << std::endl;
+    return 1;
+  }
+  for (const CorpusFile &file : CORPUS_FILES) {
+    std::ofstream os(std::string(argv[1]) + "/" + file.name);
+    uint64_t count = 0;
+    const auto write_history = [&os, &count, &file](History &&history) {
+      if (count >= file.history_num) {
+        return;
+      }
+      std::ostringstream line;
+      line << history;
+      std::string s = line.str();
+      s.erase(s.find_last_not_of(' ') + 1);
+      os << s << std::endl;
+      ++count;
+    };
+    if (file.traversal) {
+      TraversalHistoryGenerator(file.opt).DeliverHistories(write_history);
+    } else {
+      RandomHistoryGenerator(file.opt, file.history_num).DeliverHistories(write_history);
+    }
+    std::cout << file.name << ": " << count << " histories" << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,56 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/history/text_parser.h"
+
+#include <fstream>
+
+#include "benchmark/benchmark.h"
+
+// Compare History::operator>> with TextHistoryParser on the benchmark corpus.
+//   bash bench.sh text_parser_bench.cc
+
+using namespace ttts;
+
+const std::string& CorpusText() {
+  static const std::string text = [] {
+    std::ostringstream os;
+    for (const char* const name : {"traversal_t3_i3_d5_tail", "random_t5_i8_d12_tail_abort",
+                                   "random_t6_i10_d18_tail"}) {
+      os << std::ifstream(std::string("../history/corpus/v1/") + name).rdbuf();
+    }
+    return os.str();
+  }();
+  return text;
+}
+
+void BM_StreamParse(benchmark::State& state) {
+  for (auto _ : state) {
+    std::istringstream is(CorpusText());
+    for (History history; is >> history;) {
+      benchmark::DoNotOptimize(history.size());
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * CorpusText().size());
+}
+BENCHMARK(BM_StreamParse);
+
+void BM_TextHistoryParser(benchmark::State& state) {
+  const std::string& text = CorpusText();
+  TextHistoryParser parser;
+  for (auto _ : state) {
+    parser.Parse(
+        text.data(), text.data() + text.size(), 1,
+        [](History&& history) { benchmark::DoNotOptimize(history.size()); },
+        [](const HistoryParseError&) {});
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+BENCHMARK(BM_TextHistoryParser);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,181 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/cca/conflict_serializable_algorithm.h"
+
+#include "gtest/gtest.h"
+
+using namespace ttts;
+
+// The anomaly identification before it was reduced to a table lookup. It is kept here as the
+// reference which the table must agree with.
+struct LegacyAnomalyIdentifier {
+  static AnomalyType IdentifyAnomaly(const std::vector<DAPreceInfo>& preces) {
+    assert(preces.size() >= 2);
+    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WA || prece.type() == PreceType::WC; })) {
+      // WA and WC precedence han only appear
+      return AnomalyType::WAT_1_DIRTY_WRITE;
+    } else if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::RA; })) {
+      return AnomalyType::RAT_1_DIRTY_READ;
+    } else if (preces.size() >= 3) {
+      return IdentifyAnomalyMultiple_(preces);
+    // when build path, later happened precedence is sorted to front
+    } else if (preces.back().item_id() != preces.front().item_id()) {
+      return IdentifyAnomalyDouble_(preces.back().type(), preces.front().type());
+    } else {
+      return IdentifyAnomalySingle_(preces.back().type(), preces.front().type());
+    }
+  }
+
+  // require type1 precedence happens before type2 precedence
+  static AnomalyType IdentifyAnomalySingle_(const PreceType early_type, const PreceType later_type) {
+    if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
+      return AnomalyType::WAT_1_FULL_WRITE; // WW-WW | WR-WW = WWW
+    } else if (early_type == PreceType::WR && early_type == PreceType::WW) {
+      return AnomalyType::WAT_1_FULL_WRITE; // WR-WW = WWW
+    } else if ((early_type == PreceType::WW || early_type == PreceType::WR) && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::WAT_1_LOST_SELF_UPDATE; // WW-WR = WWR
+    } else if (early_type == PreceType::RW && later_type == PreceType::WW) {
+      return AnomalyType::WAT_1_LOST_UPDATE; // RW-WW | RW-RW = RWW
+    } else if (early_type == PreceType::WR && later_type == PreceType::RW) {
+      return AnomalyType::RAT_1_INTERMEDIATE_READ; // WR-RW = WRW
+    } else if (early_type == PreceType::RW && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::RAT_1_NON_REPEATABLE_READ; // RW-WR = RWR
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
+      return AnomalyType::IAT_1_LOST_UPDATE_COMMITTED; // RW-WW(WCW) = RWW
+    } else {
+      return AnomalyType::UNKNOWN_1;
+    }
+  }
+
+  static AnomalyType IdentifyAnomalyDouble_(const PreceType early_type, const PreceType later_type) {
+    const auto any_order = [early_type, later_type](const PreceType type1, const PreceType type2) -> std::optional<bool> {
+      if (early_type == type1 && later_type == type2) {
+        return true;
+      } else if (early_type == type2 && later_type == type1) {
+        return false;
+      } else {
+        return {};
+      }
+    };
+    if (const auto order = any_order(PreceType::WR, PreceType::WW); order.has_value()) {
+      return *order ? AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_1 : AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
+    } else if (early_type == PreceType::WW && later_type == PreceType::WCR) {
+      return AnomalyType::WAT_2_DOUBLE_WRITE_SKEW_2;
+    } else if (const auto order = any_order(PreceType::RW, PreceType::WW); order.has_value()) {
+      return *order ? AnomalyType::WAT_2_READ_WRITE_SKEW_1 : AnomalyType::WAT_2_READ_WRITE_SKEW_2;
+    } else if (early_type == PreceType::WW && (later_type == PreceType::WW || later_type == PreceType::WCW)) {
+      return AnomalyType::WAT_2_FULL_WRITE_SKEW;
+    } else if (early_type == PreceType::WR && (later_type == PreceType::WR || later_type == PreceType::WCR)) {
+      return AnomalyType::RAT_2_WRITE_READ_SKEW;
+    } else if (early_type == PreceType::WR && later_type == PreceType::WCW) {
+      return AnomalyType::RAT_2_DOUBLE_WRITE_SKEW_COMMITTED;
+    } else if (const auto order = any_order(PreceType::RW, PreceType::WR); order.has_value()) {
+      return *order ? AnomalyType::RAT_2_READ_SKEW : AnomalyType::RAT_2_READ_SKEW_2;
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCR) {
+      return AnomalyType::RAT_2_READ_SKEW;
+    } else if (early_type == PreceType::RW && later_type == PreceType::WCW) {
+      return AnomalyType::IAT_2_READ_WRITE_SKEW_COMMITTED;
+    } else if (early_type == PreceType::RW && later_type == PreceType::RW) {
+      return AnomalyType::IAT_2_WRITE_SKEW;
+    } else {
+      return AnomalyType::UNKNOWN_2;
+    }
+  }
+
+  static AnomalyType IdentifyAnomalyMultiple_(const std::vector<DAPreceInfo>& preces) {
+    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WW; })) {
+      return AnomalyType::WAT_STEP;
+    }
+    if (std::any_of(preces.begin(), preces.end(), [](const DAPreceInfo& prece) { return prece.type() == PreceType::WR || prece.type() == PreceType::WCR; })) {
+      return AnomalyType::RAT_STEP;
+    }
+    return AnomalyType::IAT_STEP;
+  }
+};
+
+// Build a cycle in which the first precedence in types happens first and each precedence is on the
+// item given by items.
+std::vector<DAPreceInfo> MakeCycle(const std::vector<PreceType>& types,
+                                   const std::vector<uint64_t>& items) {
+  const uint64_t trans_num = types.size();
+  std::vector<DAPreceInfo> preces;
+  for (uint64_t i = 0; i < trans_num; ++i) {
+    preces.emplace_back(i, (i + 1) % trans_num, items[i], types[i], i);
+  }
+  // when build path, later happened precedence is sorted to front
+  std::reverse(preces.begin(), preces.end());
+  return preces;
+}
+
+// Enumerate all precedence type combinations of cycles of trans_num transactions.
+void ForEachTypes(const uint64_t trans_num,
+                  const std::function<void(const std::vector<PreceType>&)>& handle) {
+  std::vector<PreceType> types(trans_num, PreceType::RW);
+  std::function<void(uint64_t)> fill = [&](const uint64_t pos) {
+    if (pos == trans_num) {
+      handle(types);
+      return;
+    }
+    for (const PreceType type : Members<PreceType>()) {
+      types[pos] = type;
+      fill(pos + 1);
+    }
+  };
+  fill(0);
+}
+
+TEST(DAAnomalyTableTest, DoubleTransSameItem) {
+  ForEachTypes(2, [](const std::vector<PreceType>& types) {
+    const auto preces = MakeCycle(types, {0, 0});
+    ASSERT_EQ(LegacyAnomalyIdentifier::IdentifyAnomaly(preces),
+              ConflictSerializableAlgorithm<true>::IdentifyAnomaly(preces))
+        << types[0] << " " << types[1];
+  });
+}
+
+TEST(DAAnomalyTableTest, DoubleTransDifferentItems) {
+  ForEachTypes(2, [](const std::vector<PreceType>& types) {
+    const auto preces = MakeCycle(types, {0, 1});
+    ASSERT_EQ(LegacyAnomalyIdentifier::IdentifyAnomaly(preces),
+              ConflictSerializableAlgorithm<true>::IdentifyAnomaly(preces))
+        << types[0] << " " << types[1];
+  });
+}
+
+TEST(DAAnomalyTableTest, MultiTrans) {
+  for (uint64_t trans_num = 3; trans_num <= 5; ++trans_num) {
+    for (const bool same_item : {false, true}) {
+      std::vector<uint64_t> items(trans_num, 0);
+      if (!same_item) {
+        std::iota(items.begin(), items.end(), 0);
+      }
+      ForEachTypes(trans_num, [&items](const std::vector<PreceType>& types) {
+        const auto preces = MakeCycle(types, items);
+        ASSERT_EQ(LegacyAnomalyIdentifier::IdentifyAnomaly(preces),
+                  ConflictSerializableAlgorithm<true>::IdentifyAnomaly(preces));
+      });
+    }
+  }
+}
+
+TEST(DAAnomalyTableTest, MultiTransSignatures) {
+  // cycles of more than two transactions are either dirty anomalies or step anomalies
+  for (uint32_t type_mask = 0; type_mask < DACycleSignature::MULTI_TRANS_NUM; ++type_mask) {
+    const AnomalyType anomaly = DA_ANOMALY_TABLE[DACycleSignature::MultiTrans(type_mask)];
+    ASSERT_TRUE(anomaly == AnomalyType::WAT_1_DIRTY_WRITE || anomaly == AnomalyType::RAT_1_DIRTY_READ ||
+                anomaly == AnomalyType::WAT_STEP || anomaly == AnomalyType::RAT_STEP ||
+                anomaly == AnomalyType::IAT_STEP)
+        << type_mask;
+  }
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,170 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/cca/serializable_algorithm.h"
+
+#include "gtest/gtest.h"
+
+using namespace ttts;
+
+History ParseHistory(const std::string& text) {
+  History history;
+  std::istringstream is(text);
+  is >> history;
+  history.UpdateWriteVersions();
+  return history;
+}
+
+template <SerializeLevel L, SerializeReadPolicy R>
+bool Serializable(const std::string& text) {
+  return HistorySerializableAlgorithm<L, R>().Check(ParseHistory(text), nullptr);
+}
+
+struct ReadRecord {
+  uint64_t trans_id;
+  uint64_t item_id;
+  uint64_t version;
+};
+
+HistoryResult MakeResult(const std::vector<bool>& trans_committed,
+                         const std::vector<ReadRecord>& reads,
+                         std::vector<uint64_t>&& item_final_versions) {
+  HistoryResult result(trans_committed.size());
+  for (const ReadRecord& read : reads) {
+    result.PushTransReadResult(read.trans_id, read.item_id, read.version);
+  }
+  for (uint64_t trans_id = 0; trans_id < trans_committed.size(); ++trans_id) {
+    result.SetTransCommitted(trans_id, trans_committed[trans_id]);
+  }
+  result.SetItemFinalVersions(std::move(item_final_versions));
+  return result;
+}
+
+// The first read of an item returns the latest committed version, later reads repeat it.
+TEST(SerializableTest, RepeatableReadFirstReadIsLatest) {
+  const HistoryResult result = Result<SerializeReadPolicy::REPEATABLE_READ>(
+      ParseHistory("W1a C1 R2a W3a C3 R2a C2"));
+  EXPECT_TRUE(result.ReadEqual(MakeResult({true, true, true}, {{1, 0, 1}, {1, 0, 1}}, {2})));
+  EXPECT_TRUE(result.FinalEqual(MakeResult({true, true, true}, {}, {2})));
+  EXPECT_FALSE(result.ReadEqual(MakeResult({true, true, true}, {{1, 0, 0}, {1, 0, 0}}, {2})));
+  EXPECT_FALSE(result.ReadEqual(MakeResult({true, true, true}, {{1, 0, 1}, {1, 0, 2}}, {2})));
+}
+
+TEST(SerializableTest, RepeatableReadOwnWrite) {
+  const HistoryResult result =
+      Result<SerializeReadPolicy::REPEATABLE_READ>(ParseHistory("R1a W2a C2 W1a R1a C1"));
+  EXPECT_TRUE(result.ReadEqual(MakeResult({true, true}, {{0, 0, 0}, {0, 0, 2}}, {2})));
+}
+
+TEST(SerializableTest, ReadsComparedPerTransaction) {
+  // Reads of different transactions may interleave, reads of one transaction keep their order.
+  const HistoryResult result = MakeResult({true, true}, {{0, 0, 1}, {1, 0, 1}, {0, 1, 0}}, {1, 0});
+  EXPECT_TRUE(
+      result.ReadEqual(MakeResult({true, true}, {{1, 0, 1}, {0, 0, 1}, {0, 1, 0}}, {1, 0})));
+  EXPECT_TRUE(
+      result.ReadEqual(MakeResult({true, true}, {{0, 0, 1}, {0, 1, 0}, {1, 0, 1}}, {1, 0})));
+  EXPECT_FALSE(
+      result.ReadEqual(MakeResult({true, true}, {{0, 1, 0}, {0, 0, 1}, {1, 0, 1}}, {1, 0})));
+  EXPECT_FALSE(
+      result.ReadEqual(MakeResult({true, true}, {{0, 0, 1}, {1, 0, 1}, {1, 1, 0}}, {1, 0})));
+  EXPECT_FALSE(result.ReadEqual(MakeResult({true, true}, {{0, 0, 1}, {0, 1, 0}}, {1, 0})));
+  EXPECT_FALSE(
+      result.ReadEqual(MakeResult({true, false}, {{0, 0, 1}, {1, 0, 1}, {0, 1, 0}}, {1, 0})));
+  EXPECT_FALSE(result.CommitReadEqual(MakeResult({true, false}, {{0, 0, 1}, {0, 1, 0}}, {1, 0})));
+  EXPECT_TRUE(
+      result.CommitReadEqual(MakeResult({true, true}, {{0, 0, 1}, {0, 1, 0}, {1, 0, 1}}, {0, 0})));
+  EXPECT_FALSE(result.FinalEqual(MakeResult({true, true}, {}, {0, 0})));
+}
+
+TEST(SerializableTest, CommitReadEqualIgnoresAbortedReads) {
+  const HistoryResult result = MakeResult({true, false}, {{0, 0, 1}, {1, 0, 1}}, {1});
+  EXPECT_TRUE(result.CommitReadEqual(MakeResult({true, false}, {{0, 0, 1}, {1, 0, 0}}, {1})));
+  EXPECT_TRUE(result.CommitReadEqual(MakeResult({true, false}, {{0, 0, 1}}, {1})));
+  EXPECT_FALSE(result.CommitReadEqual(MakeResult({true, false}, {{0, 0, 0}, {1, 0, 1}}, {1})));
+  EXPECT_FALSE(result.ReadEqual(MakeResult({true, false}, {{0, 0, 1}, {1, 0, 0}}, {1})));
+}
+
+TEST(SerializableTest, NonRepeatableRead) {
+  const std::string history = "R1a W2a C2 R1a C1";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::FINAL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_TRUE((Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::SI_READ>(history)));
+}
+
+TEST(SerializableTest, RepeatableReadAfterCommit) {
+  // T2 first reads a after T1 commits, so it must read T1's version both times.
+  const std::string history = "W1a C1 R2a W3a C3 R2a C2";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::FINAL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+}
+
+TEST(SerializableTest, DirtyRead) {
+  const std::string history = "W1a R2a C2 A1";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::UNCOMMITTED_READ>(history)));
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::UNCOMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+}
+
+TEST(SerializableTest, AbortedReaderIgnoredByCommitSame) {
+  const std::string history = "R1a W2a C2 R1a A1";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+}
+
+TEST(SerializableTest, LostUpdate) {
+  const std::string history = "R1a R2a W1a W2a C1 C2";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_FALSE((Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::SI_READ>(history)));
+  EXPECT_TRUE((Serializable<SerializeLevel::FINAL_SAME, SerializeReadPolicy::SI_READ>(history)));
+}
+
+TEST(SerializableTest, WriteSkew) {
+  const std::string history = "R1a R1b R2a R2b W1a W2b C1 C2";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_FALSE((Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::SI_READ>(history)));
+  EXPECT_FALSE((Serializable<SerializeLevel::COMMIT_SAME, SerializeReadPolicy::SI_READ>(history)));
+  EXPECT_TRUE((Serializable<SerializeLevel::FINAL_SAME, SerializeReadPolicy::SI_READ>(history)));
+}
+
+TEST(SerializableTest, ScanOdd) {
+  // The second scan of T2 sees a different set of items unless it repeats the first one.
+  const std::string history = "W1a C1 S2 W3a W3b C3 S2 C2";
+  EXPECT_FALSE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::COMMITTED_READ>(history)));
+  EXPECT_TRUE(
+      (Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::REPEATABLE_READ>(history)));
+  EXPECT_TRUE((Serializable<SerializeLevel::ALL_SAME, SerializeReadPolicy::SI_READ>(history)));
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,3 +1,3 @@
-g++ $1 -lpthread -lgtest -std=c++11 -lconfig++  
+g++ $1 -lpthread -lgtest -std=c++17 -lconfig++  
 ./a.out 
 rm ./a.out 
@@ -0,0 +1,127 @@
+/*
+ * Tencent is pleased to support the open source community by making 3TS available.
+ *
+ * Copyright (C) 2020 THL A29 Limited, a Tencent company.  All rights reserved. The below software
+ * in this distribution may have been modified by THL A29 Limited ("Tencent Modifications"). All
+ * Tencent Modifications are Copyright (C) THL A29 Limited.
+ *
+ */
+#include "../../3ts/backend/history/text_parser.h"
+
+#include "gtest/gtest.h"
+
+using namespace ttts;
+
+struct ParseOutput {
+  std::vector<std::string> histories;
+  std::vector<std::pair<uint64_t, uint64_t>> error_positions;  // (line, column)
+};
+
+ParseOutput ParseText(const std::string& text) {
+  ParseOutput output;
+  const std::vector<const char*> bounds =
+      TextHistoryParser::SplitAtLines(text.data(), text.data() + text.size(), 1);
+  TextHistoryParser().Parse(
+      bounds.front(), bounds.back(), 1,
+      [&output](History&& history) {
+        std::ostringstream os;
+        os << history;
+        output.histories.emplace_back(os.str());
+      },
+      [&output](const HistoryParseError& error) {
+        output.error_positions.emplace_back(error.line, error.column);
+      });
+  return output;
+}
+
+TEST(TextParserTest, RenumberIds) {
+  const ParseOutput output = ParseText("R1a W2a W1b C2 C1\nR3x S7 A3 C7\n");
+  EXPECT_TRUE(output.error_positions.empty());
+  EXPECT_EQ(output.histories,
+            (std::vector<std::string>{"R0a W1a W0b C1 C0 ", "R0a S1 A0 C1 "}));
+}
+
+TEST(TextParserTest, MultiDigitTransAndMultiCharItem) {
+  std::vector<History> histories;
+  TextHistoryParser parser;
+  const std::string text = "R12foo W345bar R12bar W345foo C12 A345\r\n";
+  EXPECT_EQ(1, parser.Parse(text.data(), text.data() + text.size(), 1,
+                            [&histories](History&& history) {
+                              histories.emplace_back(std::move(history));
+                            },
+                            [](const HistoryParseError&) { FAIL(); }));
+  ASSERT_EQ(1, histories.size());
+  EXPECT_EQ(2, histories[0].trans_num());
+  EXPECT_EQ(2, histories[0].item_num());
+  const std::vector<std::pair<uint64_t, uint64_t>> expected_trans_items = {
+      {0, 0}, {1, 1}, {0, 1}, {1, 0}};
+  for (size_t i = 0; i < expected_trans_items.size(); ++i) {
+    EXPECT_EQ(expected_trans_items[i].first, histories[0][i].trans_id());
+    EXPECT_EQ(expected_trans_items[i].second, histories[0][i].item_id());
+  }
+}
+
+TEST(TextParserTest, ErrorsReportedByLine) {
+  const ParseOutput output = ParseText(
+      "R1a C1\n"
+      "\n"
+      "X1a C1\n"
+      "R1 C1\n"
+      "Ra C1\n"
+      "R1a,W1a C1\n"
+      "R99999999999999999999a\n"
+      "W2b C2");
+  EXPECT_EQ(output.histories, (std::vector<std::string>{"R0a C0 ", "W0a C0 "}));
+  EXPECT_EQ(output.error_positions,
+            (std::vector<std::pair<uint64_t, uint64_t>>{{3, 1}, {4, 3}, {5, 2}, {6, 4}, {7, 21}}));
+}
+
+TEST(TextParserTest, TrailingWhitespace) {
+  const ParseOutput output = ParseText("R1a W2a C2 C1  \nW1b C1\t \r\n");
+  EXPECT_TRUE(output.error_positions.empty());
+  EXPECT_EQ(output.histories, (std::vector<std::string>{"R0a W1a C1 C0 ", "W0a C0 "}));
+
+  testing::internal::CaptureStdout();
+  testing::internal::CaptureStderr();
+  std::istringstream is("R1a W2a C2 C1  \nW1b C1\t \r\nR1A C1\nR1a W2a C1 C2\n");
+  for (const std::string expected : {"R0a W1a C1 C0 ", "W0a C0 ", "", "R0a W1a C0 C1 "}) {
+    History history;
+    ASSERT_TRUE(is >> history);
+    std::ostringstream os;
+    os << history;
+    EXPECT_EQ(expected, os.str());
+  }
+  testing::internal::GetCapturedStderr();
+  EXPECT_EQ("Invalid history: 'R1A C1'\n", testing::internal::GetCapturedStdout());
+}
+
+TEST(TextParserTest, SplitAtLines) {
+  std::string text;
+  for (int i = 0; i < 100; ++i) {
+    text += "R" + std::to_string(i) + "a W" + std::to_string(i + 1) + "a C" + std::to_string(i) +
+            "\n";
+  }
+  text += "R1a";  // last line without newline
+  for (const uint64_t chunk_num : {1, 2, 3, 7, 64, 1000}) {
+    const std::vector<const char*> bounds =
+        TextHistoryParser::SplitAtLines(text.data(), text.data() + text.size(), chunk_num);
+    ASSERT_LE(bounds.size(), chunk_num + 1);
+    EXPECT_EQ(text.data(), bounds.front());
+    EXPECT_EQ(text.data() + text.size(), bounds.back());
+    uint64_t line_num = 0;
+    uint64_t history_num = 0;
+    for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+      EXPECT_TRUE(i == 0 || bounds[i][-1] == '\n');
+      line_num += TextHistoryParser().Parse(
+          bounds[i], bounds[i + 1], line_num + 1, [&history_num](History&&) { ++history_num; },
+          [](const HistoryParseError&) { FAIL(); });
+    }
+    EXPECT_EQ(101, line_num);
+    EXPECT_EQ(101, history_num);
+  }
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}